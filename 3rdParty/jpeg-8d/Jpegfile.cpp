@@ -107,10 +107,18 @@ JpegFile::~JpegFile()
 {
 }
 
-char * JpegFile::JpegFileToRGB(std::string fileName,
-							   unsigned int *width,
-							   unsigned int *height, std::string outFilestr,bool writeFile)
+//
+//	decodes infile, or the size bytes at data when infile is NULL.
+//	outfile gets the image as a bitmap when it is not NULL.
+//	the files are left open, the caller closes them.
+//
 
+static char * JpegToRGB(FILE *infile,
+						const char *data,
+						size_t size,
+						unsigned int *width,
+						unsigned int *height,
+						FILE *outfile)
 {
 
 	// basic code from IJG Jpeg Code v6 example.c
@@ -128,30 +136,12 @@ char * JpegFile::JpegFileToRGB(std::string fileName,
 	*/
 	struct my_error_mgr jerr;
 	/* More stuff */
-	FILE * infile=NULL;		/* source file */
-	FILE * outfile=NULL;	
 	JSAMPARRAY buffer;		/* Output row buffer */
 	int row_stride;		/* physical row width in output buffer */
-	char buf[250];
-	 djpeg_dest_ptr dest_mgr = NULL;
-	/* In this example we want to open the input file before doing anything else,
-	* so that the setjmp() error recovery below can assume the file is open.
-	* VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-	* requires it in order to read binary files.
-	*/
+	djpeg_dest_ptr dest_mgr = NULL;
+	const bool writeFile = (outfile != NULL);
+	char * volatile dataBuf = NULL;	/* read again after a longjmp */
 
-	if ((infile = fopen(fileName.c_str(), "rb")) == NULL) {
-		sprintf(buf, "JPEG :\nCan't open %s\n", fileName);
-		//AfxMessageBox(buf);
-		return NULL;
-	}
-	if (writeFile)
-	{
-		if ((outfile = fopen(outFilestr.c_str(), "wb")) == NULL) {
-		  fprintf(stderr, "%s: can't open %s\n", outFilestr);
-		   return NULL;
-		}
-	}
 	/* Step 1: allocate and initialize JPEG decompression object */
 
 	/* We set up the normal JPEG error routines, then override error_exit. */
@@ -162,13 +152,11 @@ char * JpegFile::JpegFileToRGB(std::string fileName,
 	/* Establish the setjmp return context for my_error_exit to use. */
 	if (setjmp(jerr.setjmp_buffer)) {
 		/* If we get here, the JPEG code has signaled an error.
-		 * We need to clean up the JPEG object, close the input file, and return.
+		 * We need to clean up the JPEG object and return.
 		 */
 
 		jpeg_destroy_decompress(&cinfo);
-
-		if (infile!=NULL)
-			fclose(infile);
+		delete [] dataBuf;
 		return NULL;
 	}
 
@@ -177,7 +165,10 @@ char * JpegFile::JpegFileToRGB(std::string fileName,
 
 	/* Step 2: specify data source (eg, a file) */
 
-	jpeg_stdio_src(&cinfo, infile);
+	if (infile != NULL)
+		jpeg_stdio_src(&cinfo, infile);
+	else
+		jpeg_mem_src(&cinfo, (unsigned char *)data, (unsigned long)size);
 
 	/* Step 3: read file parameters with jpeg_read_header() */
 
@@ -212,9 +203,6 @@ char * JpegFile::JpegFileToRGB(std::string fileName,
 	* In this example, we need to make an output work buffer of the right size.
 	*/ 
 
-	// get our buffer set to hold data
-	char *dataBuf;
-
 	////////////////////////////////////////////////////////////
 	// alloc and open our new buffer
 	dataBuf=(char *)new char[cinfo.output_width * 3 * cinfo.output_height];
@@ -223,8 +211,6 @@ char * JpegFile::JpegFileToRGB(std::string fileName,
 		//AfxMessageBox("JpegFile :\nOut of memory",MB_ICONSTOP);
 
 		jpeg_destroy_decompress(&cinfo);
-		
-		fclose(infile);
 
 		return NULL;
 	}
@@ -286,7 +272,8 @@ char * JpegFile::JpegFileToRGB(std::string fileName,
 	}
 
 	/* Step 7: Finish decompression */
-	 (*dest_mgr->finish_output) (&cinfo, dest_mgr);
+	if (writeFile)
+		(*dest_mgr->finish_output) (&cinfo, dest_mgr);
 	(void) jpeg_finish_decompress(&cinfo);
 	/* We can ignore the return value since suspension is not possible
 	* with the stdio data source.
@@ -297,6 +284,46 @@ char * JpegFile::JpegFileToRGB(std::string fileName,
 	/* This is an important step since it will release a good deal of memory. */
 	jpeg_destroy_decompress(&cinfo);
 
+	/* At this point you may want to check to see whether any corrupt-data
+	* warnings occurred (test whether jerr.pub.num_warnings is nonzero).
+	*/
+
+	return dataBuf;
+}
+
+char * JpegFile::JpegFileToRGB(std::string fileName,
+							   unsigned int *width,
+							   unsigned int *height, std::string outFilestr,bool writeFile)
+
+{
+	*width=0;
+	*height=0;
+
+	FILE * infile=NULL;		/* source file */
+	FILE * outfile=NULL;	
+	char buf[250];
+
+	/* In this example we want to open the input file before doing anything else,
+	* so that the setjmp() error recovery below can assume the file is open.
+	* VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
+	* requires it in order to read binary files.
+	*/
+
+	if ((infile = fopen(fileName.c_str(), "rb")) == NULL) {
+		sprintf(buf, "JPEG :\nCan't open %s\n", fileName);
+		//AfxMessageBox(buf);
+		return NULL;
+	}
+	if (writeFile)
+	{
+		if ((outfile = fopen(outFilestr.c_str(), "wb")) == NULL) {
+		  fprintf(stderr, "%s: can't open %s\n", outFilestr);
+		  fclose(infile);
+		   return NULL;
+		}
+	}
+	char *dataBuf = JpegToRGB(infile, NULL, 0, width, height, outfile);
+
 	/* After finish_decompress, we can close the input file.
 	* Here we postpone it until after no more JPEG errors are possible,
 	* so as to simplify the setjmp error logic above.  (Actually, I don't
@@ -305,9 +332,31 @@ char * JpegFile::JpegFileToRGB(std::string fileName,
 	fclose(infile);
 	if (writeFile)
 		fclose(outfile);
-	/* At this point you may want to check to see whether any corrupt-data
-	* warnings occurred (test whether jerr.pub.num_warnings is nonzero).
-	*/
+
+	return dataBuf;
+}
+
+char * JpegFile::JpegBufferToRGB(const char *data,
+								 size_t size,
+								 unsigned int *width,
+								 unsigned int *height, std::string outFilestr,bool writeFile)
+
+{
+	*width=0;
+	*height=0;
+
+	if (data == NULL || size == 0)
+		return NULL;
+
+	FILE * outfile=NULL;
+	if (writeFile)
+	{
+		if ((outfile = fopen(outFilestr.c_str(), "wb")) == NULL)
+		   return NULL;
+	}
+	char *dataBuf = JpegToRGB(NULL, data, size, width, height, outfile);
+	if (writeFile)
+		fclose(outfile);
 
 	return dataBuf;
 }
@@ -159,6 +159,18 @@ public:
 							   std::string outFileName = std::string(""),
 							   bool writeOutput = false);				// image height
 
+	////////////////////////////////////////////////////////////////
+	// same as JpegFileToRGB, for a JPEG that is already in memory
+	// (an item of a mapped zip, ...). data is only read while the
+	// call runs.
+
+	static char * JpegBufferToRGB(const char *data,				// JPEG bytes
+							   size_t size,
+							   unsigned int *width,					// image width in pixels
+							   unsigned int *height,				// image height
+							   std::string outFileName = std::string(""),
+							   bool writeOutput = false);
+
 	////////////////////////////////////////////////////////////////
 	// write a JPEG file from a 3-component, 1-byte per component buffer
 
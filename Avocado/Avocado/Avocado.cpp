@@ -1590,7 +1590,21 @@ BOOL CAvocadoApp::OnIdle(LONG lCount)
 		m_pendingViews.clear ();
 	}
 #endif
-	return CWinAppEx::OnIdle(lCount);
+	BOOL more = CWinAppEx::OnIdle(lCount);
+
+	// A binary document opens with its elements pending, create them a batch at a time while the app is idle.
+	CFrameWndEx *mainFrame = (CFrameWndEx*)GetMainWnd();
+	if (mainFrame)
+	{
+		CDocument* cdoc = mainFrame->GetActiveDocument ();
+		if (cdoc && cdoc->IsKindOf (RUNTIME_CLASS (CAvocadoDoc)))
+		{
+			CAvocadoDoc *cad = (CAvocadoDoc*)cdoc;
+			if (cad->AvocadoInvokeDocW (_T("LoadPendingElements"),cad->GetAvoID (),_T("")))
+				more = TRUE;
+		}
+	}
+	return more;
 }
 
 
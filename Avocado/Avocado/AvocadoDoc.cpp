@@ -176,6 +176,26 @@ IMPLEMENT_OLECREATE_SINGLE(CAvocadoDoc, "avocado.document",
 			statusString = "Finished downloading "+ std::string (name);
 			break;
 
+		case IMPORT_STARTED :
+			statusString = "Started importing " + std::string (name);
+			break;
+
+		case IMPORT_PROGRESS :
+			statusString = "Importing " + std::string (name);
+			break;
+
+		case IMPORT_COMPLETE :
+			statusString = "Finished importing " + std::string (name);
+			break;
+
+		case IMPORT_CANCELLED :
+			statusString = "Import of " + std::string (name) + " cancelled";
+			break;
+
+		case IMPORT_FAILED :
+			statusString = "Could not import " + std::string (name);
+			break;
+
 		default:
 			break;
 		};
@@ -1004,6 +1024,53 @@ IMPLEMENT_OLECREATE_SINGLE(CAvocadoDoc, "avocado.document",
 	}
 	// CAvocadoDoc serialization
 
+#ifndef SHARED_HANDLERS
+	// Writes the engine document pieces to the archive. A text document is converted the same way the whole string used to be,
+	// a binary one (it starts with its magic in the first piece) goes out byte for byte.
+	class CAvocadoArchiveDocSink : public avocado::AvocadoDocSink
+	{
+	public:
+		CAvocadoArchiveDocSink (CArchive &ar) : m_ar (ar), m_started (false), m_binary (false) {}
+		virtual bool Write (const char *data, size_t size)
+		{
+			if (!m_started)
+			{
+				m_binary = avocado::IsBinaryDocument (data,size);
+				m_started = true;
+			}
+			if (m_binary)
+			{
+				m_ar.Write (data,UINT (size));
+				return true;
+			}
+			m_chunk.assign (data,size);
+			CA2CT ctChunk (m_chunk.c_str());
+			m_ar.WriteString(ctChunk);
+			return true;
+		}
+		virtual bool IsBinarySafe () const { return true; }
+	private:
+		CArchive &m_ar;
+		std::string m_chunk;
+		bool m_started;
+		bool m_binary;
+	};
+
+	// Peeks at the file behind a loading archive before anything was read through it.
+	static bool IsBinaryArchive (CArchive &ar)
+	{
+		CFile *file = ar.GetFile ();
+		if (!file)
+			return false;
+		const ULONGLONG start = file->GetPosition ();
+		char magic[16];
+		UINT got = file->Read (magic,sizeof (magic));
+		file->Seek (start,CFile::begin);
+		return avocado::IsBinaryDocument (magic,got);
+	}
+#endif
+
+
 	void CAvocadoDoc::Serialize(CArchive& ar)
 	{
 		// construct a std::string using the LPCSTR input
@@ -1018,11 +1085,19 @@ IMPLEMENT_OLECREATE_SINGLE(CAvocadoDoc, "avocado.document",
 
 		if (ar.IsStoring())
 		{
-			string strBuf;
-			AvocadoSerializeDoc(m_id,strBuf,false,true);
-			CA2CT ctStrBuf (strBuf.c_str());
-			ar.WriteString(ctStrBuf);
-
+			// streamed, the engine never holds the whole document text.
+			CAvocadoArchiveDocSink sink (ar);
+			avocado::OnStoreDoc(m_id,&sink);
+		}
+		else if (IsBinaryArchive (ar))
+		{
+			// binary documents go to the engine as they are, it reads them through their toc.
+			CFile *file = ar.GetFile ();
+			string docBytes;
+			docBytes.resize (size_t (file->GetLength () - file->GetPosition ()));
+			if (!docBytes.empty ())
+				docBytes.resize (ar.Read (&docBytes[0],UINT (docBytes.size ())));
+			AvocadoSerializeDoc(m_id,docBytes,false,false);
 		}
 		else
 		{
@@ -1438,6 +1513,24 @@ IMPLEMENT_OLECREATE_SINGLE(CAvocadoDoc, "avocado.document",
 
 		newLocation.SetString ( lpszPathName );
 
+		// the recovery autosave is written on the engine autosave thread, the user is not kept waiting for it.
+		if (m_isAutoSaving)
+		{
+			char autoSavePath[MAX_PATH];
+			::wcstombs (autoSavePath,lpszPathName,MAX_PATH);
+#ifdef _ZIP_DOC
+			const bool started = AvocadoInvokeDoc ("AutoSaveZippedDocument",m_id,autoSavePath);
+#else
+			const bool started = AvocadoInvokeDoc ("AutoSaveDocument",m_id,autoSavePath);
+#endif
+			if (started)
+			{
+				m_isAutoSaving = false;
+				m_isSaving = false;
+				return TRUE;
+			}
+		}
+
 #ifdef _ZIP_DOC
 		//LPCTSTR tempFileName ;
 		wchar_t tempFileName [MAX_PATH];
@@ -1450,7 +1543,21 @@ IMPLEMENT_OLECREATE_SINGLE(CAvocadoDoc, "avocado.document",
 #endif
 		wchar_t newLocStr[MAX_PATH];
 		::wcscpy (newLocStr,newLocation.GetString ());
-		BOOL res = CDocument::OnSaveDocument(newLocStr);
+		// a save of the document itself appends what changed to it when it can, see the journaled_save option.
+		const bool journaled = !m_isAutoSaving && !m_isPublishing;
+		char newLocBuf[MAX_PATH];
+		::wcstombs (newLocBuf,newLocStr,MAX_PATH);
+		BOOL res = FALSE;
+		if (journaled && AvocadoInvokeDoc ("SaveDocumentJournal",m_id,newLocBuf))
+		{
+			SetModifiedFlag (FALSE);
+			res = TRUE;
+		}
+		else
+			res = CDocument::OnSaveDocument(newLocStr);
+		// the journal follows the last file written, an autosave or a publish copy is not the document file.
+		if (!journaled)
+			AvocadoInvokeDoc ("ResetDocumentJournal",m_id,"");
 #ifdef _CREATE_THUMBNAIL
 		CString thumbLocation = theApp.GetAppSessionTempFolder () + CString (L"\\avothumb.jpg");
 		char buf[2048];
@@ -1477,6 +1584,10 @@ IMPLEMENT_OLECREATE_SINGLE(CAvocadoDoc, "avocado.document",
 						// Lets search the session folder.
 						::PathStripPath (wmodelfilename);
 						CString wss = theApp.GetAppSessionTempFolder () + CString ("\\textures\\") + CString ( wmodelfilename );
+						char wssm [MAX_PATH];
+						::wcstombs (wssm,wss.GetString (),MAX_PATH);
+						// a texture of the opened package that was read in place is not on disk yet.
+						avocado::MaterializeDocFile (string (wssm));
 						if(0xffffffff == GetFileAttributes(wss.GetString ()))
 						{
 							//File not found ib temp sessioon folder , lets check the application folder
@@ -1519,6 +1630,9 @@ IMPLEMENT_OLECREATE_SINGLE(CAvocadoDoc, "avocado.document",
 					{
 						::PathStripPath (wmodelfilename);
 						CString wss = theApp.GetAppSessionTempFolder () + CString ("\\models\\") + CString ( wmodelfilename );
+						char wssm [MAX_PATH];
+						::wcstombs (wssm,wss.GetString (),MAX_PATH);
+						avocado::MaterializeDocFile (string (wssm));
 						if(0xffffffff == GetFileAttributes(wss.GetString ()))
 						{
 							//File not found
@@ -1617,7 +1731,9 @@ IMPLEMENT_OLECREATE_SINGLE(CAvocadoDoc, "avocado.document",
 		::wcstombs (outpath, lpszPathName ,2048);
 		// clear html files duplicates images..
 
-
+		// a publish is packed small, a save fast. see the publish_compression_level option. after a journaled save
+		// the package gets the same entry appended to its Main.avc instead, it is not zipped again.
+		AvocadoInvokeDoc ("SetPackageCompression",m_id,m_isPublishing ? "publish" : "");
 		avocado::DoCompressDoc (m_id,std::string (inpath),std::string (outpath),htmlFiles,modelFiles,textureFiles,false);
 #endif
 
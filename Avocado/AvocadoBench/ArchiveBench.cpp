@@ -0,0 +1,227 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoArchive.h"
+#include "../AvocadoEngine/unzip.h"
+#include "../AvocadoEngine/zip.h"
+#include <sstream>
+#include <vector>
+#include <cstring>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* One item of the bench package, name as CompressFile adds it. */
+	struct ArchiveBenchItem
+	{
+		std::string		name;
+		std::string		bytes;
+	};
+
+	static std::string MakeArchiveBenchBytes (size_t size, unsigned int seed, bool compressible)
+	{
+		if (!compressible)
+			return MakeBenchNoise (size, seed);
+		std::string bytes (size, '\0');
+		for (size_t i=0;i<size;i++)
+			bytes[i] = char ('a' + (i / 7 + (BenchRandom (seed) >> 28)) % 16);
+		return bytes;
+	}
+
+	static bool CreateArchiveBenchPackage (const std::string &path, const std::vector<ArchiveBenchItem> &items)
+	{
+		HZIP hz = CreateZip (BenchName (path).c_str (), 0);
+		if (!hz)
+			return false;
+		bool ok = true;
+		for (size_t i=0;i<items.size () && ok;i++)
+		{
+			std::string copy = items[i].bytes;
+			ok = ZipAdd (hz, BenchName (items[i].name).c_str (), (void*)copy.data (), (unsigned int)copy.size ()) == ZR_OK;
+		}
+		return CloseZip (hz) == ZR_OK && ok;
+	}
+
+	/* What opening a document did before : every item of the package unzipped under the session folder. */
+	static bool ExtractArchiveBenchPackage (const std::string &path, const std::string &folder)
+	{
+		HZIP hz = OpenZip (BenchName (path).c_str (), 0);
+		if (!hz)
+			return false;
+		ZIPENTRY ze;
+		bool ok = GetZipItem (hz, -1, &ze) == ZR_OK;
+		const int count = ze.index;
+		for (int i=0;i<count && ok;i++)
+		{
+			ok = GetZipItem (hz, i, &ze) == ZR_OK;
+			std::string name;
+			for (const TCHAR *c=ze.name;ok && *c;c++)
+				name += (*c == '/' ? '\\' : char (*c));
+			ok = ok && UnzipItem (hz, i, BenchName (folder + name).c_str ()) == ZR_OK;
+		}
+		CloseZip (hz);
+		return ok;
+	}
+
+	/* What it does now : Main.avc and the view images are extracted, the package is mounted on the session folder
+	   and the document reads the textures it shows, the one model it imports is written out for the SceniX loader. */
+	static AvocadoArchiveSharedPtr OpenArchiveBenchPackage (const std::string &path, const std::string &folder, const std::vector<ArchiveBenchItem> &items, bool &ok)
+	{
+		AvocadoArchiveSharedPtr package (new AvocadoArchive);
+		ok = package->Open (path);
+		for (size_t i=0;i<package->GetEntryCount () && ok;i++)
+		{
+			const AvocadoArchiveEntry &entry = package->GetEntry (i);
+			if (entry.name == "Main.avc" || (entry.name.find (".bmp") != std::string::npos && entry.name.find ('/') == std::string::npos))
+				ok = package->Extract (entry, folder + entry.name);
+		}
+		if (!ok)
+			return package;
+		AvocadoVirtualFiles::Get ().Mount (folder, package);
+		for (size_t i=0;i<items.size () && ok;i++)
+		{
+			if (items[i].name.find ("textures\\") == 0)
+			{
+				AvocadoArchiveData data;
+				ok = AvocadoVirtualFiles::Get ().Read (folder + items[i].name, data) && data.size == items[i].bytes.size ();
+			}
+		}
+		ok = ok && AvocadoVirtualFiles::Get ().Materialize (folder + "models\\wheel.nbf");
+		return package;
+	}
+
+	/* In place reads have to give the packaged bytes, stored items without a copy, and the files on disk win. */
+	static bool ArchiveBenchReadsMatch (const std::string &folder, const std::vector<ArchiveBenchItem> &items)
+	{
+		bool ok = true;
+		for (size_t i=0;i<items.size () && ok;i++)
+		{
+			AvocadoArchiveData data;
+			ok = AvocadoVirtualFiles::Get ().Read (folder + items[i].name, data) && data.size == items[i].bytes.size ()
+				&& memcmp (data.data, items[i].bytes.data (), data.size) == 0;
+			if (ok && items[i].name == "textures\\decals.zip")
+				ok = !data.buffer && data.archive;	// stored, points into the mapping
+		}
+		std::vector<std::string> searchPaths;
+		searchPaths.push_back (folder + "models");
+		searchPaths.push_back (folder + "textures\\");
+		std::string found;
+		ok = ok && AvocadoVirtualFiles::Get ().FindFile ("C:\\elsewhere\\Steel.DDS", searchPaths, found) && found == folder + "textures\\Steel.DDS";
+		ok = ok && !AvocadoVirtualFiles::Get ().FindFile ("missing.dds", searchPaths, found);
+		ok = ok && AvocadoVirtualFiles::Get ().Materialize (folder + "models\\body.nbf") && ReadBenchFile (folder + "models\\body.nbf") == items[3].bytes;
+		return ok;
+	}
+
+	/* Opening a packaged document : everything unzipped to the session folder, against the archive mapped and read
+	   in place, with only the model the loader needs written out. */
+	int RunArchiveBench (int argc, char **argv)
+	{
+		int res = 0;
+		char tempDir[MAX_PATH];
+		if (!GetTempPathA (MAX_PATH, tempDir))
+			strcpy (tempDir, ".\\");
+		const std::string dir (tempDir);
+		const size_t block = 1024 * 1024;
+
+		std::vector<ArchiveBenchItem> items;
+		struct { const char *name; size_t size; bool compressible; } sources[] = {
+			{ "Main.avc",				2 * block,			true },
+			{ "avothumb.jpg",			64 * 1024,			false },
+			{ "View1.bmp",				256 * 1024,			true },
+			{ "models\\body.nbf",		24 * block + 99,	true },
+			{ "models\\wheel.nbf",		4 * block,			true },
+			{ "models\\engine.nbf",		16 * block,			false },
+			{ "textures\\steel.dds",	2 * block,			true },
+			{ "textures\\paint.jpg",	512 * 1024,			false },
+			{ "textures\\decals.zip",	3 * block,			false },	// stored
+			{ "textures\\tiny.dds",		5,					true },
+		};
+		size_t totalBytes = 0;
+		for (size_t i=0;i<sizeof (sources) / sizeof (sources[0]);i++)
+		{
+			ArchiveBenchItem item;
+			item.name = sources[i].name;
+			item.bytes = MakeArchiveBenchBytes (sources[i].size, (unsigned int)i + 1, sources[i].compressible);
+			totalBytes += item.bytes.size ();
+			items.push_back (item);
+		}
+		const std::string packagePath = dir + "AvocadoBenchArchive.avc";
+		if (!CreateArchiveBenchPackage (packagePath, items))
+		{
+			std::cout << "archive | could not write " << packagePath << std::endl;
+			return 1;
+		}
+
+		const int rounds = 3;
+		const std::string extractFolder = dir + "AvocadoBenchArchiveX\\";
+		const std::string mountFolder = dir + "AvocadoBenchArchiveM\\";
+		CreateDirectoryA (extractFolder.c_str (), NULL);
+		CreateDirectoryA (mountFolder.c_str (), NULL);
+		CreateDirectoryA ((mountFolder + "models").c_str (), NULL);
+		double extractMs = 0.0;
+		double mappedMs = 0.0;
+		for (int r=0;r<rounds && res == 0;r++)
+		{
+			BenchTimer timer;
+			if (!ExtractArchiveBenchPackage (packagePath, extractFolder))
+			{
+				std::cout << "archive | unzip failed" << std::endl;
+				res = 1;
+			}
+			extractMs += timer.ElapsedMs ();
+
+			DeleteFileA ((mountFolder + "models\\wheel.nbf").c_str ());
+			timer.Restart ();
+			bool ok = false;
+			AvocadoArchiveSharedPtr package = OpenArchiveBenchPackage (packagePath, mountFolder, items, ok);
+			mappedMs += timer.ElapsedMs ();
+			if (!ok)
+			{
+				std::cout << "archive | in place open failed" << std::endl;
+				res = 1;
+			}
+			if (r == 0 && res == 0 && !ArchiveBenchReadsMatch (mountFolder, items))
+			{
+				std::cout << "archive | in place reads do not match the packaged files" << std::endl;
+				res = 1;
+			}
+			AvocadoVirtualFiles::Get ().Unmount (package);
+			if (AvocadoVirtualFiles::Get ().Exists (mountFolder + "textures\\steel.dds"))
+			{
+				std::cout << "archive | unmounted package still found" << std::endl;
+				res = 1;
+			}
+		}
+
+		for (size_t i=0;i<items.size () && res == 0;i++)
+			if (ReadBenchFile (extractFolder + items[i].name) != items[i].bytes)
+			{
+				std::cout << "archive | unzipped " << items[i].name << " does not match" << std::endl;
+				res = 1;
+			}
+		if (res == 0 && (ReadBenchFile (mountFolder + "Main.avc") != items[0].bytes || ReadBenchFile (mountFolder + "models\\wheel.nbf") != items[4].bytes))
+		{
+			std::cout << "archive | extracted files do not match" << std::endl;
+			res = 1;
+		}
+
+		std::stringstream caseName;
+		caseName << totalBytes / block << " MB package, open and first use";
+		ReportResult ("archive", caseName.str (), rounds, extractMs, mappedMs);
+
+		for (size_t i=0;i<items.size ();i++)
+		{
+			DeleteFileA ((extractFolder + items[i].name).c_str ());
+			DeleteFileA ((mountFolder + items[i].name).c_str ());
+		}
+		RemoveDirectoryA ((extractFolder + "models").c_str ());
+		RemoveDirectoryA ((extractFolder + "textures").c_str ());
+		RemoveDirectoryA (extractFolder.c_str ());
+		RemoveDirectoryA ((mountFolder + "models").c_str ());
+		RemoveDirectoryA (mountFolder.c_str ());
+		DeleteFileA (packagePath.c_str ());
+		return res;
+	}
+}
@@ -0,0 +1,214 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoParams.h"
+#include "../AvocadoEngine/AvocadoDocStream.h"
+#include "../AvocadoEngine/AvocadoAutoSave.h"
+#include <sstream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	static const int s_autoSaveElements = 20000;
+
+	/* What the engine keeps per element that the autosave cares about. */
+	struct AutoSaveBenchElement
+	{
+		int				id;
+		bool			alive;
+		unsigned int	revision;
+		float			location[16];
+	};
+
+	static ParamListSharedPtr MakeAutoSaveParams (const AutoSaveBenchElement &e)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		pl->PushString ("OwnerModule", "ImportModule");
+		pl->PushInt ("elementID", e.id);
+		pl->PushString ("elementName", "Engine Block, rev 3");
+		pl->PushString ("fileName", "C:\\Models\\Engine Block, rev 3;final.nbf");
+		pl->PushBool ("isGroup", false);
+		pl->PushBool ("isRef", false);
+		pl->PushBool ("Visibility", true);
+		pl->PushInt ("MaterialID", int (e.revision % 97));
+		pl->PushString ("materialData", "name=steel;ambient=0.2;diffuse=0.8;baseColor=0.5,0.5,0.5;specular=0.4;shininess=30;polished=1");
+		pl->PushFloat16 ("Location", e.location);
+		return pl;
+	}
+
+	static ParamListSharedPtr MakeAutoSaveHeader (const std::vector<AutoSaveBenchElement> &elements)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		vector <string> names, values;
+		names.push_back ("Author");
+		values.push_back ("bench");
+		pl->PushStringArray ("AvocadoDocParamNames", names);
+		pl->PushStringArray ("AvocadoDocParamValues", values);
+		pl->PushInt ("ViewStateCount", 0);
+		pl->PushInt ("LastIDCount", int (elements.size ()) + 1);
+		return pl;
+	}
+
+	/* What AvocadoEngineDoc::AutoSaveDocument does on the engine thread. */
+	static void TakeAutoSaveSnapshot (AvocadoAutoSave &autoSave, const std::vector<AutoSaveBenchElement> &elements, AvocadoDocSnapshot &snapshot)
+	{
+		snapshot.docParams = MakeAutoSaveHeader (elements);
+		snapshot.elements.clear ();
+		for (size_t i=0;i<elements.size ();i++)
+		{
+			const AutoSaveBenchElement &e = elements[i];
+			if (!e.alive)
+				continue;
+			AvocadoSnapshotBlockPtr block = autoSave.FindBlock (e.id, e.revision, e.location);
+			if (!block)
+				block = AvocadoAutoSave::NewBlock (e.id, e.revision, e.location, MakeAutoSaveParams (e));
+			snapshot.elements.push_back (block);
+		}
+	}
+
+	/* The blocking save autosave used to be, everything on the calling thread. */
+	static bool SaveAutoSaveDocument (AvocadoDocSink &sink, const std::vector<AutoSaveBenchElement> &elements)
+	{
+		AvocadoDocWriter writer (sink, true);
+		writer.Begin (*MakeAutoSaveHeader (elements));
+		for (size_t i=0;i<elements.size () && writer.IsGood ();i++)
+		{
+			if (!elements[i].alive)
+				continue;
+			ParamListSharedPtr pl = MakeAutoSaveParams (elements[i]);
+			AvocadoDocTocEntry entry;
+			ReadElementTocEntry (*pl, entry);
+			writer.WriteElement (pl->SerializeList (), &entry);
+		}
+		return writer.End ();
+	}
+
+	/* What the user does while the autosave runs : edits, moves and deletes. */
+	static void MutateAutoSaveElement (std::vector<AutoSaveBenchElement> &elements, unsigned int &seed)
+	{
+		BenchRandom (seed);
+		AutoSaveBenchElement &e = elements[(seed >> 8) % elements.size ()];
+		switch ((seed >> 4) % 8)
+		{
+		case 0:
+			e.alive = false;
+			break;
+		case 1:
+		case 2:
+		case 3:
+			e.location[12] += 1.0f;
+			break;
+		default:
+			e.revision++;
+			// the engine builds lists for the views while it works, they share the param atoms with the autosave thread.
+			MakeAutoSaveParams (e)->SerializeList ();
+			break;
+		}
+	}
+
+	/* Time the engine thread is held by an autosave, the whole blocking save against taking a snapshot. Then a stress
+	   run : elements change all the time an autosave runs, every file written must be the document as it was when
+	   its snapshot was taken, byte for byte. */
+	int RunAutoSaveBench (int argc, char **argv)
+	{
+		int res = 0;
+		char tempDir[MAX_PATH];
+		if (!GetTempPathA (MAX_PATH, tempDir))
+			strcpy (tempDir, ".\\");
+		const std::string path = std::string (tempDir) + "AvocadoBenchAutoSave.avc";
+
+		std::vector<AutoSaveBenchElement> elements (s_autoSaveElements);
+		for (int i=0;i<s_autoSaveElements;i++)
+		{
+			elements[i].id = i;
+			elements[i].alive = true;
+			elements[i].revision = 0;
+			for (int k=0;k<16;k++)
+				elements[i].location[k] = ((k % 5 == 0) ? 1.0f : 0.0f) + i * 0.001f;
+		}
+
+		BenchTimer timer;
+		{
+			AvocadoFileDocSink file (path);
+			if (!SaveAutoSaveDocument (file, elements) || !file.Close ())
+				std::cout << "autosave | blocking save failed" << std::endl;
+		}
+		const double blockingMs = timer.ElapsedMs ();
+
+		AvocadoAutoSave autoSave;
+		AvocadoDocSnapshot snapshot;
+		timer.Restart ();
+		TakeAutoSaveSnapshot (autoSave, elements, snapshot);
+		autoSave.Start (snapshot, path);
+		const double firstMs = timer.ElapsedMs ();
+		autoSave.Wait ();
+
+		// one percent changed since the last autosave, the rest is shared with it.
+		unsigned int seed = 1;
+		for (int m=0;m<s_autoSaveElements / 100;m++)
+			MutateAutoSaveElement (elements, seed);
+		timer.Restart ();
+		TakeAutoSaveSnapshot (autoSave, elements, snapshot);
+		autoSave.Start (snapshot, path);
+		const double nextMs = timer.ElapsedMs ();
+		autoSave.Wait ();
+
+		ReportResult ("autosave", "engine thread held, first autosave", s_autoSaveElements, blockingMs, firstMs);
+		ReportResult ("autosave", "engine thread held, 1% changed", s_autoSaveElements, blockingMs, nextMs);
+
+		const int rounds = 20;
+		size_t concurrentEdits = 0;
+		for (int r=0;r<rounds;r++)
+		{
+			for (int m=0;m<50;m++)
+				MutateAutoSaveElement (elements, seed);
+			const std::vector<AutoSaveBenchElement> expected = elements;
+			TakeAutoSaveSnapshot (autoSave, elements, snapshot);
+			if (!autoSave.Start (snapshot, path))
+			{
+				std::cout << "autosave | round " << r << " did not start" << std::endl;
+				res = 1;
+				break;
+			}
+			if (autoSave.Start (snapshot, path))
+			{
+				std::cout << "autosave | a second save started while one runs" << std::endl;
+				res = 1;
+			}
+			while (autoSave.IsRunning ())
+			{
+				MutateAutoSaveElement (elements, seed);
+				concurrentEdits++;
+			}
+			if (!autoSave.Wait ())
+			{
+				std::cout << "autosave | round " << r << " failed to write" << std::endl;
+				res = 1;
+				continue;
+			}
+			std::string reference;
+			AvocadoStringDocSink referenceSink (reference, true);
+			SaveAutoSaveDocument (referenceSink, expected);
+			if (ReadBenchFile (path) != reference)
+			{
+				std::cout << "autosave | round " << r << " file differs from its snapshot" << std::endl;
+				res = 1;
+			}
+		}
+		std::cout << "autosave | " << rounds << " autosaves | " << concurrentEdits << " edits made while they ran" << std::endl;
+
+		AvocadoDocReader reader;
+		if (!reader.Open (ReadBenchFile (path)))
+		{
+			std::cout << "autosave | the last autosave does not open" << std::endl;
+			res = 1;
+		}
+		DeleteFileA (path.c_str ());
+		return res;
+	}
+}
@@ -0,0 +1,161 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoArchive.h"
+#include "../AvocadoEngine/unzip.h"
+#include <nvsg/nvsg.h>
+#include <cstdio>
+#include <cstring>
+
+using namespace avocado;
+using namespace avocado_bench;
+
+namespace avocado_bench {
+
+	std::string MakeBenchNoise (size_t size, unsigned int seed)
+	{
+		std::string noise (size, '\0');
+		for (size_t i=0;i<size;i++)
+			noise[i] = char (BenchRandom (seed) >> 24);
+		return noise;
+	}
+
+	bool WriteBenchFile (const std::string &path, const std::string &bytes)
+	{
+		FILE *f = fopen (path.c_str (), "wb");
+		if (!f)
+			return false;
+		const bool ok = bytes.empty () || fwrite (bytes.data (), 1, bytes.size (), f) == bytes.size ();
+		return fclose (f) == 0 && ok;
+	}
+
+	std::string ReadBenchFile (const std::string &path)
+	{
+		std::string bytes;
+		FILE *f = fopen (path.c_str (), "rb");
+		if (!f)
+			return bytes;
+		char buf[65536];
+		size_t n;
+		while ((n = fread (buf, 1, sizeof (buf), f)) > 0)
+			bytes.append (buf, n);
+		fclose (f);
+		return bytes;
+	}
+
+	long BenchFileSize (const std::string &path)
+	{
+		FILE *f = fopen (path.c_str (), "rb");
+		if (!f)
+			return -1;
+		fseek (f, 0, SEEK_END);
+		const long size = ftell (f);
+		fclose (f);
+		return size;
+	}
+
+	bool BenchPackageMatches (const std::string &path, const std::vector<BenchPackageItem> &items, size_t *stored)
+	{
+		if (stored)
+			*stored = 0;
+		{
+			AvocadoArchive archive;
+			if (!archive.Open (path) || archive.GetEntryCount () != items.size ())
+				return false;
+			for (size_t i=0;i<items.size ();i++)
+			{
+				const std::string &bytes = *items[i].bytes;
+				const AvocadoArchiveEntry *entry = archive.Find (items[i].name);
+				AvocadoArchiveData data;
+				if (!entry || !archive.Read (*entry, data) || data.size != bytes.size () || (data.size && memcmp (data.data, bytes.data (), data.size) != 0) ||
+					UnzipCrc32 (0, bytes.data (), (unsigned int)bytes.size ()) != entry->crc)
+					return false;
+				if (stored && entry->method == 0)
+					(*stored)++;
+			}
+		}
+		HZIP hz = OpenZip (BenchName (path).c_str (), 0);
+		if (!hz)
+			return false;
+		bool ok = true;
+		ZIPENTRY ze;
+		if (GetZipItem (hz, -1, &ze) != ZR_OK || ze.index != int (items.size ()))
+			ok = false;
+		for (size_t i=0;i<items.size () && ok;i++)
+		{
+			const std::string &bytes = *items[i].bytes;
+			BenchString zipName = BenchName (items[i].name);
+			for (size_t k=0;k<zipName.size ();k++)
+				if (zipName[k] == '\\')
+					zipName[k] = '/';
+			int index = -1;
+			ok = FindZipItem (hz, zipName.c_str (), false, &index, &ze) == ZR_OK && index >= 0 && ze.unc_size == long (bytes.size ());
+			if (!ok || bytes.empty ())
+				continue;	// the unzip has nothing to inflate there and says so, the size is all there is to check
+			std::vector<char> out (bytes.size () + 1);
+			ok = UnzipItem (hz, index, &out[0], (unsigned int)out.size ()) == ZR_OK && memcmp (&out[0], bytes.data (), bytes.size ()) == 0;
+		}
+		CloseZip (hz);
+		return ok;
+	}
+}
+
+struct BenchEntry
+{
+	const char *name;
+	int (*run) (int argc, char **argv);
+};
+
+static const BenchEntry s_benches[] = {
+	{ "params", RunParamsBench },
+	{ "params_lookup", RunParamsLookupBench },
+	{ "params_arrays", RunParamsArrayBench },
+	{ "params_binary", RunParamsBinaryBench },
+	{ "dispatch", RunDispatchBench },
+	{ "stats", RunStatsBench },
+	{ "doc_writer", RunDocWriterBench },
+	{ "parallel_doc", RunParallelDocBench },
+	{ "doc_format", RunDocFormatBench },
+	{ "doc_journal", RunDocJournalBench },
+	{ "autosave", RunAutoSaveBench },
+	{ "zip", RunZipBench },
+	{ "archive", RunArchiveBench },
+	{ "dedup", RunDedupBench },
+	{ "compression", RunCompressionBench },
+	{ "import", RunImportBench },
+	{ "scene_cache", RunSceneCacheBench },
+	{ "element_index", RunElementIndexBench },
+	{ "scene_query", RunSceneQueryBench },
+	{ "geometry_pool", RunGeometryPoolBench },
+	{ "fixed_allocator", RunFixedAllocatorBench },
+	{ "small_object_pool", RunSmallObjectPoolBench }
+};
+
+int main (int argc, char **argv)
+{
+	const size_t benchCount = sizeof (s_benches) / sizeof (s_benches[0]);
+	const char *which = argc > 1 ? argv[1] : "all";
+	int res = 0;
+	bool found = false;
+	// the scene benches build SceniX scenes, the parallel query reads them from the worker pool.
+	nvsg::nvsgInitialize (NVSG_MULTITHREADED);
+	for (size_t i=0;i<benchCount;i++)
+	{
+		if (strcmp (which, "all") == 0 || strcmp (which, s_benches[i].name) == 0)
+		{
+			found = true;
+			res |= s_benches[i].run (argc, argv);
+		}
+	}
+	nvsg::nvsgTerminate ();
+	if (!found)
+	{
+		std::cout << "usage : AvocadoBench [all";
+		for (size_t i=0;i<benchCount;i++)
+			std::cout << "|" << s_benches[i].name;
+		std::cout << "]" << std::endl;
+		return 1;
+	}
+	return res;
+}
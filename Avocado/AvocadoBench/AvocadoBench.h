@@ -0,0 +1,115 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include <windows.h>
+#include <tchar.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+/* Micro benchmarks for the engine hot paths.
+   Every bench lives in its own file and is selected by name on the command line : AvocadoBench.exe params */
+namespace avocado_bench {
+
+	class BenchTimer
+	{
+	public:
+		BenchTimer ()
+		{
+			QueryPerformanceFrequency (&m_freq);
+			Restart ();
+		}
+		void Restart ()
+		{
+			QueryPerformanceCounter (&m_start);
+		}
+		double ElapsedMs () const
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter (&now);
+			return double (now.QuadPart - m_start.QuadPart) * 1000.0 / double (m_freq.QuadPart);
+		}
+	private:
+		LARGE_INTEGER m_freq;
+		LARGE_INTEGER m_start;
+	};
+
+	inline void ReportResult (const std::string &bench, const std::string &caseName, size_t iterations, double baselineMs, double newMs)
+	{
+		std::cout << bench << " | " << caseName << " | iterations " << iterations
+			<< " | before " << baselineMs << " ms | after " << newMs << " ms | speedup x"
+			<< (newMs > 0.0 ? baselineMs / newMs : 0.0) << std::endl;
+	}
+
+	/* The threaded benches print the cores they ran on : on one core their threads only check the output, the
+	   speed ups have to be measured on a multi core machine. */
+	inline unsigned int ReportCores (const std::string &bench)
+	{
+		SYSTEM_INFO si;
+		GetSystemInfo (&si);
+		const unsigned int cores = si.dwNumberOfProcessors;
+		std::cout << bench << " | " << cores << (cores == 1 ? " core : the threads only check the output, no speed up to read here" : " cores") << std::endl;
+		return cores;
+	}
+
+	/* The fixture of the file and package benches. */
+	typedef std::basic_string<TCHAR> BenchString;
+
+	inline BenchString BenchName (const std::string &s)
+	{
+		return BenchString (s.begin (), s.end ());
+	}
+
+	/* The generator every bench draws its data from, the same seed gives the same bytes on every run. */
+	inline unsigned int BenchRandom (unsigned int &seed)
+	{
+		seed = seed * 1103515245u + 12345u;
+		return seed;
+	}
+
+	/* Bytes that do not compress, like a jpeg or a dds. */
+	std::string MakeBenchNoise (size_t size, unsigned int seed);
+	bool WriteBenchFile (const std::string &path, const std::string &bytes);
+	/* empty when the file can not be opened. */
+	std::string ReadBenchFile (const std::string &path);
+	/* -1 when the file can not be opened. */
+	long BenchFileSize (const std::string &path);
+
+	/* A package item : its name in the package, \ or /, and the bytes it has to read back as. */
+	struct BenchPackageItem
+	{
+		BenchPackageItem (const std::string &itemName, const std::string &itemBytes) : name (itemName), bytes (&itemBytes) {}
+		std::string			name;
+		const std::string	*bytes;
+	};
+
+	/* The package holds these items and nothing else, each read back both ways the application reads it : in place
+	   by AvocadoArchive with the crc of the central directory checked, and by the unzip, which goes by the local
+	   headers. stored, when given, counts the items kept without compression. */
+	bool BenchPackageMatches (const std::string &path, const std::vector<BenchPackageItem> &items, size_t *stored = NULL);
+
+	/* returns 0 on success, non zero when the bench found a mismatch. */
+	int RunParamsBench (int argc, char **argv);
+	int RunParamsLookupBench (int argc, char **argv);
+	int RunParamsArrayBench (int argc, char **argv);
+	int RunParamsBinaryBench (int argc, char **argv);
+	int RunDispatchBench (int argc, char **argv);
+	int RunStatsBench (int argc, char **argv);
+	int RunDocWriterBench (int argc, char **argv);
+	int RunParallelDocBench (int argc, char **argv);
+	int RunDocFormatBench (int argc, char **argv);
+	int RunDocJournalBench (int argc, char **argv);
+	int RunAutoSaveBench (int argc, char **argv);
+	int RunZipBench (int argc, char **argv);
+	int RunArchiveBench (int argc, char **argv);
+	int RunDedupBench (int argc, char **argv);
+	int RunCompressionBench (int argc, char **argv);
+	int RunImportBench (int argc, char **argv);
+	int RunSceneCacheBench (int argc, char **argv);
+	int RunElementIndexBench (int argc, char **argv);
+	int RunSceneQueryBench (int argc, char **argv);
+	int RunGeometryPoolBench (int argc, char **argv);
+	int RunFixedAllocatorBench (int argc, char **argv);
+	int RunSmallObjectPoolBench (int argc, char **argv);
+}
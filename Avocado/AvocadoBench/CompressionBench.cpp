@@ -0,0 +1,204 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoArchive.h"
+#include "../AvocadoEngine/zip.h"
+#include <sstream>
+#include <vector>
+#include <cstring>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* A file of the document corpus : its package name, where it is read from and its bytes to check against. */
+	struct CompressionBenchItem
+	{
+		std::string		name;
+		std::string		path;
+		std::string		bytes;
+	};
+
+	/* A row of the matrix : how CompressFile sets the zip up, level -1 leaves it as CreateZip has it. */
+	struct CompressionBenchRow
+	{
+		const char		*name;
+		int				level;
+		bool			storeIncompressible;
+		unsigned int	threads;
+	};
+
+	/* Text like Main.avc, noise behind a jpeg header like avothumb.jpg, runs like a .hdr, vertex floats like a model
+	   and noise under a name that says nothing, which only the sample tells apart. */
+	static std::string MakeCompressionBenchBytes (size_t size, unsigned int seed, int kind)
+	{
+		static const unsigned char jpegHeader[] = { 0xff, 0xd8, 0xff, 0xe0, 0, 0x10, 'J', 'F', 'I', 'F', 0 };
+		std::string bytes (size, '\0');
+		for (size_t i=0;i<size;i++)
+		{
+			BenchRandom (seed);
+			switch (kind)
+			{
+			case 0:		bytes[i] = char ("<element name=\"part\" visible=\"1\" />\n"[i % 36] + ((seed >> 30) == 0 ? 1 : 0)); break;
+			case 1:
+			case 4:		bytes[i] = char (seed >> 24); break;
+			case 2:		bytes[i] = char ((i / 97) % 5 + ((seed >> 29) == 0 ? 8 : 0)); break;
+			case 3:		bytes[i] = (i % 4 == 3 || i % 4 == 2) ? char (0x3f + (i / 4096) % 2) : char (seed >> 24); break;
+			}
+		}
+		if (kind == 1 && size > sizeof (jpegHeader))
+			memcpy (&bytes[0], jpegHeader, sizeof (jpegHeader));
+		return bytes;
+	}
+
+	static bool CreateCompressionBenchPackage (const std::string &path, const std::vector<CompressionBenchItem> &items, const CompressionBenchRow &row)
+	{
+		HZIP hz = CreateZip (BenchName (path).c_str (), 0);
+		if (!hz)
+			return false;
+		bool ok = ZipSetParallel (hz, row.threads) == ZR_OK;
+		if (ok && row.level >= 0)
+			ok = ZipSetCompression (hz, row.level, row.storeIncompressible) == ZR_OK;
+		for (size_t i=0;i<items.size () && ok;i++)
+			ok = ZipAdd (hz, BenchName (items[i].name).c_str (), BenchName (items[i].path).c_str ()) == ZR_OK;
+		return CloseZip (hz) == ZR_OK && ok;
+	}
+
+	/* Saving a document package : save time against package size for the deflate levels, with and without storing
+	   what does not compress. The corpus is the files given after the bench name (an unpacked .avc, a textures
+	   folder), a synthetic document when there are none. */
+	int RunCompressionBench (int argc, char **argv)
+	{
+		int res = 0;
+		char tempDir[MAX_PATH];
+		if (!GetTempPathA (MAX_PATH, tempDir))
+			strcpy (tempDir, ".\\");
+		const std::string dir (tempDir);
+		const size_t block = 1024 * 1024;
+
+		std::vector<CompressionBenchItem> items;
+		bool synthetic = argc <= 2;
+		for (int a=2;a<argc;a++)
+		{
+			CompressionBenchItem item;
+			item.path = argv[a];
+			const size_t slash = item.path.find_last_of ("\\/");
+			std::stringstream name;
+			name << a - 2 << "_" << (slash == std::string::npos ? item.path : item.path.substr (slash + 1));
+			item.name = name.str ();
+			if (!AvocadoArchiveBlobs::ReadFile (item.path, item.bytes) || item.bytes.empty ())
+			{
+				std::cout << "compression | skipping " << item.path << std::endl;
+				continue;
+			}
+			items.push_back (item);
+		}
+		if (synthetic)
+		{
+			struct { const char *name; size_t size; int kind; } sources[] = {
+				{ "Main.avc",				4 * block,			0 },
+				{ "avothumb.jpg",			256 * 1024,			1 },
+				{ "View1.bmp",				512 * 1024,			2 },
+				{ "environment.hdr",		4 * block,			2 },
+				{ "models\\body.nbf",		8 * block,			3 },
+				{ "models\\wheel.nbf",		4 * block,			3 },
+				{ "textures\\paint.jpg",	2 * block,			1 },
+				{ "textures\\steel.dds",	4 * block,			2 },
+				{ "textures\\scan.raw",		3 * block,			4 },	// noise, the sample finds it
+			};
+			for (size_t i=0;i<sizeof (sources) / sizeof (sources[0]);i++)
+			{
+				CompressionBenchItem item;
+				item.name = sources[i].name;
+				item.bytes = MakeCompressionBenchBytes (sources[i].size, (unsigned int)i + 1, sources[i].kind);
+				std::string file (item.name);
+				for (size_t k=0;k<file.size ();k++)
+					if (file[k] == '\\')
+						file[k] = '_';
+				item.path = dir + "AvocadoBenchCompression_" + file;
+				if (!WriteBenchFile (item.path, item.bytes))
+				{
+					std::cout << "compression | could not write " << item.path << std::endl;
+					res = 1;
+				}
+				items.push_back (item);
+			}
+		}
+		size_t totalBytes = 0;
+		std::vector<BenchPackageItem> expected;
+		for (size_t i=0;i<items.size ();i++)
+		{
+			totalBytes += items[i].bytes.size ();
+			expected.push_back (BenchPackageItem (items[i].name, items[i].bytes));
+		}
+		if (items.empty ())
+		{
+			std::cout << "compression | no corpus" << std::endl;
+			return 1;
+		}
+
+		const CompressionBenchRow rows[] = {
+			{ "deflate 8, before",			-1,		false,	1 },
+			{ "store",						0,		false,	1 },
+			{ "deflate 1",					1,		false,	1 },
+			{ "deflate 1, store sniffed",	1,		true,	1 },
+			{ "deflate 3",					3,		false,	1 },
+			{ "deflate 3, store sniffed",	3,		true,	1 },	// save
+			{ "deflate 6, store sniffed",	6,		true,	1 },
+			{ "deflate 9",					9,		false,	1 },
+			{ "deflate 9, store sniffed",	9,		true,	1 },	// publish
+			{ "deflate 3, store sniffed, parallel",	3,	true,	0 },
+			{ "deflate 9, store sniffed, parallel",	9,	true,	0 },
+		};
+		const std::string packagePath = dir + "AvocadoBenchCompression.avc";
+		const int rounds = 2;
+		double baselineMs = 0.0;
+		long baselineSize = 0;
+		for (size_t r=0;r<sizeof (rows) / sizeof (rows[0]) && res == 0;r++)
+		{
+			double ms = 0.0;
+			for (int k=0;k<rounds && res == 0;k++)
+			{
+				DeleteFileA (packagePath.c_str ());
+				BenchTimer timer;
+				if (!CreateCompressionBenchPackage (packagePath, items, rows[r]))
+				{
+					std::cout << "compression | " << rows[r].name << " package failed" << std::endl;
+					res = 1;
+				}
+				ms += timer.ElapsedMs ();
+			}
+			// every item has to read back as its file, and what was stored is the incompressible part of the corpus.
+			size_t stored = 0;
+			if (res == 0 && !BenchPackageMatches (packagePath, expected, &stored))
+			{
+				std::cout << "compression | " << rows[r].name << " package does not read back as its files" << std::endl;
+				res = 1;
+			}
+			// the jpegs and the noise are stored when sniffing, nothing is when not.
+			if (res == 0 && synthetic && rows[r].level > 0 && stored != (rows[r].storeIncompressible ? 3u : 0u))
+			{
+				std::cout << "compression | " << rows[r].name << " stored " << stored << " items" << std::endl;
+				res = 1;
+			}
+			const long size = BenchFileSize (packagePath);
+			if (r == 0)
+			{
+				baselineMs = ms;
+				baselineSize = size;
+			}
+			std::stringstream caseName;
+			caseName << rows[r].name << ", " << totalBytes / block << " MB";
+			ReportResult ("compression", caseName.str (), rounds, baselineMs, ms);
+			std::cout << "compression | " << rows[r].name << " : " << size << " bytes (" << (baselineSize > 0 ? 100.0 * size / baselineSize : 0.0)
+				<< "% of before), " << stored << " of " << items.size () << " items stored" << std::endl;
+		}
+
+		if (synthetic)
+			for (size_t i=0;i<items.size ();i++)
+				DeleteFileA (items[i].path.c_str ());
+		DeleteFileA (packagePath.c_str ());
+		return res;
+	}
+}
@@ -0,0 +1,216 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoArchive.h"
+#include "../AvocadoEngine/zip.h"
+#include <sstream>
+#include <vector>
+#include <cstring>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* An embedded model or texture : its package name and the session file it comes from. */
+	struct DedupBenchAsset
+	{
+		std::string		name;
+		std::string		path;
+		std::string		bytes;
+	};
+
+	static std::string MakeDedupBenchBytes (size_t size, unsigned int seed)
+	{
+		std::string bytes (size, '\0');
+		for (size_t i=0;i<size;i++)
+		{
+			const unsigned int r = BenchRandom (seed);
+			bytes[i] = char ((i % 64 < 40) ? 'a' + (r >> 29) : (r >> 24));
+		}
+		return bytes;
+	}
+
+	/* CompressFile before : every path added under its name. */
+	static bool CreateDedupBenchPackage (const std::string &path, const std::vector<DedupBenchAsset> &assets)
+	{
+		HZIP hz = CreateZip (BenchName (path).c_str (), 0);
+		if (!hz)
+			return false;
+		bool ok = true;
+		for (size_t i=0;i<assets.size () && ok;i++)
+			ok = ZipAdd (hz, BenchName (assets[i].name).c_str (), BenchName (assets[i].path).c_str ()) == ZR_OK;
+		return CloseZip (hz) == ZR_OK && ok;
+	}
+
+	/* And now : the files hashed as they are read, the bytes of one already in only go to the manifest. */
+	static bool CreateDedupBenchBlobPackage (const std::string &path, const std::vector<DedupBenchAsset> &assets, size_t &stored)
+	{
+		HZIP hz = CreateZip (BenchName (path).c_str (), 0);
+		if (!hz)
+			return false;
+		AvocadoArchiveBlobs blobs;
+		bool ok = true;
+		stored = 0;
+		for (size_t i=0;i<assets.size () && ok;i++)
+		{
+			std::string bytes;
+			ok = AvocadoArchiveBlobs::ReadFile (assets[i].path, bytes);
+			if (ok && blobs.Add (assets[i].name, assets[i].path, bytes))
+			{
+				ok = ZipAdd (hz, BenchName (assets[i].name).c_str (), (void*)bytes.data (), (unsigned int)bytes.size ()) == ZR_OK;
+				stored++;
+			}
+		}
+		if (ok && blobs.HasAliases ())
+		{
+			const std::string manifest = blobs.GetManifest ();
+			ok = ZipAdd (hz, BenchName (AvocadoArchive::ManifestName ()).c_str (), (void*)manifest.data (), (unsigned int)manifest.size ()) == ZR_OK;
+		}
+		return CloseZip (hz) == ZR_OK && ok;
+	}
+
+	/* Every logical name has to read back as its own file, through the manifest for the aliases. */
+	static bool DedupBenchPackageMatches (const std::string &path, const std::vector<DedupBenchAsset> &assets, size_t stored, const std::string &dir)
+	{
+		AvocadoArchiveSharedPtr package (new AvocadoArchive);
+		if (!package->Open (path) || package->GetEntryCount () != stored + 1)
+			return false;
+		bool ok = true;
+		for (size_t i=0;i<assets.size () && ok;i++)
+		{
+			const AvocadoArchiveEntry *entry = package->Find (assets[i].name);
+			AvocadoArchiveData data;
+			ok = entry && package->Read (*entry, data) && data.size == assets[i].bytes.size ()
+				&& memcmp (data.data, assets[i].bytes.data (), data.size) == 0;
+		}
+		// an alias is written out with the bytes of its blob, as the loaders ask for it.
+		const std::string folder = dir + "AvocadoBenchDedupM\\";
+		const std::string alias = folder + assets[assets.size () - 1].name;
+		AvocadoVirtualFiles::Get ().Mount (folder, package);
+		std::string written;
+		ok = ok && AvocadoVirtualFiles::Get ().Materialize (alias) && AvocadoArchiveBlobs::ReadFile (alias, written)
+			&& written == assets[assets.size () - 1].bytes;
+		AvocadoVirtualFiles::Get ().Unmount (package);
+		DeleteFileA (alias.c_str ());
+		RemoveDirectoryA ((folder + "textures").c_str ());
+		RemoveDirectoryA (folder.c_str ());
+		return ok;
+	}
+
+	/* Saving a material heavy scene : textures copied into the session folder under several names, the same models
+	   imported twice. The package with every path added against the one with each content stored once. */
+	int RunDedupBench (int argc, char **argv)
+	{
+		int res = 0;
+		char tempDir[MAX_PATH];
+		if (!GetTempPathA (MAX_PATH, tempDir))
+			strcpy (tempDir, ".\\");
+		const std::string dir (tempDir);
+		const size_t block = 1024 * 1024;
+
+		const size_t distinctTextures = 8;
+		const size_t textureCopies = 6;
+		const size_t distinctModels = 3;
+		std::vector<DedupBenchAsset> assets;
+		for (size_t m=0;m<distinctModels * 2;m++)
+		{
+			DedupBenchAsset asset;
+			std::stringstream name;
+			name << "models\\part" << m << ".nbf";
+			asset.name = name.str ();
+			asset.bytes = MakeDedupBenchBytes (3 * block + m % distinctModels, (unsigned int)(m % distinctModels) + 100);
+			assets.push_back (asset);
+		}
+		for (size_t t=0;t<distinctTextures * textureCopies;t++)
+		{
+			DedupBenchAsset asset;
+			std::stringstream name;
+			name << "textures\\mat" << t << ".dds";
+			asset.name = name.str ();
+			asset.bytes = MakeDedupBenchBytes (512 * 1024, (unsigned int)(t % distinctTextures) + 1);
+			assets.push_back (asset);
+		}
+		// same size and hash bucket does not make a blob, only the same bytes.
+		DedupBenchAsset nearCopy;
+		nearCopy.name = "textures\\nearcopy.dds";
+		nearCopy.bytes = assets[assets.size () - 1].bytes;
+		nearCopy.bytes[nearCopy.bytes.size () / 2] ^= 1;
+		assets.push_back (nearCopy);
+		DedupBenchAsset upperCase = assets[assets.size () - 2];
+		upperCase.name = "textures\\Alias.DDS";
+		assets.push_back (upperCase);
+
+		size_t totalBytes = 0;
+		for (size_t i=0;i<assets.size ();i++)
+		{
+			std::string file (assets[i].name);
+			for (size_t k=0;k<file.size ();k++)
+				if (file[k] == '\\')
+					file[k] = '_';
+			assets[i].path = dir + "AvocadoBenchDedup_" + file;
+			if (!WriteBenchFile (assets[i].path, assets[i].bytes))
+			{
+				std::cout << "dedup | could not write " << assets[i].path << std::endl;
+				res = 1;
+			}
+			totalBytes += assets[i].bytes.size ();
+		}
+
+		if (AvocadoArchiveBlobs::ContentHash (nearCopy.bytes.data (), nearCopy.bytes.size ()) == AvocadoArchiveBlobs::ContentHash (upperCase.bytes.data (), upperCase.bytes.size ()))
+		{
+			std::cout << "dedup | one bit apart hashes the same" << std::endl;
+			res = 1;
+		}
+
+		const std::string plainPath = dir + "AvocadoBenchDedup_plain.avc";
+		const std::string blobPath = dir + "AvocadoBenchDedup_blobs.avc";
+		size_t stored = 0;
+		BenchTimer timer;
+		if (res == 0 && !CreateDedupBenchPackage (plainPath, assets))
+		{
+			std::cout << "dedup | plain package failed" << std::endl;
+			res = 1;
+		}
+		const double plainMs = timer.ElapsedMs ();
+		timer.Restart ();
+		if (res == 0 && !CreateDedupBenchBlobPackage (blobPath, assets, stored))
+		{
+			std::cout << "dedup | package with blobs failed" << std::endl;
+			res = 1;
+		}
+		const double blobMs = timer.ElapsedMs ();
+
+		const size_t expected = distinctModels + distinctTextures + 1;
+		if (res == 0 && stored != expected)
+		{
+			std::cout << "dedup | stored " << stored << " items, expected " << expected << std::endl;
+			res = 1;
+		}
+		std::vector<BenchPackageItem> plainItems;
+		for (size_t i=0;i<assets.size ();i++)
+			plainItems.push_back (BenchPackageItem (assets[i].name, assets[i].bytes));
+		if (res == 0 && !BenchPackageMatches (plainPath, plainItems))
+		{
+			std::cout << "dedup | plain package does not read back as its files" << std::endl;
+			res = 1;
+		}
+		if (res == 0 && !DedupBenchPackageMatches (blobPath, assets, stored, dir))
+		{
+			std::cout << "dedup | package does not read back as its files" << std::endl;
+			res = 1;
+		}
+
+		std::stringstream caseName;
+		caseName << assets.size () << " assets, " << totalBytes / block << " MB, " << stored << " stored";
+		ReportResult ("dedup", caseName.str (), assets.size (), plainMs, blobMs);
+		std::cout << "dedup | package " << BenchFileSize (plainPath) << " bytes before, " << BenchFileSize (blobPath)
+			<< " bytes after" << std::endl;
+
+		for (size_t i=0;i<assets.size ();i++)
+			DeleteFileA (assets[i].path.c_str ());
+		DeleteFileA (plainPath.c_str ());
+		DeleteFileA (blobPath.c_str ());
+		return res;
+	}
+}
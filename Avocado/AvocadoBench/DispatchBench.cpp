@@ -0,0 +1,153 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoMessageHandler.h"
+#include <sstream>
+#include <vector>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* Module shaped like the engine ones : an if (msg == "...") chain over its own messages. */
+	class BenchModule : public AvocadoMessageHandler
+	{
+	public:
+		BenchModule (int index, int messageCount, bool subscribe, bool wantsRepaint) : AvocadoMessageHandler ("BenchModule"), m_hits (0)
+		{
+			for (int i=0;i<messageCount;i++)
+			{
+				std::stringstream ss;
+				ss << "BenchModule" << index << "Message" << i;
+				m_messages.push_back (ss.str ());
+			}
+			if (wantsRepaint)
+				m_messages.push_back ("Render");
+			m_wantsMouse = wantsRepaint;
+			if (subscribe)
+			{
+				for (size_t i=0;i<m_messages.size ();i++)
+					SubscribeMessage (m_messages[i]);
+				if (m_wantsMouse)
+					SubscribeMouseMessage (AVC_MOUSE_MOVE);
+			}
+		}
+		virtual bool HandleAvocadoMouseStringMessage (AvcMouseActType msg, int viewId, int x, int y, int zDelta, bool &needRepaint)
+		{
+			if (m_wantsMouse && msg == AVC_MOUSE_MOVE)
+				m_hits += x + y;
+			return false;
+		}
+		virtual bool HandleAvocadoViewGeneralStringMessage (const std::string &msg, int viewId, const std::string &paramStr, bool &needRepaint)
+		{
+			for (size_t i=0;i<m_messages.size ();i++)
+			{
+				if (msg == m_messages[i])
+				{
+					m_hits++;
+					needRepaint = true;
+					break;
+				}
+			}
+			return false;
+		}
+		virtual bool HandleAvocadoDocGeneralStringMessage (const std::string &msg, int docId, const std::string &paramStr, bool &needRepaint)
+		{
+			return false;
+		}
+		size_t m_hits;
+	private:
+		std::vector<std::string> m_messages;
+		bool m_wantsMouse;
+	};
+
+	static size_t CountHits (const std::vector<BenchModule*> &modules)
+	{
+		size_t hits = 0;
+		for (size_t i=0;i<modules.size ();i++)
+			hits += modules[i]->m_hits;
+		return hits;
+	}
+
+	/* One module (the pipeline) wants repaints and mouse moves, every other module handles only its own messages. */
+	static int RunDispatchCase (int moduleCount, int messagesPerModule, size_t iterations)
+	{
+		std::vector<BenchModule*> legacy, subscribed;
+		AvocadoDispatchTable table;
+		for (int m=0;m<moduleCount;m++)
+		{
+			legacy.push_back (new BenchModule (m, messagesPerModule, false, m == moduleCount / 2));
+			subscribed.push_back (new BenchModule (m, messagesPerModule, true, m == moduleCount / 2));
+			table.AddHandler (subscribed.back ());
+		}
+		const std::string render ("Render");
+		const std::string empty;
+		bool needRepaint = false;
+		int res = 0;
+
+		// repaint traffic : the old loop asks every module, the table only the subscribers.
+		BenchTimer timer;
+		for (size_t k=0;k<iterations;k++)
+		{
+			for (size_t i=0;i<legacy.size ();i++)
+				legacy[i]->HandleAvocadoViewGeneralStringMessage (render, 0, empty, needRepaint);
+		}
+		double legacyRenderMs = timer.ElapsedMs ();
+		timer.Restart ();
+		for (size_t k=0;k<iterations;k++)
+		{
+			const AvocadoMessageId msgId = AvocadoMessageRegistry::FindMessage (render);
+			for (size_t i=0;i<table.GetHandlerCount (msgId);i++)
+				table.GetHandler (msgId,i)->HandleAvocadoViewGeneralStringMessage (render, 0, empty, needRepaint);
+		}
+		double tableRenderMs = timer.ElapsedMs ();
+
+		// mouse move traffic.
+		timer.Restart ();
+		for (size_t k=0;k<iterations;k++)
+		{
+			for (size_t i=0;i<legacy.size ();i++)
+				legacy[i]->HandleAvocadoMouseStringMessage (AVC_MOUSE_MOVE, 0, int (k & 1023), 3, 0, needRepaint);
+		}
+		double legacyMouseMs = timer.ElapsedMs ();
+		timer.Restart ();
+		for (size_t k=0;k<iterations;k++)
+		{
+			for (size_t i=0;i<table.GetMouseHandlerCount (AVC_MOUSE_MOVE);i++)
+				table.GetMouseHandler (AVC_MOUSE_MOVE,i)->HandleAvocadoMouseStringMessage (AVC_MOUSE_MOVE, 0, int (k & 1023), 3, 0, needRepaint);
+		}
+		double tableMouseMs = timer.ElapsedMs ();
+
+		if (CountHits (legacy) != CountHits (subscribed) || CountHits (legacy) == 0)
+		{
+			std::cout << "dispatch | MISMATCH between broadcast and table dispatch" << std::endl;
+			res = 1;
+		}
+
+		std::stringstream caseName;
+		caseName << moduleCount << " modules x " << messagesPerModule << " messages";
+		ReportResult ("dispatch", "Render, " + caseName.str (), iterations, legacyRenderMs, tableRenderMs);
+		ReportResult ("dispatch", "mouse move, " + caseName.str (), iterations, legacyMouseMs, tableMouseMs);
+
+		for (size_t i=0;i<legacy.size ();i++)
+		{
+			delete legacy[i];
+			delete subscribed[i];
+		}
+		return res;
+	}
+
+	int RunDispatchBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int moduleCounts[] = { 5, 20, 80 };
+		const int messageCounts[] = { 10, 40 };
+		for (size_t m=0;m<sizeof (moduleCounts) / sizeof (moduleCounts[0]);m++)
+		{
+			for (size_t n=0;n<sizeof (messageCounts) / sizeof (messageCounts[0]);n++)
+				res |= RunDispatchCase (moduleCounts[m], messageCounts[n], 200000);
+		}
+		return res;
+	}
+}
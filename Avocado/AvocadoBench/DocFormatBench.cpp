@@ -0,0 +1,185 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoParams.h"
+#include "../AvocadoEngine/AvocadoDocStream.h"
+#include <sstream>
+#include <vector>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	static const int s_benchViewStates = 8;
+
+	static std::string MakeFormatBenchElement (int id)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		pl->PushString ("OwnerModule", "ImportModule");
+		pl->PushInt ("elementID", id);
+		pl->PushString ("elementName", "Engine Block, rev 3");
+		pl->PushString ("fileName", "C:\\Models\\Engine Block, rev 3;final.nbf");
+		pl->PushBool ("isGroup", false);
+		pl->PushBool ("isRef", (id % 4) == 0);
+		if ((id % 4) == 0)
+			pl->PushInt ("eid", id + 1);
+		pl->PushBool ("Visibility", (id % 7) != 0);
+		pl->PushInt ("MaterialID", id % 97);
+		float mat[16];
+		for (int i=0;i<16;i++)
+			mat[i] = ((i % 5 == 0) ? 1.0f : 0.0f) + id * 0.001f;
+		pl->PushFloat16 ("Location", mat);
+		pl->PushInt ("MetaCount", 2);
+		pl->PushString ("metaVarName0", "Part");
+		pl->PushString ("metaVarData0", "EB-3");
+		pl->PushString ("metaVarName1", "Vendor");
+		pl->PushString ("metaVarData1", "ACME;Ltd");
+		return pl->SerializeList ();
+	}
+
+	/* A header with view states, they get blocks of their own in the binary layout. */
+	static std::string MakeFormatBenchHeader (int elements)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		vector <string> names, values;
+		names.push_back ("Author");
+		values.push_back ("bench");
+		pl->PushStringArray ("AvocadoDocParamNames", names);
+		pl->PushStringArray ("AvocadoDocParamValues", values);
+		pl->PushInt ("ViewStateCount", s_benchViewStates);
+		for (int v=0;v<s_benchViewStates;v++)
+		{
+			std::stringstream index;
+			index << v;
+			vector <string> lines (4, "view state line");
+			pl->PushStringArray ("ViewStateHtmlLines" + index.str (), lines);
+			pl->PushString ("ViewStateImage" + index.str (), std::string (2048, 'x'));
+		}
+		pl->PushInt ("LastIDCount", elements + 1);
+		return pl->SerializeList ();
+	}
+
+	static std::string MakeTextDocument (int elements)
+	{
+		std::string text;
+		AvocadoStringDocSink sink (text);
+		AvocadoDocWriter writer (sink);
+		writer.Begin (MakeFormatBenchHeader (elements));
+		for (int i=0;i<elements;i++)
+			writer.WriteElement (MakeFormatBenchElement (i));
+		writer.End ();
+		return text;
+	}
+
+	/* What the v1 loader has to do before it can list the elements : read every line and parse every element. */
+	static size_t TextStructure (const std::string &text)
+	{
+		std::istringstream in (text);
+		std::string line, element;
+		size_t found = 0;
+		bool inElement = false;
+		while (std::getline (in, line))
+		{
+			if (line == "<AvocadoDocV1>")
+			{
+				std::getline (in, line);
+				ParamList::createFromString (line);
+			}
+			else if (line == "<Element>")
+			{
+				inElement = true;
+				element.clear ();
+			}
+			else if (line == "</Element>")
+			{
+				ParamListSharedPtr pl = ParamList::createFromString (element);
+				AvocadoDocTocEntry entry;
+				ReadElementTocEntry (*pl, entry);
+				found += (entry.id >= 0 ? 1 : 0);
+				inElement = false;
+			}
+			else if (inElement)
+				element += line;
+		}
+		return found;
+	}
+
+	/* The v2 loader : the toc and the header blocks, the elements stay where they are. */
+	static size_t BinaryStructure (const std::string &bytes)
+	{
+		AvocadoDocReader reader;
+		if (!reader.Open (bytes))
+			return 0;
+		ParamList::createFromString (reader.GetDocParams ());
+		size_t found = 0;
+		for (size_t i=0;i<reader.GetEntryCount ();i++)
+			if (reader.GetEntry (i).kind == AVC_DOC_BLOCK_ELEMENT && reader.GetEntry (i).id >= 0)
+				found++;
+		return found;
+	}
+
+	static size_t BinaryParseAll (const std::string &bytes)
+	{
+		AvocadoDocReader reader;
+		if (!reader.Open (bytes))
+			return 0;
+		ParamList::createFromString (reader.GetDocParams ());
+		size_t found = 0;
+		for (size_t i=0;i<reader.GetEntryCount ();i++)
+			if (reader.GetEntry (i).kind == AVC_DOC_BLOCK_ELEMENT)
+			{
+				ParamListSharedPtr pl = ParamList::createFromString (reader.GetBlock (i));
+				found += (pl->GetParamCount () > 0 ? 1 : 0);
+			}
+		return found;
+	}
+
+	/* Time until the document structure is known, v1 text against the v2 toc, and the v2 load of every element.
+	   The header params come back grouped by block, so it is text -> binary -> text -> binary -> text that must repeat itself. */
+	int RunDocFormatBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int sizes[] = { 1000, 10000, 50000 };
+		for (size_t s=0;s<sizeof (sizes) / sizeof (sizes[0]);s++)
+		{
+			const int elements = sizes[s];
+			const std::string text = MakeTextDocument (elements);
+			std::string binary, text2, binary2, text3;
+			AvocadoStringDocSink binarySink (binary, true), text2Sink (text2), binary2Sink (binary2, true), text3Sink (text3);
+			if (!ConvertTextDocumentToBinary (text, binarySink) || !ConvertBinaryDocumentToText (binary, text2Sink) ||
+				!ConvertTextDocumentToBinary (text2, binary2Sink) || !ConvertBinaryDocumentToText (binary2, text3Sink) ||
+				binary != binary2 || text2 != text3)
+			{
+				std::cout << "doc_format | " << elements << " elements | round trip differs" << std::endl;
+				res = 1;
+				continue;
+			}
+
+			BenchTimer timer;
+			const size_t textFound = TextStructure (text);
+			const double textMs = timer.ElapsedMs ();
+
+			timer.Restart ();
+			const size_t binaryFound = BinaryStructure (binary);
+			const double binaryMs = timer.ElapsedMs ();
+
+			timer.Restart ();
+			const size_t parsed = BinaryParseAll (binary);
+			const double parseAllMs = timer.ElapsedMs ();
+
+			if (textFound != size_t (elements) || binaryFound != size_t (elements) || parsed != size_t (elements))
+			{
+				std::cout << "doc_format | " << elements << " elements | element count differs" << std::endl;
+				res = 1;
+			}
+			std::stringstream caseName;
+			caseName << elements << " elements, ";
+			ReportResult ("doc_format", caseName.str () + "time to structure", elements, textMs, binaryMs);
+			ReportResult ("doc_format", caseName.str () + "all elements parsed", elements, textMs, parseAllMs);
+			std::cout << "doc_format | " << elements << " elements | text " << text.size () / 1024 << " KB | binary "
+				<< binary.size () / 1024 << " KB" << std::endl;
+		}
+		return res;
+	}
+}
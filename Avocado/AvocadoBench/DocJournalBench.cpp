@@ -0,0 +1,345 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoParams.h"
+#include "../AvocadoEngine/AvocadoDocStream.h"
+#include "../AvocadoEngine/AvocadoArchive.h"
+#include "../AvocadoEngine/zip.h"
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	static const int s_journalBenchElements = 20000;
+	static const int s_journalBenchViewStates = 4;
+
+	static std::string MakeJournalBenchElement (int id, int material)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		pl->PushString ("OwnerModule", "ImportModule");
+		pl->PushInt ("elementID", id);
+		pl->PushString ("elementName", "Engine Block, rev 3");
+		pl->PushString ("fileName", "C:\\Models\\Engine Block, rev 3;final.nbf");
+		pl->PushBool ("isGroup", false);
+		pl->PushBool ("isRef", false);
+		pl->PushBool ("Visibility", true);
+		pl->PushInt ("MaterialID", material);
+		float mat[16];
+		for (int i=0;i<16;i++)
+			mat[i] = ((i % 5 == 0) ? 1.0f : 0.0f) + id * 0.001f;
+		pl->PushFloat16 ("Location", mat);
+		return pl->SerializeList ();
+	}
+
+	/* The document the bench edits, what the engine would hand the writer. */
+	struct JournalBenchDoc
+	{
+		std::vector<std::string>	elements;
+		std::vector<bool>			removed;
+		std::string					author;
+		std::string					viewImage;
+
+		ParamListSharedPtr Header () const
+		{
+			ParamListSharedPtr pl = ParamList::createNew ();
+			vector <string> names, values;
+			names.push_back ("Author");
+			values.push_back (author);
+			pl->PushStringArray ("AvocadoDocParamNames", names);
+			pl->PushStringArray ("AvocadoDocParamValues", values);
+			pl->PushInt ("ViewStateCount", s_journalBenchViewStates);
+			for (int v=0;v<s_journalBenchViewStates;v++)
+			{
+				std::stringstream index;
+				index << v;
+				pl->PushString ("ViewStateImage" + index.str (), v == 1 ? viewImage : std::string (1024, 'x'));
+			}
+			pl->PushInt ("LastIDCount", int (elements.size ()) + 1);
+			return pl;
+		}
+	};
+
+	static bool SaveJournalBenchDoc (AvocadoDocSink &sink, const JournalBenchDoc &doc, AvocadoDocJournal *journal)
+	{
+		AvocadoDocWriter writer (sink, true, journal);
+		writer.Begin (*doc.Header ());
+		for (size_t i=0;i<doc.elements.size () && writer.IsGood ();i++)
+			if (!doc.removed[i])
+				writer.WriteElement (doc.elements[i]);
+		return writer.End ();
+	}
+
+	static bool SaveJournalBenchFile (const std::string &path, const JournalBenchDoc &doc, AvocadoDocJournal *journal)
+	{
+		AvocadoFileDocSink file (path);
+		return SaveJournalBenchDoc (file, doc, journal) && file.Close ();
+	}
+
+	/* One journal entry with the elements given, removed lists the ids to drop. */
+	static bool AppendJournalBenchEntry (const std::string &path, const JournalBenchDoc &doc, AvocadoDocJournal &journal,
+		const std::vector<int> &changed, const std::vector<int> &removed)
+	{
+		AvocadoDocJournalFile file (path, journal);
+		if (!file.IsOpen ())
+			return false;
+		AvocadoDocWriter writer (file, true, &journal);
+		writer.BeginJournal (*doc.Header ());
+		for (size_t k=0;k<removed.size ();k++)
+			writer.RemoveElement (removed[k]);
+		for (size_t k=0;k<changed.size ();k++)
+			writer.WriteElement (doc.elements[changed[k]]);
+		writer.End ();
+		if (!writer.IsGood () || !file.Close (true))
+		{
+			file.Close (false);
+			journal.Reset ();
+			return false;
+		}
+		return true;
+	}
+
+	static std::string ReadJournalBenchTail (const std::string &path, unsigned __int64 from)
+	{
+		std::string bytes;
+		FILE *f = fopen (path.c_str (), "rb");
+		if (!f)
+			return bytes;
+		if (_fseeki64 (f, (__int64)from, SEEK_SET) == 0)
+		{
+			char buf[65536];
+			size_t n;
+			while ((n = fread (buf, 1, sizeof (buf), f)) > 0)
+				bytes.append (buf, n);
+		}
+		fclose (f);
+		return bytes;
+	}
+
+	/* The package as CompressFile writes it on a save : the document and a thumbnail. The document went in first and
+	   deflated before, it goes in last and stored when the saves are journaled. */
+	static bool CreateJournalBenchPackage (const std::string &path, const std::string &docPath, const std::string &thumbnail, bool storedLast)
+	{
+		HZIP hz = CreateZip (BenchName (path).c_str (), 0);
+		if (!hz)
+			return false;
+		ZipSetCompression (hz, 3, true);
+		bool ok = true;
+		if (!storedLast)
+			ok = ZipAdd (hz, _T("Main.avc"), BenchName (docPath).c_str ()) == ZR_OK;
+		std::string copy = thumbnail;
+		ok = ok && ZipAdd (hz, _T("avothumb.jpg"), (void*)copy.data (), (unsigned int)copy.size ()) == ZR_OK;
+		if (storedLast)
+		{
+			ZipSetCompression (hz, 0, false);
+			ok = ok && ZipAdd (hz, _T("Main.avc"), BenchName (docPath).c_str ()) == ZR_OK;
+		}
+		return CloseZip (hz) == ZR_OK && ok;
+	}
+
+	/* Main.avc of the package has to be the document file, next to the thumbnail. */
+	static bool JournalBenchPackageHolds (const std::string &packagePath, const std::string &docPath, const std::string &thumbnail)
+	{
+		const std::string doc = ReadBenchFile (docPath);
+		std::vector<BenchPackageItem> items;
+		items.push_back (BenchPackageItem ("avothumb.jpg", thumbnail));
+		items.push_back (BenchPackageItem ("Main.avc", doc));
+		return BenchPackageMatches (packagePath, items);
+	}
+
+	/* The journaled file has to read back as the whole save of the same document does. */
+	static bool SameAsWholeSave (const std::string &path, const JournalBenchDoc &doc)
+	{
+		std::string whole;
+		AvocadoStringDocSink wholeSink (whole, true);
+		SaveJournalBenchDoc (wholeSink, doc, NULL);
+		AvocadoDocReader journaled, reference;
+		if (!journaled.Open (ReadBenchFile (path)) || !reference.Open (whole))
+			return false;
+		if (journaled.GetDocParams () != reference.GetDocParams () || journaled.GetEntryCount () != reference.GetEntryCount ())
+			return false;
+		for (size_t i=0;i<reference.GetEntryCount ();i++)
+			if (journaled.GetEntry (i).kind != reference.GetEntry (i).kind || journaled.GetEntry (i).id != reference.GetEntry (i).id ||
+				journaled.GetBlock (i) != reference.GetBlock (i))
+				return false;
+		return true;
+	}
+
+	static void JournalBenchFailed (int &res, const char *what)
+	{
+		std::cout << "doc_journal | " << what << std::endl;
+		res = 1;
+	}
+
+	/* Saving one changed element of a large binary document, the whole file written again against one journal entry
+	   appended to it. Then the package step : the package zipped again against the entry appended to its stored Main.avc.
+	   Every entry is read back and compared with the whole save of the same document, from the package too. */
+	int RunDocJournalBench (int argc, char **argv)
+	{
+		int res = 0;
+		char tempDir[MAX_PATH];
+		if (!GetTempPathA (MAX_PATH, tempDir))
+			strcpy (tempDir, ".\\");
+		const std::string path = std::string (tempDir) + "AvocadoBenchJournal.avc";
+
+		JournalBenchDoc doc;
+		doc.author = "bench";
+		doc.viewImage = std::string (1024, 'x');
+		for (int i=0;i<s_journalBenchElements;i++)
+			doc.elements.push_back (MakeJournalBenchElement (i, i % 97));
+		doc.removed.assign (doc.elements.size (), false);
+
+		AvocadoDocJournal journal;
+		if (!SaveJournalBenchFile (path, doc, &journal) || !journal.IsValid ())
+		{
+			JournalBenchFailed (res, "whole save failed");
+			return res;
+		}
+		// the package of the whole save, a thumbnail jpeg does not compress.
+		const std::string packagePath = path + ".pkg";
+		const std::string zippedPath = path + ".zip";
+		const std::string thumbnail = MakeBenchNoise (48 * 1024, 1);
+		if (!CreateJournalBenchPackage (packagePath, path, thumbnail, true))
+			JournalBenchFailed (res, "package failed");
+
+		// one element changes, then it is saved both ways.
+		const int changedId = s_journalBenchElements / 3;
+		doc.elements[changedId] = MakeJournalBenchElement (changedId, 1000);
+		std::vector<int> changed (1, changedId), removed;
+
+		BenchTimer timer;
+		AvocadoDocJournal wholeJournal;
+		if (!SaveJournalBenchFile (path + ".whole", doc, &wholeJournal))
+			JournalBenchFailed (res, "whole save failed");
+		const double wholeMs = timer.ElapsedMs ();
+		DeleteFileA ((path + ".whole").c_str ());
+
+		const unsigned __int64 sizeBefore = journal.GetFileSize ();
+		timer.Restart ();
+		if (!AppendJournalBenchEntry (path, doc, journal, changed, removed))
+			JournalBenchFailed (res, "journal entry could not be appended");
+		const double journalMs = timer.ElapsedMs ();
+		ReportResult ("doc_journal", "one element changed, save", 1, wholeMs, journalMs);
+		std::cout << "doc_journal | " << s_journalBenchElements << " elements | whole file " << sizeBefore / 1024
+			<< " KB | journal entry " << (journal.GetFileSize () - sizeBefore) << " bytes" << std::endl;
+		if (!SameAsWholeSave (path, doc))
+			JournalBenchFailed (res, "changed element reads back differently");
+
+		// the package after it, zipped again whole as DoCompressDoc did, against the entry appended in place.
+		timer.Restart ();
+		if (!CreateJournalBenchPackage (zippedPath, path, thumbnail, false))
+			JournalBenchFailed (res, "package failed");
+		const double zipMs = timer.ElapsedMs ();
+		timer.Restart ();
+		const std::string appended = ReadJournalBenchTail (path, sizeBefore);
+		if (!AvocadoArchive::AppendToStoredEntry (packagePath, "Main.avc", size_t (sizeBefore), appended.data (), appended.size ()))
+			JournalBenchFailed (res, "journal entry could not be appended to the package");
+		const double appendMs = timer.ElapsedMs ();
+		ReportResult ("doc_journal", "one element changed, package", 1, zipMs, appendMs);
+		ReportResult ("doc_journal", "one element changed, save and package", 1, wholeMs + zipMs, journalMs + appendMs);
+		if (!JournalBenchPackageHolds (packagePath, path, thumbnail) || !JournalBenchPackageHolds (zippedPath, path, thumbnail))
+			JournalBenchFailed (res, "package does not hold the journaled file");
+
+		// only a stored Main.avc of the expected size, at the end of the package, is appended to.
+		{
+			const std::string before = ReadBenchFile (packagePath);
+			if (AvocadoArchive::AppendToStoredEntry (packagePath, "Main.avc", size_t (sizeBefore), appended.data (), appended.size ()) ||
+				ReadBenchFile (packagePath) != before)
+				JournalBenchFailed (res, "appended to a package entry of another size");
+			if (AvocadoArchive::AppendToStoredEntry (zippedPath, "Main.avc", size_t (sizeBefore), appended.data (), appended.size ()))
+				JournalBenchFailed (res, "appended to a deflated package entry");
+			if (AvocadoArchive::AppendToStoredEntry (packagePath, "avothumb.jpg", thumbnail.size (), appended.data (), appended.size ()))
+				JournalBenchFailed (res, "appended to a package entry that is not the last");
+		}
+
+		// a changed view state and doc property, a removed element and a new one.
+		doc.author = "bench, second pass";
+		doc.viewImage = std::string (512, 'y');
+		doc.removed[7] = true;
+		doc.elements.push_back (MakeJournalBenchElement (int (doc.elements.size ()), 3));
+		doc.removed.push_back (false);
+		changed.assign (1, int (doc.elements.size ()) - 1);
+		removed.assign (1, 7);
+		const unsigned __int64 sizeSecond = journal.GetFileSize ();
+		if (!AppendJournalBenchEntry (path, doc, journal, changed, removed) || !SameAsWholeSave (path, doc))
+			JournalBenchFailed (res, "states, removal and addition read back differently");
+		const std::string appendedSecond = ReadJournalBenchTail (path, sizeSecond);
+		if (!AvocadoArchive::AppendToStoredEntry (packagePath, "Main.avc", size_t (sizeSecond), appendedSecond.data (), appendedSecond.size ()) ||
+			!JournalBenchPackageHolds (packagePath, path, thumbnail))
+			JournalBenchFailed (res, "second entry appended to the package reads back differently");
+		if (journal.HasElement (7) || !journal.HasElement (changed[0]))
+			JournalBenchFailed (res, "journal does not follow the removal");
+
+		// nothing changed, nothing is written.
+		const unsigned __int64 sizeUnchanged = journal.GetFileSize ();
+		changed.clear ();
+		removed.clear ();
+		if (!AppendJournalBenchEntry (path, doc, journal, changed, removed) || journal.GetFileSize () != sizeUnchanged ||
+			ReadBenchFile (path).size () != sizeUnchanged)
+			JournalBenchFailed (res, "an empty entry wrote something");
+
+		// an entry that is not kept leaves the file as it was.
+		{
+			const std::string before = ReadBenchFile (path);
+			AvocadoDocJournalFile file (path, journal);
+			file.Write ("partial entry", 13);
+			file.Close (false);
+			if (ReadBenchFile (path) != before)
+				JournalBenchFailed (res, "rolled back entry left bytes behind");
+		}
+
+		// the journal read back from the file is the one the saves kept.
+		{
+			AvocadoDocReader reader;
+			AvocadoDocJournal readJournal;
+			if (!reader.Open (ReadBenchFile (path)))
+				JournalBenchFailed (res, "journaled file does not open");
+			reader.FillJournal (readJournal);
+			if (!readJournal.IsValid () || readJournal.GetFileSize () != journal.GetFileSize () ||
+				readJournal.GetEntryCount () != journal.GetEntryCount () || readJournal.GetTrailer () != journal.GetTrailer () ||
+				readJournal.HasElement (7) || !readJournal.HasElement (changedId))
+				JournalBenchFailed (res, "journal read from the file differs");
+		}
+
+		// a file changed by someone else is not appended to.
+		{
+			FILE *f = fopen (path.c_str (), "ab");
+			if (f)
+			{
+				fputc ('x', f);
+				fclose (f);
+			}
+			AvocadoDocJournalFile file (path, journal);
+			if (file.IsOpen ())
+				JournalBenchFailed (res, "appended to a file that changed");
+		}
+
+		// entries pile up until a whole save compacts them.
+		if (!SaveJournalBenchFile (path, doc, &journal))
+			JournalBenchFailed (res, "whole save failed");
+		const int maxEntries = 32;
+		int entries = 0;
+		while (!journal.NeedsCompaction (maxEntries) && entries < 2 * maxEntries)
+		{
+			const int id = 100 + entries;
+			doc.elements[id] = MakeJournalBenchElement (id, 2000 + entries);
+			changed.assign (1, id);
+			if (!AppendJournalBenchEntry (path, doc, journal, changed, removed))
+				break;
+			entries++;
+		}
+		if (entries != maxEntries || !SameAsWholeSave (path, doc))
+			JournalBenchFailed (res, "compaction point or chained entries are wrong");
+		if (!SaveJournalBenchFile (path, doc, &journal) || journal.NeedsCompaction (maxEntries) || journal.GetEntryCount () != 0)
+			JournalBenchFailed (res, "whole save did not compact");
+
+		DeleteFileA (path.c_str ());
+		DeleteFileA (packagePath.c_str ());
+		DeleteFileA (zippedPath.c_str ());
+		return res;
+	}
+}
@@ -0,0 +1,199 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoParams.h"
+#include "../AvocadoEngine/AvocadoDocStream.h"
+#include <psapi.h>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* What an element serialize () gives back, built on demand like the engine does. */
+	static std::string SerializeBenchElement (int id)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		pl->PushString ("OwnerModule", "ImportModule");
+		pl->PushInt ("elementID", id);
+		pl->PushString ("elementName", "Engine Block, rev 3");
+		pl->PushString ("fileName", "C:\\Models\\Engine Block, rev 3;final.nbf");
+		pl->PushBool ("isGroup", false);
+		pl->PushBool ("isRef", false);
+		pl->PushBool ("Visibility", true);
+		pl->PushInt ("MaterialID", id % 97);
+		pl->PushString ("materialData", "name=steel;ambient=0.2;diffuse=0.8;baseColor=0.5,0.5,0.5;specular=0.4;shininess=30;polished=1");
+		float mat[16];
+		for (int i=0;i<16;i++)
+			mat[i] = ((i % 5 == 0) ? 1.0f : 0.0f) + id * 0.001f;
+		pl->PushFloat16 ("Location", mat);
+		pl->PushInt ("MetaCount", 2);
+		pl->PushString ("metaVarName0", "Part");
+		pl->PushString ("metaVarData0", "EB-3");
+		pl->PushString ("metaVarName1", "Vendor");
+		pl->PushString ("metaVarData1", "ACME;Ltd");
+		return pl->SerializeList ();
+	}
+
+	static std::string MakeBenchHeader (int elements)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		vector <string> names, values;
+		names.push_back ("Author");
+		values.push_back ("bench");
+		pl->PushStringArray ("AvocadoDocParamNames", names);
+		pl->PushStringArray ("AvocadoDocParamValues", values);
+		pl->PushInt ("ViewStateCount", 0);
+		pl->PushInt ("LastIDCount", elements + 1);
+		return pl->SerializeList ();
+	}
+
+	/* The document text built whole, then handed out as a copy and written, as the engine and the app did before. */
+	static bool SaveConcatenated (const std::string &path, int elements)
+	{
+		std::string str;
+		{
+			string DocString ("<AvocadoDocV1>\n");
+			DocString += MakeBenchHeader (elements) + "\n";
+			for (int i=0;i<elements;i++)
+			{
+				DocString += "<Element>\n";
+				DocString += SerializeBenchElement (i) + string ("\n");
+				DocString += "</Element>\n";
+			}
+			DocString += "</AvocadoDocV1>\n";
+			str = DocString.c_str();
+		}
+		AvocadoFileDocSink file (path);
+		file.Write (str.data (), str.size ());
+		return file.Close ();
+	}
+
+	static bool SaveStreamed (AvocadoDocSink &sink, int elements)
+	{
+		AvocadoDocWriter writer (sink);
+		writer.Begin (MakeBenchHeader (elements));
+		for (int i=0;i<elements && writer.IsGood ();i++)
+			writer.WriteElement (SerializeBenchElement (i));
+		return writer.End ();
+	}
+
+	static size_t PeakWorkingSet ()
+	{
+		PROCESS_MEMORY_COUNTERS pmc;
+		if (!GetProcessMemoryInfo (GetCurrentProcess (), &pmc, sizeof (pmc)))
+			return 0;
+		return size_t (pmc.PeakWorkingSetSize);
+	}
+
+	static bool SameFile (const std::string &a, const std::string &b)
+	{
+		FILE *fa = fopen (a.c_str (), "rb");
+		FILE *fb = fopen (b.c_str (), "rb");
+		bool same = fa && fb;
+		while (same)
+		{
+			char ba[4096], bb[4096];
+			size_t na = fread (ba, 1, sizeof (ba), fa);
+			size_t nb = fread (bb, 1, sizeof (bb), fb);
+			if (na != nb || memcmp (ba, bb, na) != 0)
+				same = false;
+			if (na == 0)
+				break;
+		}
+		if (fa)
+			fclose (fa);
+		if (fb)
+			fclose (fb);
+		return same;
+	}
+
+	static std::string BenchFile (const std::string &dir, const char *name, int elements)
+	{
+		std::stringstream path;
+		path << dir << name << elements << ".avc";
+		return path.str ();
+	}
+
+	/* Save time and peak working set growth for the old whole string save against the streamed one.
+	   The peak can only go up within a process, so every streamed save runs first and the concatenated ones
+	   follow by growing size, each of them then sets a new peak of its own. */
+	int RunDocWriterBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int sizes[] = { 1000, 10000, 50000 };
+		const size_t sizeCount = sizeof (sizes) / sizeof (sizes[0]);
+		char tempDir[MAX_PATH];
+		if (!GetTempPathA (MAX_PATH, tempDir))
+			strcpy (tempDir, ".\\");
+
+		// warm up the param atoms and the allocator so the first timed save is not the cold one.
+		std::string warmUp;
+		AvocadoStringDocSink warmUpSink (warmUp);
+		SaveStreamed (warmUpSink, 1000);
+		warmUp.clear ();
+
+		const size_t basePeak = PeakWorkingSet ();
+		double streamedMs[sizeCount], concatMs[sizeCount];
+		size_t streamedPeak[sizeCount], concatPeak[sizeCount];
+		for (size_t s=0;s<sizeCount;s++)
+		{
+			BenchTimer timer;
+			AvocadoFileDocSink file (BenchFile (tempDir, "AvocadoBenchStreamed", sizes[s]));
+			if (!SaveStreamed (file, sizes[s]) || !file.Close ())
+			{
+				std::cout << "doc_writer | streamed save failed" << std::endl;
+				res = 1;
+			}
+			streamedMs[s] = timer.ElapsedMs ();
+			streamedPeak[s] = PeakWorkingSet ();
+		}
+		for (size_t s=0;s<sizeCount;s++)
+		{
+			BenchTimer timer;
+			if (!SaveConcatenated (BenchFile (tempDir, "AvocadoBenchConcat", sizes[s]), sizes[s]))
+			{
+				std::cout << "doc_writer | concatenated save failed" << std::endl;
+				res = 1;
+			}
+			concatMs[s] = timer.ElapsedMs ();
+			concatPeak[s] = PeakWorkingSet ();
+		}
+
+		for (size_t s=0;s<sizeCount;s++)
+		{
+			std::stringstream caseName;
+			caseName << sizes[s] << " elements, save to file";
+			ReportResult ("doc_writer", caseName.str (), 1, concatMs[s], streamedMs[s]);
+			std::cout << "doc_writer | " << sizes[s] << " elements | peak working set growth before "
+				<< (concatPeak[s] - basePeak) / 1024 << " KB | after " << (streamedPeak[s] - basePeak) / 1024 << " KB" << std::endl;
+			if (!SameFile (BenchFile (tempDir, "AvocadoBenchStreamed", sizes[s]), BenchFile (tempDir, "AvocadoBenchConcat", sizes[s])))
+			{
+				std::cout << "doc_writer | " << sizes[s] << " elements | streamed file differs" << std::endl;
+				res = 1;
+			}
+			DeleteFileA (BenchFile (tempDir, "AvocadoBenchStreamed", sizes[s]).c_str ());
+			DeleteFileA (BenchFile (tempDir, "AvocadoBenchConcat", sizes[s]).c_str ());
+		}
+
+		// the string adapter SerializeDocument keeps must give the same text.
+		std::string adapted;
+		AvocadoStringDocSink stringSink (adapted);
+		SaveStreamed (stringSink, 10);
+		std::string whole ("<AvocadoDocV1>\n");
+		whole += MakeBenchHeader (10) + "\n";
+		for (int i=0;i<10;i++)
+			whole += "<Element>\n" + SerializeBenchElement (i) + "\n</Element>\n";
+		whole += "</AvocadoDocV1>\n";
+		if (adapted != whole)
+		{
+			std::cout << "doc_writer | string adapter differs" << std::endl;
+			res = 1;
+		}
+		return res;
+	}
+}
@@ -0,0 +1,244 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoElementSceneIndex.h"
+#include <nvsg/Transform.h>
+#include <nvsg/GeoNode.h>
+#include <nvsg/StateSet.h>
+#include <nvsg/Primitive.h>
+#include <nvtraverser/SearchTraverser.h>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace avocado;
+using namespace nvsg;
+using namespace nvutil;
+
+namespace avocado_bench {
+
+	/* An imported model under its element root : transforms over GeoNodes, each with its drawables under two state
+	   sets. The names come back every thousand GeoNodes, as the parts of an assembly do. */
+	static TransformSharedPtr MakeElementIndexBenchElement (int geoNodes, int drawablesPerGeoNode)
+	{
+		TransformSharedPtr root = Transform::create ();
+		TransformWriteLock (root)->setName ("AvocadoElement");
+		TransformSharedPtr parent;
+		for (int g=0;g<geoNodes;g++)
+		{
+			if (g % 16 == 0)
+			{
+				std::stringstream groupName;
+				groupName << "Group" << g / 16;
+				parent = Transform::create ();
+				TransformWriteLock (parent)->setName (groupName.str ());
+				TransformWriteLock (root)->addChild (parent);
+			}
+			std::stringstream geoName;
+			geoName << "AvoGeoNode" << g % 1000;
+			GeoNodeSharedPtr geoNode = GeoNode::create ();
+			{
+				GeoNodeWriteLock geo (geoNode);
+				geo->setName (geoName.str ());
+				const StateSetSharedPtr stateSets[2] = { StateSet::create (), StateSet::create () };
+				for (int d=0;d<drawablesPerGeoNode;d++)
+					geo->addDrawable (stateSets[d % 2], Primitive::create ());
+			}
+			TransformWriteLock (parent)->addChild (geoNode);
+		}
+		return root;
+	}
+
+	/* What the element did before the index : a SearchTraverser over its subgraph by class name, and by object name
+	   for a sub element, then a dynamic_cast of every result. */
+	static std::vector<GeoNodeSharedPtr> SearchElementIndexBench (const NodeSharedPtr &root, const std::string *name)
+	{
+		SmartPtr<nvtraverser::SearchTraverser> st (new nvtraverser::SearchTraverser);
+		st->setClassName ("class nvsg::GeoNode");
+		if (name)
+			st->setObjectName (*name);
+		st->apply (root);
+		const std::vector<ObjectWeakPtr> &results = st->getResults ();
+		std::vector<GeoNodeSharedPtr> res;
+		for (size_t i=0;i<results.size ();i++)
+		{
+			GeoNodeWeakPtr geoNode = dynamic_cast<GeoNodeWeakPtr> (results[i]);
+			if (geoNode)
+				res.push_back (GeoNodeSharedPtr (geoNode));
+		}
+		return res;
+	}
+
+	/* Both have to find the same GeoNodes, the order of the search results is the traverser's own. */
+	static bool SameElementIndexBenchGeoNodes (std::vector<GeoNodeSharedPtr> a, std::vector<GeoNodeSharedPtr> b)
+	{
+		std::sort (a.begin (), a.end ());
+		std::sort (b.begin (), b.end ());
+		return a == b;
+	}
+
+	/* Material changes, drawable masks and sub element lookups on an element of a few thousand GeoNodes : a search
+	   of the element subgraph by class name every time before, AvocadoElementSceneIndex built once when the element
+	   gets its scene after. Arguments : GeoNodes, drawables per GeoNode. */
+	int RunElementIndexBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int geoNodeCount = argc > 2 ? atoi (argv[2]) : 4000;
+		const int drawableCount = argc > 3 ? atoi (argv[3]) : 4;
+		const int changes = 200;
+
+		const TransformSharedPtr root = MakeElementIndexBenchElement (geoNodeCount, drawableCount);
+
+		// what attachElementRoot builds, the Build counted in the index time below.
+		BenchTimer timer;
+		AvocadoElementSceneIndex index;
+		index.Build (root);
+		const double buildMs = timer.ElapsedMs ();
+		const std::vector<GeoNodeSharedPtr> all = SearchElementIndexBench (root, NULL);
+		if ((int)index.GetGeoNodes ().size () != geoNodeCount || index.GetDrawables ().size () != (size_t)geoNodeCount * drawableCount ||
+			!SameElementIndexBenchGeoNodes (index.GetGeoNodes (), all))
+		{
+			std::cout << "element_index | the index holds " << index.GetGeoNodes ().size () << " GeoNodes and "
+				<< index.GetDrawables ().size () << " drawables" << std::endl;
+			res = 1;
+		}
+		// the drawables in the order prepareElementRoot names them : the state sets of a GeoNode one after the other.
+		const std::vector<AvocadoElementDrawable> &drawables = index.GetDrawables ();
+		for (size_t i=0;i<drawables.size () && res == 0;i++)
+		{
+			const int d = drawables[i].refDrawableIdx;
+			const int expectedStateSet = (drawableCount > 1 && d >= (drawableCount + 1) / 2) ? 1 : 0;
+			if (drawables[i].geoNode != index.GetGeoNodes ()[i / drawableCount] || d != (int)(i % drawableCount) || drawables[i].stateSetIdx != expectedStateSet)
+			{
+				std::cout << "element_index | drawable " << i << " is not where prepareElementRoot names it" << std::endl;
+				res = 1;
+			}
+		}
+
+		// setDrawablesTraversalMask : every drawable of the element hidden or shown.
+		timer.Restart ();
+		for (int c=0;c<changes;c++)
+		{
+			const std::vector<GeoNodeSharedPtr> geoNodes = SearchElementIndexBench (root, NULL);
+			for (size_t i=0;i<geoNodes.size ();i++)
+			{
+				GeoNodeReadLock geo (geoNodes[i]);
+				for (GeoNode::StateSetConstIterator ss = geo->beginStateSets ();ss != geo->endStateSets ();++ss)
+					for (GeoNode::DrawableConstIterator dr = geo->beginDrawables (ss);dr != geo->endDrawables (ss);++dr)
+						DrawableWriteLock (*dr)->setTraversalMask (c % 2 ? 2u : 3u);
+			}
+		}
+		const double maskSearchMs = timer.ElapsedMs ();
+		timer.Restart ();
+		for (int c=0;c<changes;c++)
+			for (size_t i=0;i<drawables.size ();i++)
+				DrawableWriteLock (drawables[i].drawable)->setTraversalMask (c % 2 ? 2u : 3u);
+		const double maskIndexMs = timer.ElapsedMs ();
+		for (size_t i=0;i<drawables.size () && res == 0;i++)
+		{
+			if (DrawableReadLock (drawables[i].drawable)->getTraversalMask () != ((changes - 1) % 2 ? 2u : 3u))
+			{
+				std::cout << "element_index | drawable " << i << " missed a traversal mask" << std::endl;
+				res = 1;
+			}
+		}
+		std::stringstream maskCase;
+		maskCase << geoNodeCount << " GeoNodes, " << drawables.size () << " drawables, traversal mask";
+		ReportResult ("element_index", maskCase.str (), (size_t)changes, maskSearchMs, buildMs + maskIndexMs);
+
+		// a material change : every GeoNode of the element gets the new state set.
+		StateSetSharedPtr stateSet;
+		timer.Restart ();
+		for (int c=0;c<changes;c++)
+		{
+			stateSet = StateSet::create ();
+			const std::vector<GeoNodeSharedPtr> geoNodes = SearchElementIndexBench (root, NULL);
+			for (size_t i=0;i<geoNodes.size ();i++)
+				GeoNodeWriteLock (geoNodes[i])->replaceAllStateSets (stateSet);
+		}
+		const double searchMs = timer.ElapsedMs ();
+		const std::vector<GeoNodeSharedPtr> &geoNodes = index.GetGeoNodes ();
+		timer.Restart ();
+		for (int c=0;c<changes;c++)
+		{
+			stateSet = StateSet::create ();
+			for (size_t i=0;i<geoNodes.size ();i++)
+				GeoNodeWriteLock (geoNodes[i])->replaceAllStateSets (stateSet);
+		}
+		const double indexMs = timer.ElapsedMs ();
+		for (size_t i=0;i<geoNodes.size () && res == 0;i++)
+		{
+			GeoNodeReadLock geo (geoNodes[i]);
+			if (geo->getNumberOfStateSets () != 1 || geo->findStateSet (stateSet) == geo->endStateSets () || (int)geo->getNumberOfDrawables () != drawableCount)
+			{
+				std::cout << "element_index | " << geo->getName () << " missed a material change" << std::endl;
+				res = 1;
+			}
+		}
+		std::stringstream changeCase;
+		changeCase << geoNodeCount << " GeoNodes, material change";
+		ReportResult ("element_index", changeCase.str (), (size_t)changes, searchMs, buildMs + indexMs);
+
+		// sub elements of a document being opened : the GeoNodes of a name each.
+		std::vector<std::string> names;
+		for (int i=0;i<changes;i++)
+		{
+			std::stringstream geoName;
+			geoName << "AvoGeoNode" << (i * 7919) % 1000;
+			names.push_back (geoName.str ());
+		}
+		std::vector<GeoNodeSharedPtr> searched;
+		timer.Restart ();
+		for (size_t i=0;i<names.size ();i++)
+		{
+			const std::vector<GeoNodeSharedPtr> results = SearchElementIndexBench (root, &names[i]);
+			searched.insert (searched.end (), results.begin (), results.end ());
+		}
+		const double nameSearchMs = timer.ElapsedMs ();
+
+		std::vector<GeoNodeSharedPtr> found;
+		timer.Restart ();
+		for (size_t i=0;i<names.size ();i++)
+		{
+			const std::vector<GeoNodeSharedPtr> *results = index.FindGeoNodes (names[i]);
+			if (results)
+				found.insert (found.end (), results->begin (), results->end ());
+		}
+		const double nameIndexMs = timer.ElapsedMs ();
+		if (searched.empty () || !SameElementIndexBenchGeoNodes (found, searched))
+		{
+			std::cout << "element_index | the index finds " << found.size () << " GeoNodes by name, the search " << searched.size () << std::endl;
+			res = 1;
+		}
+		std::stringstream nameCase;
+		nameCase << geoNodeCount << " GeoNodes, GeoNodes by name";
+		ReportResult ("element_index", nameCase.str (), names.size (), nameSearchMs, nameIndexMs);
+
+		// a sub element moved out of the element : its GeoNode leaves the index with its last drawable.
+		const GeoNodeSharedPtr removed = geoNodes[0];
+		std::string removedName;
+		std::vector<DrawableSharedPtr> removedDrawables;
+		{
+			GeoNodeReadLock geo (removed);
+			removedName = geo->getName ();
+			for (GeoNode::StateSetConstIterator ss = geo->beginStateSets ();ss != geo->endStateSets ();++ss)
+				for (GeoNode::DrawableConstIterator dr = geo->beginDrawables (ss);dr != geo->endDrawables (ss);++dr)
+					removedDrawables.push_back (*dr);
+		}
+		const size_t namedBefore = index.FindGeoNodes (removedName) ? index.FindGeoNodes (removedName)->size () : 0;
+		for (size_t i=0;i<removedDrawables.size ();i++)
+			index.RemoveDrawable (removedDrawables[i]);
+		const std::vector<GeoNodeSharedPtr> *named = index.FindGeoNodes (removedName);
+		const size_t namedAfter = named ? named->size () : 0;
+		if ((int)index.GetGeoNodes ().size () != geoNodeCount - 1 || index.GetDrawables ().size () != (size_t)(geoNodeCount - 1) * drawableCount ||
+			namedAfter + 1 != namedBefore || (named && std::find (named->begin (), named->end (), removed) != named->end ()))
+		{
+			std::cout << "element_index | " << removedName << " is still indexed after its drawables went" << std::endl;
+			res = 1;
+		}
+		index.Clear ();
+		return res;
+	}
+}
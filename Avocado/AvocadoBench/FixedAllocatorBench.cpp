@@ -0,0 +1,267 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include <nvutil/FixedAllocator.h>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace avocado_bench {
+
+	/* The FixedAllocator this replaces : chunks of 255 blocks, a set of the chunks with free blocks scanned on
+	   alloc, and a map from the first block of each chunk to the chunk, so freeing any other block is lost. */
+	class FixedAllocatorBenchOld
+	{
+	public:
+		struct Chunk
+		{
+			Chunk (size_t blockSize) : blockSize (blockSize), first (0), available (255)
+			{
+				mem = new unsigned char[blockSize * 255];
+				unsigned char *p = mem;
+				for (unsigned char i=0;i!=255;p+=blockSize)
+					*p = ++i;
+			}
+			void* Alloc ()
+			{
+				if (!available)
+					return NULL;
+				unsigned char *p = &mem[first * blockSize];
+				first = *p;
+				--available;
+				return p;
+			}
+			void Dealloc (void *p)
+			{
+				*(unsigned char*)p = first;
+				first = (unsigned char)(((unsigned char*)p - mem) / blockSize);
+				++available;
+			}
+
+			unsigned char	*mem;
+			size_t			blockSize;
+			unsigned char	first;
+			unsigned char	available;
+		};
+
+		FixedAllocatorBenchOld (size_t blockSize) : m_blockSize (blockSize) {}
+		~FixedAllocatorBenchOld ()
+		{
+			for (std::map<void*,Chunk*>::iterator it = m_chunks.begin ();it != m_chunks.end ();++it)
+			{
+				delete [] it->second->mem;
+				delete it->second;
+			}
+		}
+
+		void* Alloc ()
+		{
+			for (std::set<Chunk*>::iterator it = m_availableChunks.begin ();it != m_availableChunks.end ();++it)
+			{
+				if ((*it)->available)
+				{
+					void *p = (*it)->Alloc ();
+					if (!(*it)->available)
+						m_availableChunks.erase (it);
+					return p;
+				}
+			}
+			Chunk *chunk = new Chunk (m_blockSize);
+			void *p = chunk->Alloc ();
+			m_chunks.insert (std::make_pair (p, chunk));
+			m_availableChunks.insert (chunk);
+			return p;
+		}
+
+		void Dealloc (void *p)
+		{
+			std::map<void*,Chunk*>::iterator it = m_chunks.find (p);
+			if (it != m_chunks.end ())
+			{
+				it->second->Dealloc (p);
+				if (m_availableChunks.find (it->second) != m_availableChunks.end ())
+					m_availableChunks.insert (it->second);
+			}
+		}
+
+		size_t GetChunkCount () const { return m_chunks.size (); }
+	private:
+		size_t					m_blockSize;
+		std::map<void*,Chunk*>	m_chunks;
+		std::set<Chunk*>		m_availableChunks;
+	};
+
+	struct FixedAllocatorBenchMalloc
+	{
+		FixedAllocatorBenchMalloc (size_t blockSize) : m_blockSize (blockSize) {}
+		void* Alloc () { return malloc (m_blockSize); }
+		void Dealloc (void *p) { free (p); }
+		size_t m_blockSize;
+	};
+
+	struct FixedAllocatorBenchNew
+	{
+		FixedAllocatorBenchNew (size_t blockSize) { m_alloc.init (blockSize); }
+		void* Alloc () { return m_alloc.alloc (); }
+		void Dealloc (void *p) { m_alloc.dealloc (p); }
+		nvutil::FixedAllocator m_alloc;
+	};
+
+	/* What the scene graph does to the allocator : a model's objects made in a burst, then freed in about the
+	   order they were made, with small objects coming and going in between. */
+	template <class A>
+	static double RunFixedAllocatorBenchPattern (A &alloc, const std::vector<size_t> &order, int live, int rounds)
+	{
+		std::vector<void*> blocks (live, (void*)NULL);
+		BenchTimer timer;
+		for (int r=0;r<rounds;r++)
+		{
+			for (int i=0;i<live;i++)
+				blocks[i] = alloc.Alloc ();
+			// churn : a freed block is taken again right away.
+			for (size_t i=0;i<order.size ();i++)
+			{
+				alloc.Dealloc (blocks[order[i]]);
+				blocks[order[i]] = alloc.Alloc ();
+			}
+			for (int i=0;i<live;i++)
+				alloc.Dealloc (blocks[order[i]]);
+		}
+		return timer.ElapsedMs ();
+	}
+
+	/* Random allocs and frees of many sizes, each live block filled with its own bytes : a block handed out twice
+	   or one of another allocator shows as overwritten bytes. Every chunk but the spare one is returned in the end. */
+	static int StressFixedAllocatorBench (int ops)
+	{
+		static const size_t sizes[] = { 1, 8, 12, 24, 56, 72, 200, 1024 };
+		const size_t sizeCount = sizeof (sizes) / sizeof (sizes[0]);
+		std::vector<nvutil::FixedAllocator*> allocators;
+		for (size_t s=0;s<sizeCount;s++)
+		{
+			allocators.push_back (new nvutil::FixedAllocator ());
+			allocators.back ()->init (sizes[s]);
+		}
+		struct Live { unsigned char *p; size_t sizeIdx; unsigned char fill; };
+		std::vector<Live> live;
+		unsigned int seed = 12345;
+		int res = 0;
+		for (int op=0;op<ops && res == 0;op++)
+		{
+			BenchRandom (seed);
+			const unsigned int r = seed >> 8;
+			// grows for the first half, shrinks for the second.
+			const bool grow = live.empty () || (r % 100) < (op < ops / 2 ? 60u : 35u);
+			if (grow)
+			{
+				Live l;
+				l.sizeIdx = r % sizeCount;
+				l.fill = (unsigned char)(op * 31 + 7);
+				l.p = (unsigned char*)allocators[l.sizeIdx]->alloc ();
+				if (!l.p || ((size_t)l.p % sizeof (void*)) != 0)
+				{
+					std::cout << "fixed_allocator | bad block from the allocator of " << sizes[l.sizeIdx] << " bytes" << std::endl;
+					res = 1;
+					break;
+				}
+				memset (l.p, l.fill, sizes[l.sizeIdx]);
+				live.push_back (l);
+			}
+			else
+			{
+				const size_t i = (r / 7) % live.size ();
+				const Live l = live[i];
+				for (size_t b=0;b<sizes[l.sizeIdx] && res == 0;b++)
+				{
+					if (l.p[b] != l.fill)
+					{
+						std::cout << "fixed_allocator | a block of " << sizes[l.sizeIdx] << " bytes was overwritten" << std::endl;
+						res = 1;
+					}
+				}
+				allocators[l.sizeIdx]->dealloc (l.p);
+				live[i] = live.back ();
+				live.pop_back ();
+			}
+		}
+		for (size_t i=0;i<live.size ();i++)
+			allocators[live[i].sizeIdx]->dealloc (live[i].p);
+		for (size_t s=0;s<sizeCount;s++)
+		{
+			if (res == 0 && allocators[s]->getChunkCount () > 1)
+			{
+				std::cout << "fixed_allocator | " << allocators[s]->getChunkCount () << " chunks left for " << sizes[s] << " bytes" << std::endl;
+				res = 1;
+			}
+			delete allocators[s];
+		}
+
+		// around a chunk boundary : the chunk that gets empty is kept, no chunk is made or freed per call.
+		nvutil::FixedAllocator boundary;
+		boundary.init (1024);
+		std::vector<void*> full;
+		while (boundary.getChunkCount () < 2)
+			full.push_back (boundary.alloc ());
+		for (int i=0;i<1000 && res == 0;i++)
+		{
+			boundary.dealloc (full.back ());
+			full.pop_back ();
+			if (boundary.getChunkCount () != 2)
+				res = 1;
+			full.push_back (boundary.alloc ());
+		}
+		for (size_t i=0;i<full.size ();i++)
+			boundary.dealloc (full[i]);
+		if (res == 0 && boundary.getChunkCount () != 1)
+			res = 1;
+		if (res)
+			std::cout << "fixed_allocator | empty chunks are not kept back once" << std::endl;
+		return res;
+	}
+
+	/* Alloc and free of 48 byte blocks, about an RCObject, against the FixedAllocator this replaces and malloc,
+	   after a stress test of the new one. Arguments : live blocks, rounds, stress operations. */
+	int RunFixedAllocatorBench (int argc, char **argv)
+	{
+		const int live = argc > 2 ? atoi (argv[2]) : 100000;
+		const int rounds = argc > 3 ? atoi (argv[3]) : 10;
+		const int ops = argc > 4 ? atoi (argv[4]) : 2000000;
+		const size_t blockSize = 48;
+
+		int res = StressFixedAllocatorBench (ops);
+
+		std::vector<size_t> order;
+		for (int i=0;i<live;i++)
+			order.push_back ((size_t)i);
+		// mostly in order, a few blocks out of place.
+		unsigned int seed = 99;
+		for (int i=0;i<live;i++)
+		{
+			BenchRandom (seed);
+			std::swap (order[i], order[std::min (live - 1, i + (int)((seed >> 16) % 64))]);
+		}
+
+		FixedAllocatorBenchOld oldAlloc (blockSize);
+		const double oldMs = RunFixedAllocatorBenchPattern (oldAlloc, order, live, rounds);
+		FixedAllocatorBenchMalloc mallocAlloc (blockSize);
+		const double mallocMs = RunFixedAllocatorBenchPattern (mallocAlloc, order, live, rounds);
+		FixedAllocatorBenchNew newAlloc (blockSize);
+		const double newMs = RunFixedAllocatorBenchPattern (newAlloc, order, live, rounds);
+
+		std::stringstream caseName;
+		caseName << live << " blocks of " << blockSize << " bytes";
+		const size_t iterations = (size_t)rounds * live * 2;
+		ReportResult ("fixed_allocator", caseName.str () + ", old FixedAllocator", iterations, oldMs, newMs);
+		ReportResult ("fixed_allocator", caseName.str () + ", malloc", iterations, mallocMs, newMs);
+		std::cout << "fixed_allocator | chunks held after freeing everything : old " << oldAlloc.GetChunkCount () << ", new "
+			<< newAlloc.m_alloc.getChunkCount () << std::endl;
+		if (res == 0 && newAlloc.m_alloc.getChunkCount () > 1)
+			res = 1;
+		return res;
+	}
+}
@@ -0,0 +1,178 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoGeometryPool.h"
+#include "../AvocadoEngine/AvocadoSceneQuery.h"
+#include <nvsg/Transform.h>
+#include <nvsg/GeoNode.h>
+#include <nvsg/StateSet.h>
+#include <nvsg/Primitive.h>
+#include <nvsg/VertexAttributeSet.h>
+#include <nvsg/IndexSet.h>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+
+using namespace avocado;
+using namespace nvsg;
+
+namespace avocado_bench {
+
+	/* A part file : a bolt or a bracket. The variant only changes the texture coordinates, it hashes as the
+	   part does and has to be told apart by the comparison. */
+	static std::string MakeGeometryPoolBenchPart (int part, int variant, int vertexCount)
+	{
+		std::stringstream text;
+		unsigned int seed = (unsigned int)part * 2654435761u + 11;
+		for (int i=0;i<vertexCount;i++)
+		{
+			text << "v";
+			for (int k=0;k<8;k++)
+				text << " " << (k >= 6 ? float (variant) : float ((BenchRandom (seed) >> 16) % 1000) * 0.01f);
+			text << "\n";
+		}
+		for (int i=0;i+2<vertexCount;i++)
+			text << "f " << i << " " << i + 1 << " " << i + 2 << "\n";
+		return text.str ();
+	}
+
+	/* What a loader makes of the file : a Transform over a GeoNode, its Primitive with a VertexAttributeSet and an
+	   IndexSet of its own. */
+	static NodeSharedPtr LoadGeometryPoolBenchPart (const std::string &text)
+	{
+		std::vector<nvmath::Vec3f> positions;
+		std::vector<nvmath::Vec3f> normals;
+		std::vector<nvmath::Vec2f> texCoords;
+		std::vector<unsigned int> indices;
+		std::istringstream in (text);
+		std::string tag;
+		while (in >> tag)
+		{
+			if (tag == "v")
+			{
+				float v[8];
+				for (int k=0;k<8;k++)
+					in >> v[k];
+				positions.push_back (nvmath::Vec3f (v[0], v[1], v[2]));
+				normals.push_back (nvmath::Vec3f (v[3], v[4], v[5]));
+				texCoords.push_back (nvmath::Vec2f (v[6], v[7]));
+			}
+			else
+			{
+				unsigned int f[3];
+				in >> f[0] >> f[1] >> f[2];
+				indices.insert (indices.end (), f, f + 3);
+			}
+		}
+		VertexAttributeSetSharedPtr vas = VertexAttributeSet::create ();
+		{
+			VertexAttributeSetWriteLock set (vas);
+			set->setVertices (&positions[0], (unsigned int)positions.size ());
+			set->setNormals (&normals[0], (unsigned int)normals.size ());
+			set->setTexCoords (0, &texCoords[0], (unsigned int)texCoords.size ());
+		}
+		IndexSetSharedPtr indexSet = IndexSet::create ();
+		IndexSetWriteLock (indexSet)->setData (&indices[0], (unsigned int)indices.size ());
+		PrimitiveSharedPtr primitive = Primitive::create ();
+		{
+			PrimitiveWriteLock prim (primitive);
+			prim->setPrimitiveType (PRIMITIVE_TRIANGLES);
+			prim->setVertexAttributeSet (vas);
+			prim->setIndexSet (indexSet);
+		}
+		GeoNodeSharedPtr geoNode = GeoNode::create ();
+		GeoNodeWriteLock (geoNode)->addDrawable (StateSet::create (), primitive);
+		TransformSharedPtr root = Transform::create ();
+		TransformWriteLock (root)->addChild (geoNode);
+		return root;
+	}
+
+	static PrimitiveSharedPtr GetGeometryPoolBenchPrimitive (const NodeSharedPtr &root)
+	{
+		return AvocadoSceneQuery ().FindFirst<Primitive> (root);
+	}
+
+	/* An assembly of a few kinds of parts placed thousands of times, each placement a file loaded again : every
+	   placement keeps its own sets before, AvocadoGeometryPool::Share, as attachElementRoot calls it, leaves one
+	   per content after. Reports what the import costs with the pool and GetSharedBytes. Arguments : placements,
+	   part kinds, vertices per part. */
+	int RunGeometryPoolBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int placements = argc > 2 ? atoi (argv[2]) : 3000;
+		const int kinds = argc > 3 ? atoi (argv[3]) : 12;
+		const int vertexCount = argc > 4 ? atoi (argv[4]) : 300;
+
+		std::vector<std::string> files;
+		for (int k=0;k<kinds;k++)
+			files.push_back (MakeGeometryPoolBenchPart (k / 2, k % 2, vertexCount));
+
+		AvocadoGeometryPool &pool = AvocadoGeometryPool::Get ();
+		pool.Clear ();
+		pool.SetEnabled (true);
+
+		std::vector<NodeSharedPtr> copies;
+		BenchTimer timer;
+		for (int p=0;p<placements;p++)
+			copies.push_back (LoadGeometryPoolBenchPart (files[p % kinds]));
+		const double copyMs = timer.ElapsedMs ();
+
+		std::vector<NodeSharedPtr> shared;
+		timer.Restart ();
+		for (int p=0;p<placements;p++)
+		{
+			shared.push_back (LoadGeometryPoolBenchPart (files[p % kinds]));
+			pool.Share (shared.back ());
+		}
+		const double poolMs = timer.ElapsedMs ();
+
+		// every placement keeps equal sets, those of the placements of one kind are the same sets.
+		for (int p=0;p<placements && res == 0;p++)
+		{
+			const PrimitiveSharedPtr copyPrimitive = GetGeometryPoolBenchPrimitive (copies[p]);
+			const PrimitiveSharedPtr primitive = GetGeometryPoolBenchPrimitive (shared[p]);
+			const PrimitiveSharedPtr firstPrimitive = GetGeometryPoolBenchPrimitive (shared[p % kinds]);
+			PrimitiveReadLock copy (copyPrimitive);
+			PrimitiveReadLock prim (primitive);
+			PrimitiveReadLock first (firstPrimitive);
+			VertexAttributeSetReadLock copyVertices (copy->getVertexAttributeSet ());
+			IndexSetReadLock copyIndices (copy->getIndexSet ());
+			if (!VertexAttributeSetReadLock (prim->getVertexAttributeSet ())->isEquivalent ((const VertexAttributeSet*)copyVertices, true, true) ||
+				!IndexSetReadLock (prim->getIndexSet ())->isEquivalent ((const IndexSet*)copyIndices, true) ||
+				prim->getVertexAttributeSet () != first->getVertexAttributeSet () || prim->getIndexSet () != first->getIndexSet ())
+			{
+				std::cout << "geometry_pool | placement " << p << " does not get its part" << std::endl;
+				res = 1;
+			}
+		}
+
+		// a variant keeps a vertex set of its own, every part has the same strip of indices and one index set.
+		const unsigned __int64 vertexBytes = (unsigned __int64)vertexCount * (3 + 3 + 2) * sizeof (float);
+		const unsigned __int64 indexBytes = (unsigned __int64)(vertexCount - 2) * 3 * sizeof (unsigned int);
+		const unsigned __int64 copyBytes = (unsigned __int64)placements * (vertexBytes + indexBytes);
+		const unsigned __int64 poolBytes = (unsigned __int64)kinds * vertexBytes + indexBytes;
+		if (res == 0 && (pool.GetSetCount () != (size_t)kinds + 1 || pool.GetSharedBytes () != copyBytes - poolBytes))
+		{
+			std::cout << "geometry_pool | " << pool.GetSetCount () << " sets kept for " << kinds << " kinds of parts, "
+				<< pool.GetSharedBytes () << " bytes shared" << std::endl;
+			res = 1;
+		}
+		std::stringstream caseName;
+		caseName << placements << " placements of " << kinds << " parts, import";
+		ReportResult ("geometry_pool", caseName.str (), (size_t)placements, copyMs, poolMs);
+		std::cout << "geometry_pool | geometry " << copyBytes / 1024 << " KB before, " << poolBytes / 1024 << " KB after, "
+			<< pool.GetSharedBytes () / 1024 << " KB not loaded twice" << std::endl;
+
+		// once the elements are gone nothing holds the sets but the pool.
+		shared.clear ();
+		pool.Prune ();
+		if (pool.GetSetCount () != 0)
+		{
+			std::cout << "geometry_pool | " << pool.GetSetCount () << " sets left after the elements went" << std::endl;
+			res = 1;
+		}
+		pool.Clear ();
+		return res;
+	}
+}
@@ -0,0 +1,207 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoImportScheduler.h"
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* The model file of an assembly part : vertex lines like an .obj and the material it is painted with. */
+	static std::string MakeImportBenchPart (int part, int vertices, int materials)
+	{
+		std::stringstream text;
+		text << "usemtl material" << part % materials << "\n";
+		unsigned int seed = (unsigned int)part * 2654435761u + 1;
+		for (int i=0;i<vertices;i++)
+		{
+			float v[3];
+			for (int k=0;k<3;k++)
+			{
+				BenchRandom (seed);
+				// the grid makes the welding find shared vertices.
+				v[k] = float ((seed >> 16) % 64) * 0.25f + float (part);
+			}
+			text << "v " << v[0] << " " << v[1] << " " << v[2] << "\n";
+		}
+		return text.str ();
+	}
+
+	/* Stands for building an effect : rounds of mixing over the shader source. */
+	static std::string CompileImportBenchEffect (const std::string &source, int rounds)
+	{
+		unsigned int h = 2166136261u;
+		for (int r=0;r<rounds;r++)
+			for (size_t i=0;i<source.size ();i++)
+				h = (h ^ (unsigned char)source[i]) * 16777619u;
+		std::stringstream effect;
+		effect << source << "#" << h;
+		return effect.str ();
+	}
+
+	struct ImportBenchEffectMaker
+	{
+		ImportBenchEffectMaker (int rounds) : m_rounds (rounds) {}
+		std::string Make (const std::string &source) { return CompileImportBenchEffect (source, m_rounds); }
+		std::string Copy (const std::string &cached) { return cached; }
+		int m_rounds;
+	};
+
+	/* The stages of a file import : the load under the loader lock, the optimize (bounds and vertex welding), the
+	   effect and the naming. The checksum stands for the element root. */
+	static unsigned int ImportBenchPart (const std::string &text, AvocadoImportLock *loaderLock, AvocadoImportCache<std::string> *effects, int compileRounds)
+	{
+		std::vector<float> vertices;
+		std::string material;
+		{
+			if (loaderLock)
+				loaderLock->Enter ();
+			std::istringstream in (text);
+			std::string tag;
+			in >> tag >> material;
+			float x, y, z;
+			while (in >> tag >> x >> y >> z)
+			{
+				vertices.push_back (x);
+				vertices.push_back (y);
+				vertices.push_back (z);
+			}
+			if (loaderLock)
+				loaderLock->Leave ();
+		}
+
+		float bounds[6] = { 1e30f, 1e30f, 1e30f, -1e30f, -1e30f, -1e30f };
+		std::vector<std::pair<unsigned int,unsigned int> > keys;
+		for (size_t i=0;i<vertices.size ();i+=3)
+		{
+			for (int k=0;k<3;k++)
+			{
+				bounds[k] = std::min (bounds[k], vertices[i + k]);
+				bounds[k + 3] = std::max (bounds[k + 3], vertices[i + k]);
+			}
+			const unsigned int key = (unsigned int)(vertices[i] * 4.0f) * 73856093u ^ (unsigned int)(vertices[i + 1] * 4.0f) * 19349663u ^ (unsigned int)(vertices[i + 2] * 4.0f) * 83492791u;
+			keys.push_back (std::make_pair (key, (unsigned int)(i / 3)));
+		}
+		std::sort (keys.begin (), keys.end ());
+		unsigned int unique = 0;
+		for (size_t i=0;i<keys.size ();i++)
+			if (i == 0 || keys[i].first != keys[i - 1].first)
+				unique++;
+
+		const std::string source = "technique " + material + " { pass p0 { LightingEnable = true; } }";
+		ImportBenchEffectMaker maker (compileRounds);
+		const std::string effect = effects ? effects->Find (source, maker) : maker.Make (source);
+
+		std::stringstream names;
+		names << material << "_" << unique << "_" << bounds[0] << "_" << bounds[5];
+		const std::string name = names.str ();
+
+		unsigned int h = 2166136261u;
+		const std::string all = name + effect;
+		for (size_t i=0;i<all.size ();i++)
+			h = (h ^ (unsigned char)all[i]) * 16777619u;
+		return h;
+	}
+
+	class ImportBenchTask : public AvocadoImportTask
+	{
+	public:
+		ImportBenchTask (const std::string *text, AvocadoImportLock *loaderLock, AvocadoImportCache<std::string> *effects, int compileRounds)
+			: m_text (text), m_loaderLock (loaderLock), m_effects (effects), m_compileRounds (compileRounds), m_checksum (0) {}
+		~ImportBenchTask () { Finish (); }
+
+		unsigned int GetChecksum () const { return m_checksum; }
+	protected:
+		virtual Result Run ()
+		{
+			m_checksum = ImportBenchPart (*m_text, m_loaderLock, m_effects, m_compileRounds);
+			return IMPORT_SUCCEEDED;
+		}
+	private:
+		const std::string					*m_text;
+		AvocadoImportLock					*m_loaderLock;
+		AvocadoImportCache<std::string>		*m_effects;
+		int									m_compileRounds;
+		unsigned int						m_checksum;
+	};
+
+	/* Opening an assembly : every part is started on the import scheduler and attached in document order, as
+	   LoadElementBlocks and AddDocFileElement do. */
+	static bool OpenImportBenchAssembly (const std::vector<std::string> &parts, int compileRounds, std::vector<unsigned int> &checksums, size_t &compiles)
+	{
+		AvocadoImportLock loaderLock;
+		AvocadoImportCache<std::string> effects;
+		std::vector<ImportBenchTask*> tasks;
+		bool ok = true;
+		for (size_t i=0;i<parts.size ();i++)
+		{
+			tasks.push_back (new ImportBenchTask (&parts[i], &loaderLock, &effects, compileRounds));
+			tasks.back ()->Start ();
+		}
+		checksums.clear ();
+		for (size_t i=0;i<tasks.size ();i++)
+		{
+			ok = ok && tasks[i]->Wait () == AvocadoImportTask::IMPORT_SUCCEEDED;
+			checksums.push_back (tasks[i]->GetChecksum ());
+			delete tasks[i];
+		}
+		compiles = effects.GetMisses ();
+		return ok;
+	}
+
+	/* Opening a 200 part assembly : one part after the other and every effect built per part before, the import
+	   scheduler with the shared effect cache after, on 1, 4 and 16 threads. Arguments : parts, vertices per part. */
+	int RunImportBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int partCount = argc > 2 ? atoi (argv[2]) : 200;
+		const int vertexCount = argc > 3 ? atoi (argv[3]) : 4000;
+		const int materials = 8;
+		const int compileRounds = 400;
+		ReportCores ("import");
+
+		std::vector<std::string> parts;
+		for (int i=0;i<partCount;i++)
+			parts.push_back (MakeImportBenchPart (i, vertexCount, materials));
+
+		std::vector<unsigned int> baseline;
+		BenchTimer timer;
+		for (int i=0;i<partCount;i++)
+			baseline.push_back (ImportBenchPart (parts[i], NULL, NULL, compileRounds));
+		const double baselineMs = timer.ElapsedMs ();
+
+		const int threadCounts[] = { 1, 4, 16 };
+		for (size_t t=0;t<sizeof (threadCounts) / sizeof (threadCounts[0]) && res == 0;t++)
+		{
+			AvocadoImportScheduler::Get ().SetThreadCount (threadCounts[t]);
+			std::vector<unsigned int> checksums;
+			size_t compiles = 0;
+			timer.Restart ();
+			const bool ok = OpenImportBenchAssembly (parts, compileRounds, checksums, compiles);
+			const double ms = timer.ElapsedMs ();
+			// the same elements in the same order, whatever finished first.
+			if (!ok || checksums != baseline)
+			{
+				std::cout << "import | " << threadCounts[t] << " threads : the assembly differs from the one by one load" << std::endl;
+				res = 1;
+			}
+			if (compiles != (size_t)std::min (partCount, materials))
+			{
+				std::cout << "import | " << threadCounts[t] << " threads : " << compiles << " effects built for " << materials << " materials" << std::endl;
+				res = 1;
+			}
+			std::stringstream caseName;
+			caseName << partCount << " parts, " << threadCounts[t] << " threads";
+			ReportResult ("import", caseName.str (), (size_t)partCount, baselineMs, ms);
+		}
+		AvocadoImportScheduler::Get ().SetThreadCount (0);
+		AvocadoImportScheduler::Get ().Shutdown ();
+		return res;
+	}
+}
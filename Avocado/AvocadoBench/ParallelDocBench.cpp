@@ -0,0 +1,157 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoParams.h"
+#include "../AvocadoEngine/AvocadoWorkerPool.h"
+#include <sstream>
+#include <vector>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	static const size_t s_benchBatchSize = 512;
+
+	/* An element list as serializeParams gives it, with a bit of meta data and a removed geo node list. */
+	static ParamListSharedPtr MakeElementParams (int id)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		pl->PushString ("OwnerModule", "ImportModule");
+		pl->PushBool ("isGroup", false);
+		pl->PushBool ("isRef", (id % 4) == 0);
+		pl->PushString ("fileName", "C:\\Models\\Engine Block, rev 3;final.nbf");
+		pl->PushInt ("elementID", id);
+		pl->PushString ("elementName", "Engine Block, rev 3");
+		pl->PushInt ("MetaCount", 4);
+		for (int m=0;m<4;m++)
+		{
+			std::stringstream name;
+			name << m;
+			pl->PushString ("metaVarName" + name.str (), "Part");
+			pl->PushString ("metaVarData" + name.str (), "EB-3;ACME Ltd");
+		}
+		pl->PushBool ("Visibility", true);
+		pl->PushInt ("MaterialID", id % 97);
+		pl->PushInt ("removedGeoNodesCount", 8);
+		for (int r=0;r<8;r++)
+		{
+			std::stringstream name;
+			name << "RemovedGeoNode" << r;
+			pl->PushString (name.str (), "GeoNode_cylinder_head_bolt");
+		}
+		float mat[16];
+		for (int i=0;i<16;i++)
+			mat[i] = ((i % 5 == 0) ? 1.0f : 0.0f) + id * 0.001f;
+		pl->PushFloat16 ("Location", mat);
+		return pl;
+	}
+
+	class BenchFormatTask : public AvocadoParallelTask
+	{
+	public:
+		BenchFormatTask (std::vector<ParamListSharedPtr> &params, std::vector<string> &texts, size_t first) : m_params (params), m_texts (texts), m_first (first) {}
+		virtual void Run (size_t index) { m_texts[m_first + index] = m_params[m_first + index]->SerializeList (); }
+	private:
+		std::vector<ParamListSharedPtr>		&m_params;
+		std::vector<string>					&m_texts;
+		size_t								m_first;
+	};
+
+	class BenchParseTask : public AvocadoParallelTask
+	{
+	public:
+		BenchParseTask (const std::vector<string> &texts, std::vector<string> &binaries, size_t first) : m_texts (texts), m_binaries (binaries), m_first (first) {}
+		virtual void Run (size_t index)
+		{
+			ParamListSharedPtr pl = ParamList::createFromString (m_texts[m_first + index]);
+			bool isRef = false;
+			pl->GetBoolValueByName ("isRef", isRef);
+			if (isRef)
+				pl->PushBool ("UpdateDocUI", false);
+			m_binaries[m_first + index] = pl->SerializeBinary ();
+		}
+	private:
+		const std::vector<string>			&m_texts;
+		std::vector<string>					&m_binaries;
+		size_t								m_first;
+	};
+
+	static bool SameStrings (const std::vector<string> &a, const std::vector<string> &b)
+	{
+		if (a.size () != b.size ())
+			return false;
+		for (size_t i=0;i<a.size ();i++)
+			if (a[i] != b[i])
+				return false;
+		return true;
+	}
+
+	/* Element text on save and element parsing on load, as the document does them, by worker thread count.
+	   Batches of 512 like AvocadoEngineDoc, every thread count must give the single thread output. */
+	int RunParallelDocBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int elements = 50000;
+		std::vector<ParamListSharedPtr> params (elements);
+		for (int i=0;i<elements;i++)
+			params[i] = MakeElementParams (i);
+
+		ReportCores ("parallel_doc");
+		AvocadoWorkerPool &pool = AvocadoWorkerPool::Get ();
+		pool.SetThreadCount (0);
+		const int cores = pool.GetThreadCount ();
+		std::vector<int> threadCounts;
+		for (int t=1;t<cores;t*=2)
+			threadCounts.push_back (t);
+		threadCounts.push_back (cores);
+		if (cores == 1)
+			threadCounts.push_back (4);	// no speed up here, but the threads still have to agree with the serial run.
+
+		std::vector<string> serialTexts, serialBinaries;
+		double serialFormatMs = 0.0, serialParseMs = 0.0;
+		for (size_t c=0;c<threadCounts.size ();c++)
+		{
+			pool.SetThreadCount (threadCounts[c]);
+			std::vector<string> texts (elements), binaries (elements);
+
+			BenchTimer timer;
+			for (size_t first=0;first<size_t (elements);first+=s_benchBatchSize)
+			{
+				const size_t batch = (elements - first < s_benchBatchSize ? elements - first : s_benchBatchSize);
+				BenchFormatTask task (params, texts, first);
+				pool.ParallelFor (batch, task);
+			}
+			const double formatMs = timer.ElapsedMs ();
+
+			timer.Restart ();
+			for (size_t first=0;first<size_t (elements);first+=s_benchBatchSize)
+			{
+				const size_t batch = (elements - first < s_benchBatchSize ? elements - first : s_benchBatchSize);
+				BenchParseTask task (texts, binaries, first);
+				pool.ParallelFor (batch, task);
+			}
+			const double parseMs = timer.ElapsedMs ();
+
+			if (c == 0)
+			{
+				serialTexts.swap (texts);
+				serialBinaries.swap (binaries);
+				serialFormatMs = formatMs;
+				serialParseMs = parseMs;
+			}
+			else if (!SameStrings (texts, serialTexts) || !SameStrings (binaries, serialBinaries))
+			{
+				std::cout << "parallel_doc | " << threadCounts[c] << " threads | output differs from the serial run" << std::endl;
+				res = 1;
+			}
+			std::stringstream caseName;
+			caseName << elements << " elements, " << threadCounts[c] << " threads";
+			ReportResult ("parallel_doc", caseName.str () + ", save text", elements, serialFormatMs, formatMs);
+			ReportResult ("parallel_doc", caseName.str () + ", load parse", elements, serialParseMs, parseMs);
+		}
+		pool.SetThreadCount (0);
+		pool.Shutdown ();
+		return res;
+	}
+}
@@ -0,0 +1,332 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoParams.h"
+#include <sstream>
+#include <vector>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	//----------------------------------------------
+	// Legacy parser, kept as it was before the arena parser so we can compare output and speed.
+	// Every token goes through substr/find, every param is a separate heap object and numbers go through istringstream.
+
+	struct LegacyParam
+	{
+		LegacyParam (const string &type, const string &name) : m_type (type), m_name (name) {}
+		virtual ~LegacyParam () {}
+		string m_type;
+		string m_name;
+		string m_text;	// value as the new ParamList would print it with GetValue (string&).
+	};
+
+	struct LegacyIntParam : public LegacyParam
+	{
+		LegacyIntParam (const string &name, const string &x) : LegacyParam ("Integer", name), value (0)
+		{
+			std::istringstream xs(x);
+			xs >> value;
+			std::stringstream vs;
+			vs << value;
+			m_text = vs.str();
+		}
+		int value;
+	};
+
+	struct LegacyFloatParam : public LegacyParam
+	{
+		LegacyFloatParam (const string &name, const string &x) : LegacyParam ("Float", name), value (0.0f)
+		{
+			std::istringstream xs(x);
+			xs >> value;
+			std::stringstream vs;
+			vs << value;
+			m_text = vs.str();
+		}
+		float value;
+	};
+
+	struct LegacyFloat16Param : public LegacyParam
+	{
+		LegacyFloat16Param (const string &name, const string &x) : LegacyParam ("Float16", name)
+		{
+			for (int i=0;i<16;i++)
+				value[i] = 0.0f;
+			size_t k=0;
+			size_t cell = 0;
+			while (k<x.size() && cell < 16)
+			{
+				std::string temp  = "";
+				while (k<x.size() && x[k] != 'F')
+				{
+					temp+= x[k];
+					k++;
+				}
+				std::istringstream xs(temp);
+				xs >> value[cell] ;
+				cell++;
+				k++;
+			}
+			std::stringstream vs;
+			for (int i=0;i<16;i++)
+				vs << value[i] << "F";
+			m_text = vs.str();
+		}
+		float value[16];
+	};
+
+	struct LegacyBoolParam : public LegacyParam
+	{
+		LegacyBoolParam (const string &name, const string &x) : LegacyParam ("Boolean", name)
+		{
+			value = (x == "1");
+			m_text = value ? "1" : "0";
+		}
+		bool value;
+	};
+
+	struct LegacyStringParam : public LegacyParam
+	{
+		LegacyStringParam (const string &name, const string &x) : LegacyParam ("String", name)
+		{
+			m_text = x;
+		}
+	};
+
+	struct LegacyPointerParam : public LegacyParam
+	{
+		LegacyPointerParam (const string &name, const string &x) : LegacyParam ("Pointer", name)
+		{
+			std::istringstream xs(x);
+			int xi = 0;
+			xs >> xi;
+			value = (void*)(intptr_t)xi;
+		}
+		void *value;
+	};
+
+	static void LegacyCreateFromString (const string &params, vector <LegacyParam*> &res)
+	{
+		unsigned int pos = 0;
+		int last = -1;
+		int prevStringIdx = -1;
+		while (pos < params.size())
+		{
+			if (params[pos] == ',' || params[pos] == ';')
+			{
+				string param =  params.substr (last+1,pos-last-1);
+				size_t eq = param.find ("=");
+				size_t sq = param.find (" ");
+				string type,name,value ;
+				if (sq == string::npos || eq == string::npos)
+				{
+					type = "none";
+				}
+				else
+				{
+					type =  param.substr (0,sq);
+					name = param.substr(sq+1,eq-sq-1);
+					value = param.substr (eq+1,param.size()-eq-1);
+				}
+				if (type == "int")
+				{
+					prevStringIdx = -1;
+					res.push_back (new LegacyIntParam (name,value));
+				}
+				else if (type == "float")
+				{
+					prevStringIdx = -1;
+					res.push_back (new LegacyFloatParam (name,value));
+				}
+				else if (type == "float16")
+				{
+					prevStringIdx = -1;
+					res.push_back (new LegacyFloat16Param (name,value));
+				}
+				else if (type == "bool")
+				{
+					prevStringIdx = -1;
+					res.push_back (new LegacyBoolParam (name,value));
+				}
+				else if (type == "string")
+				{
+					prevStringIdx = (int)res.size();
+					res.push_back (new LegacyStringParam (name,value));
+				}
+				else if (type == "ptr")
+				{
+					prevStringIdx = -1;
+					res.push_back (new LegacyPointerParam (name,value));
+				}
+				else if (prevStringIdx != -1)
+				{
+					LegacyParam *p = res[prevStringIdx];
+					string val = p->m_text;
+					val += params[last];
+					val += param;
+					p->m_text = val;
+				}
+				last = pos;
+			}
+			pos++;
+		}
+	}
+
+	static void LegacyFree (vector <LegacyParam*> &res)
+	{
+		for (size_t i=0;i<res.size();i++)
+			delete res[i];
+		res.clear();
+	}
+
+	//----------------------------------------------
+	// Sample messages, shaped like the strings the engine sends around.
+
+	static string MakeMouseMessage ()
+	{
+		return "int x=512,int y=384,bool ctrl=0,bool shift=0,bool lbutton=1,bool rbutton=0,bool mbutton=0,int vid=0,";
+	}
+
+	static string MakePickMessage ()
+	{
+		return "string owner=AvocadoSelectionModule,bool prepick=1,int eid=5,int vid=0,bool multi=0,int x=511,int y=380,";
+	}
+
+	static string MakeSetViewParamMessage ()
+	{
+		return "string RenderStyle=1;";
+	}
+
+	static string MakeFileElementMessage ()
+	{
+		std::stringstream ss;
+		ss << "string OwnerModule=AvocadoImportModule,bool isGroup=0,bool isRef=0,";
+		ss << "string fileName=C:\\Models\\Engine Block, rev 3;final.nbf,";
+		ss << "int elementID=4711,string elementName=Engine Block, rev 3,";
+		ss << "int MetaCount=2,string metaVarName0=Part,string metaVarData0=EB-3,string metaVarName1=Vendor,string metaVarData1=ACME;Ltd,";
+		ss << "bool Visibility=1,int MaterialID=12,int ColorRed=200,int ColorGreen=120,int ColorBlue=40,";
+		const char *mats[] = { "Ambient", "Diffuse", "Specular", "Emissive", "Shininess", "Opacity", "Reflectivity", "Refraction" };
+		for (int i=0;i<8;i++)
+		{
+			ss << "float Mat" << mats[i] << "R=" << 0.125f * (i + 1) << ",";
+			ss << "float Mat" << mats[i] << "G=" << 0.5f / (i + 1) << ",";
+			ss << "float Mat" << mats[i] << "B=" << 0.03125f * i << ",";
+		}
+		ss << "float16 Location=";
+		for (int i=0;i<16;i++)
+			ss << ((i % 5 == 0) ? 1.0f : 0.0f) + i * 0.25f << "F";
+		ss << ",";
+		return ss.str();
+	}
+
+	static string MakeDocumentHeaderLine ()
+	{
+		std::stringstream ss;
+		ss << "int DocVersion=1,int ViewsCount=1,";
+		for (int i=0;i<16;i++)
+			ss << "float ViewLocation" << i << "=" << (i % 5 == 0 ? 1.0f : 0.001f * i) << ",";
+		ss << "int ViewStatesCount=8,";
+		for (int vs=0;vs<8;vs++)
+		{
+			ss << "string ViewStateName-" << vs << "=Saved view " << vs << ", front;left,";
+			ss << "float16 ViewStateLocation-" << vs << "=";
+			for (int i=0;i<16;i++)
+				ss << (i % 5 == 0 ? 1.0f : 0.0f) + vs * 0.5f << "F";
+			ss << ",";
+			ss << "int ViewStateElementsCount-" << vs << "=4,";
+			for (int e=0;e<4;e++)
+			{
+				ss << "int ViewStateElementID" << vs << "-" << e << "=" << (vs * 10 + e) << ",";
+				ss << "float16 ViewStateElementLocation-" << vs << "-" << e << "=";
+				for (int i=0;i<16;i++)
+					ss << (i % 5 == 0 ? 1.0f : 0.0f) << "F";
+				ss << ",";
+			}
+		}
+		ss << "int LastIDCount=5003,";
+		return ss.str();
+	}
+
+	//----------------------------------------------
+
+	static bool SameLists (const ParamListSharedPtr &pl, const vector <LegacyParam*> &legacy)
+	{
+		if (pl->GetParamCount() != legacy.size())
+			return false;
+		for (size_t i=0;i<legacy.size();i++)
+		{
+			Param *p = pl->GetParam (i);
+			string name, text;
+			p->GetName (name);
+			if (p->GetTypeId() == PARAM_TYPE_POINTER)
+			{
+				void *v = 0;
+				p->GetValue (&v);
+				if (v != ((LegacyPointerParam*)legacy[i])->value)
+					return false;
+			}
+			else
+			{
+				p->GetValue (text);
+			}
+			if (p->GetType() != legacy[i]->m_type || name != legacy[i]->m_name)
+				return false;
+			if (p->GetTypeId() != PARAM_TYPE_POINTER && text != legacy[i]->m_text)
+				return false;
+		}
+		return true;
+	}
+
+	int RunParamsBench (int argc, char **argv)
+	{
+		struct Case { const char *name; string text; size_t iterations; };
+		Case cases[] = {
+			{ "mouse move", MakeMouseMessage (), 200000 },
+			{ "pick", MakePickMessage (), 200000 },
+			{ "SetViewParam", MakeSetViewParamMessage (), 500000 },
+			{ "AddDocFileElement", MakeFileElementMessage (), 20000 },
+			{ "document header", MakeDocumentHeaderLine (), 5000 }
+		};
+		const size_t caseCount = sizeof (cases) / sizeof (cases[0]);
+
+		int res = 0;
+		for (size_t c=0;c<caseCount;c++)
+		{
+			vector <LegacyParam*> legacy;
+			LegacyCreateFromString (cases[c].text, legacy);
+			ParamListSharedPtr pl = ParamList::createFromString (cases[c].text);
+			if (!SameLists (pl, legacy))
+			{
+				std::cout << "params | " << cases[c].name << " | MISMATCH between legacy and arena parser" << std::endl;
+				res = 1;
+			}
+			LegacyFree (legacy);
+
+			size_t touched = 0;
+			BenchTimer timer;
+			for (size_t i=0;i<cases[c].iterations;i++)
+			{
+				LegacyCreateFromString (cases[c].text, legacy);
+				touched += legacy.size();
+				LegacyFree (legacy);
+			}
+			double legacyMs = timer.ElapsedMs ();
+
+			timer.Restart ();
+			for (size_t i=0;i<cases[c].iterations;i++)
+			{
+				ParamListSharedPtr parsed = ParamList::createFromString (cases[c].text);
+				touched += parsed->GetParamCount ();
+			}
+			double arenaMs = timer.ElapsedMs ();
+
+			ReportResult ("params", cases[c].name, cases[c].iterations, legacyMs, arenaMs);
+			if (touched == 0)
+				res = 1;
+		}
+		return res;
+	}
+}
@@ -0,0 +1,131 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoParams.h"
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* An AddDocFileElement list as the document loader hands it to the import module. */
+	static ParamListSharedPtr MakeFileElementList ()
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		pl->PushString ("OwnerModule", "ImportModule");
+		pl->PushBool ("isGroup", false);
+		pl->PushBool ("isRef", false);
+		pl->PushString ("fileName", "C:\\Models\\Engine Block, rev 3;final.nbf");
+		pl->PushInt ("elementID", 4711);
+		pl->PushString ("elementName", "Engine Block, rev 3");
+		pl->PushInt ("MetaCount", 2);
+		pl->PushString ("metaVarName0", "Part");
+		pl->PushString ("metaVarData0", "EB-3");
+		pl->PushString ("metaVarName1", "Vendor");
+		pl->PushString ("metaVarData1", "ACME;Ltd");
+		pl->PushBool ("Visibility", true);
+		pl->PushInt ("MaterialID", -12);
+		float mat[16];
+		for (int i=0;i<16;i++)
+			mat[i] = ((i % 5 == 0) ? 1.0f : 0.0f) + i * 0.1f;
+		pl->PushFloat16 ("Location", mat);
+		vector <int> children;
+		for (int i=0;i<64;i++)
+			children.push_back (1000 + i * 3);
+		pl->PushIntArray ("GroupChildIDs", &children[0], children.size());
+		return pl;
+	}
+
+	/* A view state block, mostly matrices, like the document header carries per view state. */
+	static ParamListSharedPtr MakeViewStateList (int elements)
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		vector <float> locations (16 * size_t (elements));
+		vector <int> ids (elements);
+		for (int ks=0;ks<elements;ks++)
+		{
+			for (int i=0;i<16;i++)
+				locations[16 * ks + i] = ((i % 5 == 0) ? 1.0f : 0.0f) + ks * 0.001f;
+			ids[ks] = ks + 1;
+		}
+		pl->PushIntArray ("ViewStateElementIDs0", &ids[0], ids.size());
+		pl->PushFloat16Array ("ViewStateElementLocations0", &locations[0], elements);
+		pl->PushInt ("ViewStateCount", 1);
+		return pl;
+	}
+
+	/* Binary round trip must give back the very same list, floats included. */
+	static bool SameAfterBinaryRoundTrip (const ParamListSharedPtr &pl)
+	{
+		ParamListSharedPtr copy = ParamList::createFromString (pl->SerializeBinary ());
+		if (copy->GetParamCount () != pl->GetParamCount ())
+			return false;
+		for (size_t i=0;i<pl->GetParamCount ();i++)
+		{
+			Param *a = pl->GetParam (i);
+			Param *b = copy->GetParam (i);
+			string an, bn, av, bv;
+			a->GetName (an);
+			b->GetName (bn);
+			a->GetValue (av);
+			b->GetValue (bv);
+			if (a->GetTypeId () != b->GetTypeId () || an != bn || av != bv)
+				return false;
+		}
+		return copy->SerializeBinary () == pl->SerializeBinary ();
+	}
+
+	static void RunRoundTripCase (const char *caseName, const ParamListSharedPtr &pl, size_t iterations, int &res)
+	{
+		if (!SameAfterBinaryRoundTrip (pl))
+		{
+			std::cout << "params_binary | " << caseName << " | MISMATCH after binary round trip" << std::endl;
+			res = 1;
+		}
+		size_t touched = 0;
+		BenchTimer timer;
+		for (size_t i=0;i<iterations;i++)
+		{
+			ParamListSharedPtr parsed = ParamList::createFromString (pl->SerializeList ());
+			touched += parsed->GetParamCount ();
+		}
+		double textMs = timer.ElapsedMs ();
+
+		timer.Restart ();
+		for (size_t i=0;i<iterations;i++)
+		{
+			ParamListSharedPtr parsed = ParamList::createFromString (pl->SerializeBinary ());
+			touched += parsed->GetParamCount ();
+		}
+		double binaryMs = timer.ElapsedMs ();
+
+		std::stringstream name;
+		name << caseName << ", serialize + parse, " << pl->SerializeList ().size () << " bytes text vs " << pl->SerializeBinary ().size () << " bytes binary";
+		ReportResult ("params_binary", name.str (), iterations, textMs, binaryMs);
+		if (touched == 0)
+			res = 1;
+	}
+
+	int RunParamsBinaryBench (int argc, char **argv)
+	{
+		int elements = 5000;
+		if (argc > 2)
+			elements = atoi (argv[2]);
+		int res = 0;
+		RunRoundTripCase ("AddDocFileElement", MakeFileElementList (), 20000, res);
+		std::stringstream vsName;
+		vsName << "view state, " << elements << " elements";
+		RunRoundTripCase (vsName.str ().c_str (), MakeViewStateList (elements), 20, res);
+
+		// text still has to work for the shell and scripts, and binary must never be mistaken for it.
+		if (ParamList::IsBinary ("int x=1,") || !ParamList::IsBinary (MakeFileElementList ()->SerializeBinary ()))
+		{
+			std::cout << "params_binary | format detection is broken" << std::endl;
+			res = 1;
+		}
+		return res;
+	}
+}
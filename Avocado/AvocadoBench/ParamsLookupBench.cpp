@@ -0,0 +1,264 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoParams.h"
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* Synthetic document header, written with the same keys as AvocadoEngineDoc::SerializeDocument. */
+	static string MakeHeaderLine (int viewStates, int elements)
+	{
+		ParamListSharedPtr dppl = ParamList::createNew ();
+		float ident[16];
+		for (int i=0;i<16;i++)
+			ident[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+		for (int i=0;i<16;i++)
+		{
+			std::stringstream key;
+			key << "ViewLocation" << i;
+			dppl->PushFloat (key.str(), ident[i]);
+		}
+		for (int vs=0;vs<viewStates;vs++)
+		{
+			std::stringstream dd;
+			dd << vs;
+			dppl->PushFloat16 ("ViewStateLocation-" + dd.str(), ident);
+			dppl->PushInt ("ViewStateElementCount" + dd.str(), elements);
+			for (int ks=0;ks<elements;ks++)
+			{
+				std::stringstream key;
+				key << "ViewStateElementID" << vs << "-" << ks;
+				dppl->PushInt (key.str(), ks + 1);
+			}
+			for (int ks=0;ks<elements;ks++)
+			{
+				std::stringstream key;
+				key << "ViewStateElementLocation-" << vs << "-" << ks;
+				dppl->PushFloat16 (key.str(), ident);
+			}
+			for (int ks=0;ks<elements;ks++)
+			{
+				std::stringstream key;
+				key << "ViewStateElementVisibility-" << vs << "-" << ks;
+				dppl->PushBool (key.str(), (ks & 1) == 0);
+			}
+		}
+		dppl->PushInt ("CurrentViewState", 0);
+		dppl->PushInt ("ViewStateCount", viewStates);
+		dppl->PushInt ("LastIDCount", elements + 1);
+		return dppl->SerializeList ();
+	}
+
+	/* GetParam as it was before the name index, a linear scan copying every name. */
+	static Param* LegacyGetParam (const ParamListSharedPtr &pl, const string &name)
+	{
+		size_t i=0;
+		while (i<pl->GetParamCount())
+		{
+			string cn;
+			pl->GetParam (i)->GetName (cn);
+			if (cn == name)
+				return pl->GetParam (i);
+			i++;
+		}
+		return 0;
+	}
+
+	static void ElementKeys (int vs, int ks, string &idKey, string &locKey, string &visKey)
+	{
+		char dd[16], cc[16];
+		sprintf (dd, "%d", vs);
+		sprintf (cc, "%d", ks);
+		idKey = string ("ViewStateElementID") + dd + "-" + cc;
+		locKey = string ("ViewStateElementLocation-") + dd + "-" + cc;
+		visKey = string ("ViewStateElementVisibility-") + dd + "-" + cc;
+	}
+
+	/* Reads the view states the way the document loader does. Returns a checksum so nothing gets optimized away. */
+	static long long LoadViewStates (const ParamListSharedPtr &dppl)
+	{
+		static const ParamAtom s_viewStateCount ("ViewStateCount");
+		long long sum = 0;
+		int vsCount = 0;
+		if (!dppl->GetIntValueByName (s_viewStateCount, vsCount))
+			return -1;
+		string idKey, locKey, visKey;
+		for (int vs=0;vs<vsCount;vs++)
+		{
+			char dd[16];
+			sprintf (dd, "%d", vs);
+			int elemCount = 0;
+			float mat[16];
+			dppl->GetFloat16ValueByName (string ("ViewStateLocation-") + dd, mat);
+			dppl->GetIntValueByName (string ("ViewStateElementCount") + dd, elemCount);
+			for (int ks=0;ks<elemCount;ks++)
+			{
+				ElementKeys (vs, ks, idKey, locKey, visKey);
+				int id = 0;
+				bool vis = false;
+				dppl->GetIntValueByName (idKey, id);
+				dppl->GetFloat16ValueByName (locKey, mat);
+				dppl->GetBoolValueByName (visKey, vis);
+				sum += id + (vis ? 1 : 0) + int (mat[0]);
+			}
+		}
+		return sum;
+	}
+
+	int RunParamsLookupBench (int argc, char **argv)
+	{
+		int viewStates = 50;
+		int elements = 5000;
+		if (argc > 3)
+		{
+			viewStates = atoi (argv[2]);
+			elements = atoi (argv[3]);
+		}
+		int res = 0;
+
+		BenchTimer timer;
+		string header = MakeHeaderLine (viewStates, elements);
+		std::cout << "params_lookup | header line " << header.size() / (1024 * 1024) << " MB built in " << timer.ElapsedMs () << " ms" << std::endl;
+
+		timer.Restart ();
+		ParamListSharedPtr dppl = ParamList::createFromString (header);
+		std::cout << "params_lookup | " << dppl->GetParamCount () << " params parsed in " << timer.ElapsedMs () << " ms" << std::endl;
+
+		timer.Restart ();
+		long long sum = LoadViewStates (dppl);
+		double indexedMs = timer.ElapsedMs ();
+		const size_t lookups = size_t (viewStates) * size_t (elements) * 3;
+
+		// the old lookup is far too slow for the whole document, time an even sample and project it.
+		const int samples = 100;
+		string idKey, locKey, visKey;
+		long long legacySum = 0;
+		timer.Restart ();
+		for (int s=0;s<samples;s++)
+		{
+			size_t pos = size_t (s) * size_t (viewStates) * size_t (elements) / samples;
+			int vs = int (pos / elements);
+			int ks = int (pos % elements);
+			ElementKeys (vs, ks, idKey, locKey, visKey);
+			int id = 0;
+			if (Param *p = LegacyGetParam (dppl, idKey))
+				p->GetValue (id);
+			LegacyGetParam (dppl, locKey);
+			LegacyGetParam (dppl, visKey);
+			legacySum += id;
+
+			int indexedId = -1;
+			dppl->GetIntValueByName (idKey, indexedId);
+			if (indexedId != id)
+				res = 1;
+		}
+		double legacyPerLookup = timer.ElapsedMs () / (samples * 3);
+		double legacyProjectedMs = legacyPerLookup * double (lookups);
+
+		std::stringstream caseName;
+		caseName << "document load, " << elements << " elements x " << viewStates << " view states, " << lookups << " lookups (before is projected)";
+		ReportResult ("params_lookup", caseName.str (), 1, legacyProjectedMs, indexedMs);
+		if (res || sum <= 0 || legacySum <= 0)
+		{
+			std::cout << "params_lookup | MISMATCH between linear and indexed lookup" << std::endl;
+			res = 1;
+		}
+		return res;
+	}
+
+	/* The same view states written the way the document writer does it now, one array param per list. */
+	static string MakeArrayHeaderLine (int viewStates, int elements)
+	{
+		ParamListSharedPtr dppl = ParamList::createNew ();
+		float ident[16];
+		for (int i=0;i<16;i++)
+			ident[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+		dppl->PushFloat16 ("ViewLocation", ident);
+		vector <float> locations (16 * size_t (elements));
+		vector <int> ids (elements), visibility (elements);
+		for (int ks=0;ks<elements;ks++)
+		{
+			memcpy (&locations[16 * ks], ident, sizeof (ident));
+			ids[ks] = ks + 1;
+			visibility[ks] = (ks & 1) == 0;
+		}
+		vector <float> vsLocations;
+		for (int vs=0;vs<viewStates;vs++)
+		{
+			std::stringstream dd;
+			dd << vs;
+			vsLocations.insert (vsLocations.end (), ident, ident + 16);
+			dppl->PushIntArray ("ViewStateElementIDs" + dd.str(), &ids[0], ids.size());
+			dppl->PushFloat16Array ("ViewStateElementLocations" + dd.str(), &locations[0], elements);
+			dppl->PushIntArray ("ViewStateElementVisibilities" + dd.str(), &visibility[0], visibility.size());
+		}
+		dppl->PushFloat16Array ("ViewStateLocations", &vsLocations[0], viewStates);
+		dppl->PushInt ("CurrentViewState", 0);
+		dppl->PushInt ("ViewStateCount", viewStates);
+		dppl->PushInt ("LastIDCount", elements + 1);
+		return dppl->SerializeList ();
+	}
+
+	static long long LoadArrayViewStates (const ParamListSharedPtr &dppl)
+	{
+		static const ParamAtom s_viewStateCount ("ViewStateCount");
+		long long sum = 0;
+		int vsCount = 0;
+		if (!dppl->GetIntValueByName (s_viewStateCount, vsCount))
+			return -1;
+		vector <int> ids, visibility;
+		vector <float> locations;
+		for (int vs=0;vs<vsCount;vs++)
+		{
+			char dd[16];
+			sprintf (dd, "%d", vs);
+			dppl->GetIntArrayByName (string ("ViewStateElementIDs") + dd, ids);
+			dppl->GetFloat16ArrayByName (string ("ViewStateElementLocations") + dd, locations);
+			dppl->GetIntArrayByName (string ("ViewStateElementVisibilities") + dd, visibility);
+			for (size_t ks=0;ks<ids.size();ks++)
+				sum += ids[ks] + visibility[ks] + int (locations[16 * ks]);
+		}
+		return sum;
+	}
+
+	int RunParamsArrayBench (int argc, char **argv)
+	{
+		int viewStates = 50;
+		int elements = 5000;
+		if (argc > 3)
+		{
+			viewStates = atoi (argv[2]);
+			elements = atoi (argv[3]);
+		}
+		string keyed = MakeHeaderLine (viewStates, elements);
+		string arrays = MakeArrayHeaderLine (viewStates, elements);
+
+		BenchTimer timer;
+		ParamListSharedPtr keyedList = ParamList::createFromString (keyed);
+		long long keyedSum = LoadViewStates (keyedList);
+		double keyedMs = timer.ElapsedMs ();
+
+		timer.Restart ();
+		ParamListSharedPtr arrayList = ParamList::createFromString (arrays);
+		long long arraySum = LoadArrayViewStates (arrayList);
+		double arrayMs = timer.ElapsedMs ();
+
+		std::stringstream caseName;
+		caseName << "header parse + view state read, " << elements << " elements x " << viewStates << " view states, "
+			<< keyed.size () / 1024 << " KB per item keys vs " << arrays.size () / 1024 << " KB arrays";
+		ReportResult ("params_arrays", caseName.str (), 1, keyedMs, arrayMs);
+		if (keyedSum != arraySum)
+		{
+			std::cout << "params_arrays | MISMATCH between per item keys and arrays" << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+}
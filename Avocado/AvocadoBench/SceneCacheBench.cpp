@@ -0,0 +1,251 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoSceneCache.h"
+#include "../AvocadoEngine/AvocadoArchive.h"
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* What an import makes of a model file : welded vertices and the triangles over them. */
+	struct SceneCacheBenchScene
+	{
+		std::vector<float>			vertices;
+		std::vector<unsigned int>	indices;
+
+		bool operator== (const SceneCacheBenchScene &o) const { return vertices == o.vertices && indices == o.indices; }
+	};
+
+	static std::string MakeSceneCacheBenchModel (int model, int vertexCount)
+	{
+		std::stringstream text;
+		unsigned int seed = (unsigned int)model * 2654435761u + 7;
+		for (int i=0;i<vertexCount;i++)
+		{
+			float v[3];
+			for (int k=0;k<3;k++)
+			{
+				BenchRandom (seed);
+				v[k] = float ((seed >> 16) % 48) * 0.5f;
+			}
+			text << "v " << v[0] << " " << v[1] << " " << v[2] << "\n";
+		}
+		return text.str ();
+	}
+
+	/* The parse and the passes createScene runs after it : the vertices are welded and the triangles sorted for
+	   locality a few times over, as the optimizers do. flipYZ changes what comes out, like flip_yz_on_import. */
+	static SceneCacheBenchScene ImportSceneCacheBenchModel (const std::string &text, bool flipYZ, int passes)
+	{
+		std::vector<float> raw;
+		std::istringstream in (text);
+		std::string tag;
+		float x, y, z;
+		while (in >> tag >> x >> y >> z)
+		{
+			raw.push_back (x);
+			raw.push_back (flipYZ ? z : y);
+			raw.push_back (flipYZ ? -y : z);
+		}
+		SceneCacheBenchScene scene;
+		for (int p=0;p<passes;p++)
+		{
+			std::vector<std::pair<std::pair<float,std::pair<float,float> >,unsigned int> > keyed;
+			for (size_t i=0;i<raw.size ();i+=3)
+				keyed.push_back (std::make_pair (std::make_pair (raw[i], std::make_pair (raw[i + 1], raw[i + 2])), (unsigned int)(i / 3)));
+			std::sort (keyed.begin (), keyed.end ());
+			scene.vertices.clear ();
+			scene.indices.assign (raw.size () / 3, 0);
+			for (size_t i=0;i<keyed.size ();i++)
+			{
+				if (i == 0 || keyed[i].first != keyed[i - 1].first)
+				{
+					scene.vertices.push_back (keyed[i].first.first);
+					scene.vertices.push_back (keyed[i].first.second.first);
+					scene.vertices.push_back (keyed[i].first.second.second);
+				}
+				scene.indices[keyed[i].second] = (unsigned int)(scene.vertices.size () / 3 - 1);
+			}
+		}
+		return scene;
+	}
+
+	static bool WriteSceneCacheBenchEntry (const std::string &path, const SceneCacheBenchScene &scene)
+	{
+		FILE *f = fopen (path.c_str (), "wb");
+		if (!f)
+			return false;
+		const unsigned int counts[2] = { (unsigned int)scene.vertices.size (), (unsigned int)scene.indices.size () };
+		bool ok = fwrite (counts, sizeof (counts), 1, f) == 1
+			&& (counts[0] == 0 || fwrite (&scene.vertices[0], sizeof (float), counts[0], f) == counts[0])
+			&& (counts[1] == 0 || fwrite (&scene.indices[0], sizeof (unsigned int), counts[1], f) == counts[1]);
+		return fclose (f) == 0 && ok;
+	}
+
+	static bool ReadSceneCacheBenchEntry (const std::string &path, SceneCacheBenchScene &scene)
+	{
+		std::string bytes;
+		unsigned int counts[2];
+		if (!AvocadoArchiveBlobs::ReadFile (path, bytes) || bytes.size () < sizeof (counts))
+			return false;
+		memcpy (counts, bytes.data (), sizeof (counts));
+		if (bytes.size () != sizeof (counts) + counts[0] * sizeof (float) + counts[1] * sizeof (unsigned int))
+			return false;
+		const float *v = (const float*)(bytes.data () + sizeof (counts));
+		scene.vertices.assign (v, v + counts[0]);
+		const unsigned int *ix = (const unsigned int*)(v + counts[0]);
+		scene.indices.assign (ix, ix + counts[1]);
+		return true;
+	}
+
+	/* createScene with the cache in front, as loadCachedFileScene and storeCachedFileScene do it. */
+	static SceneCacheBenchScene OpenSceneCacheBenchModel (const std::string &path, bool flipYZ, int passes, bool &hit)
+	{
+		SceneCacheBenchScene scene;
+		const std::string key = AvocadoSceneCache::Get ().MakeKey (path, flipYZ ? "import=1;flip_yz=1;" : "import=1;flip_yz=0;");
+		std::string cached;
+		hit = key != "" && AvocadoSceneCache::Get ().Find (key, cached) && ReadSceneCacheBenchEntry (cached, scene);
+		if (hit)
+			return scene;
+		std::string text;
+		AvocadoArchiveBlobs::ReadFile (path, text);
+		scene = ImportSceneCacheBenchModel (text, flipYZ, passes);
+		if (key != "")
+		{
+			const std::string written = AvocadoSceneCache::Get ().GetWritePath (key);
+			if (WriteSceneCacheBenchEntry (written, scene))
+				AvocadoSceneCache::Get ().Add (key, written);
+			else
+				AvocadoSceneCache::Get ().Discard (written);
+		}
+		return scene;
+	}
+
+	/* Reopening a document : every model imported and optimized before, read back from the scene cache after.
+	   Checks that a hit is the scene the import makes, that the options are part of the key and that the least
+	   recently used entries go past the size limit. Arguments : models, vertices per model. */
+	int RunSceneCacheBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int modelCount = argc > 2 ? atoi (argv[2]) : 24;
+		const int vertexCount = argc > 3 ? atoi (argv[3]) : 20000;
+		const int passes = 3;
+		char tempDir[MAX_PATH];
+		if (!GetTempPathA (MAX_PATH, tempDir))
+			strcpy (tempDir, ".\\");
+		const std::string dir (tempDir);
+		const std::string cacheFolder = dir + "AvocadoBenchSceneCache";
+
+		std::vector<std::string> models;
+		std::vector<std::string> texts;
+		for (int i=0;i<modelCount;i++)
+		{
+			std::stringstream name;
+			name << dir << "AvocadoBenchSceneCache_model" << i << ".obj";
+			models.push_back (name.str ());
+			texts.push_back (MakeSceneCacheBenchModel (i, vertexCount));
+			if (!WriteBenchFile (models.back (), texts.back ()))
+				res = 1;
+		}
+		if (res)
+		{
+			std::cout << "scene_cache | could not write the models" << std::endl;
+			return res;
+		}
+
+		std::vector<SceneCacheBenchScene> imported;
+		BenchTimer timer;
+		for (int i=0;i<modelCount;i++)
+			imported.push_back (ImportSceneCacheBenchModel (texts[i], false, passes));
+		const double importMs = timer.ElapsedMs ();
+
+		AvocadoSceneCache::Get ().SetFolder (cacheFolder);
+		AvocadoSceneCache::Get ().SetEnabled (true);
+		AvocadoSceneCache::Get ().SetMaxBytes ((unsigned __int64)1 << 40);
+		// what an earlier run left is not what this one measures.
+		for (int i=0;i<modelCount;i++)
+		{
+			AvocadoSceneCache::Get ().Remove (AvocadoSceneCache::Get ().MakeKey (models[i], "import=1;flip_yz=0;"));
+			AvocadoSceneCache::Get ().Remove (AvocadoSceneCache::Get ().MakeKey (models[i], "import=1;flip_yz=1;"));
+		}
+
+		for (int round=0;round<2 && res == 0;round++)
+		{
+			timer.Restart ();
+			int hits = 0;
+			for (int i=0;i<modelCount && res == 0;i++)
+			{
+				bool hit = false;
+				const SceneCacheBenchScene scene = OpenSceneCacheBenchModel (models[i], false, passes, hit);
+				hits += hit ? 1 : 0;
+				if (!(scene == imported[i]))
+				{
+					std::cout << "scene_cache | model " << i << " does not come back as imported" << std::endl;
+					res = 1;
+				}
+			}
+			const double ms = timer.ElapsedMs ();
+			if (hits != (round == 0 ? 0 : modelCount))
+			{
+				std::cout << "scene_cache | " << hits << " hits opening the document " << (round == 0 ? "first" : "again") << std::endl;
+				res = 1;
+			}
+			std::stringstream caseName;
+			caseName << modelCount << " models, " << (round == 0 ? "first open" : "reopen");
+			ReportResult ("scene_cache", caseName.str (), (size_t)modelCount, importMs, ms);
+		}
+
+		// another flip is another scene.
+		bool hit = true;
+		const SceneCacheBenchScene flipped = OpenSceneCacheBenchModel (models[0], true, passes, hit);
+		if (res == 0 && (hit || flipped == imported[0]))
+		{
+			std::cout << "scene_cache | flip_yz_on_import does not change the key" << std::endl;
+			res = 1;
+		}
+
+		// a new session finds the entries of the last one.
+		const size_t entries = AvocadoSceneCache::Get ().GetEntryCount ();
+		AvocadoSceneCache::Get ().SetFolder ("");
+		AvocadoSceneCache::Get ().SetFolder (cacheFolder);
+		if (res == 0 && AvocadoSceneCache::Get ().GetEntryCount () != entries)
+		{
+			std::cout << "scene_cache | " << AvocadoSceneCache::Get ().GetEntryCount () << " of " << entries << " entries found again" << std::endl;
+			res = 1;
+		}
+
+		// room for a third of the models, used from the second one on and the first one last : the first one
+		// survives, the second one is among the first to go.
+		std::string keptPath;
+		for (int i=1;i<modelCount;i++)
+			AvocadoSceneCache::Get ().Find (AvocadoSceneCache::Get ().MakeKey (models[i], "import=1;flip_yz=0;"), keptPath);
+		const std::string keptKey = AvocadoSceneCache::Get ().MakeKey (models[0], "import=1;flip_yz=0;");
+		AvocadoSceneCache::Get ().Find (keptKey, keptPath);
+		const unsigned __int64 limit = AvocadoSceneCache::Get ().GetTotalBytes () / 3;
+		AvocadoSceneCache::Get ().SetMaxBytes (limit);
+		std::string path;
+		if (res == 0 && (AvocadoSceneCache::Get ().GetTotalBytes () > limit || !AvocadoSceneCache::Get ().Find (keptKey, path)
+			|| AvocadoSceneCache::Get ().Find (AvocadoSceneCache::Get ().MakeKey (models[1], "import=1;flip_yz=0;"), path)))
+		{
+			std::cout << "scene_cache | eviction did not go by last use" << std::endl;
+			res = 1;
+		}
+		std::cout << "scene_cache | " << AvocadoSceneCache::Get ().GetEntryCount () << " entries, " << AvocadoSceneCache::Get ().GetTotalBytes () << " bytes under a "
+			<< limit << " bytes limit" << std::endl;
+
+		AvocadoSceneCache::Get ().SetMaxBytes (0);
+		AvocadoSceneCache::Get ().Remove (keptKey);
+		AvocadoSceneCache::Get ().SetFolder ("");
+		RemoveDirectoryA (cacheFolder.c_str ());
+		for (int i=0;i<modelCount;i++)
+			DeleteFileA (models[i].c_str ());
+		return res;
+	}
+}
@@ -0,0 +1,185 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoSceneQuery.h"
+#include "../AvocadoEngine/AvocadoWorkerPool.h"
+#include <nvsg/Group.h>
+#include <nvsg/Transform.h>
+#include <nvsg/GeoNode.h>
+#include <nvsg/StateSet.h>
+#include <nvsg/Primitive.h>
+#include <nvtraverser/SearchTraverser.h>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace avocado;
+using namespace nvsg;
+using namespace nvutil;
+
+namespace avocado_bench {
+
+	/* Elements under the document root, transforms over groups of GeoNodes with a few drawables each. Every
+	   eighth GeoNode is hidden from the query mask, every fifth one belongs to the tagged element. */
+	static GroupSharedPtr MakeSceneQueryBenchScene (int objectCount, const void *tag, size_t &objects)
+	{
+		const int elements = 64;
+		const int drawables = 3;
+		const int perElement = objectCount / elements;
+		GroupSharedPtr root = Group::create ();
+		GroupWriteLock (root)->setName ("AvocadoRoot");
+		objects = 1;
+		int geoIndex = 0;
+		for (int e=0;e<elements;e++)
+		{
+			std::stringstream elementName;
+			elementName << "AvocadoElement" << e;
+			TransformSharedPtr element = Transform::create ();
+			TransformWriteLock (element)->setName (elementName.str ());
+			GroupWriteLock (root)->addChild (element);
+			objects++;
+			GroupSharedPtr group;
+			for (int n=0;n<perElement;n+=drawables + 1,geoIndex++)
+			{
+				if (!group || geoIndex % 32 == 0)
+				{
+					group = Group::create ();
+					GroupWriteLock (group)->setName ("Group");
+					TransformWriteLock (element)->addChild (group);
+					objects++;
+				}
+				std::stringstream geoName;
+				geoName << (geoIndex % 3 == 0 ? "AvoGeoNode" : "Part") << geoIndex;
+				GeoNodeSharedPtr geoNode = GeoNode::create ();
+				{
+					GeoNodeWriteLock geo (geoNode);
+					geo->setName (geoName.str ());
+					geo->setTraversalMask (geoIndex % 8 == 7 ? 2u : 3u);
+					geo->setUserData (geoIndex % 5 == 0 ? tag : NULL);
+					const StateSetSharedPtr stateSet = StateSet::create ();
+					for (int d=0;d<drawables;d++)
+						geo->addDrawable (stateSet, Primitive::create ());
+				}
+				GroupWriteLock (group)->addChild (geoNode);
+				objects += drawables + 1;
+			}
+		}
+		return root;
+	}
+
+	/* What the engine did before : a SearchTraverser by class name, then a dynamic_cast of every result and
+	   the rest of what it looks for tested on it. */
+	static std::vector<const void*> SearchSceneQueryBench (const NodeSharedPtr &root, const std::string &prefix, unsigned int mask, const void *userData)
+	{
+		SmartPtr<nvtraverser::SearchTraverser> st (new nvtraverser::SearchTraverser);
+		st->setClassName ("class nvsg::GeoNode");
+		st->setTraversalMask (mask);
+		st->apply (root);
+		const std::vector<ObjectWeakPtr> &results = st->getResults ();
+		std::vector<const void*> res;
+		for (size_t i=0;i<results.size ();i++)
+		{
+			GeoNodeWeakPtr geoNode = dynamic_cast<GeoNodeWeakPtr> (results[i]);
+			if (!geoNode)
+				continue;
+			GeoNodeReadLock geo (geoNode);
+			if (geo->getUserData () == userData && geo->getName ().compare (0, prefix.size (), prefix) == 0)
+				res.push_back (geoNode);
+		}
+		return res;
+	}
+
+	static std::vector<const void*> GetSceneQueryBenchObjects (const std::vector<GeoNodeSharedPtr> &geoNodes)
+	{
+		std::vector<const void*> res;
+		for (size_t i=0;i<geoNodes.size ();i++)
+			res.push_back (geoNodes[i].get ());
+		return res;
+	}
+
+	/* Both have to find the same GeoNodes, the order of the search results is the traverser's own. */
+	static bool SameSceneQueryBenchObjects (std::vector<const void*> a, std::vector<const void*> b)
+	{
+		std::sort (a.begin (), a.end ());
+		std::sort (b.begin (), b.end ());
+		return a == b;
+	}
+
+	/* GeoNodes of an element by name prefix, query mask and user data on a SceniX scene : a SearchTraverser by class
+	   name with a cast and test of every result before, AvocadoSceneQuery::Find<GeoNode> after, on one thread and
+	   Parallel over the subtrees of the root, and the first match alone. Arguments : objects, repeats. */
+	int RunSceneQueryBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int objectCount = argc > 2 ? atoi (argv[2]) : 250000;
+		const int repeats = argc > 3 ? atoi (argv[3]) : 5;
+		const int tag = 0;
+		const std::string prefix ("AvoGeoNode");
+		const unsigned int mask = 1;
+
+		size_t objects = 0;
+		const GroupSharedPtr root = MakeSceneQueryBenchScene (objectCount, &tag, objects);
+
+		std::vector<const void*> searched;
+		BenchTimer timer;
+		for (int r=0;r<repeats;r++)
+			searched = SearchSceneQueryBench (root, prefix, mask, &tag);
+		const double searchMs = timer.ElapsedMs ();
+
+		std::vector<GeoNodeSharedPtr> queried;
+		timer.Restart ();
+		for (int r=0;r<repeats;r++)
+			queried = AvocadoSceneQuery ().NamePrefix (prefix).TraversalMask (mask).UserData (&tag).Find<GeoNode> (root);
+		const double queryMs = timer.ElapsedMs ();
+		if (searched.empty () || !SameSceneQueryBenchObjects (GetSceneQueryBenchObjects (queried), searched))
+		{
+			std::cout << "scene_query | the query finds " << queried.size () << " GeoNodes, the search " << searched.size () << std::endl;
+			res = 1;
+		}
+		std::stringstream queryCase;
+		queryCase << objects << " objects, " << searched.size () << " matches";
+		ReportResult ("scene_query", queryCase.str (), (size_t)repeats, searchMs, queryMs);
+
+		// the same query over the subtrees of the root, the parts put together in child order.
+		ReportCores ("scene_query");
+		std::vector<GeoNodeSharedPtr> parallel;
+		timer.Restart ();
+		for (int r=0;r<repeats;r++)
+			parallel = AvocadoSceneQuery ().NamePrefix (prefix).TraversalMask (mask).UserData (&tag).Parallel (true).Find<GeoNode> (root);
+		const double parallelMs = timer.ElapsedMs ();
+		if (parallel != queried)
+		{
+			std::cout << "scene_query | the parallel query finds other GeoNodes or in another order" << std::endl;
+			res = 1;
+		}
+		std::stringstream parallelCase;
+		parallelCase << objects << " objects, parallel on " << AvocadoWorkerPool::Get ().GetThreadCount () << " threads";
+		ReportResult ("scene_query", parallelCase.str (), (size_t)repeats, searchMs, parallelMs);
+
+		// the first match : the search still visits everything.
+		const void *searchedFirst = NULL;
+		timer.Restart ();
+		for (int r=0;r<repeats;r++)
+		{
+			const std::vector<const void*> results = SearchSceneQueryBench (root, prefix, mask, &tag);
+			searchedFirst = results.empty () ? NULL : results[0];
+		}
+		const double searchFirstMs = timer.ElapsedMs ();
+		GeoNodeSharedPtr first;
+		timer.Restart ();
+		for (int r=0;r<repeats;r++)
+			first = AvocadoSceneQuery ().NamePrefix (prefix).TraversalMask (mask).UserData (&tag).FindFirst<GeoNode> (root);
+		const double queryFirstMs = timer.ElapsedMs ();
+		if (!first || queried.empty () || first != queried[0] || std::find (searched.begin (), searched.end (), (const void*)first.get ()) == searched.end () || !searchedFirst)
+		{
+			std::cout << "scene_query | the first match is not the first one the query finds" << std::endl;
+			res = 1;
+		}
+		std::stringstream firstCase;
+		firstCase << objects << " objects, first match";
+		ReportResult ("scene_query", firstCase.str (), (size_t)repeats, searchFirstMs, queryFirstMs);
+		return res;
+	}
+}
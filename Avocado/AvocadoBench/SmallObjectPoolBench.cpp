@@ -0,0 +1,202 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include <nvutil/SmallObjectPool.h>
+#include <process.h>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+namespace avocado_bench {
+
+	/* nvutil::Allocator before the thread caches : the FixedAllocator of the size behind one lock. */
+	class SmallObjectPoolBenchLocked
+	{
+	public:
+		enum { blockGranularity = 8, classCount = 1024 / blockGranularity };
+
+		SmallObjectPoolBenchLocked ()
+		{
+			InitializeCriticalSection (&m_lock);
+			for (size_t i=0;i<classCount;i++)
+				m_pools[i].init ((i + 1) * blockGranularity);
+		}
+		~SmallObjectPoolBenchLocked ()
+		{
+			DeleteCriticalSection (&m_lock);
+		}
+		void* Alloc (size_t size)
+		{
+			EnterCriticalSection (&m_lock);
+			void *p = m_pools[(size - 1) / blockGranularity].alloc ();
+			LeaveCriticalSection (&m_lock);
+			return p;
+		}
+		void Dealloc (void *p, size_t size)
+		{
+			EnterCriticalSection (&m_lock);
+			m_pools[(size - 1) / blockGranularity].dealloc (p);
+			LeaveCriticalSection (&m_lock);
+		}
+	private:
+		CRITICAL_SECTION		m_lock;
+		nvutil::FixedAllocator	m_pools[classCount];
+	};
+
+	struct SmallObjectPoolBenchNew
+	{
+		void* Alloc (size_t size) { return m_pool.alloc (size); }
+		void Dealloc (void *p, size_t size) { m_pool.dealloc (p,size); }
+		nvutil::SmallObjectPool m_pool;
+	};
+
+	/* What the loaders and traversers make most : handles, smart pointer counts, nodes and primitives. */
+	static const size_t s_smallObjectPoolBenchSizes[] = { 24, 48, 96, 160, 320 };
+	static const size_t s_smallObjectPoolBenchKinds = sizeof (s_smallObjectPoolBenchSizes) / sizeof (s_smallObjectPoolBenchSizes[0]);
+
+	/* A scene object : its size and a byte all of it is filled with, a block handed out twice shows as another byte. */
+	struct SmallObjectPoolBenchObject
+	{
+		size_t			size;
+		unsigned char	fill;
+	};
+
+	template <class Pool>
+	struct SmallObjectPoolBenchTask
+	{
+		Pool									*pool;
+		int										ops;
+		unsigned int							seed;
+		std::vector<SmallObjectPoolBenchObject*>	live;		// left for the next round to destroy
+		std::vector<SmallObjectPoolBenchObject*>	*inherited;	// of another thread
+		int										errors;
+	};
+
+	template <class Pool>
+	static SmallObjectPoolBenchObject* CreateSmallObjectPoolBenchObject (Pool &pool, unsigned int r)
+	{
+		const size_t size = s_smallObjectPoolBenchSizes[r % s_smallObjectPoolBenchKinds];
+		SmallObjectPoolBenchObject *object = (SmallObjectPoolBenchObject*)pool.Alloc (size);
+		if (object)
+		{
+			memset (object, (unsigned char)(r >> 8), size);
+			object->size = size;
+			object->fill = (unsigned char)(r >> 8);
+		}
+		return object;
+	}
+
+	template <class Pool>
+	static bool DestroySmallObjectPoolBenchObject (Pool &pool, SmallObjectPoolBenchObject *object)
+	{
+		if (!object)
+			return false;
+		const size_t size = object->size;
+		bool intact = true;
+		for (size_t b=sizeof (SmallObjectPoolBenchObject);b<size && intact;b++)
+			intact = ((unsigned char*)object)[b] == object->fill;
+		pool.Dealloc (object,size);
+		return intact;
+	}
+
+	/* Destroys what a thread of the round before left, then creates and destroys objects in a window of live ones. */
+	template <class Pool>
+	static unsigned __stdcall SmallObjectPoolBenchThread (void *arg)
+	{
+		SmallObjectPoolBenchTask<Pool> *task = (SmallObjectPoolBenchTask<Pool>*)arg;
+		Pool &pool = *task->pool;
+		int errors = 0;
+		if (task->inherited)
+		{
+			for (size_t i=0;i<task->inherited->size ();i++)
+				errors += DestroySmallObjectPoolBenchObject (pool, (*task->inherited)[i]) ? 0 : 1;
+			task->inherited->clear ();
+		}
+		std::vector<SmallObjectPoolBenchObject*> &live = task->live;
+		unsigned int seed = task->seed;
+		for (int op=0;op<task->ops;op++)
+		{
+			BenchRandom (seed);
+			const unsigned int r = seed >> 8;
+			if (live.size () < 256)
+				live.push_back (CreateSmallObjectPoolBenchObject (pool, r));
+			else
+			{
+				SmallObjectPoolBenchObject *&slot = live[r % live.size ()];
+				errors += DestroySmallObjectPoolBenchObject (pool, slot) ? 0 : 1;
+				slot = CreateSmallObjectPoolBenchObject (pool, r * 7);
+			}
+		}
+		task->errors = errors;
+		return 0;
+	}
+
+	/* Rounds of threads, each destroys the objects another thread of the round before left : the last one only
+	   does that, every object is destroyed on a thread that ends after. */
+	template <class Pool>
+	static double RunSmallObjectPoolBenchThreads (Pool &pool, int threads, int ops, int &errors)
+	{
+		std::vector<SmallObjectPoolBenchTask<Pool> > tasks (threads);
+		std::vector<std::vector<SmallObjectPoolBenchObject*> > left (threads);
+		std::vector<HANDLE> handles (threads);
+		BenchTimer timer;
+		for (int round=0;round<3;round++)
+		{
+			for (int t=0;t<threads;t++)
+			{
+				left[t].swap (tasks[t].live);
+				tasks[t].pool = &pool;
+				tasks[t].ops = round < 2 ? ops : 0;
+				tasks[t].seed = (unsigned int)(t * 7919 + round * 104729 + 1);
+				tasks[t].inherited = round ? &left[(t + 1) % threads] : NULL;
+				tasks[t].errors = 0;
+			}
+			for (int t=0;t<threads;t++)
+				handles[t] = (HANDLE)_beginthreadex (NULL, 0, SmallObjectPoolBenchThread<Pool>, &tasks[t], 0, NULL);
+			for (int t=0;t<threads;t++)
+			{
+				WaitForSingleObject (handles[t], INFINITE);
+				CloseHandle (handles[t]);
+				errors += tasks[t].errors;
+			}
+		}
+		return timer.ElapsedMs ();
+	}
+
+	/* Scene objects created and destroyed from 1 to 32 threads, through one lock before and the per thread caches
+	   after. Every thread ending gives its cache back, the pools keep no more than a spare chunk per size then.
+	   Arguments : operations per thread. */
+	int RunSmallObjectPoolBench (int argc, char **argv)
+	{
+		int res = 0;
+		const int ops = argc > 2 ? atoi (argv[2]) : 200000;
+		const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+		ReportCores ("small_object_pool");
+		for (size_t c=0;c<sizeof (threadCounts) / sizeof (threadCounts[0]) && res == 0;c++)
+		{
+			const int threads = threadCounts[c];
+			int errors = 0;
+			SmallObjectPoolBenchLocked locked;
+			const double lockedMs = RunSmallObjectPoolBenchThreads (locked, threads, ops, errors);
+			SmallObjectPoolBenchNew cached;
+			const double cachedMs = RunSmallObjectPoolBenchThreads (cached, threads, ops, errors);
+			if (errors)
+			{
+				std::cout << "small_object_pool | " << threads << " threads : " << errors << " objects overwritten" << std::endl;
+				res = 1;
+			}
+			else if (cached.m_pool.getChunkCount () > s_smallObjectPoolBenchKinds)
+			{
+				std::cout << "small_object_pool | " << threads << " threads : " << cached.m_pool.getChunkCount ()
+					<< " chunks held after the threads ended" << std::endl;
+				res = 1;
+			}
+			std::stringstream caseName;
+			caseName << threads << " threads, create and destroy";
+			ReportResult ("small_object_pool", caseName.str (), (size_t)threads * ops * 2, lockedMs, cachedMs);
+		}
+		return res;
+	}
+}
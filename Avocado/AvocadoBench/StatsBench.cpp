@@ -0,0 +1,114 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/AvocadoMessageStats.h"
+#include <vector>
+
+using namespace avocado;
+
+namespace avocado_bench {
+
+	/* A module that does a little work per message, like the picker pre highlight test on a mouse move. */
+	class StatsBenchModule : public AvocadoMessageHandler
+	{
+	public:
+		StatsBenchModule () : AvocadoMessageHandler ("StatsBenchModule"), m_hits (0)
+		{
+			SubscribeMessage ("CameraChanged");
+			SubscribeMouseMessage (AVC_MOUSE_MOVE);
+		}
+		virtual bool HandleAvocadoMouseStringMessage (AvcMouseActType msg, int viewId, int x, int y, int zDelta, bool &needRepaint)
+		{
+			m_hits += size_t (x * 3 + y);
+			return false;
+		}
+		virtual bool HandleAvocadoViewGeneralStringMessage (const std::string &msg, int viewId, const std::string &paramStr, bool &needRepaint)
+		{
+			m_hits++;
+			return false;
+		}
+		virtual bool HandleAvocadoDocGeneralStringMessage (const std::string &msg, int docId, const std::string &paramStr, bool &needRepaint)
+		{
+			return false;
+		}
+		size_t m_hits;
+	};
+
+	/* The view dispatch loop, with or without the stats scopes the engine puts around it. */
+	static void DispatchMoves (AvocadoDispatchTable &table, size_t iterations, bool scoped)
+	{
+		bool needRepaint = false;
+		for (size_t k=0;k<iterations;k++)
+		{
+			if (scoped)
+			{
+				AvocadoStatsScope stats (AVC_MOUSE_MOVE);
+				for (size_t i=0;i<table.GetMouseHandlerCount (AVC_MOUSE_MOVE);i++)
+				{
+					AvocadoMessageHandler *handler = table.GetMouseHandler (AVC_MOUSE_MOVE,i);
+					AvocadoStatsScope moduleStats (AVC_MOUSE_MOVE,handler);
+					handler->HandleAvocadoMouseStringMessage (AVC_MOUSE_MOVE, 0, int (k & 1023), 7, 0, needRepaint);
+				}
+			}
+			else
+			{
+				for (size_t i=0;i<table.GetMouseHandlerCount (AVC_MOUSE_MOVE);i++)
+					table.GetMouseHandler (AVC_MOUSE_MOVE,i)->HandleAvocadoMouseStringMessage (AVC_MOUSE_MOVE, 0, int (k & 1023), 7, 0, needRepaint);
+			}
+		}
+	}
+
+	int RunStatsBench (int argc, char **argv)
+	{
+		int res = 0;
+		const size_t iterations = 1000000;
+		std::vector<StatsBenchModule*> modules;
+		AvocadoDispatchTable table;
+		for (int m=0;m<5;m++)
+		{
+			modules.push_back (new StatsBenchModule ());
+			table.AddHandler (modules.back ());
+		}
+
+		AvocadoMessageStats::SetEnabled (false);
+		AvocadoMessageStats::Reset ();
+		BenchTimer timer;
+		DispatchMoves (table, iterations, false);
+		double plainMs = timer.ElapsedMs ();
+		timer.Restart ();
+		DispatchMoves (table, iterations, true);
+		double disabledMs = timer.ElapsedMs ();
+		ReportResult ("stats", "5 modules, mouse move, stats off vs no stats", iterations, plainMs, disabledMs);
+
+		if (AvocadoMessageStats::GetStats ()->GetParamCount () != 4)
+		{
+			std::cout << "stats | counters were touched while disabled" << std::endl;
+			res = 1;
+		}
+
+		AvocadoMessageStats::SetEnabled (true);
+		timer.Restart ();
+		DispatchMoves (table, iterations, true);
+		double enabledMs = timer.ElapsedMs ();
+		AvocadoMessageStats::SetEnabled (false);
+		ReportResult ("stats", "5 modules, mouse move, stats on vs no stats", iterations, plainMs, enabledMs);
+
+		int count = 0;
+		ParamListSharedPtr stats = AvocadoMessageStats::GetStats ();
+		if (!stats->GetIntValueByName ("Count0", count) || size_t (count) != iterations)
+		{
+			std::cout << "stats | wrong message count " << count << std::endl;
+			res = 1;
+		}
+		if (!stats->GetIntValueByName ("ModuleCount0", count) || size_t (count) != iterations * modules.size ())
+		{
+			std::cout << "stats | wrong module count " << count << std::endl;
+			res = 1;
+		}
+		AvocadoMessageStats::Reset ();
+		for (size_t i=0;i<modules.size ();i++)
+			delete modules[i];
+		return res;
+	}
+}
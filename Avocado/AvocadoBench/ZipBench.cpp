@@ -0,0 +1,165 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoBench.h"
+#include "../AvocadoEngine/zip.h"
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+
+namespace avocado_bench {
+
+	/* One file of the bench package, what CompressFile puts next to Main.avc. */
+	struct ZipBenchItem
+	{
+		std::string		name;
+		std::string		path;
+		std::string		bytes;
+	};
+
+	/* The document text : element lists, compresses well. */
+	static std::string MakeZipBenchDocument (size_t size)
+	{
+		std::string doc;
+		unsigned int seed = 7;
+		while (doc.size () < size)
+		{
+			BenchRandom (seed);
+			std::stringstream line;
+			line << "OwnerModule,s,ImportModule;elementID,i," << (seed >> 12) % 50000 << ";elementName,s,Engine Block "
+				<< (seed >> 20) % 97 << ";Visibility,b,1;Location,f16,1,0,0,0,0,1,0,0,0,0,1,0," << (seed >> 8) % 1000 << ".25,0,0,1\n";
+			doc += line.str ();
+		}
+		doc.resize (size);
+		return doc;
+	}
+
+	/* Vertex data : smooth floats with some noise, compresses a little. */
+	static std::string MakeZipBenchModel (size_t size, unsigned int seed)
+	{
+		std::string model (size, '\0');
+		float *v = (float*)&model[0];
+		for (size_t i=0;i<size / sizeof (float);i++)
+			v[i] = float (i % 3000) * 0.01f + float ((BenchRandom (seed) >> 16) % 4) * 0.001f;
+		return model;
+	}
+
+	/* CompressFile, the items added one after the other by name. threads 1 is the path CompressFile always had. */
+	static bool CreateZipBenchPackage (const std::string &path, const std::vector<ZipBenchItem> &items, unsigned int threads)
+	{
+		HZIP hz = CreateZip (BenchName (path).c_str (), 0);
+		if (!hz)
+			return false;
+		bool ok = (threads == 1 || ZipSetParallel (hz, threads) == ZR_OK);
+		for (size_t i=0;i<items.size () && ok;i++)
+			ok = ZipAdd (hz, BenchName (items[i].name).c_str (), BenchName (items[i].path).c_str ()) == ZR_OK;
+		// and one from memory, the caller's buffer is gone once ZipAdd returns.
+		if (ok)
+		{
+			std::string copy = items[0].bytes;
+			ok = ZipAdd (hz, _T("memory.avc"), (void*)copy.data (), (unsigned int)copy.size ()) == ZR_OK;
+			std::fill (copy.begin (), copy.end (), 'x');
+		}
+		return CloseZip (hz) == ZR_OK && ok;
+	}
+
+	/* Packing a document with its models, attachments and textures : the zip writer deflating one item after the
+	   other on the calling thread, against the parallel mode. Both packages are unzipped and compared with the files. */
+	int RunZipBench (int argc, char **argv)
+	{
+		int res = 0;
+		char tempDir[MAX_PATH];
+		if (!GetTempPathA (MAX_PATH, tempDir))
+			strcpy (tempDir, ".\\");
+		const std::string dir (tempDir);
+
+		std::vector<ZipBenchItem> items;
+		const size_t block = 1024 * 1024;
+		struct { const char *name; std::string bytes; } sources[] = {
+			{ "Main.avc",				MakeZipBenchDocument (24 * block) },
+			{ "avothumb.jpg",			MakeBenchNoise (64 * 1024, 1) },
+			{ "notes.txt",				MakeZipBenchDocument (100) },
+			{ "empty.txt",				std::string () },
+			{ "exact.bin",				MakeZipBenchModel (2 * block, 2) },		// ends right on a block
+			{ "archive.zip",			MakeBenchNoise (block + 17, 3) },	// stored
+			{ "models\\wheel.nbf",		MakeZipBenchModel (6 * block, 4) },
+			{ "models\\body.nbf",		MakeZipBenchModel (9 * block + 4321, 5) },
+			{ "models\\bolt.nbf",		MakeZipBenchModel (300 * 1024, 6) },
+			{ "textures\\steel.dds",	MakeBenchNoise (3 * block, 7) },
+			{ "textures\\paint.dds",	MakeZipBenchDocument (2 * block) },
+		};
+		size_t totalBytes = 0;
+		for (size_t i=0;i<sizeof (sources) / sizeof (sources[0]);i++)
+		{
+			ZipBenchItem item;
+			item.name = sources[i].name;
+			std::string file (sources[i].name);
+			for (size_t k=0;k<file.size ();k++)
+				if (file[k] == '\\')
+					file[k] = '_';
+			item.path = dir + "AvocadoBenchZip_" + file;
+			item.bytes = sources[i].bytes;
+			if (!WriteBenchFile (item.path, item.bytes))
+			{
+				std::cout << "zip | could not write " << item.path << std::endl;
+				return 1;
+			}
+			totalBytes += item.bytes.size ();
+			items.push_back (item);
+		}
+		totalBytes += items[0].bytes.size ();
+
+		const unsigned int cores = ReportCores ("zip");
+		// no speed up on one core, but the threads still have to write the same files.
+		const unsigned int threads = (cores > 1 ? cores : 4);
+
+		const std::string serialPath = dir + "AvocadoBenchZip_serial.zip";
+		const std::string parallelPath = dir + "AvocadoBenchZip_parallel.zip";
+		BenchTimer timer;
+		if (!CreateZipBenchPackage (serialPath, items, 1))
+		{
+			std::cout << "zip | serial package failed" << std::endl;
+			res = 1;
+		}
+		const double serialMs = timer.ElapsedMs ();
+		timer.Restart ();
+		if (!CreateZipBenchPackage (parallelPath, items, threads))
+		{
+			std::cout << "zip | parallel package failed" << std::endl;
+			res = 1;
+		}
+		const double parallelMs = timer.ElapsedMs ();
+
+		const double totalMb = double (totalBytes) / double (block);
+		std::stringstream caseName;
+		caseName << int (totalMb) << " MB package, " << threads << " threads";
+		ReportResult ("zip", caseName.str (), items.size () + 1, serialMs, parallelMs);
+		const long serialSize = BenchFileSize (serialPath);
+		const long parallelSize = BenchFileSize (parallelPath);
+		std::cout << "zip | serial " << (serialMs > 0.0 ? totalMb * 1000.0 / serialMs : 0.0)
+			<< " MB/s, " << serialSize << " bytes | parallel " << (parallelMs > 0.0 ? totalMb * 1000.0 / parallelMs : 0.0)
+			<< " MB/s, " << parallelSize << " bytes" << std::endl;
+
+		// every item has to come out of both packages as it went in, the memory one as the document.
+		std::vector<BenchPackageItem> expected;
+		for (size_t i=0;i<items.size ();i++)
+			expected.push_back (BenchPackageItem (items[i].name, items[i].bytes));
+		expected.push_back (BenchPackageItem ("memory.avc", items[0].bytes));
+		if (!BenchPackageMatches (serialPath, expected))
+		{
+			std::cout << "zip | serial package does not unzip to its files" << std::endl;
+			res = 1;
+		}
+		if (!BenchPackageMatches (parallelPath, expected))
+		{
+			std::cout << "zip | parallel package does not unzip to its files" << std::endl;
+			res = 1;
+		}
+
+		for (size_t i=0;i<items.size ();i++)
+			DeleteFileA (items[i].path.c_str ());
+		DeleteFileA (serialPath.c_str ());
+		DeleteFileA (parallelPath.c_str ());
+		return res;
+	}
+}
@@ -97,6 +97,11 @@ namespace avocado
 		m_camAnimator.setViewState (m_viewState);
 		AnimationModuleFinishCallBack* cb = new AnimationModuleFinishCallBack (this);
 		m_camAnimator.m_finishCallBack = cb; 
+		// only these messages are dispatched to this module, keep the list in sync with the handlers below.
+		static const char *s_messages[] = { "OrientCamera", "ViewCamera_Orient", "MoveToCamera", "FitToPage", "OnLoadAnimation", "OnPlayAnimation", "OnStopAnimation", "OnPauseAnimation" };
+		for (size_t i=0;i<sizeof (s_messages) / sizeof (s_messages[0]);i++)
+			SubscribeMessage (s_messages[i]);
+		SubscribeMouseMessage (AVC_TIMER_TICK);
 		return true;
 	}
 
@@ -4,6 +4,7 @@
 #pragma once
 #include "AvocadoAnnotationsModule.h"
 #include "SceneFunctions.h"
+#include "AvocadoSceneQuery.h"
 #include "MeshGenerator.h"
 #include <nvgl/RenderTargetGLFB.h>
 #include <nvgl/ScenerendererGL2.h>
@@ -46,7 +47,7 @@ namespace avocado
 		 }
 		 return AvocadoEngineDocElement::SetVisibility (isVisible);
 	 }
-	string AvocadoEngineDocAnnotationElement::serialize()
+	ParamListSharedPtr AvocadoEngineDocAnnotationElement::serializeParams ()
 	{
 		// TODO : MOVE COMMON SERIALIZATION STUFF TO THE BASE ELEMENT CLASS..ITS DUPLICATE CODE, BUT HEY.. ITS ONLY 2 COPIES SO FAR.. MANAGABLE.
 		ParamListSharedPtr ppl = ParamList::createNew ();
@@ -87,7 +88,7 @@ namespace avocado
 
 		}
 
-		return (ppl->SerializeList ());
+		return ppl;
 	}
 	void AvocadoEngineDocAnnotationElement::RecalcAnnotation ()
 	{
@@ -350,18 +351,10 @@ namespace avocado
 
 			/* TODO : MOVE THIS TO PIPELINE MODULE !!! */
 			TransformWriteLock(elementRoot)->setTraversalMask (1);
-			nvutil::SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-			NVSG_ASSERT(st);
-			st->setClassName("class nvsg::Drawable");
-			st->setBaseClassSearch(true);
-			st->apply( child );
-
-			const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-			std::vector<ObjectWeakPtr>::const_iterator it;
-			for(it=searchResults.begin(); it!=searchResults.end(); it++)
+			const std::vector<DrawableSharedPtr> drawables = AvocadoSceneQuery ().Find<Drawable> (child);
+			for (size_t i=0;i<drawables.size ();i++)
 			{
-				//DrawableWeakPtr node = static_cast<GeoNodeWeakPtr>(*it);
-				DrawableSharedPtr node(dynamic_cast<DrawableWeakPtr>(*it));
+				const DrawableSharedPtr &node = drawables[i];
 				int mask = 1;
 				for (int viewId=0;viewId<8;viewId++)
 					mask |= (int(pow(2.0,2*viewId+4)));// >> 1);
@@ -538,11 +531,12 @@ namespace avocado
 				mmat[j][i] = mat[i+4*j];
 		//if (updateLastSaved)
 		//m_lastSavedLocation = mmat;
+		MarkChanged ();
 		TransformWriteLock (m_elementRoot)->setMatrix (mmat );//* TransformWriteLock (m_elementRoot)->getMatrix ());
 	}
 	bool AvocadoEngineDocAnnotationElement::setAnnotationParam (string paramName,string valStr)
 	{
-		
+		MarkChanged ();
 		bool found = false;
 		for (size_t i=0;i<m_intr.annotationData.size ();i++)
 		{
@@ -686,6 +680,10 @@ namespace avocado
 
 	bool AvocadoAnnotations::OnRegister()
 	{
+		// only these messages are dispatched to this module, keep the list in sync with the handlers below.
+		static const char *s_messages[] = { "AddAnnotationElement", "DeleteDocCommonElement", "DeleteAnnotationElement", "ViewSelectionChanged", "MouseOverElement", "NotifyDocElementMove", "SetAnnotationParam", "HideElement", "UnHideElement", "UnHideAllElements" };
+		for (size_t i=0;i<sizeof (s_messages) / sizeof (s_messages[0]);i++)
+			SubscribeMessage (s_messages[i]);
 		return true;
 	}
 
@@ -897,6 +895,7 @@ namespace avocado
 		if (it == 0)
 			return false;
 		(it)->annotationMoved(m_scene);
+		(it)->MarkChanged ();
 		
 		//for (size_t ki=0;ki < (it)->m_attachments.size ();ki++)
 		int atts[2];
@@ -13,7 +13,7 @@ namespace avocado
 		~AvocadoEngineDocAnnotationElement();
 
 		virtual void attachmentMoved (int attID,nvsg::GroupSharedPtr &node,nvsg::SceneSharedPtr &scene) ;
-		virtual string serialize() ;
+		virtual ParamListSharedPtr serializeParams () ;
 		virtual void removeFromScene(SceneSharedPtr &scene); 
 		virtual void createScene(SceneSharedPtr &scene,std::string sessionFolder);
 		void annotationMoved (SceneSharedPtr &scene);
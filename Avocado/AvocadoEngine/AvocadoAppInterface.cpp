@@ -1,6 +1,9 @@
 #include "AvocadoAppInterface.h"
 
 #include "AvocadoEngine.h"
+#include "AvocadoMessageStats.h"
+#include "AvocadoDocStream.h"
+#include "AvocadoArchive.h"
 #include <nvgl/SceneRendererGL2.h>
 #include <nvgl/RenderTargetGLFBO.h>
 
@@ -128,6 +131,40 @@ namespace avocado
 		theEngine->OnSerializeDoc (docId,path,isImport,isStoring);
 	}
 
+	bool __stdcall OnStoreDoc (int docId, AvocadoDocSink *sink)
+	{
+		return theEngine->OnStoreDoc (docId,sink);
+	}
+
+	bool __stdcall IsBinaryDocument (const char *data, size_t size)
+	{
+		return AvocadoDocReader::IsBinary (data,size);
+	}
+
+	bool __stdcall ConvertDocumentFile (const string &inPath, const string &outPath, bool toBinary)
+	{
+		FILE *in = fopen (inPath.c_str (),"rb");
+		if (!in)
+			return false;
+		string bytes;
+		char buf[64 * 1024];
+		size_t got;
+		while ((got = fread (buf,1,sizeof (buf),in)) > 0)
+			bytes.append (buf,got);
+		fclose (in);
+
+		AvocadoFileDocSink out (outPath);
+		if (!out.IsOpen ())
+			return false;
+		const bool converted = (toBinary ? ConvertTextDocumentToBinary (bytes,out) : ConvertBinaryDocumentToText (bytes,out));
+		return out.Close () && converted;
+	}
+
+	bool __stdcall MaterializeDocFile (const string &path)
+	{
+		return AvocadoVirtualFiles::Get ().Materialize (path);
+	}
+
 	void __stdcall SetActiveDoc (int docId)
 	{
 		theEngine->SetActiveDoc (docId);
@@ -185,4 +222,20 @@ namespace avocado
 	{
 		return theEngine->OnSendAvocadoDocGeneralStringMessage(msg,docId,paramStr,targetModule);
 	}
+	void __stdcall FlushViewMessages (int viewId)
+	{
+		theEngine->FlushViewMessages (viewId);
+	}
+	void __stdcall GetEngineStats (std::string &stats)
+	{
+		stats = AvocadoMessageStats::GetStats ()->SerializeList ();
+	}
+	bool __stdcall StartMessageRecording (const std::string &path)
+	{
+		return theEngine->StartMessageRecording (path);
+	}
+	void __stdcall StopMessageRecording ()
+	{
+		theEngine->StopMessageRecording ();
+	}
 }
\ No newline at end of file
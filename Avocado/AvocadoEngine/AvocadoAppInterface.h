@@ -253,7 +253,12 @@ public:
 		SAVE_DOCUMENT_COMPLETE,
 		DOWNLOAD_STARTED,
 		DOWNLOAD_PROGRESS,
-		DOWNLOAD_COMPLETE
+		DOWNLOAD_COMPLETE,
+		IMPORT_STARTED,
+		IMPORT_PROGRESS,
+		IMPORT_COMPLETE,
+		IMPORT_CANCELLED,
+		IMPORT_FAILED
 	};
 
 	virtual void ViewStateChanged (vector <AvocadoViewStateInterface>, int current )=0;
@@ -266,6 +271,16 @@ public:
 	bool m_isAvailable;
 };
 
+// Receives a stored document piece by piece, see OnStoreDoc. Returning false from Write aborts the save.
+class AvocadoDocSink
+{
+public:
+	virtual ~AvocadoDocSink () {}
+	virtual bool Write (const char *data, size_t size) = 0;
+	// Binary (v2) documents are only stored into sinks that keep the bytes as they are, the others get the text layout.
+	virtual bool IsBinarySafe () const { return false; }
+};
+
 // Avocado Initizalizations and termination.
 AVDLL	void __stdcall AvocadoInit(bool multiThreded=false,std::string sessionFolder = "");
 AVDLL	void __stdcall AvocadoTerminate();
@@ -274,6 +289,13 @@ AVDLL	void __stdcall AvocadoTerminate();
 AVDLL	bool __stdcall OnSendAvocadoMouseStringMessage (AvcMouseActType msg, int viewId, int x, int y, int zDelta);
 AVDLL	bool __stdcall OnSendAvocadoGeneralStringMessage (const string &msg, int viewId,const string &paramStr,bool toAllModules = true);
 AVDLL	bool __stdcall OnSendAvocadoDocGeneralStringMessage (const string &msg, int docId, const string &paramStr,string targetModule = "");
+// Queued mode only (engine option "queued_messages") : deliver the view queued messages and its pending repaint now.
+AVDLL	void __stdcall FlushViewMessages (int viewId);
+// Message latency counters as a serialized ParamList, empty rows when the engine_stats option is off.
+AVDLL	void __stdcall GetEngineStats (string &stats);
+// Session recording for AvocadoReplay, see AvocadoMessageRecorder.
+AVDLL	bool __stdcall StartMessageRecording (const string &path);
+AVDLL	void __stdcall StopMessageRecording ();
 
 // Document and view creation and sizing.
 AVDLL	void __stdcall SetActiveDoc(int docId);
@@ -289,6 +311,15 @@ AVDLL	void __stdcall DoCompressDoc (int docId, std::string &inpath,std::string &
 	std::vector<std::string> embeddedTextures, 
 	bool unzip);
 AVDLL	void __stdcall OnSerializeDoc(int docId, string &path, bool isImport=false, bool isStoring=false);
+// Stores the document straight into sink, without building it in memory as OnSerializeDoc does.
+AVDLL	bool __stdcall OnStoreDoc(int docId, AvocadoDocSink *sink);
+// True when data starts a binary (v2) document, a loader hands those to OnSerializeDoc byte for byte instead of as text.
+AVDLL	bool __stdcall IsBinaryDocument(const char *data, size_t size);
+// Rewrites an unzipped document (Main.avc) in the binary or the text layout, no document has to be open for it.
+AVDLL	bool __stdcall ConvertDocumentFile(const string &inPath, const string &outPath, bool toBinary);
+// A model or texture of an opened package is read from the .avc until it is needed as a file, this writes it
+// out under the session folder. true when path is on disk after.
+AVDLL	bool __stdcall MaterializeDocFile(const string &path);
 
 // App Interface callbacks.
 AVDLL	void __stdcall InvokePaintView(int viewId);
@@ -0,0 +1,644 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoArchive.h"
+#include <cstring>
+#include <windows.h>
+#include <tchar.h>
+#include "unzip.h"
+
+namespace avocado
+{
+	static const unsigned long s_endOfCentralDirSig = 0x06054b50;
+	static const unsigned long s_centralHeaderSig = 0x02014b50;
+	static const unsigned long s_localHeaderSig = 0x04034b50;
+	static const size_t s_endOfCentralDirSize = 22;
+	static const size_t s_centralHeaderSize = 46;
+	static const size_t s_localHeaderSize = 30;
+
+	static unsigned int ReadShort (const unsigned char *p)
+	{
+		return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+	}
+
+	static unsigned long ReadLong (const unsigned char *p)
+	{
+		return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+	}
+
+	AvocadoArchive::AvocadoArchive () : m_file (INVALID_HANDLE_VALUE), m_mapping (NULL), m_view (NULL), m_size (0), m_dirOffset (0), m_endOffset (0)
+	{
+	}
+
+	AvocadoArchive::~AvocadoArchive ()
+	{
+		Close ();
+	}
+
+	bool AvocadoArchive::Open (const std::string &path)
+	{
+		Close ();
+		HANDLE file = CreateFileA (path.c_str (),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		// the whole file is mapped, a package that does not fit the address space is extracted as before.
+		if (!GetFileSizeEx (file,&size) || size.QuadPart < LONGLONG (s_endOfCentralDirSize) || (unsigned __int64)size.QuadPart > (unsigned __int64)(size_t (-1) >> 1))
+		{
+			CloseHandle (file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA (file,NULL,PAGE_READONLY,0,0,NULL);
+		const void *view = (mapping ? MapViewOfFile (mapping,FILE_MAP_READ,0,0,0) : NULL);
+		if (!view)
+		{
+			if (mapping)
+				CloseHandle (mapping);
+			CloseHandle (file);
+			return false;
+		}
+		m_path = path;
+		m_file = file;
+		m_mapping = mapping;
+		m_view = (const unsigned char*)view;
+		m_size = size_t (size.QuadPart);
+		if (!ReadCentralDirectory ())
+		{
+			Close ();
+			return false;
+		}
+		ReadManifest ();
+		return true;
+	}
+
+	void AvocadoArchive::Close ()
+	{
+		if (m_view)
+			UnmapViewOfFile (m_view);
+		if (m_mapping)
+			CloseHandle ((HANDLE)m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle ((HANDLE)m_file);
+		m_view = NULL;
+		m_mapping = NULL;
+		m_file = INVALID_HANDLE_VALUE;
+		m_size = 0;
+		m_dirOffset = 0;
+		m_endOffset = 0;
+		m_entries.clear ();
+		m_byName.clear ();
+	}
+
+	/* The end record is looked for backwards, past the archive comment. Entries that point outside the file
+	   make the whole archive corrupt, nothing is read through them later. */
+	bool AvocadoArchive::ReadCentralDirectory ()
+	{
+		const size_t maxBack = s_endOfCentralDirSize + 0xffff;
+		const size_t first = (m_size > maxBack ? m_size - maxBack : 0);
+		const unsigned char *end = NULL;
+		for (size_t pos=m_size - s_endOfCentralDirSize + 1;pos-- > first;)
+			if (ReadLong (m_view + pos) == s_endOfCentralDirSig)
+			{
+				end = m_view + pos;
+				break;
+			}
+		if (!end)
+			return false;
+		const size_t count = ReadShort (end + 10);
+		const size_t dirSize = ReadLong (end + 12);
+		const size_t dirOffset = ReadLong (end + 16);
+		if (dirOffset > m_size || dirSize > m_size - dirOffset)
+			return false;
+		m_dirOffset = dirOffset;
+		m_endOffset = size_t (end - m_view);
+
+		m_entries.reserve (count);
+		const unsigned char *p = m_view + dirOffset;
+		const unsigned char *dirEnd = p + dirSize;
+		for (size_t i=0;i<count;i++)
+		{
+			if (size_t (dirEnd - p) < s_centralHeaderSize || ReadLong (p) != s_centralHeaderSig)
+				return false;
+			const size_t nameLength = ReadShort (p + 28);
+			const size_t recordSize = s_centralHeaderSize + nameLength + ReadShort (p + 30) + ReadShort (p + 32);
+			if (size_t (dirEnd - p) < recordSize)
+				return false;
+			AvocadoArchiveEntry entry;
+			entry.flags = ReadShort (p + 8);
+			entry.method = ReadShort (p + 10);
+			entry.crc = ReadLong (p + 16);
+			entry.compressedSize = ReadLong (p + 20);
+			entry.size = ReadLong (p + 24);
+			entry.headerOffset = ReadLong (p + 42);
+			entry.name.assign ((const char*)p + s_centralHeaderSize,nameLength);
+			if (entry.headerOffset > m_size || m_size - entry.headerOffset < s_localHeaderSize)
+				return false;
+			m_byName.insert (EntryHash::value_type (EntryKey (entry.name),m_entries.size ()));
+			m_entries.push_back (entry);
+			p += recordSize;
+		}
+		return true;
+	}
+
+	/* An alias that names an entry of its own, or a blob the archive does not have, is left out. */
+	void AvocadoArchive::ReadManifest ()
+	{
+		const AvocadoArchiveEntry *manifest = Find (ManifestName ());
+		AvocadoArchiveData data;
+		if (!manifest || !Read (*manifest,data))
+			return;
+		std::vector<std::pair<std::string,std::string> > aliases;
+		ParseManifest (data.data,data.size,aliases);
+		for (size_t i=0;i<aliases.size ();i++)
+		{
+			const std::string alias = EntryKey (aliases[i].first);
+			EntryHash::const_iterator blob = m_byName.find (EntryKey (aliases[i].second));
+			if (blob != m_byName.end () && m_byName.find (alias) == m_byName.end ())
+				m_byName.insert (EntryHash::value_type (alias,blob->second));
+		}
+	}
+
+	void AvocadoArchive::ParseManifest (const char *data, size_t size, std::vector<std::pair<std::string,std::string> > &aliases)
+	{
+		const std::string text (data,size);
+		for (size_t pos=0;pos<text.size ();)
+		{
+			size_t end = text.find ('\n',pos);
+			if (end == std::string::npos)
+				end = text.size ();
+			std::string line = text.substr (pos,end - pos);
+			pos = end + 1;
+			if (!line.empty () && line[line.size () - 1] == '\r')
+				line.erase (line.size () - 1);
+			const size_t eq = line.find ('=');
+			if (eq != std::string::npos && eq > 0 && eq + 1 < line.size ())
+				aliases.push_back (std::make_pair (line.substr (0,eq),line.substr (eq + 1)));
+		}
+	}
+
+	std::string AvocadoArchive::EntryKey (const std::string &name)
+	{
+		std::string key (name);
+		for (size_t i=0;i<key.size ();i++)
+		{
+			if (key[i] == '\\')
+				key[i] = '/';
+			else if (key[i] >= 'A' && key[i] <= 'Z')
+				key[i] = key[i] - 'A' + 'a';
+		}
+		return key;
+	}
+
+	const AvocadoArchiveEntry* AvocadoArchive::Find (const std::string &name) const
+	{
+		EntryHash::const_iterator it = m_byName.find (EntryKey (name));
+		return (it == m_byName.end () ? NULL : &m_entries[it->second]);
+	}
+
+	bool AvocadoArchive::Read (const AvocadoArchiveEntry &entry, AvocadoArchiveData &data) const
+	{
+		data = AvocadoArchiveData ();
+		if (!m_view || (entry.flags & 1) != 0)
+			return false;
+		// the local header has its own name and extra field lengths, the data follows them.
+		const unsigned char *header = m_view + entry.headerOffset;
+		if (ReadLong (header) != s_localHeaderSig)
+			return false;
+		const size_t dataOffset = entry.headerOffset + s_localHeaderSize + ReadShort (header + 26) + ReadShort (header + 28);
+		if (dataOffset > m_size || entry.compressedSize > m_size - dataOffset)
+			return false;
+		const char *compressed = (const char*)m_view + dataOffset;
+		if (entry.method == 0)
+		{
+			if (entry.compressedSize != entry.size)
+				return false;
+			data.data = compressed;
+			data.size = entry.size;
+			return true;
+		}
+		if (entry.method != 8)
+			return false;
+		std::shared_ptr<std::string> buffer (new std::string (entry.size,'\0'));
+		if (entry.size != 0 && UnzipInflate (compressed,(unsigned int)entry.compressedSize,&(*buffer)[0],(unsigned int)entry.size,entry.crc) != ZR_OK)
+			return false;
+		data.buffer = buffer;
+		data.data = buffer->data ();
+		data.size = buffer->size ();
+		return true;
+	}
+
+	bool AvocadoArchive::Extract (const AvocadoArchiveEntry &entry, const std::string &path) const
+	{
+		AvocadoArchiveData data;
+		if (!Read (entry,data))
+			return false;
+		const std::string written = path + ".tmp";
+		HANDLE file = CreateFileA (written.c_str (),GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		bool res = true;
+		for (size_t done=0;done<data.size && res;)
+		{
+			const DWORD chunk = DWORD (data.size - done < 0x4000000 ? data.size - done : 0x4000000);
+			DWORD n = 0;
+			res = WriteFile (file,data.data + done,chunk,&n,NULL) && n == chunk;
+			done += chunk;
+		}
+		CloseHandle (file);
+		if (res)
+			res = MoveFileExA (written.c_str (),path.c_str (),MOVEFILE_REPLACE_EXISTING) != FALSE;
+		if (!res)
+			DeleteFileA (written.c_str ());
+		return res;
+	}
+
+	static void PutLong (unsigned char *p, unsigned long value)
+	{
+		p[0] = (unsigned char)(value & 0xff);
+		p[1] = (unsigned char)((value >> 8) & 0xff);
+		p[2] = (unsigned char)((value >> 16) & 0xff);
+		p[3] = (unsigned char)((value >> 24) & 0xff);
+	}
+
+	static bool WriteAt (HANDLE file, size_t offset, const void *data, size_t size)
+	{
+		LARGE_INTEGER pos;
+		pos.QuadPart = LONGLONG (offset);
+		if (!SetFilePointerEx (file,pos,NULL,FILE_BEGIN))
+			return false;
+		for (size_t done=0;done<size;)
+		{
+			const DWORD chunk = DWORD (size - done < 0x4000000 ? size - done : 0x4000000);
+			DWORD n = 0;
+			if (!WriteFile (file,(const char*)data + done,chunk,&n,NULL) || n != chunk)
+				return false;
+			done += chunk;
+		}
+		return true;
+	}
+
+	/* The new bytes and the directory behind them are written first, the local header last. When a write fails the
+	   old directory goes back right after the entry and the old local header fields with it. */
+	bool AvocadoArchive::AppendToStoredEntry (const std::string &path, const std::string &name, size_t expectedSize,
+		const char *data, size_t size)
+	{
+		std::string tail;					// the central directory and the end record, as they are
+		unsigned char oldFields[12];		// crc and sizes of the local header
+		size_t headerOffset = 0, dataEnd = 0, record = 0, endRecord = 0;
+		unsigned long crc = 0;
+		{
+			AvocadoArchive archive;
+			if (!archive.Open (path))
+				return false;
+			const AvocadoArchiveEntry *entry = archive.Find (name);
+			// stored, not encrypted, and its sizes in the local header rather than in a descriptor after the data.
+			if (!entry || entry->method != 0 || (entry->flags & 9) != 0 || entry->size != expectedSize || entry->compressedSize != expectedSize)
+				return false;
+			const unsigned char *header = archive.m_view + entry->headerOffset;
+			if (ReadLong (header) != s_localHeaderSig)
+				return false;
+			headerOffset = entry->headerOffset;
+			dataEnd = headerOffset + s_localHeaderSize + ReadShort (header + 26) + ReadShort (header + 28) + expectedSize;
+			if (dataEnd != archive.m_dirOffset)
+				return false;
+			// the records before the one of the entry were checked on Open.
+			const unsigned char *p = archive.m_view + archive.m_dirOffset;
+			for (size_t i=0;i<size_t (entry - &archive.m_entries[0]);i++)
+				p += s_centralHeaderSize + ReadShort (p + 28) + ReadShort (p + 30) + ReadShort (p + 32);
+			record = size_t (p - archive.m_view) - archive.m_dirOffset;
+			endRecord = archive.m_endOffset - archive.m_dirOffset;
+			crc = entry->crc;
+			memcpy (oldFields,header + 14,sizeof (oldFields));
+			tail.assign ((const char*)archive.m_view + archive.m_dirOffset,archive.m_size - archive.m_dirOffset);
+		}
+		// no zip64 here, the entry size and the directory offset have to stay 32 bits.
+		if (size > 0xffffffffUL - dataEnd)
+			return false;
+		for (size_t done=0;done<size;)
+		{
+			const unsigned int chunk = (unsigned int)(size - done < 0x40000000 ? size - done : 0x40000000);
+			crc = UnzipCrc32 (crc,data + done,chunk);
+			done += chunk;
+		}
+		const unsigned long newSize = (unsigned long)(expectedSize + size);
+		unsigned char newFields[12];
+		PutLong (newFields,crc);
+		PutLong (newFields + 4,newSize);
+		PutLong (newFields + 8,newSize);
+		std::string newTail (tail);
+		memcpy (&newTail[record + 16],newFields,sizeof (newFields));
+		PutLong ((unsigned char*)&newTail[endRecord + 16],(unsigned long)(dataEnd + size));
+
+		HANDLE file = CreateFileA (path.c_str (),GENERIC_WRITE,0,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		bool res = WriteAt (file,dataEnd,data,size) && WriteAt (file,dataEnd + size,newTail.data (),newTail.size ()) &&
+			SetEndOfFile (file) && WriteAt (file,headerOffset + 14,newFields,sizeof (newFields));
+		if (!res)
+		{
+			WriteAt (file,headerOffset + 14,oldFields,sizeof (oldFields));
+			if (WriteAt (file,dataEnd,tail.data (),tail.size ()))
+				SetEndOfFile (file);
+		}
+		CloseHandle (file);
+		return res;
+	}
+
+	bool AvocadoArchiveBlobs::Add (const std::string &name, const std::string &path, const std::string &bytes)
+	{
+		const std::string key = AvocadoArchive::EntryKey (name);
+		if (m_names.find (key) != m_names.end ())
+			return false;
+		const unsigned __int64 hash = ContentHash (bytes.data (),bytes.size ());
+		std::pair<BlobHash::const_iterator,BlobHash::const_iterator> same = m_byContent.equal_range (hash);
+		for (BlobHash::const_iterator it=same.first;it!=same.second;++it)
+		{
+			// a hash match is only taken once the bytes compare, the blob file is read again for it.
+			const Blob &blob = m_blobs[it->second];
+			std::string blobBytes;
+			if (blob.size != bytes.size () || !ReadFile (blob.path,blobBytes) || blobBytes != bytes)
+				continue;
+			m_names.insert (std::make_pair (key,it->second));
+			m_aliases.push_back (std::make_pair (name,blob.name));
+			return false;
+		}
+		Blob blob;
+		blob.name = name;
+		blob.path = path;
+		blob.size = bytes.size ();
+		m_names.insert (std::make_pair (key,m_blobs.size ()));
+		m_byContent.insert (BlobHash::value_type (hash,m_blobs.size ()));
+		m_blobs.push_back (blob);
+		return true;
+	}
+
+	std::string AvocadoArchiveBlobs::GetManifest () const
+	{
+		std::string manifest;
+		for (size_t i=0;i<m_aliases.size ();i++)
+		{
+			std::string line = m_aliases[i].first + "=" + m_aliases[i].second + "\n";
+			for (size_t k=0;k<line.size ();k++)
+				if (line[k] == '\\')
+					line[k] = '/';
+			manifest += line;
+		}
+		return manifest;
+	}
+
+	/* MurmurHash64A, 8 bytes a step. */
+	unsigned __int64 AvocadoArchiveBlobs::ContentHash (const void *data, size_t size)
+	{
+		const unsigned __int64 m = 0xc6a4a7935bd1e995ULL;
+		const int r = 47;
+		unsigned __int64 h = 0x5bd1e995ULL ^ ((unsigned __int64)size * m);
+		const unsigned char *p = (const unsigned char*)data;
+		const unsigned char *end = p + (size & ~size_t (7));
+		for (;p!=end;p+=8)
+		{
+			unsigned __int64 k;
+			memcpy (&k,p,8);
+			k *= m;
+			k ^= k >> r;
+			k *= m;
+			h ^= k;
+			h *= m;
+		}
+		switch (size & 7)
+		{
+		case 7: h ^= (unsigned __int64)p[6] << 48;
+		case 6: h ^= (unsigned __int64)p[5] << 40;
+		case 5: h ^= (unsigned __int64)p[4] << 32;
+		case 4: h ^= (unsigned __int64)p[3] << 24;
+		case 3: h ^= (unsigned __int64)p[2] << 16;
+		case 2: h ^= (unsigned __int64)p[1] << 8;
+		case 1: h ^= (unsigned __int64)p[0];
+			h *= m;
+		}
+		h ^= h >> r;
+		h *= m;
+		h ^= h >> r;
+		return h;
+	}
+
+	bool AvocadoArchiveBlobs::ReadFile (const std::string &path, std::string &bytes)
+	{
+		bytes.clear ();
+		HANDLE file = CreateFileA (path.c_str (),GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		bool res = GetFileSizeEx (file,&size) && (unsigned __int64)size.QuadPart < (unsigned __int64)(size_t (-1) >> 1);
+		if (res)
+			bytes.resize (size_t (size.QuadPart));
+		for (size_t done=0;done<bytes.size () && res;)
+		{
+			const DWORD chunk = DWORD (bytes.size () - done < 0x4000000 ? bytes.size () - done : 0x4000000);
+			DWORD n = 0;
+			res = ::ReadFile (file,&bytes[done],chunk,&n,NULL) && n == chunk;
+			done += chunk;
+		}
+		CloseHandle (file);
+		if (!res)
+			bytes.clear ();
+		return res;
+	}
+
+	struct AvocadoVirtualFiles::Impl
+	{
+		struct MountPoint
+		{
+			std::string					folder;		// FolderKey
+			AvocadoArchiveSharedPtr		archive;
+		};
+
+		Impl ()
+		{
+			InitializeCriticalSection (&m_lock);
+		}
+
+		/* Lower case, '\' separated, no doubled separators, so that the paths the search paths make compare. */
+		static std::string PathKey (const std::string &path)
+		{
+			std::string key;
+			key.reserve (path.size ());
+			for (size_t i=0;i<path.size ();i++)
+			{
+				char c = path[i];
+				if (c == '/')
+					c = '\\';
+				else if (c >= 'A' && c <= 'Z')
+					c = c - 'A' + 'a';
+				if (c == '\\' && i > 1 && !key.empty () && key[key.size () - 1] == '\\')
+					continue;
+				key += c;
+			}
+			return key;
+		}
+
+		static std::string FolderKey (const std::string &folder)
+		{
+			std::string key = PathKey (folder);
+			if (!key.empty () && key[key.size () - 1] != '\\')
+				key += '\\';
+			return key;
+		}
+
+		static bool OnDisk (const std::string &path)
+		{
+			const DWORD attr = GetFileAttributesA (path.c_str ());
+			return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) == 0;
+		}
+
+		// called with m_lock held.
+		bool FindEntry (const std::string &path, AvocadoArchiveSharedPtr &archive, const AvocadoArchiveEntry *&entry)
+		{
+			if (m_mounts.empty ())
+				return false;
+			const std::string key = PathKey (path);
+			for (size_t i=m_mounts.size ();i-- > 0;)
+			{
+				const MountPoint &mount = m_mounts[i];
+				if (key.size () <= mount.folder.size () || key.compare (0,mount.folder.size (),mount.folder) != 0)
+					continue;
+				entry = mount.archive->Find (key.substr (mount.folder.size ()));
+				if (entry)
+				{
+					archive = mount.archive;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool InArchive (const std::string &path)
+		{
+			AvocadoArchiveSharedPtr archive;
+			const AvocadoArchiveEntry *entry = NULL;
+			EnterCriticalSection (&m_lock);
+			const bool res = FindEntry (path,archive,entry);
+			LeaveCriticalSection (&m_lock);
+			return res;
+		}
+
+		CRITICAL_SECTION				m_lock;
+		std::vector<MountPoint>			m_mounts;
+	};
+
+	AvocadoVirtualFiles::AvocadoVirtualFiles () : m_impl (new Impl)
+	{
+	}
+
+	AvocadoVirtualFiles& AvocadoVirtualFiles::Get ()
+	{
+		static AvocadoVirtualFiles files;
+		return files;
+	}
+
+	void AvocadoVirtualFiles::Mount (const std::string &folder, AvocadoArchiveSharedPtr archive)
+	{
+		if (!archive || !archive->IsOpen ())
+			return;
+		Impl::MountPoint mount;
+		mount.folder = Impl::FolderKey (folder);
+		mount.archive = archive;
+		EnterCriticalSection (&m_impl->m_lock);
+		m_impl->m_mounts.push_back (mount);
+		LeaveCriticalSection (&m_impl->m_lock);
+	}
+
+	void AvocadoVirtualFiles::Unmount (const AvocadoArchiveSharedPtr &archive)
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		for (size_t i=m_impl->m_mounts.size ();i-- > 0;)
+			if (m_impl->m_mounts[i].archive == archive)
+				m_impl->m_mounts.erase (m_impl->m_mounts.begin () + i);
+		LeaveCriticalSection (&m_impl->m_lock);
+	}
+
+	bool AvocadoVirtualFiles::Exists (const std::string &path)
+	{
+		return Impl::OnDisk (path) || m_impl->InArchive (path);
+	}
+
+	bool AvocadoVirtualFiles::FindFile (const std::string &name, const std::vector<std::string> &searchPaths, std::string &found)
+	{
+		const size_t slash = name.find_last_of ("\\/");
+		const std::string fileName = (slash == std::string::npos ? name : name.substr (slash + 1));
+		std::vector<std::string> candidates;
+		if (slash != std::string::npos || searchPaths.empty ())
+			candidates.push_back (name);
+		for (size_t i=0;i<searchPaths.size ();i++)
+		{
+			const std::string &dir = searchPaths[i];
+			if (dir.empty ())
+				continue;
+			const char last = dir[dir.size () - 1];
+			candidates.push_back ((last == '\\' || last == '/') ? dir + fileName : dir + "\\" + fileName);
+		}
+		for (size_t i=0;i<candidates.size ();i++)
+			if (Impl::OnDisk (candidates[i]))
+			{
+				found = candidates[i];
+				return true;
+			}
+		for (size_t i=0;i<candidates.size ();i++)
+			if (m_impl->InArchive (candidates[i]))
+			{
+				found = candidates[i];
+				return true;
+			}
+		return false;
+	}
+
+	bool AvocadoVirtualFiles::Read (const std::string &path, AvocadoArchiveData &data)
+	{
+		data = AvocadoArchiveData ();
+		if (Impl::OnDisk (path))
+		{
+			std::shared_ptr<std::string> buffer (new std::string);
+			if (!AvocadoArchiveBlobs::ReadFile (path,*buffer))
+				return false;
+			data.buffer = buffer;
+			data.data = buffer->data ();
+			data.size = buffer->size ();
+			return true;
+		}
+		AvocadoArchiveSharedPtr archive;
+		const AvocadoArchiveEntry *entry = NULL;
+		EnterCriticalSection (&m_impl->m_lock);
+		const bool found = m_impl->FindEntry (path,archive,entry);
+		LeaveCriticalSection (&m_impl->m_lock);
+		// the archive cannot be unmapped while this holds it, reading needs no lock.
+		if (!found || !archive->Read (*entry,data))
+			return false;
+		data.archive = archive;
+		return true;
+	}
+
+	bool AvocadoVirtualFiles::Materialize (const std::string &path)
+	{
+		if (Impl::OnDisk (path))
+			return true;
+		// one at a time, two loaders asking for the same model write it once.
+		EnterCriticalSection (&m_impl->m_lock);
+		AvocadoArchiveSharedPtr archive;
+		const AvocadoArchiveEntry *entry = NULL;
+		bool res = Impl::OnDisk (path);
+		if (!res && m_impl->FindEntry (path,archive,entry))
+		{
+			// the entry folders (models\, textures\) may not be there yet.
+			const size_t slash = path.find_last_of ("\\/");
+			if (slash != std::string::npos)
+			{
+				const std::string dir = path.substr (0,slash);
+				for (size_t sep=dir.find_first_of ("\\/",3);sep!=std::string::npos;sep=dir.find_first_of ("\\/",sep + 1))
+					CreateDirectoryA (dir.substr (0,sep).c_str (),NULL);
+				CreateDirectoryA (dir.c_str (),NULL);
+			}
+			res = archive->Extract (*entry,path);
+		}
+		LeaveCriticalSection (&m_impl->m_lock);
+		return res;
+	}
+}
@@ -0,0 +1,151 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <hash_map>
+
+namespace avocado
+{
+	/* An item of the archive, as its central directory has it. */
+	struct AvocadoArchiveEntry
+	{
+		std::string			name;			// as stored, '/' separated
+		unsigned int		method;			// 0 stored, 8 deflated
+		unsigned int		flags;
+		unsigned long		crc;
+		size_t				compressedSize;
+		size_t				size;
+		size_t				headerOffset;	// of the local header
+	};
+
+	class AvocadoArchive;
+	typedef std::shared_ptr<AvocadoArchive> AvocadoArchiveSharedPtr;
+
+	/* The bytes of an entry. A stored entry points into the mapped archive, which archive keeps mapped while the
+	   data is held, a deflated one into its own buffer. */
+	struct AvocadoArchiveData
+	{
+		AvocadoArchiveData () : data (NULL), size (0) {}
+
+		const char							*data;
+		size_t								size;
+		std::shared_ptr<std::string>		buffer;
+		AvocadoArchiveSharedPtr				archive;
+	};
+
+	/* A zip (the .avc document package) mapped in memory. The central directory is read once on Open, entries are
+	   found by name and read in place : stored ones are not copied, deflated ones are inflated when they are read.
+	   Once open the archive does not change, Find and Read can be called from any thread. */
+	class AvocadoArchive
+	{
+	public:
+		AvocadoArchive ();
+		~AvocadoArchive ();
+
+		bool							Open (const std::string &path);
+		/* Unmaps the file, data read from it must not be used after. */
+		void							Close ();
+		bool							IsOpen () const { return m_view != NULL; }
+		const std::string&				GetPath () const { return m_path; }
+
+		size_t							GetEntryCount () const { return m_entries.size (); }
+		const AvocadoArchiveEntry&		GetEntry (size_t index) const { return m_entries[index]; }
+		/* By name, not case sensitive, '\' and '/' are the same. NULL when the archive has no such entry. */
+		const AvocadoArchiveEntry*		Find (const std::string &name) const;
+		/* The entry bytes, false for an encrypted entry, an unknown method or a corrupt one. data.archive is left
+		   empty, the data is good while this archive stays open. */
+		bool							Read (const AvocadoArchiveEntry &entry, AvocadoArchiveData &data) const;
+		/* Writes the entry to path, through a temporary file next to it. */
+		bool							Extract (const AvocadoArchiveEntry &entry, const std::string &path) const;
+		/* Appends size bytes to the stored entry name of the zip at path, in place : the entry has to be the last
+		   item of the zip and be expectedSize long. The bytes go over the central directory, which is written again
+		   after them, and the entry crc and sizes are updated in it and in the local header. false when the entry
+		   is not such a one or the file could not be written, the zip is left as it was then. The file must not be
+		   open, an archive mapping it included. */
+		static bool						AppendToStoredEntry (const std::string &path, const std::string &name, size_t expectedSize,
+											const char *data, size_t size);
+
+		static std::string				EntryKey (const std::string &name);
+		/* The item listing the entries that share the bytes of another, one "alias=blob" line each, names as stored.
+		   Open makes every alias find its blob. */
+		static const char*				ManifestName () { return "avoassets.txt"; }
+		static void						ParseManifest (const char *data, size_t size, std::vector<std::pair<std::string,std::string> > &aliases);
+	private:
+		AvocadoArchive (const AvocadoArchive &);
+		AvocadoArchive &operator= (const AvocadoArchive &);
+
+		bool							ReadCentralDirectory ();
+		void							ReadManifest ();
+
+		typedef std::hash_map<std::string,size_t> EntryHash;
+
+		std::string						m_path;
+		void							*m_file;
+		void							*m_mapping;
+		const unsigned char				*m_view;
+		size_t							m_size;
+		size_t							m_dirOffset;		// of the central directory
+		size_t							m_endOffset;		// of the end of central directory record
+		std::vector<AvocadoArchiveEntry>	m_entries;
+		EntryHash						m_byName;			// EntryKey to m_entries index, aliases included
+	};
+
+	/* Packaging side of the manifest : the files going into a package are told apart by their content, a file with
+	   the bytes of one already added is not stored again but becomes an alias of it. */
+	class AvocadoArchiveBlobs
+	{
+	public:
+		/* name is the package item name, bytes the file content. false when the item is not to be stored : an
+		   alias (recorded for the manifest) or a name already added. */
+		bool							Add (const std::string &name, const std::string &path, const std::string &bytes);
+		bool							HasAliases () const { return !m_aliases.empty (); }
+		std::string						GetManifest () const;
+
+		static unsigned __int64			ContentHash (const void *data, size_t size);
+		static bool						ReadFile (const std::string &path, std::string &bytes);
+	private:
+		struct Blob
+		{
+			std::string					name;
+			std::string					path;
+			size_t						size;
+		};
+		typedef std::hash_multimap<unsigned __int64,size_t> BlobHash;
+
+		std::vector<Blob>				m_blobs;
+		BlobHash						m_byContent;		// ContentHash to m_blobs index
+		std::hash_map<std::string,size_t>	m_names;		// EntryKey of every added name to its m_blobs index
+		std::vector<std::pair<std::string,std::string> >	m_aliases;
+	};
+
+	/* Archives mounted on folders : a file under the folder that is not on disk is read from the archive entry of
+	   the same relative path. CompressFile mounts an opened document on the session folder, so its models and
+	   textures are read from the .avc as they are needed instead of being extracted when it opens.
+	   Files on disk always come first, the archive mounted last is looked in first. Thread safe. */
+	class AvocadoVirtualFiles
+	{
+	public:
+		static AvocadoVirtualFiles&		Get ();
+
+		void							Mount (const std::string &folder, AvocadoArchiveSharedPtr archive);
+		void							Unmount (const AvocadoArchiveSharedPtr &archive);
+
+		bool							Exists (const std::string &path);
+		/* nvutil::FindFileFirst over disk and the mounted archives : name itself, then its file name in every
+		   search path. A path on disk anywhere wins over a mounted one. */
+		bool							FindFile (const std::string &name, const std::vector<std::string> &searchPaths, std::string &found);
+		/* The file bytes, in place when path is in a mounted archive. */
+		bool							Read (const std::string &path, AvocadoArchiveData &data);
+		/* For what can only open files by name (the SceniX loader plug-ins) : writes the archive entry behind path
+		   to path, once. true when path is on disk after. */
+		bool							Materialize (const std::string &path);
+	private:
+		AvocadoVirtualFiles ();
+
+		struct Impl;
+		Impl							*m_impl;
+	};
+}
@@ -0,0 +1,159 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoAutoSave.h"
+#include <cstring>
+#include <windows.h>
+#include <process.h>
+
+namespace avocado
+{
+	AvocadoAutoSave::AvocadoAutoSave () : m_finish (NULL), m_thread (NULL), m_lastResult (true)
+	{
+	}
+
+	AvocadoAutoSave::~AvocadoAutoSave ()
+	{
+		Join ();
+	}
+
+	AvocadoSnapshotBlockPtr AvocadoAutoSave::FindBlock (int id, unsigned int revision, const float *location) const
+	{
+		BlockHash::const_iterator it = m_blocks.find (id);
+		if (it == m_blocks.end ())
+			return AvocadoSnapshotBlockPtr ();
+		const AvocadoSnapshotBlock &block = *it->second;
+		if (!block.formatted || block.revision != revision || block.hasLocation != (location != NULL))
+			return AvocadoSnapshotBlockPtr ();
+		if (location && memcmp (block.location,location,sizeof (block.location)) != 0)
+			return AvocadoSnapshotBlockPtr ();
+		return it->second;
+	}
+
+	AvocadoSnapshotBlockPtr AvocadoAutoSave::NewBlock (int id, unsigned int revision, const float *location, ParamListSharedPtr params)
+	{
+		AvocadoSnapshotBlockPtr block (new AvocadoSnapshotBlock);
+		block->id = id;
+		block->revision = revision;
+		block->hasLocation = (location != NULL);
+		if (location)
+			memcpy (block->location,location,sizeof (block->location));
+		block->params = params;
+		return block;
+	}
+
+	AvocadoSnapshotBlockPtr AvocadoAutoSave::NewTextBlock (const std::string &text, const AvocadoDocTocEntry &entry)
+	{
+		AvocadoSnapshotBlockPtr block (new AvocadoSnapshotBlock);
+		block->id = entry.id;
+		block->text = text;
+		block->entry = entry;
+		block->formatted = true;
+		return block;
+	}
+
+	bool AvocadoAutoSave::Start (AvocadoDocSnapshot &snapshot, const std::string &path, AvocadoAutoSaveFinish finish)
+	{
+		if (IsRunning ())
+			return false;
+		m_snapshot.docParams = snapshot.docParams;
+		m_snapshot.elements.swap (snapshot.elements);
+		snapshot.docParams = ParamListSharedPtr ();
+		snapshot.elements.clear ();
+		m_path = path;
+		m_finish = finish;
+
+		// the blocks are kept before the thread starts, after that only the thread touches them until it is joined.
+		BlockHash blocks;
+		for (size_t i=0;i<m_snapshot.elements.size ();i++)
+			if (m_snapshot.elements[i]->id >= 0)
+				blocks[m_snapshot.elements[i]->id] = m_snapshot.elements[i];
+		HANDLE h = (HANDLE)_beginthreadex (NULL,0,ThreadMain,this,0,NULL);
+		if (!h)
+		{
+			m_snapshot.docParams = ParamListSharedPtr ();
+			m_snapshot.elements.clear ();
+			return false;
+		}
+		m_blocks.swap (blocks);
+		m_thread = h;
+		return true;
+	}
+
+	bool AvocadoAutoSave::IsRunning ()
+	{
+		if (!m_thread)
+			return false;
+		if (WaitForSingleObject ((HANDLE)m_thread,0) != WAIT_OBJECT_0)
+			return true;
+		Join ();
+		return false;
+	}
+
+	bool AvocadoAutoSave::Wait ()
+	{
+		Join ();
+		return m_lastResult;
+	}
+
+	void AvocadoAutoSave::ClearBlocks ()
+	{
+		m_blocks.clear ();
+	}
+
+	void AvocadoAutoSave::Join ()
+	{
+		if (!m_thread)
+			return;
+		WaitForSingleObject ((HANDLE)m_thread,INFINITE);
+		CloseHandle ((HANDLE)m_thread);
+		m_thread = NULL;
+	}
+
+	unsigned __stdcall AvocadoAutoSave::ThreadMain (void *arg)
+	{
+		AvocadoAutoSave *autoSave = (AvocadoAutoSave*)arg;
+		autoSave->m_lastResult = autoSave->Run ();
+		return 0;
+	}
+
+	/* Every block gets its text even when the file could not be written, the next snapshot counts on it. */
+	bool AvocadoAutoSave::Run ()
+	{
+		const std::string written = m_path + ".tmp";
+		bool res = false;
+		{
+			AvocadoFileDocSink file (written);
+			AvocadoDocWriter writer (file,true);
+			writer.Begin (*m_snapshot.docParams);
+			m_snapshot.docParams = ParamListSharedPtr ();
+			for (size_t i=0;i<m_snapshot.elements.size ();i++)
+			{
+				AvocadoSnapshotBlock &block = *m_snapshot.elements[i];
+				if (!block.formatted)
+				{
+					block.text = block.params->SerializeList ();
+					ReadElementTocEntry (*block.params,block.entry);
+					block.params = ParamListSharedPtr ();
+					block.formatted = true;
+				}
+				if (writer.IsGood ())
+					writer.WriteElement (block.text,&block.entry);
+			}
+			writer.End ();
+			res = writer.IsGood () && file.Close ();
+		}
+		// the blocks stay with the engine thread copy (m_blocks), this one lets go of them here.
+		m_snapshot.elements.clear ();
+		if (res)
+			res = (m_finish ? m_finish (written,m_path) : MoveToPath (written,m_path));
+		if (!res)
+			DeleteFileA (written.c_str ());
+		return res;
+	}
+
+	bool AvocadoAutoSave::MoveToPath (const std::string &written, const std::string &path)
+	{
+		return MoveFileExA (written.c_str (),path.c_str (),MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+	}
+}
@@ -0,0 +1,82 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include "AvocadoParams.h"
+#include "AvocadoDocStream.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <hash_map>
+
+namespace avocado
+{
+	/* One element of a snapshot. The engine thread fills params, the autosave thread turns them into text and lets them go.
+	   After that nobody writes to the block, the next snapshot reuses it for as long as the element stays the same. */
+	struct AvocadoSnapshotBlock
+	{
+		AvocadoSnapshotBlock () : id (-1), revision (0), hasLocation (false), formatted (false) {}
+
+		int						id;
+		unsigned int			revision;
+		bool					hasLocation;
+		float					location[16];
+		ParamListSharedPtr		params;
+		bool					formatted;
+		std::string				text;
+		AvocadoDocTocEntry		entry;
+	};
+	typedef std::shared_ptr<AvocadoSnapshotBlock> AvocadoSnapshotBlockPtr;
+
+	/* What an autosave writes, taken on the engine thread. The blocks of elements that did not change are shared with
+	   the previous snapshot, no element text and no geometry is copied. */
+	struct AvocadoDocSnapshot
+	{
+		ParamListSharedPtr						docParams;
+		std::vector<AvocadoSnapshotBlockPtr>	elements;
+	};
+
+	/* Moves the written file to its place, zipping it on the way if it wants to. Runs on the autosave thread. */
+	typedef bool (*AvocadoAutoSaveFinish) (const std::string &written, const std::string &path);
+
+	/* Writes document snapshots on a thread of its own, one at a time. Everything but the thread body is called from the
+	   engine thread. */
+	class AvocadoAutoSave
+	{
+	public:
+		AvocadoAutoSave ();
+		/* Waits for a running save. */
+		~AvocadoAutoSave ();
+
+		/* The block the last snapshot had for the element, while its revision and location are the same. */
+		AvocadoSnapshotBlockPtr		FindBlock (int id, unsigned int revision, const float *location) const;
+		/* A block for an element that changed, params is the element serializeParams list and must not be kept elsewhere. */
+		static AvocadoSnapshotBlockPtr	NewBlock (int id, unsigned int revision, const float *location, ParamListSharedPtr params);
+		/* A block for element text that never changes (a pending element of a binary document). */
+		static AvocadoSnapshotBlockPtr	NewTextBlock (const std::string &text, const AvocadoDocTocEntry &entry);
+
+		/* Starts writing the snapshot, path is written through a temporary file next to it. Takes the snapshot apart,
+		   false while the previous save still runs or when the thread could not start. */
+		bool						Start (AvocadoDocSnapshot &snapshot, const std::string &path, AvocadoAutoSaveFinish finish = NULL);
+		bool						IsRunning ();
+		/* Waits for a running save, true when the last save reached its file. */
+		bool						Wait ();
+		/* A new document, its ids mean other elements. */
+		void						ClearBlocks ();
+
+		static bool					MoveToPath (const std::string &written, const std::string &path);
+	private:
+		typedef std::hash_map<int,AvocadoSnapshotBlockPtr> BlockHash;
+
+		static unsigned __stdcall	ThreadMain (void *arg);
+		bool						Run ();
+		void						Join ();
+
+		BlockHash					m_blocks;			// the last snapshot by element id, engine thread only
+		AvocadoDocSnapshot			m_snapshot;			// the autosave thread owns it while it runs
+		std::string					m_path;
+		AvocadoAutoSaveFinish		m_finish;
+		void						*m_thread;
+		bool						m_lastResult;
+	};
+}
@@ -0,0 +1,722 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoDocStream.h"
+#include "AvocadoParams.h"
+#include <sstream>
+#include <cstring>
+#include <io.h>
+
+namespace avocado
+{
+	static const size_t s_fileSinkBufferSize = 256 * 1024;
+
+	static const char s_binaryDocMagic[] = "AVCDOCV2";
+	static const char s_binaryTocMagic[] = "AVCTOCV2";
+	static const char s_binaryJournalMagic[] = "AVCJNLV2";
+	static const size_t s_binaryMagicSize = 8;
+	static const unsigned int s_binaryDocVersion = 2;
+	static const size_t s_fileHeaderSize = s_binaryMagicSize + 8;
+	static const size_t s_trailerSize = 16 + s_binaryMagicSize;
+	static const size_t s_maxStateIndex = 0xffff;
+
+	enum { AVC_DOC_TOC_VISIBLE = 1, AVC_DOC_TOC_REF = 2 };
+
+	AvocadoFileDocSink::AvocadoFileDocSink (const std::string &path) : m_good (true)
+	{
+		m_file = fopen (path.c_str (),"wb");
+		if (m_file)
+			setvbuf (m_file,NULL,_IOFBF,s_fileSinkBufferSize);
+		else
+			m_good = false;
+	}
+
+	AvocadoFileDocSink::~AvocadoFileDocSink ()
+	{
+		Close ();
+	}
+
+	bool AvocadoFileDocSink::Write (const char *data, size_t size)
+	{
+		if (!m_file)
+			return false;
+		if (size && fwrite (data,1,size,m_file) != size)
+			m_good = false;
+		return m_good;
+	}
+
+	bool AvocadoFileDocSink::Close ()
+	{
+		if (m_file)
+		{
+			if (fclose (m_file) != 0)
+				m_good = false;
+			m_file = NULL;
+		}
+		return m_good;
+	}
+
+	// FNV-1a, tells a changed header or state block from the one in the file.
+	static unsigned __int64 BlockHashOf (const char *data, size_t size)
+	{
+		unsigned __int64 hash = 14695981039346656037ULL;
+		for (size_t i=0;i<size;i++)
+		{
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	void AvocadoDocJournal::Reset ()
+	{
+		m_blocks.clear ();
+		m_valid = false;
+		m_fileSize = 0;
+		m_staleBytes = 0;
+		m_entryCount = 0;
+		m_trailer.clear ();
+	}
+
+	bool AvocadoDocJournal::HasElement (int id) const
+	{
+		return m_valid && m_blocks.find (BlockKey (AVC_DOC_BLOCK_ELEMENT,id)) != m_blocks.end ();
+	}
+
+	bool AvocadoDocJournal::NeedsCompaction (int maxEntries) const
+	{
+		return m_entryCount >= maxEntries || m_staleBytes * 2 > m_fileSize;
+	}
+
+	void AvocadoDocJournal::SetBlock (const AvocadoDocTocEntry &entry, unsigned __int64 hash)
+	{
+		Block &block = m_blocks[BlockKey (entry.kind,entry.id)];
+		if (block.size)
+			m_staleBytes += block.size;
+		block.hash = hash;
+		block.size = entry.size;
+	}
+
+	void AvocadoDocJournal::RemoveBlock (int kind, int id)
+	{
+		BlockHash::iterator it = m_blocks.find (BlockKey (kind,id));
+		if (it == m_blocks.end ())
+			return;
+		m_staleBytes += it->second.size;
+		m_blocks.erase (it);
+	}
+
+	bool AvocadoDocJournal::SameBlock (int kind, int id, unsigned __int64 hash) const
+	{
+		BlockHash::const_iterator it = m_blocks.find (BlockKey (kind,id));
+		return it != m_blocks.end () && it->second.hash == hash;
+	}
+
+	AvocadoDocJournalFile::AvocadoDocJournalFile (const std::string &path, const AvocadoDocJournal &journal) : m_file (NULL), m_start (0), m_good (false)
+	{
+		if (!journal.IsValid () || journal.GetTrailer ().size () != s_trailerSize)
+			return;
+		FILE *file = fopen (path.c_str (),"r+b");
+		if (!file)
+			return;
+		char tail[s_trailerSize];
+		if (_fseeki64 (file,0,SEEK_END) == 0 && (unsigned __int64)_ftelli64 (file) == journal.GetFileSize () &&
+			_fseeki64 (file,-(__int64)s_trailerSize,SEEK_END) == 0 && fread (tail,1,s_trailerSize,file) == s_trailerSize &&
+			memcmp (tail,journal.GetTrailer ().data (),s_trailerSize) == 0 && _fseeki64 (file,0,SEEK_END) == 0)
+		{
+			m_file = file;
+			m_start = journal.GetFileSize ();
+			m_good = true;
+		}
+		else
+			fclose (file);
+	}
+
+	AvocadoDocJournalFile::~AvocadoDocJournalFile ()
+	{
+		Close (false);
+	}
+
+	bool AvocadoDocJournalFile::Write (const char *data, size_t size)
+	{
+		if (!m_file)
+			return false;
+		if (size && fwrite (data,1,size,m_file) != size)
+			m_good = false;
+		return m_good;
+	}
+
+	bool AvocadoDocJournalFile::Close (bool keep)
+	{
+		if (!m_file)
+			return false;
+		bool kept = m_good && keep;
+		if (fflush (m_file) != 0)
+			kept = false;
+		if (!kept)
+			_chsize_s (_fileno (m_file),(__int64)m_start);
+		if (fclose (m_file) != 0)
+			kept = false;
+		m_file = NULL;
+		return kept;
+	}
+
+	static void PutUInt (std::string &out, unsigned __int64 value, size_t bytes)
+	{
+		for (size_t i=0;i<bytes;i++)
+			out += char ((value >> (8 * i)) & 0xff);
+	}
+
+	static void PutString16 (std::string &out, const std::string &str)
+	{
+		const size_t len = (str.size () < 0xffff ? str.size () : 0xffff);
+		PutUInt (out,len,2);
+		out.append (str.data (),len);
+	}
+
+	/* Bounds checked little endian reads, every Get fails once the data ran out. */
+	class AvocadoDocBytes
+	{
+	public:
+		AvocadoDocBytes (const unsigned char *begin, const unsigned char *end) : m_cur (begin), m_end (end) {}
+
+		bool GetUInt (unsigned __int64 &value, size_t bytes)
+		{
+			if (size_t (m_end - m_cur) < bytes)
+				return false;
+			value = 0;
+			for (size_t i=0;i<bytes;i++)
+				value |= (unsigned __int64)(*m_cur++) << (8 * i);
+			return true;
+		}
+
+		bool GetInt32 (int &value)
+		{
+			unsigned __int64 v;
+			if (!GetUInt (v,4))
+				return false;
+			value = int ((unsigned int)v);
+			return true;
+		}
+
+		bool GetString16 (std::string &str)
+		{
+			unsigned __int64 len;
+			if (!GetUInt (len,2) || size_t (m_end - m_cur) < size_t (len))
+				return false;
+			str.assign ((const char*)m_cur,size_t (len));
+			m_cur += size_t (len);
+			return true;
+		}
+	private:
+		const unsigned char *m_cur;
+		const unsigned char *m_end;
+	};
+
+	static const ParamAtom s_tocElementIDAtom ("elementID");
+	static const ParamAtom s_tocAnnoIDAtom ("AnnoID");
+	static const ParamAtom s_tocElementNameAtom ("elementName");
+	static const ParamAtom s_tocNameAtom ("Name");
+	static const ParamAtom s_tocOwnerModuleAtom ("OwnerModule");
+	static const ParamAtom s_tocVisibilityAtom ("Visibility");
+	static const ParamAtom s_tocIsVisibleAtom ("isVisible");
+	static const ParamAtom s_tocIsRefAtom ("isRef");
+	static const ParamAtom s_tocRefIDAtom ("eid");
+
+	void ReadElementTocEntry (ParamList &params, AvocadoDocTocEntry &entry)
+	{
+		entry.kind = AVC_DOC_BLOCK_ELEMENT;
+		if (!params.GetIntValueByName (s_tocElementIDAtom,entry.id))
+			params.GetIntValueByName (s_tocAnnoIDAtom,entry.id);
+		if (!params.GetStringValueByName (s_tocElementNameAtom,entry.name))
+			params.GetStringValueByName (s_tocNameAtom,entry.name);
+		params.GetStringValueByName (s_tocOwnerModuleAtom,entry.ownerModule);
+		if (!params.GetBoolValueByName (s_tocVisibilityAtom,entry.isVisible))
+			params.GetBoolValueByName (s_tocIsVisibleAtom,entry.isVisible);
+		params.GetBoolValueByName (s_tocIsRefAtom,entry.isRef);
+		if (entry.isRef)
+			params.GetIntValueByName (s_tocRefIDAtom,entry.parentID);
+	}
+
+	/* The per state params of the doc params end with their state index, everything else stays in the header block.
+	   The per item names of old documents (ViewStateHtml0-3 ..) stay in the header too, they read the same from there. */
+	static bool StateBlockOf (const char *name, size_t length, int &kind, size_t &index)
+	{
+		static const char *viewStateNames[] = { "ViewStateHtmlLines", "ViewStateImage", "ViewStateElementIDs", "ViewStateElementLocations", "ViewStateElementVisibilities" };
+		static const char *materialStateNames[] = { "MaterialStateMatElemIDs", "MaterialStateMatElemDatas" };
+		const size_t viewStateCount = sizeof (viewStateNames) / sizeof (viewStateNames[0]);
+		const size_t nameCount = viewStateCount + sizeof (materialStateNames) / sizeof (materialStateNames[0]);
+		for (size_t k=0;k<nameCount;k++)
+		{
+			const char *prefix = (k < viewStateCount ? viewStateNames[k] : materialStateNames[k - viewStateCount]);
+			const size_t prefixLength = strlen (prefix);
+			if (length <= prefixLength || strncmp (name,prefix,prefixLength) != 0)
+				continue;
+			index = 0;
+			size_t i = prefixLength;
+			for (;i<length && name[i] >= '0' && name[i] <= '9' && index <= s_maxStateIndex;i++)
+				index = index * 10 + size_t (name[i] - '0');
+			if (i < length || index > s_maxStateIndex)
+				return false;
+			kind = (k < viewStateCount ? AVC_DOC_BLOCK_VIEW_STATE : AVC_DOC_BLOCK_MATERIAL_STATE);
+			return true;
+		}
+		return false;
+	}
+
+	bool AvocadoDocWriter::Write (const char *data, size_t size)
+	{
+		if (!m_good)
+			return false;
+		m_good = m_sink.Write (data,size);
+		if (m_good)
+			m_bytesWritten += size;
+		return m_good;
+	}
+
+	bool AvocadoDocWriter::WriteBlock (const std::string &block, AvocadoDocTocEntry &entry, unsigned __int64 hash)
+	{
+		entry.offset = m_base + m_bytesWritten;
+		entry.size = block.size ();
+		m_toc.push_back (entry);
+		m_hashes.push_back (hash);
+		return Write (block);
+	}
+
+	bool AvocadoDocWriter::Begin (const std::string &docParams)
+	{
+		if (m_binary)
+		{
+			ParamListSharedPtr pl = ParamList::createFromString (docParams);
+			return Begin (*pl);
+		}
+		Write ("<AvocadoDocV1>\n",15);
+		Write (docParams);
+		return Write ("\n",1);
+	}
+
+	bool AvocadoDocWriter::Begin (ParamList &docParams)
+	{
+		if (!m_binary)
+			return Begin (docParams.SerializeList ());
+
+		std::string fileHeader (s_binaryDocMagic,s_binaryMagicSize);
+		PutUInt (fileHeader,s_binaryDocVersion,4);
+		PutUInt (fileHeader,0,4);
+		Write (fileHeader);
+		WriteDocParams (docParams);
+		return m_good;
+	}
+
+	bool AvocadoDocWriter::BeginJournal (ParamList &docParams)
+	{
+		if (!m_binary || !m_journal || !m_journal->IsValid ())
+			return m_good = false;
+		m_appending = true;
+		m_base = m_journal->GetFileSize ();
+		WriteDocParams (docParams);
+		return m_good;
+	}
+
+	/* The header block, then a block per view state and per material state. A journal entry only gets the blocks whose text
+	   changed, and drops the states that are gone. */
+	void AvocadoDocWriter::WriteDocParams (ParamList &docParams)
+	{
+		std::string header;
+		std::vector<std::string> viewStates, materialStates;
+		for (size_t i=0;i<docParams.GetParamCount ();i++)
+		{
+			const Param *p = docParams.GetParam (i);
+			int kind;
+			size_t index;
+			if (!StateBlockOf (p->GetNameData (),p->GetNameLength (),kind,index))
+			{
+				header += docParams.SerializeParam (i);
+				continue;
+			}
+			std::vector<std::string> &states = (kind == AVC_DOC_BLOCK_VIEW_STATE ? viewStates : materialStates);
+			if (states.size () <= index)
+				states.resize (index + 1);
+			states[index] += docParams.SerializeParam (i);
+		}
+
+		AvocadoDocTocEntry entry;
+		const size_t blockCount = 1 + viewStates.size () + materialStates.size ();
+		for (size_t b=0;b<blockCount && m_good;b++)
+		{
+			const std::string *block = &header;
+			entry.kind = AVC_DOC_BLOCK_HEADER;
+			entry.id = 0;
+			if (b > viewStates.size ())
+			{
+				entry.kind = AVC_DOC_BLOCK_MATERIAL_STATE;
+				entry.id = int (b - 1 - viewStates.size ());
+				block = &materialStates[entry.id];
+			}
+			else if (b > 0)
+			{
+				entry.kind = AVC_DOC_BLOCK_VIEW_STATE;
+				entry.id = int (b - 1);
+				block = &viewStates[entry.id];
+			}
+			const unsigned __int64 hash = (m_journal ? BlockHashOf (block->data (),block->size ()) : 0);
+			if (m_appending && m_journal->SameBlock (entry.kind,entry.id,hash))
+				continue;
+			WriteBlock (*block,entry,hash);
+		}
+
+		if (!m_appending)
+			return;
+		for (AvocadoDocJournal::BlockHash::const_iterator it=m_journal->m_blocks.begin ();it!=m_journal->m_blocks.end ();++it)
+		{
+			const int kind = int (it->first >> 32);
+			const int id = int ((unsigned int)it->first);
+			if ((kind == AVC_DOC_BLOCK_VIEW_STATE && size_t (id) >= viewStates.size ()) ||
+				(kind == AVC_DOC_BLOCK_MATERIAL_STATE && size_t (id) >= materialStates.size ()))
+				m_removed.push_back (std::pair<int,int> (kind,id));
+		}
+	}
+
+	bool AvocadoDocWriter::WriteElement (const std::string &element, const AvocadoDocTocEntry *entry)
+	{
+		if (!m_binary)
+		{
+			Write ("<Element>\n",10);
+			Write (element);
+			return Write ("\n</Element>\n",12);
+		}
+		AvocadoDocTocEntry tocEntry;
+		if (entry)
+			tocEntry = *entry;
+		else
+		{
+			ParamListSharedPtr pl = ParamList::createFromString (element);
+			ReadElementTocEntry (*pl,tocEntry);
+		}
+		tocEntry.kind = AVC_DOC_BLOCK_ELEMENT;
+		return WriteBlock (element,tocEntry,0);
+	}
+
+	void AvocadoDocWriter::RemoveElement (int id)
+	{
+		if (m_appending)
+			m_removed.push_back (std::pair<int,int> (AVC_DOC_BLOCK_ELEMENT,id));
+	}
+
+	bool AvocadoDocWriter::End ()
+	{
+		if (!m_binary)
+			return Write ("</AvocadoDocV1>\n",16);
+		if (m_appending && !HasChanges ())
+			return m_good;
+
+		const unsigned __int64 tocOffset = m_base + m_bytesWritten;
+		std::string toc;
+		if (m_appending)
+			PutUInt (toc,m_base,8);
+		PutUInt (toc,m_toc.size (),4);
+		for (size_t i=0;i<m_toc.size ();i++)
+		{
+			const AvocadoDocTocEntry &entry = m_toc[i];
+			PutUInt (toc,(unsigned int)entry.kind,1);
+			PutUInt (toc,(entry.isVisible ? AVC_DOC_TOC_VISIBLE : 0) | (entry.isRef ? AVC_DOC_TOC_REF : 0),1);
+			PutUInt (toc,(unsigned int)entry.id,4);
+			PutUInt (toc,(unsigned int)entry.parentID,4);
+			PutUInt (toc,entry.offset,8);
+			PutUInt (toc,entry.size,4);
+			PutString16 (toc,entry.name);
+			PutString16 (toc,entry.ownerModule);
+		}
+		if (m_appending)
+		{
+			PutUInt (toc,m_removed.size (),4);
+			for (size_t i=0;i<m_removed.size ();i++)
+			{
+				PutUInt (toc,(unsigned int)m_removed[i].first,1);
+				PutUInt (toc,(unsigned int)m_removed[i].second,4);
+			}
+		}
+		Write (toc);
+
+		std::string trailer;
+		PutUInt (trailer,tocOffset,8);
+		PutUInt (trailer,toc.size (),8);
+		trailer.append (m_appending ? s_binaryJournalMagic : s_binaryTocMagic,s_binaryMagicSize);
+		Write (trailer);
+
+		if (m_journal)
+		{
+			if (!m_good)
+				m_journal->Reset ();
+			else
+			{
+				if (!m_appending)
+					m_journal->Reset ();
+				for (size_t i=0;i<m_toc.size ();i++)
+					m_journal->SetBlock (m_toc[i],m_hashes[i]);
+				for (size_t i=0;i<m_removed.size ();i++)
+					m_journal->RemoveBlock (m_removed[i].first,m_removed[i].second);
+				m_journal->m_fileSize = m_base + m_bytesWritten;
+				m_journal->m_trailer = trailer;
+				m_journal->m_valid = true;
+				if (m_appending)
+					m_journal->m_entryCount++;
+			}
+		}
+		m_toc.clear ();
+		m_hashes.clear ();
+		m_removed.clear ();
+		return m_good;
+	}
+
+	bool AvocadoDocReader::IsBinary (const char *data, size_t size)
+	{
+		return size >= s_binaryMagicSize && memcmp (data,s_binaryDocMagic,s_binaryMagicSize) == 0;
+	}
+
+	/* The toc of the whole save, or of a journal entry whose blocks lie between the end of the previous entry and its toc. */
+	bool AvocadoDocReader::ReadToc (const unsigned char *data, size_t tocOffset, size_t tocEnd, bool journal,
+		std::vector<AvocadoDocTocEntry> &toc, std::vector<std::pair<int,int> > &removed, size_t &previousEnd)
+	{
+		AvocadoDocBytes in (data + tocOffset,data + tocEnd);
+		size_t blocksBegin = s_fileHeaderSize;
+		if (journal)
+		{
+			unsigned __int64 end;
+			if (!in.GetUInt (end,8) || end < s_fileHeaderSize + s_trailerSize || end > tocOffset)
+				return false;
+			previousEnd = size_t (end);
+			blocksBegin = previousEnd;
+		}
+		unsigned __int64 count;
+		if (!in.GetUInt (count,4))
+			return false;
+		for (unsigned __int64 i=0;i<count;i++)
+		{
+			AvocadoDocTocEntry entry;
+			unsigned __int64 kind, flags, offset, blockSize;
+			if (!in.GetUInt (kind,1) || !in.GetUInt (flags,1) || !in.GetInt32 (entry.id) || !in.GetInt32 (entry.parentID) ||
+				!in.GetUInt (offset,8) || !in.GetUInt (blockSize,4) || !in.GetString16 (entry.name) || !in.GetString16 (entry.ownerModule))
+				return false;
+			if (kind > AVC_DOC_BLOCK_ELEMENT || offset < blocksBegin || offset > tocOffset || blockSize > tocOffset - offset)
+				return false;
+			entry.kind = int (kind);
+			entry.isVisible = (flags & AVC_DOC_TOC_VISIBLE) != 0;
+			entry.isRef = (flags & AVC_DOC_TOC_REF) != 0;
+			entry.offset = offset;
+			entry.size = size_t (blockSize);
+			toc.push_back (entry);
+		}
+		if (!journal)
+			return true;
+		if (!in.GetUInt (count,4))
+			return false;
+		for (unsigned __int64 i=0;i<count;i++)
+		{
+			unsigned __int64 kind;
+			int id;
+			if (!in.GetUInt (kind,1) || !in.GetInt32 (id) || kind > AVC_DOC_BLOCK_ELEMENT)
+				return false;
+			removed.push_back (std::pair<int,int> (int (kind),id));
+		}
+		return true;
+	}
+
+	bool AvocadoDocReader::Open (const std::string &bytes)
+	{
+		Close ();
+		const size_t size = bytes.size ();
+		if (!IsBinary (bytes.data (),size) || size < s_fileHeaderSize + s_trailerSize)
+			return false;
+		const unsigned char *data = (const unsigned char*)bytes.data ();
+		unsigned __int64 version;
+		AvocadoDocBytes fileHeader (data + s_binaryMagicSize,data + s_fileHeaderSize);
+		if (!fileHeader.GetUInt (version,4) || version > s_binaryDocVersion)
+			return false;
+
+		// from the last trailer back to the whole save, every entry ends where the next one starts.
+		std::vector<AvocadoDocTocEntry> toc;
+		std::vector<std::vector<AvocadoDocTocEntry> > entries;
+		std::vector<std::vector<std::pair<int,int> > > removals;
+		size_t end = size;
+		for (;;)
+		{
+			if (end < s_fileHeaderSize + s_trailerSize)
+				return false;
+			const unsigned char *magic = data + end - s_binaryMagicSize;
+			const bool journal = (memcmp (magic,s_binaryJournalMagic,s_binaryMagicSize) == 0);
+			if (!journal && memcmp (magic,s_binaryTocMagic,s_binaryMagicSize) != 0)
+				return false;
+			unsigned __int64 tocOffset, tocSize;
+			AvocadoDocBytes trailer (data + end - s_trailerSize,data + end);
+			if (!trailer.GetUInt (tocOffset,8) || !trailer.GetUInt (tocSize,8))
+				return false;
+			const size_t tocEnd = end - s_trailerSize;
+			if (tocOffset < s_fileHeaderSize || tocOffset > tocEnd || tocSize != tocEnd - tocOffset)
+				return false;
+			std::vector<AvocadoDocTocEntry> entryToc;
+			std::vector<std::pair<int,int> > removed;
+			size_t previousEnd = 0;
+			if (!ReadToc (data,size_t (tocOffset),tocEnd,journal,entryToc,removed,previousEnd))
+				return false;
+			if (!journal)
+			{
+				toc.swap (entryToc);
+				break;
+			}
+			entries.resize (entries.size () + 1);
+			entries.back ().swap (entryToc);
+			removals.resize (removals.size () + 1);
+			removals.back ().swap (removed);
+			end = previousEnd;
+		}
+
+		// the entries apply oldest first, a block keeps the place of the one it replaces.
+		std::hash_map<unsigned __int64,size_t> index;
+		std::vector<bool> removedBlocks (toc.size (),false);
+		for (size_t i=0;i<toc.size ();i++)
+			index[AvocadoDocJournal::BlockKey (toc[i].kind,toc[i].id)] = i;
+		unsigned __int64 staleBytes = 0;
+		for (size_t e=entries.size ();e-->0;)
+		{
+			for (size_t i=0;i<entries[e].size ();i++)
+			{
+				const AvocadoDocTocEntry &entry = entries[e][i];
+				const unsigned __int64 key = AvocadoDocJournal::BlockKey (entry.kind,entry.id);
+				std::hash_map<unsigned __int64,size_t>::iterator it = index.find (key);
+				if (it != index.end ())
+				{
+					staleBytes += toc[it->second].size;
+					toc[it->second] = entry;
+				}
+				else
+				{
+					index[key] = toc.size ();
+					toc.push_back (entry);
+					removedBlocks.push_back (false);
+				}
+			}
+			for (size_t i=0;i<removals[e].size ();i++)
+			{
+				std::hash_map<unsigned __int64,size_t>::iterator it = index.find (AvocadoDocJournal::BlockKey (removals[e][i].first,removals[e][i].second));
+				if (it == index.end ())
+					continue;
+				staleBytes += toc[it->second].size;
+				removedBlocks[it->second] = true;
+				index.erase (it);
+			}
+		}
+		if (!entries.empty ())
+		{
+			size_t kept = 0;
+			for (size_t i=0;i<toc.size ();i++)
+				if (!removedBlocks[i])
+					toc[kept++] = toc[i];
+			toc.resize (kept);
+		}
+
+		m_bytes = bytes;
+		m_toc.swap (toc);
+		m_staleBytes = staleBytes;
+		m_entryCount = int (entries.size ());
+		return true;
+	}
+
+	void AvocadoDocReader::Close ()
+	{
+		std::string ().swap (m_bytes);
+		std::vector<AvocadoDocTocEntry> ().swap (m_toc);
+		m_staleBytes = 0;
+		m_entryCount = 0;
+	}
+
+	std::string AvocadoDocReader::GetBlock (size_t i) const
+	{
+		return m_bytes.substr (size_t (m_toc[i].offset),m_toc[i].size);
+	}
+
+	std::string AvocadoDocReader::GetDocParams () const
+	{
+		std::string docParams;
+		for (size_t i=0;i<m_toc.size ();i++)
+			if (m_toc[i].kind != AVC_DOC_BLOCK_ELEMENT)
+				docParams.append (m_bytes,size_t (m_toc[i].offset),m_toc[i].size);
+		return docParams;
+	}
+
+	void AvocadoDocReader::FillJournal (AvocadoDocJournal &journal) const
+	{
+		journal.Reset ();
+		if (!IsOpen ())
+			return;
+		for (size_t i=0;i<m_toc.size ();i++)
+		{
+			const AvocadoDocTocEntry &entry = m_toc[i];
+			const unsigned __int64 hash = (entry.kind != AVC_DOC_BLOCK_ELEMENT ? BlockHashOf (m_bytes.data () + size_t (entry.offset),entry.size) : 0);
+			journal.SetBlock (entry,hash);
+		}
+		journal.m_staleBytes = m_staleBytes;
+		journal.m_fileSize = m_bytes.size ();
+		journal.m_trailer = m_bytes.substr (m_bytes.size () - s_trailerSize);
+		journal.m_entryCount = m_entryCount;
+		journal.m_valid = true;
+	}
+
+	/* Reads the text layout the way AvocadoEngineDoc does, a document without its footer is refused. */
+	bool ConvertTextDocumentToBinary (const std::string &text, AvocadoDocSink &sink)
+	{
+		AvocadoDocWriter writer (sink,true);
+		std::istringstream in (text);
+		std::string line, element;
+		bool started = false;
+		bool inElement = false;
+		while (writer.IsGood () && std::getline (in,line))
+		{
+			if (line == "<AvocadoDocV1>")
+			{
+				if (started)
+					return false;
+				std::string docParams;
+				std::getline (in,docParams);
+				writer.Begin (docParams);
+				started = true;
+			}
+			else if (line == "</AvocadoDocV1>")
+			{
+				if (!started || inElement)
+					return false;
+				return writer.End ();
+			}
+			else if (line == "<Element>")
+			{
+				if (!started || inElement)
+					return false;
+				inElement = true;
+				element.clear ();
+			}
+			else if (line == "</Element>")
+			{
+				if (!inElement)
+					return false;
+				writer.WriteElement (element);
+				inElement = false;
+			}
+			else if (inElement)
+				element += line;
+		}
+		return false;
+	}
+
+	bool ConvertBinaryDocumentToText (const std::string &bytes, AvocadoDocSink &sink)
+	{
+		AvocadoDocReader reader;
+		if (!reader.Open (bytes))
+			return false;
+		AvocadoDocWriter writer (sink);
+		writer.Begin (reader.GetDocParams ());
+		for (size_t i=0;i<reader.GetEntryCount () && writer.IsGood ();i++)
+			if (reader.GetEntry (i).kind == AVC_DOC_BLOCK_ELEMENT)
+				writer.WriteElement (reader.GetBlock (i));
+		return writer.End ();
+	}
+}
@@ -0,0 +1,218 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include "AvocadoAppInterface.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <hash_map>
+
+namespace avocado
+{
+	class ParamList;
+
+	/* Appends to a string, the adapter behind SerializeDocument (str,true). */
+	class AvocadoStringDocSink : public AvocadoDocSink
+	{
+	public:
+		AvocadoStringDocSink (std::string &str, bool binarySafe = false) : m_str (str), m_binarySafe (binarySafe) {}
+		virtual bool	Write (const char *data, size_t size) { m_str.append (data,size); return true; }
+		virtual bool	IsBinarySafe () const { return m_binarySafe; }
+	private:
+		std::string		&m_str;
+		bool			m_binarySafe;
+	};
+
+	/* Writes to a file through a fixed buffer. */
+	class AvocadoFileDocSink : public AvocadoDocSink
+	{
+	public:
+		AvocadoFileDocSink (const std::string &path);
+		~AvocadoFileDocSink ();
+		bool			IsOpen () const { return m_file != NULL; }
+		virtual bool	Write (const char *data, size_t size);
+		virtual bool	IsBinarySafe () const { return true; }
+		/* Flushes and closes, false if anything failed to reach the file. */
+		bool			Close ();
+	private:
+		FILE			*m_file;
+		bool			m_good;
+	};
+
+	/* The binary (v2) document, all numbers little endian :
+	     file header	"AVCDOCV2", uint32 version, uint32 reserved
+	     blocks			ParamList text, one after the other
+	     toc			uint32 count, then per block uint8 kind, uint8 flags, int32 id, int32 parentID,
+						uint64 offset, uint32 size, uint16 sized name, uint16 sized owner module
+	     trailer		uint64 toc offset, uint64 toc size, "AVCTOCV2"
+	   The toc goes last so the file is still written front to back. The header block holds the doc params and LastIDCount,
+	   every view state and material state has a block of its own. The header block followed by the state blocks is the
+	   list a v1 document keeps on its <AvocadoDocV1> line, element blocks are the text between <Element> and </Element>.
+
+	   A journaled save appends an entry after the trailer instead of writing the file again :
+	     blocks			the blocks that changed
+	     journal toc	uint64 end of the previous entry, uint32 count, the changed blocks as in the toc,
+						uint32 removed count, then per removed block uint8 kind, int32 id
+	     trailer		uint64 journal toc offset, uint64 journal toc size, "AVCJNLV2"
+	   A block replaces the one of the same kind and id (it keeps its place), or is added after the others. */
+	enum AvocadoDocBlockKind
+	{
+		AVC_DOC_BLOCK_HEADER = 0,
+		AVC_DOC_BLOCK_VIEW_STATE,
+		AVC_DOC_BLOCK_MATERIAL_STATE,
+		AVC_DOC_BLOCK_ELEMENT
+	};
+
+	struct AvocadoDocTocEntry
+	{
+		AvocadoDocTocEntry () : kind (AVC_DOC_BLOCK_ELEMENT), id (-1), parentID (-1), isVisible (true), isRef (false), offset (0), size (0) {}
+
+		int					kind;
+		int					id;				// the element id, the state index of a state block
+		int					parentID;		// the element an instance refers to, -1 otherwise
+		bool				isVisible;
+		bool				isRef;
+		std::string			name;
+		std::string			ownerModule;
+		unsigned __int64	offset;
+		size_t				size;
+	};
+
+	/* The toc fields of an element, read from its serializeParams list. Knows the import and the annotation names. */
+	void ReadElementTocEntry (ParamList &params, AvocadoDocTocEntry &entry);
+
+	/* What the document file holds, kept by the document between saves so the next one can append only what changed. */
+	class AvocadoDocJournal
+	{
+	public:
+		AvocadoDocJournal () { Reset (); }
+
+		void				Reset ();
+		/* Valid after a binary document was written whole or read. */
+		bool				IsValid () const { return m_valid; }
+		bool				HasElement (int id) const;
+		/* After maxEntries journal entries, or once replaced blocks take half of the file. */
+		bool				NeedsCompaction (int maxEntries) const;
+		unsigned __int64	GetFileSize () const { return m_fileSize; }
+		/* The bytes the file has to end with for an entry to be appended to it. */
+		const std::string	&GetTrailer () const { return m_trailer; }
+		int					GetEntryCount () const { return m_entryCount; }
+	private:
+		friend class AvocadoDocWriter;
+		friend class AvocadoDocReader;
+
+		struct Block
+		{
+			unsigned __int64	hash;		// of the text, only kept for the header and state blocks
+			size_t				size;
+		};
+		typedef std::hash_map<unsigned __int64,Block> BlockHash;
+
+		static unsigned __int64	BlockKey (int kind, int id) { return ((unsigned __int64)(unsigned int)kind << 32) | (unsigned int)id; }
+		void				SetBlock (const AvocadoDocTocEntry &entry, unsigned __int64 hash);
+		void				RemoveBlock (int kind, int id);
+		bool				SameBlock (int kind, int id, unsigned __int64 hash) const;
+
+		BlockHash			m_blocks;
+		bool				m_valid;
+		unsigned __int64	m_fileSize;
+		unsigned __int64	m_staleBytes;
+		int					m_entryCount;
+		std::string			m_trailer;
+	};
+
+	/* The end of a document file the journal describes, opened for appending. Nothing is appended unless the file still ends
+	   the way the journal remembers it, and Close (false) cuts anything written back off. */
+	class AvocadoDocJournalFile : public AvocadoDocSink
+	{
+	public:
+		AvocadoDocJournalFile (const std::string &path, const AvocadoDocJournal &journal);
+		~AvocadoDocJournalFile ();
+		bool			IsOpen () const { return m_file != NULL; }
+		virtual bool	Write (const char *data, size_t size);
+		virtual bool	IsBinarySafe () const { return true; }
+		bool			Close (bool keep);
+	private:
+		FILE				*m_file;
+		unsigned __int64	m_start;
+		bool				m_good;
+	};
+
+	/* Writes a document as it is produced, only one element string is alive at a time and the sink decides where the bytes go.
+	   The text (v1) layout is a header line and one <Element> block per element, the binary one is described above.
+	   A binary writer given a journal brings it up to date with what End wrote. */
+	class AvocadoDocWriter
+	{
+	public:
+		AvocadoDocWriter (AvocadoDocSink &sink, bool binary = false, AvocadoDocJournal *journal = NULL) : m_sink (sink), m_binary (binary),
+			m_good (true), m_bytesWritten (0), m_journal (binary ? journal : NULL), m_appending (false), m_base (0) {}
+
+		bool			Begin (const std::string &docParams);
+		bool			Begin (ParamList &docParams);
+		/* An entry for the end of the file the journal describes, it gets the doc params blocks that changed and the elements given. */
+		bool			BeginJournal (ParamList &docParams);
+		/* entry can be NULL, the binary writer then reads the toc fields from the element text. */
+		bool			WriteElement (const std::string &element, const AvocadoDocTocEntry *entry = NULL);
+		void			RemoveElement (int id);
+		/* A journal entry with nothing in it writes nothing. */
+		bool			End ();
+		bool			IsBinary () const { return m_binary; }
+		bool			HasChanges () const { return !m_toc.empty () || !m_removed.empty (); }
+		/* false once the sink refused a write, nothing is written after that. */
+		bool			IsGood () const { return m_good; }
+		size_t			GetBytesWritten () const { return m_bytesWritten; }
+	private:
+		bool			Write (const char *data, size_t size);
+		bool			Write (const std::string &str) { return Write (str.data (),str.size ()); }
+		bool			WriteBlock (const std::string &block, AvocadoDocTocEntry &entry, unsigned __int64 hash);
+		void			WriteDocParams (ParamList &docParams);
+
+		AvocadoDocSink					&m_sink;
+		bool							m_binary;
+		bool							m_good;
+		size_t							m_bytesWritten;
+		std::vector<AvocadoDocTocEntry>	m_toc;
+		std::vector<unsigned __int64>	m_hashes;
+		AvocadoDocJournal				*m_journal;
+		bool							m_appending;
+		unsigned __int64				m_base;
+		std::vector<std::pair<int,int> >	m_removed;
+	};
+
+	/* Reads the toc of a binary document, blocks are cut out of its bytes when asked for. */
+	class AvocadoDocReader
+	{
+	public:
+		AvocadoDocReader () : m_staleBytes (0), m_entryCount (0) {}
+
+		static bool					IsBinary (const char *data, size_t size);
+
+		/* Keeps a copy of the bytes, false when the file header, a trailer or a toc do not add up.
+		   Journal entries are applied, the toc is the one of the last save. */
+		bool						Open (const std::string &bytes);
+		void						Close ();
+		void						Swap (AvocadoDocReader &other) { m_bytes.swap (other.m_bytes); m_toc.swap (other.m_toc); std::swap (m_staleBytes,other.m_staleBytes); std::swap (m_entryCount,other.m_entryCount); }
+		bool						IsOpen () const { return !m_bytes.empty (); }
+		size_t						GetEntryCount () const { return m_toc.size (); }
+		const AvocadoDocTocEntry	&GetEntry (size_t i) const { return m_toc[i]; }
+		std::string					GetBlock (size_t i) const;
+		/* The header and state blocks joined, the same list a v1 document has on its first line. */
+		std::string					GetDocParams () const;
+		/* Journal entries on top of the last whole save. */
+		int							GetJournalEntryCount () const { return m_entryCount; }
+		void						FillJournal (AvocadoDocJournal &journal) const;
+	private:
+		static bool					ReadToc (const unsigned char *data, size_t tocOffset, size_t tocEnd, bool journal,
+										std::vector<AvocadoDocTocEntry> &toc, std::vector<std::pair<int,int> > &removed, size_t &previousEnd);
+
+		std::string						m_bytes;
+		std::vector<AvocadoDocTocEntry>	m_toc;
+		unsigned __int64				m_staleBytes;
+		int								m_entryCount;
+	};
+
+	/* Conversion between the two layouts without an engine, element text is carried over as it is. */
+	bool ConvertTextDocumentToBinary (const std::string &text, AvocadoDocSink &sink);
+	bool ConvertBinaryDocumentToText (const std::string &bytes, AvocadoDocSink &sink);
+}
@@ -383,6 +383,12 @@ namespace avocado
 			m_currentPrePicked = -1;
 			m_y = 0;
 	//	optimizeUnifyVertices ((ViewStateReadLock (viewState)->getScene()));
+		// only these messages are dispatched to this module, keep the list in sync with the handlers below.
+		static const char *s_messages[] = { "HightlightElement", "UnHightlightElement", "CameraChanged", "NotifyDocElementMove", "UnPreHightlightElement", "PreHightlightElement", "OnViewPick", "SetViewParam" };
+		for (size_t i=0;i<sizeof (s_messages) / sizeof (s_messages[0]);i++)
+			SubscribeMessage (s_messages[i]);
+		SubscribeMouseMessage (AVC_MOUSE_MOVE);
+		SubscribeMouseMessage (AVC_MOUSE_LUP);
 		return true;
 	}
 	void AvocadoDragger::AddAxisElement (Quatf ori, Vec3f color)
@@ -0,0 +1,94 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoElementSceneIndex.h"
+#include "AvocadoSceneQuery.h"
+#include <algorithm>
+
+using namespace nvsg;
+
+namespace avocado
+{
+	void AvocadoElementSceneIndex::Build (NodeSharedPtr root)
+	{
+		Clear ();
+		const std::vector<GeoNodeSharedPtr> geoNodes = AvocadoSceneQuery ().Find<GeoNode> (root);
+		for (size_t i=0;i<geoNodes.size ();i++)
+		{
+			const GeoNodeSharedPtr &geoNode = geoNodes[i];
+			m_geoNodes.push_back (geoNode);
+			GeoNodeReadLock geo (geoNode);
+			m_byName[geo->getName ()].push_back (geoNode);
+			// the same order prepareElementRoot names the drawables in.
+			int stateSetIdx = 0;
+			int refDrawableIdx = 0;
+			for (GeoNode::StateSetConstIterator ss = geo->beginStateSets ();ss != geo->endStateSets ();++ss,stateSetIdx++)
+			{
+				for (GeoNode::DrawableConstIterator dr = geo->beginDrawables (ss);dr != geo->endDrawables (ss);++dr)
+				{
+					AvocadoElementDrawable entry;
+					entry.drawable = *dr;
+					entry.geoNode = geoNode;
+					entry.stateSetIdx = stateSetIdx;
+					entry.refDrawableIdx = refDrawableIdx++;
+					m_drawables.push_back (entry);
+				}
+			}
+		}
+	}
+
+	void AvocadoElementSceneIndex::Clear ()
+	{
+		m_geoNodes.clear ();
+		m_drawables.clear ();
+		m_byName.clear ();
+	}
+
+	const std::vector<GeoNodeSharedPtr>* AvocadoElementSceneIndex::FindGeoNodes (const std::string &name) const
+	{
+		GeoNodeNameHash::const_iterator it = m_byName.find (name);
+		return it != m_byName.end () ? &it->second : NULL;
+	}
+
+	void AvocadoElementSceneIndex::RemoveGeoNode (const GeoNodeSharedPtr &geoNode)
+	{
+		m_geoNodes.erase (std::remove (m_geoNodes.begin (),m_geoNodes.end (),geoNode),m_geoNodes.end ());
+		size_t kept = 0;
+		for (size_t i=0;i<m_drawables.size ();i++)
+			if (m_drawables[i].geoNode != geoNode)
+				m_drawables[kept++] = m_drawables[i];
+		m_drawables.resize (kept);
+		for (GeoNodeNameHash::iterator it = m_byName.begin ();it != m_byName.end ();++it)
+		{
+			std::vector<GeoNodeSharedPtr>::iterator found = std::find (it->second.begin (),it->second.end (),geoNode);
+			if (found == it->second.end ())
+				continue;
+			it->second.erase (found);
+			if (it->second.empty ())
+				m_byName.erase (it);
+			break;
+		}
+	}
+
+	void AvocadoElementSceneIndex::RemoveDrawable (const DrawableSharedPtr &drawable)
+	{
+		GeoNodeSharedPtr geoNode;
+		bool geoNodeUsed = false;
+		for (size_t i=0;i<m_drawables.size ();)
+		{
+			if (m_drawables[i].drawable == drawable)
+			{
+				geoNode = m_drawables[i].geoNode;
+				m_drawables.erase (m_drawables.begin () + i);
+			}
+			else
+				i++;
+		}
+		if (!geoNode)
+			return;
+		for (size_t i=0;i<m_drawables.size () && !geoNodeUsed;i++)
+			geoNodeUsed = (m_drawables[i].geoNode == geoNode);
+		if (!geoNodeUsed)
+			RemoveGeoNode (geoNode);
+	}
+}
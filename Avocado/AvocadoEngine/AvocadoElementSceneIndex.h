@@ -0,0 +1,45 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include <nvsg/GeoNode.h>
+#include <hash_map>
+#include <vector>
+#include <string>
+
+namespace avocado
+{
+	/* A drawable of an element as it was loaded. */
+	struct AvocadoElementDrawable
+	{
+		nvsg::DrawableSharedPtr			drawable;
+		nvsg::GeoNodeSharedPtr			geoNode;
+		int								stateSetIdx;		// the state set of geoNode it was under
+		int								refDrawableIdx;		// over all the state sets of geoNode, the "DrawableN" name
+	};
+
+	/* The GeoNodes and drawables under an element root, built once when the element gets its scene. Material
+	   changes, sub elements and removed GeoNodes look them up here instead of searching the subgraph by class
+	   name, whatever takes a GeoNode or a drawable out from under the root takes it out of here too. */
+	class AvocadoElementSceneIndex
+	{
+	public:
+		void							Build (nvsg::NodeSharedPtr root);
+		void							Clear ();
+
+		const std::vector<nvsg::GeoNodeSharedPtr>&		GetGeoNodes () const { return m_geoNodes; }
+		const std::vector<AvocadoElementDrawable>&		GetDrawables () const { return m_drawables; }
+		/* Every GeoNode of that name, in load order. NULL when there is none. */
+		const std::vector<nvsg::GeoNodeSharedPtr>*		FindGeoNodes (const std::string &name) const;
+
+		void							RemoveGeoNode (const nvsg::GeoNodeSharedPtr &geoNode);
+		/* The GeoNode goes too when it was its last drawable. */
+		void							RemoveDrawable (const nvsg::DrawableSharedPtr &drawable);
+	private:
+		typedef std::hash_map<std::string,std::vector<nvsg::GeoNodeSharedPtr> > GeoNodeNameHash;
+
+		std::vector<nvsg::GeoNodeSharedPtr>	m_geoNodes;
+		std::vector<AvocadoElementDrawable>	m_drawables;
+		GeoNodeNameHash					m_byName;
+	};
+}
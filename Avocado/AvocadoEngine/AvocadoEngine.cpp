@@ -4,12 +4,18 @@
 #include "AvocadoEngine.h"
 #include "AvocadoScenixAdapter.h"
 #include "AvocadoInternalModules.h"
+#include "AvocadoMessageStats.h"
+#include "AvocadoWorkerPool.h"
+#include "AvocadoImportJob.h"
+#include "AvocadoSceneCache.h"
+#include "AvocadoGeometryPool.h"
 
 #include <nvui/SceneRenderer.h>
 #include <nvgl/SceneRendererGL2.h>
 #include <nvgl/RenderTargetGLFBO.h>
 #include <nvgl/RendererGLFSQ.h>
 #include <nvutil\Trace.h>
+#include <algorithm>
 
 
 static std::string globalTracePath;
@@ -107,9 +113,17 @@ namespace avocado
 
 		bool ret = false;
 
-		// First send the message to engine modules.
-		for (size_t i=0;i<m_modules.size ();i++)
-			m_modules[i]->HandleAvocadoDocGeneralStringMessage (msg,docId,paramStr,needRepaint);
+		if (HandleStatsMessage (msg,docId,paramStr))
+			return true;
+
+		// First send the message to the engine modules that subscribed to it.
+		const AvocadoMessageId msgId = AvocadoMessageRegistry::FindMessage (msg);
+		for (size_t i=0;i<m_dispatch.GetHandlerCount (msgId);i++)
+		{
+			AvocadoMessageHandler *handler = m_dispatch.GetHandler (msgId,i);
+			AvocadoStatsScope stats (msg,msgId,handler);
+			handler->HandleAvocadoDocGeneralStringMessage (msg,docId,paramStr,needRepaint);
+		}
 
 	    // Now send to a specific document.
 		std::vector<AvocadoEngineDoc *>::iterator iter = GetDocById (docId);
@@ -132,15 +146,13 @@ namespace avocado
 	void AvocadoEngine::InvokePaintView(int viewId)
 	{
 		NVSG_TRACE();
-		//if (m_nestedMessagePaintCount == 0)
+		if (m_queuedMessages)
 		{
-			GetActiveDoc()->InvokePaintView (viewId);
+			// painted once when the view frame ends.
+			m_viewQueues[viewId].needRepaint = true;
+			return;
 		}
-		// else
-	//	{
-		//	NVSG_TRACE_OUT("NESTED REPAINT INTERSECEPTED");
-	//	}
-//		m_nestedMessagePaintCount ++;
+		GetActiveDoc()->InvokePaintView (viewId);
 	}
 	void AvocadoEngine::NotifyElementsChanged()
 	{
@@ -157,28 +169,42 @@ namespace avocado
 	void AvocadoEngine::InvokePaintAll ()
 	{
 		NVSG_TRACE();
+		if (m_queuedMessages)
+		{
+			m_needRepaintAll = true;
+			return;
+		}
 		GetActiveDoc()->InvokePaintAll ();
 	}
 
 	int AvocadoEngine::OnCreateView (void *phWnd, AvocadoViewInterface *viewInterface)
 	{
 		NVSG_TRACE();
+		AvocadoRecordGuard recordGuard;
 		int viewId = GetActiveDoc()->OnCreateView(phWnd,viewInterface);
 		AddModulesToView(viewId);
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordCall (AvocadoRecordedCall::CREATE_VIEW,viewId);
 		return viewId;
 	}
 
 	int AvocadoEngine::OnCreateDCView (void *phWnd, AvocadoViewInterface *viewInterface)
 	{
 		NVSG_TRACE();
+		AvocadoRecordGuard recordGuard;
 		int viewId = GetActiveDoc()->OnCreateView(phWnd,viewInterface,false);
 		AddModulesToView(viewId);
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordCall (AvocadoRecordedCall::CREATE_VIEW,viewId);
 		return viewId;
 	}
 
 	void AvocadoEngine::OnSizeView (int viewId, int px, int py)
 	{
 		NVSG_TRACE();
+		AvocadoRecordGuard recordGuard;
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordCall (AvocadoRecordedCall::SIZE_VIEW,viewId,px,py);
 		GetActiveDoc()->OnSizeView (viewId,px,py);
 	}
 
@@ -216,6 +242,7 @@ namespace avocado
 	{
 		NVSG_TRACE();
 		m_modules.push_back (module);
+		m_dispatch.AddHandler (module);
 		module->registerModule (GetID());
 	}
 
@@ -229,6 +256,7 @@ namespace avocado
 			m_modules[i] = NULL;
 		}
 		m_modules.clear ();
+		m_dispatch.Clear ();
 	}
 	void AvocadoEngine::AvocadoReadOverideOptions (std::string filename)
 	{
@@ -290,6 +318,35 @@ namespace avocado
 
 		m_nestedMessageCount = 0;
 		m_nestedMessagePaintCount =0 ;
+		m_queuedMessages = false;
+		m_needRepaintAll = false;
+		AddCoalescedMessage ("CameraChanged");
+		AddCoalescedMessage ("NotifyDocElementMove");
+		bool queued = false;
+		if (GetAvocadoOption ("queued_messages",(void*)(&queued),AvocadoOption::BOOL))
+			SetQueuedMessages (queued);
+		bool stats = false;
+		if (GetAvocadoOption ("engine_stats",(void*)(&stats),AvocadoOption::BOOL))
+			AvocadoMessageStats::SetEnabled (stats);
+		std::string recordFile;
+		if (GetAvocadoOption ("record_messages_file",(void*)(&recordFile),AvocadoOption::STRING) && recordFile != "")
+			StartMessageRecording (recordFile);
+		int workerThreads = 0;
+		if (GetAvocadoOption ("worker_threads",(void*)(&workerThreads),AvocadoOption::INT))
+			AvocadoWorkerPool::Get ().SetThreadCount (workerThreads);
+		int importThreads = 0;
+		if (GetAvocadoOption ("import_threads",(void*)(&importThreads),AvocadoOption::INT))
+			AvocadoImportScheduler::Get ().SetThreadCount (importThreads);
+		bool sceneCache = true;
+		if (GetAvocadoOption ("scene_cache",(void*)(&sceneCache),AvocadoOption::BOOL))
+			AvocadoSceneCache::Get ().SetEnabled (sceneCache);
+		int sceneCacheMB = 0;
+		if (GetAvocadoOption ("scene_cache_size_mb",(void*)(&sceneCacheMB),AvocadoOption::INT))
+			AvocadoSceneCache::Get ().SetMaxBytes ((unsigned __int64)sceneCacheMB * 1024 * 1024);
+		AvocadoSceneCache::Get ().SetFolder (sessionFolder + "\\scenecache");
+		bool shareGeometry = true;
+		if (GetAvocadoOption ("share_geometry",(void*)(&shareGeometry),AvocadoOption::BOOL))
+			AvocadoGeometryPool::Get ().SetEnabled (shareGeometry);
 
 		// Start engine timer.
 		m_todTimer.start ();
@@ -312,6 +369,8 @@ namespace avocado
 	bool AvocadoEngine::AvocadoTerminate ()
 	{
 		//NVSG_TRACE();
+		StopMessageRecording ();
+		AvocadoWorkerPool::Get ().Shutdown ();
 		m_defaultOptions = 0;
 		m_overideOptions = 0;
 
@@ -322,6 +381,9 @@ namespace avocado
 			m_docList[i] = NULL;
 		}
 		m_docList.clear();
+		// the documents cancelled their imports, what the threads still run stops at its next stage.
+		AvocadoImportScheduler::Get ().Shutdown ();
+		AvocadoGeometryPool::Get ().Clear ();
 
 		//for (size_t i=0;i<m_viewModules.size ();i++)
 		{
@@ -368,7 +430,16 @@ namespace avocado
 	void AvocadoEngine::SetActiveDoc (int docId)
 	{
 		NVSG_TRACE();
+		AvocadoRecordGuard recordGuard;
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordCall (AvocadoRecordedCall::SET_ACTIVE_DOC,docId);
 		std::vector<AvocadoEngineDoc *>::iterator it = GetDocById (docId);
+		if (m_queuedMessages && *it != m_activeDoc)
+		{
+			// the queues belong to the views of the document we leave.
+			DeliverAllViewQueues ();
+			m_viewQueues.clear ();
+		}
 		m_activeDoc = *it;
 	}
 
@@ -390,6 +461,8 @@ namespace avocado
 	{
 		NVSG_TRACE();
 		std::vector<AvocadoEngineDoc *>::iterator it = GetDocById (docId);
+		if (*it == m_activeDoc)
+			m_viewQueues.clear ();
 		delete *it;
 		m_docList.erase (it);
 		return true;
@@ -426,7 +499,10 @@ namespace avocado
 	int AvocadoEngine::OnCreateDoc(AvocadoDocInterface *docInterface)
 	{
 		NVSG_TRACE();
+		AvocadoRecordGuard recordGuard;
 		int docId = AddDoc ();
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordCall (AvocadoRecordedCall::CREATE_DOC,docId);
 		std::vector<AvocadoEngineDoc *>::iterator it = GetDocById(docId);
 		AvocadoEngineDoc *doc = *it;
 		doc->GetCNVSGDocData()->SetDefScene();
@@ -450,20 +526,28 @@ namespace avocado
 	void AvocadoEngine::OnSerializeDoc (int docId, std::string &path,bool isImport, bool isStoring)
 	{
 		NVSG_TRACE();
+			AvocadoRecordGuard recordGuard;
+			if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+				m_recorder.RecordSerializeDoc (docId,path,isImport,isStoring);
 			std::vector<AvocadoEngineDoc *>::iterator it = GetDocById(docId);
 			AvocadoEngineDoc *doc = *it;
 			bool needRepaint = false;
 			if (isImport)
 			{
 				bool firstImport = GetActiveDoc()->isEmpty();
+				bool background = false;
+				avocado::GetEngineOptionBool ("import_in_background",&background);
 				ParamListSharedPtr pl = ParamList::createNew ();
 				pl->PushBool ("isRef",false);
 				pl->PushBool ("isGroup",false);
 				pl->PushString ("fileName",path);
 				pl->PushInt ("MetaCount",0);
+				// the import module fits the page itself once a background import is in.
+				pl->PushBool ("background",background);
+				pl->PushBool ("fitToPage",firstImport);
 
-				HandleAvocadoDocGeneralStringMessage("AddDocFileElement",docId,pl->SerializeList (),needRepaint);
-				if (firstImport)
+				HandleAvocadoDocGeneralStringMessage("AddDocFileElement",docId,pl->SerializeBinary (),needRepaint);
+				if (firstImport && !background)
 						HandleAvocadoDocGeneralStringMessage("FitToPage",docId,path,needRepaint);
 						
 			}
@@ -490,38 +574,127 @@ namespace avocado
 	}
 	
 
+	bool AvocadoEngine::OnStoreDoc (int docId, AvocadoDocSink *sink)
+	{
+		NVSG_TRACE();
+		AvocadoRecordGuard recordGuard;
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordSerializeDoc (docId,"",false,true);
+		std::vector<AvocadoEngineDoc *>::iterator it = GetDocById(docId);
+		if (!sink || it == m_docList.end ())
+			return false;
+		if (!(*it)->StoreDocument (*sink,true))
+		{
+			RaiseAvocadoDocErrorMessage (docId,"Could not store the document");
+			return false;
+		}
+		return true;
+	}
+
 	bool AvocadoEngine::OnSendAvocadoMouseStringMessage (AvcMouseActType msg, int viewId, int x, int y, int zDelta)
 	{
+		AvocadoRecordGuard recordGuard;
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordMouseMessage (msg,viewId,x,y,zDelta);
+		if (m_queuedMessages && m_nestedMessageCount == 0)
+		{
+			if (msg == AVC_MOUSE_MOVE)
+			{
+				AvocadoQueuedMessage qm;
+				qm.isMouse = true;
+				qm.mouseMsg = msg;
+				qm.x = x;
+				qm.y = y;
+				qm.zDelta = zDelta;
+				qm.msgId = AVC_INVALID_MESSAGE_ID;
+				QueueViewMessage (viewId,qm);
+				return true;
+			}
+			DeliverViewQueue (viewId);
+		}
 		bool ret = false;
 		bool needRepaint = false;
-	//	m_nestedMessageCount++;
-		ret = HandleAvocadoMouseStringMessage(msg,viewId,x,y,zDelta,needRepaint);
-	//	m_nestedMessageCount--;
-	//	if (m_nestedMessageCount == 0 && m_nestedMessagePaintCount >0)
-	//	{
-	//		needRepaint = true;
-	//	}
+		m_nestedMessageCount++;
+		{
+			AvocadoStatsScope stats (msg);
+			ret = HandleAvocadoMouseStringMessage(msg,viewId,x,y,zDelta,needRepaint);
+		}
+		m_nestedMessageCount--;
 		if (needRepaint)
 			InvokePaintView(viewId);
+		if (msg == AVC_TIMER_TICK && m_nestedMessageCount == 0 && AvocadoImportJob::GetPendingCount () > 0)
+			PollImportJobs ();
+		if (m_queuedMessages && m_nestedMessageCount == 0 && msg == AVC_TIMER_TICK)
+		{
+			// end of the view frame, the notifications the tick raised still make it into this frame.
+			DeliverViewQueue (viewId);
+			PaintPendingViews (viewId);
+		}
 		return ret;
 	}
 
+	/* Background imports are attached between frames. Not recorded : the import itself is, with its file. */
+	void AvocadoEngine::PollImportJobs ()
+	{
+		AvocadoRecordGuard recordGuard;
+		for (size_t i=0;i<m_docList.size ();i++)
+		{
+			bool needRepaint = false;
+			m_nestedMessageCount++;
+			HandleAvocadoDocGeneralStringMessage ("PollImportJobs",m_docList[i]->GetID (),"",needRepaint);
+			m_nestedMessageCount--;
+			if (needRepaint)
+				InvokePaintAll ();
+		}
+	}
+
 	bool AvocadoEngine::OnSendAvocadoGeneralStringMessage (const std::string &msg, int viewId, const std::string &paramStr, bool toAllModules)
 	{
 		NVSG_TRACE();
 		NVSG_TRACE_OUT(string (msg + string("( ") +paramStr+ string(")\n")).c_str());
+		AvocadoRecordGuard recordGuard;
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordViewMessage (msg,viewId,paramStr,toAllModules);
+		if (m_queuedMessages)
+		{
+			const AvocadoMessageId msgId = AvocadoMessageRegistry::FindMessage (msg);
+			if (IsCoalescedMessage (msgId))
+			{
+				AvocadoQueuedMessage qm;
+				qm.isMouse = false;
+				qm.mouseMsg = AVC_MOUSE_MOVE;
+				qm.x = qm.y = qm.zDelta = 0;
+				qm.msgId = msgId;
+				qm.msg = msg;
+				qm.paramStr = paramStr;
+				QueueViewMessage (viewId,qm);
+				return true;
+			}
+			if (m_nestedMessageCount == 0)
+			{
+				if (msg == "OnDestroy")
+					m_viewQueues.erase (viewId);
+				else
+					DeliverViewQueue (viewId);
+			}
+		}
 		bool ret = false;
 		bool needRepaint = false;
-		//m_nestedMessageCount++;
-		ret = HandleAvocadoViewGeneralStringMessage(msg,viewId,paramStr,needRepaint);
-		// trying to be smart and catch extra repaints..
-		//m_nestedMessageCount--;
-		//if (m_nestedMessageCount == 0 && m_nestedMessagePaintCount >0)
-		//{
-		//	needRepaint = true;
-		//}
+		m_nestedMessageCount++;
+		{
+			AvocadoStatsScope stats (msg);
+			ret = HandleAvocadoViewGeneralStringMessage(msg,viewId,paramStr,needRepaint);
+		}
+		m_nestedMessageCount--;
 		if (needRepaint && msg!= std::string("OnPaint"))
 			InvokePaintView(viewId);
+		if (m_queuedMessages && msg == std::string("OnPaint"))
+		{
+			// the view just painted, its pending repaint is done.
+			std::map<int,AvocadoViewQueue>::iterator it = m_viewQueues.find (viewId);
+			if (it != m_viewQueues.end ())
+				it->second.needRepaint = false;
+		}
 		return ret;
 	}
 	
@@ -529,15 +702,210 @@ namespace avocado
 	{
 		NVSG_TRACE();
 		NVSG_TRACE_OUT(string (msg + string("( ") +paramStr+ string(")\n")).c_str());
+		AvocadoRecordGuard recordGuard;
+		if (m_recorder.IsRecording () && recordGuard.IsOutermost ())
+			m_recorder.RecordDocMessage (msg,docId,paramStr,targetModule);
+		if (m_queuedMessages && m_nestedMessageCount == 0)
+			DeliverAllViewQueues ();
 		bool ret = false;
 		bool needRepaint = false;
-		if (targetModule == "")
-			ret = HandleAvocadoDocGeneralStringMessage(msg,docId,paramStr,needRepaint);
-		else
-			ret = HandleSpecificModuleMessage(msg,docId,paramStr,needRepaint,targetModule);
+		m_nestedMessageCount++;
+		{
+			AvocadoStatsScope stats (msg);
+			if (targetModule == "")
+				ret = HandleAvocadoDocGeneralStringMessage(msg,docId,paramStr,needRepaint);
+			else
+				ret = HandleSpecificModuleMessage(msg,docId,paramStr,needRepaint,targetModule);
+		}
+		m_nestedMessageCount--;
 
 		if (needRepaint && msg!= std::string("OnPaint"))
 			InvokePaintAll();
 		return ret;
 	}
+
+	void AvocadoEngine::SetQueuedMessages (bool queued)
+	{
+		if (queued == m_queuedMessages)
+			return;
+		if (queued)
+		{
+			m_queuedMessages = true;
+			return;
+		}
+		// deliver what is still waiting, then run everything synchronously again.
+		std::vector<int> viewIds;
+		for (std::map<int,AvocadoViewQueue>::iterator it = m_viewQueues.begin ();it != m_viewQueues.end ();it++)
+			viewIds.push_back (it->first);
+		for (size_t i=0;i<viewIds.size ();i++)
+		{
+			DeliverViewQueue (viewIds[i]);
+			PaintPendingViews (viewIds[i]);
+		}
+		m_queuedMessages = false;
+		m_viewQueues.clear ();
+		if (m_needRepaintAll && GetActiveDoc ())
+			GetActiveDoc ()->InvokePaintAll ();
+		m_needRepaintAll = false;
+	}
+
+	void AvocadoEngine::AddCoalescedMessage (const std::string &msg)
+	{
+		AvocadoMessageId msgId = AvocadoMessageRegistry::RegisterMessage (msg);
+		if (!IsCoalescedMessage (msgId))
+			m_coalescedMessages.push_back (msgId);
+	}
+
+	bool AvocadoEngine::IsCoalescedMessage (AvocadoMessageId msgId) const
+	{
+		if (msgId == AVC_INVALID_MESSAGE_ID)
+			return false;
+		return std::find (m_coalescedMessages.begin (), m_coalescedMessages.end (), msgId) != m_coalescedMessages.end ();
+	}
+
+	void AvocadoEngine::QueueViewMessage (int viewId, const AvocadoQueuedMessage &qm)
+	{
+		std::deque<AvocadoQueuedMessage> &messages = m_viewQueues[viewId].messages;
+		if (!messages.empty ())
+		{
+			AvocadoQueuedMessage &last = messages.back ();
+			if (qm.isMouse && last.isMouse && last.mouseMsg == qm.mouseMsg && last.zDelta == qm.zDelta)
+			{
+				last.x = qm.x;
+				last.y = qm.y;
+				return;
+			}
+			if (!qm.isMouse && !last.isMouse && last.msgId == qm.msgId)
+			{
+				last.paramStr = qm.paramStr;
+				return;
+			}
+		}
+		messages.push_back (qm);
+	}
+
+	void AvocadoEngine::DispatchQueuedMessage (int viewId, const AvocadoQueuedMessage &qm)
+	{
+		bool needRepaint = false;
+		m_nestedMessageCount++;
+		if (qm.isMouse)
+		{
+			AvocadoStatsScope stats (qm.mouseMsg);
+			HandleAvocadoMouseStringMessage (qm.mouseMsg,viewId,qm.x,qm.y,qm.zDelta,needRepaint);
+		}
+		else
+		{
+			AvocadoStatsScope stats (qm.msg,qm.msgId);
+			HandleAvocadoViewGeneralStringMessage (qm.msg,viewId,qm.paramStr,needRepaint);
+		}
+		m_nestedMessageCount--;
+		if (needRepaint)
+			InvokePaintView (viewId);
+	}
+
+	void AvocadoEngine::DeliverViewQueue (int viewId)
+	{
+		// the queued messages first, then the notifications they raised. Anything raised by those waits for the next frame,
+		// so a notification handler that raises itself again can not keep us here.
+		for (int pass=0;pass<2;pass++)
+		{
+			std::map<int,AvocadoViewQueue>::iterator it = m_viewQueues.find (viewId);
+			if (it == m_viewQueues.end () || it->second.messages.empty ())
+				return;
+			std::deque<AvocadoQueuedMessage> messages;
+			messages.swap (it->second.messages);
+			if (!GetActiveDoc () || !GetActiveDoc ()->HasView (viewId))
+				return;
+			for (size_t i=0;i<messages.size ();i++)
+			{
+				// a handler may close the view.
+				if (!GetActiveDoc ()->HasView (viewId))
+					return;
+				DispatchQueuedMessage (viewId,messages[i]);
+			}
+		}
+	}
+
+	void AvocadoEngine::DeliverAllViewQueues ()
+	{
+		std::vector<int> viewIds;
+		for (std::map<int,AvocadoViewQueue>::iterator it = m_viewQueues.begin ();it != m_viewQueues.end ();it++)
+		{
+			if (!it->second.messages.empty ())
+				viewIds.push_back (it->first);
+		}
+		for (size_t i=0;i<viewIds.size ();i++)
+			DeliverViewQueue (viewIds[i]);
+	}
+
+	void AvocadoEngine::PaintPendingViews (int viewId)
+	{
+		if (!GetActiveDoc ())
+			return;
+		if (m_needRepaintAll)
+		{
+			m_needRepaintAll = false;
+			for (std::map<int,AvocadoViewQueue>::iterator it = m_viewQueues.begin ();it != m_viewQueues.end ();it++)
+				it->second.needRepaint = false;
+			GetActiveDoc ()->InvokePaintAll ();
+			return;
+		}
+		std::map<int,AvocadoViewQueue>::iterator it = m_viewQueues.find (viewId);
+		if (it == m_viewQueues.end () || !it->second.needRepaint)
+			return;
+		it->second.needRepaint = false;
+		if (GetActiveDoc ()->HasView (viewId))
+			GetActiveDoc ()->InvokePaintView (viewId);
+	}
+
+	void AvocadoEngine::FlushViewMessages (int viewId)
+	{
+		if (!m_queuedMessages || m_nestedMessageCount > 0)
+			return;
+		DeliverViewQueue (viewId);
+		PaintPendingViews (viewId);
+	}
+
+	bool AvocadoEngine::HandleStatsMessage (const std::string &msg, int docId, const std::string &paramStr)
+	{
+		if (msg == "EnableEngineStats")
+		{
+			ParamListSharedPtr pl = ParamList::createFromString (paramStr);
+			bool enabled = true;
+			pl->GetBoolValueByName ("Enabled",enabled);
+			AvocadoMessageStats::SetEnabled (enabled);
+		}
+		else if (msg == "GetEngineStats")
+		{
+			std::vector<AvocadoEngineDoc *>::iterator iter = GetDocById (docId);
+			if (iter == m_docList.end () || (*iter)->GetDocInterface () == NULL)
+				return true;
+			(*iter)->GetDocInterface ()->DocParamChanged ("EngineStats",AvocadoMessageStats::GetStats ()->SerializeList ().c_str ());
+		}
+		else if (msg == "ResetEngineStats")
+		{
+			AvocadoMessageStats::Reset ();
+		}
+		else if (msg == "DumpEngineStats")
+		{
+			std::string path = paramStr.empty () ? m_sessionFolder + "\\AvocadoEngineStats.txt" : paramStr;
+			if (!AvocadoMessageStats::Dump (path))
+				RaiseAvocadoDocErrorMessage (docId,"Could not write engine statistics to " + path);
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	bool AvocadoEngine::StartMessageRecording (const std::string &path)
+	{
+		return m_recorder.Start (path);
+	}
+
+	void AvocadoEngine::StopMessageRecording ()
+	{
+		m_recorder.Stop ();
+	}
 }
\ No newline at end of file
@@ -4,11 +4,34 @@
 #pragma once
 #include "AvocadoEngineDoc.h"
 #include "AvocadoAppOptionsInterface.h"
+#include "AvocadoMessageRecorder.h"
 #include <nvutil/Timer.h>
 #include <vector>
+#include <deque>
+#include <map>
 
 namespace avocado
 {
+	/* A view message waiting in a view queue, see the queued mode below. */
+	struct AvocadoQueuedMessage
+	{
+		bool					isMouse;
+		AvcMouseActType			mouseMsg;
+		int						x;
+		int						y;
+		int						zDelta;
+		AvocadoMessageId		msgId;
+		std::string				msg;
+		std::string				paramStr;
+	};
+
+	struct AvocadoViewQueue
+	{
+		AvocadoViewQueue () : needRepaint (false) {}
+		std::deque<AvocadoQueuedMessage>	messages;
+		bool								needRepaint;
+	};
+
 	class AvocadoEngine : public AvocadoMessageHandler
 	{
 	public:
@@ -38,6 +61,7 @@ namespace avocado
 														std::vector<std::string> embeddedTextures, 
 														bool unzip);
 		void										OnSerializeDoc(int docId, std::string &path,bool isImport = false, bool isStoring = false);
+		bool										OnStoreDoc (int docId, AvocadoDocSink *sink);
 		
 		void										AddModulesToDoc (int docId);
 		void										AddDocModule (AvocadoDocModule * module);
@@ -65,6 +89,31 @@ namespace avocado
 		void										RaiseAvocadoViewErrorMessage(int viewID,std::string err);
 		void										RaiseAvocadoDocErrorMessage(int docID,std::string err);
 
+		/* Queued mode (engine option "queued_messages", off by default).
+		   Mouse moves and coalesced notifications (CameraChanged, NotifyDocElementMove) sent to a view go into that view's
+		   queue instead of running on the caller's stack, and repaint requests only mark the view.
+		   AVC_TIMER_TICK ends the view's frame : its queue is delivered, the tick is handled and the view repaints at most once.
+		   Ordering :
+		   - per view, messages run in the order they were sent. A message that is not queued first delivers everything queued
+		     before it on its view, so OnPaint, SaveViewToFile and the button messages see all earlier input.
+		   - a queued message merges into the one queued right before it when both are mouse moves with the same button
+		     state or both are the same coalesced notification; the last position / parameters win. Nothing else merges.
+		   - messages sent while another message is handled run right away, as before, except coalesced notifications which
+		     are delivered after the queued messages ahead of them, in the same frame.
+		   - a top level document message first delivers the queues of every view, its repaint request repaints every view once.
+		   - there is no ordering between different views.
+		   - OnDestroy drops whatever is still queued for its view. */
+		void										SetQueuedMessages (bool queued);
+		bool										GetQueuedMessages () const { return m_queuedMessages; }
+		void										AddCoalescedMessage (const std::string &msg);
+		/* Delivers the view queue and does its pending repaint now, for hosts that have no timer. */
+		void										FlushViewMessages (int viewId);
+
+		/* Every call the host makes into the engine from now on goes to the file, see AvocadoMessageRecorder and AvocadoReplay.
+		   The "record_messages_file" option starts a recording in AvocadoInit. */
+		bool										StartMessageRecording (const std::string &path);
+		void										StopMessageRecording ();
+
 		// Options
 		bool									    SetAvocadoOption (std::string optionName,void *value, AvocadoOption::InternalType type);
 		bool									    GetAvocadoOption (std::string optionName,void *value, AvocadoOption::InternalType type);
@@ -75,6 +124,17 @@ namespace avocado
 		void										AvocadoInitDefaultOptions ();
 	//void										AvocadoInitOptionStructure ();
 		void										AvocadoReadOverideOptions (std::string filename);
+		/* EnableEngineStats, GetEngineStats, ResetEngineStats and DumpEngineStats, see AvocadoMessageStats. */
+		bool										HandleStatsMessage (const std::string &msg, int docId, const std::string &paramStr);
+		// Queued mode
+		bool										IsCoalescedMessage (AvocadoMessageId msgId) const;
+		void										QueueViewMessage (int viewId, const AvocadoQueuedMessage &qm);
+		void										DeliverViewQueue (int viewId);
+		void										DeliverAllViewQueues ();
+		void										DispatchQueuedMessage (int viewId, const AvocadoQueuedMessage &qm);
+		void										PaintPendingViews (int viewId);
+		// Background imports
+		void										PollImportJobs ();
 
 		nvutil::Timer						m_todTimer;
 		AvocadoEngineDoc					*m_activeDoc;
@@ -82,9 +142,15 @@ namespace avocado
 		std::vector<AvocadoDocModule *>		m_docModules;
 		std::vector<AvocadoViewModule *>	m_viewModules;
 		std::vector<AvocadoEngineModule *>	m_modules;
+		AvocadoDispatchTable				m_dispatch;
 		std::string							m_sessionFolder;
 		int									m_nestedMessageCount;
 		int									m_nestedMessagePaintCount;
+		bool								m_queuedMessages;
+		bool								m_needRepaintAll;
+		std::map<int,AvocadoViewQueue>		m_viewQueues;
+		std::vector<AvocadoMessageId>		m_coalescedMessages;
+		AvocadoMessageRecorder				m_recorder;
 
 		/* Options handling */
 		ParamListSharedPtr					m_defaultOptions;
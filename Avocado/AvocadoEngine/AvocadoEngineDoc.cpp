@@ -3,6 +3,10 @@
 /* --------------------------------*/
 #include "AvocadoEngineDoc.h"
 #include "AvocadoScenixAdapter.h"
+#include "AvocadoMessageStats.h"
+#include "AvocadoDocStream.h"
+#include "AvocadoWorkerPool.h"
+#include "AvocadoSceneQuery.h"
 #include <nvgl/SceneRendererGL2.h>
 #include <nvgl/RenderTargetGLFBO.h>
 // need to avoid nvsg includes here , move this to paging module
@@ -25,6 +29,8 @@
 #include "zip.h"
 
 #include <fstream>
+#include <algorithm>
+#include <set>
 namespace avocado
 {
 	// AvocadoEngineDoc
@@ -36,6 +42,10 @@ namespace avocado
 	{
 		NVSG_TRACE();
 		m_nvsgDocData = new CNVSGDocData ();
+		m_pendingNext = 0;
+		m_pendingCount = 0;
+		m_pendingTotal = 1;
+		m_publishPackage = false;
 		AvocadoViewStateData defaultVS;
 		defaultVS.viewID = 0;
 		defaultVS.cameraMatrix = nvmath::Mat44f(true);
@@ -56,6 +66,7 @@ namespace avocado
 		ClearDocElements ();
 		ClearDocModules (); 
 		delete m_nvsgDocData; 
+		UnmountPackage ();
 	}
 
 	CNVSGDocData *AvocadoEngineDoc::GetCNVSGDocData ()
@@ -100,6 +111,7 @@ namespace avocado
 			/* later on , set priorites for each module */
 			if (m_modules[i]->m_name == targetModule)
 			{
+				AvocadoStatsScope stats (msg,AVC_INVALID_MESSAGE_ID,m_modules[i]);
 				if (m_modules[i]->HandleAvocadoDocGeneralStringMessage(msg,docId,paramStr,needRepaint))
 					return true; // Message was handled succsusfully 
 			}
@@ -133,6 +145,97 @@ namespace avocado
 		}
 	}
 
+	void AvocadoEngineDoc::UnmountPackage ()
+	{
+		if (!m_package)
+			return;
+		// a loader still reading from it keeps it mapped, the last one lets go of the file.
+		AvocadoVirtualFiles::Get ().Unmount (m_package);
+		m_package = AvocadoArchiveSharedPtr ();
+	}
+
+	/* Adds the file at path as folder + its file name, from the bytes read for its content hash. */
+	static void ZipAddAsset (HZIP hz, AvocadoArchiveBlobs &blobs, const string &folder, const string &path)
+	{
+		string nameStr = folder + path.substr (path.rfind ("\\")+1);
+		string bytes;
+		// what cannot be read is added by name, as it always was, and the zip reports it.
+		const bool read = AvocadoArchiveBlobs::ReadFile (path,bytes);
+		if (read && !blobs.Add (nameStr,path,bytes))
+			return;
+#ifdef UNICODE
+		size_t bc = 0;
+		wchar_t att_path [MAX_PATH];
+		::mbstowcs_s<MAX_PATH> (&bc,att_path,path.c_str (),MAX_PATH);
+		wchar_t att_name [MAX_PATH];
+		::mbstowcs_s<MAX_PATH> (&bc,att_name,nameStr.c_str(),MAX_PATH);
+#else
+		TCHAR att_path [MAX_PATH];
+		::strcpy (att_path,path.c_str ());
+		TCHAR att_name [MAX_PATH];
+		::strcpy (att_name,nameStr.c_str());
+#endif
+		if (read && !bytes.empty ())
+			ZipAdd(hz,att_name,(void*)bytes.data (),(unsigned int)bytes.size ());
+		else
+			ZipAdd(hz,att_name,att_path);
+	}
+
+	/* Attachments with the hash of their bytes, they are written again before every save, models and textures by name. */
+	static void ListPackageItems (const std::vector<std::string> &attachments, const std::vector<std::string> &embeddedModels,
+		const std::vector<std::string> &embeddedTextures, std::vector<std::pair<string,unsigned __int64> > &items)
+	{
+		for (size_t k=0;k<attachments.size ();k++)
+		{
+			string bytes;
+			AvocadoArchiveBlobs::ReadFile (attachments[k],bytes);
+			items.push_back (std::make_pair (attachments[k],AvocadoArchiveBlobs::ContentHash (bytes.data (),bytes.size ())));
+		}
+		for (size_t k=0;k<embeddedModels.size ();k++)
+			items.push_back (std::make_pair ("models\\" + embeddedModels[k],(unsigned __int64)0));
+		for (size_t k=0;k<embeddedTextures.size ();k++)
+			items.push_back (std::make_pair ("textures\\" + embeddedTextures[k],(unsigned __int64)0));
+	}
+
+	static bool GetFileStamp (const string &path, unsigned __int64 &size, unsigned __int64 &time)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExA (path.c_str (),GetFileExInfoStandard,&attributes))
+			return false;
+		size = ((unsigned __int64)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+		time = ((unsigned __int64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+		return true;
+	}
+
+	/* After a save that only appended a journal entry to the document file, the same bytes are appended to the Main.avc
+	   stored at the end of the package, when nothing else that goes into it changed. The package is not zipped again, its
+	   thumbnail stays the one of the last whole package. false when it has to be written whole. */
+	bool AvocadoEngineDoc::AppendToPackage (const std::string &inpath, const std::string &outpath, const PackageItems &items)
+	{
+		PackageState &state = m_packageState;
+		// an opened package is mapped, the first save after opening it writes it whole and lets go of it.
+		if (m_package || state.path.empty () || state.path != outpath || state.docPath != inpath || state.items != items || !m_journal.IsValid ())
+			return false;
+		unsigned __int64 size = 0, time = 0;
+		if (!GetFileStamp (outpath,size,time) || size != state.fileSize || time != state.fileTime)
+			return false;
+		if (!GetFileStamp (inpath,size,time) || size != m_journal.GetFileSize () || size < state.docSize)
+			return false;
+		string appended (size_t (size - state.docSize),'\0');
+		if (!appended.empty ())
+		{
+			FILE *file = fopen (inpath.c_str (),"rb");
+			if (!file)
+				return false;
+			const bool read = _fseeki64 (file,(__int64)state.docSize,SEEK_SET) == 0 && fread (&appended[0],1,appended.size (),file) == appended.size ();
+			fclose (file);
+			if (!read || !AvocadoArchive::AppendToStoredEntry (outpath,"Main.avc",size_t (state.docSize),appended.data (),appended.size ()))
+				return false;
+		}
+		state.docSize = size;
+		return GetFileStamp (outpath,state.fileSize,state.fileTime);
+	}
+
 	bool AvocadoEngineDoc::CompressFile (std::string &inpath,std::string &outpath,
 		std::vector<std::string> attachments,
 		std::vector<std::string> embeddedModels,
@@ -164,12 +267,44 @@ namespace avocado
 		HZIP hz;
 		if (!unzip)
 		{
+			// with journaled saves the document goes in last and stored, the next save appends to it in place.
+			bool journaled = true, binary = false;
+			avocado::GetEngineOptionBool ("journaled_save",&journaled);
+			avocado::GetEngineOptionBool ("binary_documents",&binary);
+			const bool appendable = journaled && binary && !m_publishPackage;
+			PackageItems items;
+			if (appendable)
+			{
+				ListPackageItems (attachments,embeddedModels,embeddedTextures,items);
+				if (AppendToPackage (inpath,outpath,items))
+					return true;
+			}
+			m_packageState = PackageState ();
+			// what was never read from the opened package is written out now, then it lets go of the file, which
+			// may be the one about to be written.
+			for (size_t k=0;k<embeddedModels.size ();k++)
+				AvocadoVirtualFiles::Get ().Materialize (embeddedModels[k]);
+			for (size_t k=0;k<embeddedTextures.size ();k++)
+				AvocadoVirtualFiles::Get ().Materialize (embeddedTextures[k]);
+			UnmountPackage ();
 			hz = CreateZip(woutp,0);
+			// the items are deflated on as many threads as the worker pool has, in blocks, see ZipSetParallel.
+			ZipSetParallel (hz,(unsigned int)AvocadoWorkerPool::Get ().GetThreadCount ());
+			// a fast level for saves, a small package for a publish. the thumbnail, jpegs, hdr maps.. that would not
+			// get smaller are stored.
+			int level = (m_publishPackage ? 9 : 3);
+			bool storeIncompressible = true;
+			avocado::GetEngineOptionInt (m_publishPackage ? "publish_compression_level" : "save_compression_level",&level);
+			avocado::GetEngineOptionBool ("store_incompressible_assets",&storeIncompressible);
+			m_publishPackage = false;
+			ZipSetCompression (hz,level,storeIncompressible);
 #ifdef UNICODE
-			ZipAdd(hz,L"Main.avc", winp);
+			if (!appendable)
+				ZipAdd(hz,L"Main.avc", winp);
 			ZipAdd(hz,L"avothumb.jpg", wtpath);
 #else
-			ZipAdd(hz,"Main.avc", winp);
+			if (!appendable)
+				ZipAdd(hz,"Main.avc", winp);
 			ZipAdd(hz,"avothumb.jpg", wtpath);
 #endif
 			for (size_t ati =  0; ati < attachments.size(); ati++)
@@ -198,72 +333,72 @@ namespace avocado
 #endif
 
 			}
-			// embed models
+			// embed models and textures, a file with the bytes of one already in is only listed in the manifest.
+			AvocadoArchiveBlobs blobs;
 			for (size_t ati =  0; ati < embeddedModels.size(); ati++)
+				ZipAddAsset (hz,blobs,"models\\",embeddedModels[ati]);
+			for (size_t ati =  0; ati < embeddedTextures.size(); ati++)
+				ZipAddAsset (hz,blobs,"textures\\",embeddedTextures[ati]);
+			if (blobs.HasAliases ())
 			{
+				string manifest = blobs.GetManifest ();
 #ifdef UNICODE
-			     bc = 0;
-				wchar_t att_path [MAX_PATH];
-				::mbstowcs_s<MAX_PATH> (&bc,att_path,embeddedModels[ati].c_str (),MAX_PATH);
-
-				string nameStr = embeddedModels[ati].c_str ();
-				nameStr = nameStr.substr (nameStr.rfind ("\\")+1,nameStr.size() - nameStr.rfind ("\\") - 1);
-				nameStr = "models\\" + nameStr;
-				wchar_t att_name [MAX_PATH];
-				::mbstowcs_s<MAX_PATH> (&bc,att_name,nameStr.c_str(),MAX_PATH);
-				ZipAdd(hz,att_name, att_path);
+				wchar_t manifestName [MAX_PATH];
+				bc = 0;
+				::mbstowcs_s<MAX_PATH> (&bc,manifestName,AvocadoArchive::ManifestName (),MAX_PATH);
+				ZipAdd(hz,manifestName,(void*)manifest.data (),(unsigned int)manifest.size ());
 #else
-				TCHAR att_path [MAX_PATH];
-				::strcpy (att_path,embeddedModels[ati].c_str ());
-
-				string nameStr = embeddedModels[ati].c_str ();
-				nameStr = nameStr.substr (nameStr.rfind ("\\")+1,nameStr.size() - nameStr.rfind ("\\") - 1);
-				nameStr = "models\\" + nameStr;
-				TCHAR att_name [MAX_PATH];
-
-				::strcpy (att_name,nameStr.c_str());
-				ZipAdd(hz,att_name, att_path);
+				ZipAdd(hz,AvocadoArchive::ManifestName (),(void*)manifest.data (),(unsigned int)manifest.size ());
 #endif
-
 			}
-			
-			// embed textures
-			for (size_t ati =  0; ati < embeddedTextures.size(); ati++)
+			if (appendable)
 			{
+				ZipSetCompression (hz,0,false);
 #ifdef UNICODE
-				wchar_t att_path [MAX_PATH];
-			     bc = 0;
-				::mbstowcs_s<MAX_PATH> (&bc,att_path,embeddedTextures[ati].c_str (),MAX_PATH);
-
-				string nameStr = embeddedTextures[ati].c_str ();
-				nameStr = nameStr.substr (nameStr.rfind ("\\")+1,nameStr.size() - nameStr.rfind ("\\") - 1);
-				nameStr = "textures\\" + nameStr;
-				wchar_t att_name [MAX_PATH];
-				::mbstowcs_s<MAX_PATH> (&bc,att_name,nameStr.c_str(),MAX_PATH);
-				ZipAdd(hz,att_name, att_path);
+				ZipAdd(hz,L"Main.avc", winp);
 #else
-				TCHAR att_path [MAX_PATH];
-				::strcpy (att_path,embeddedTextures[ati].c_str ());
-
-				string nameStr = embeddedTextures[ati].c_str ();
-				nameStr = nameStr.substr (nameStr.rfind ("\\")+1,nameStr.size() - nameStr.rfind ("\\") - 1);
-				nameStr = "textures\\" + nameStr;
-				TCHAR att_name [MAX_PATH];
-
-				::strcpy (att_name,nameStr.c_str());
-				ZipAdd(hz,att_name, att_path);
+				ZipAdd(hz,"Main.avc", winp);
 #endif
-
 			}
 
-			CloseZip(hz);
+			unsigned __int64 docTime = 0;
+			if (CloseZip(hz) == ZR_OK && appendable && GetFileStamp (inpath,m_packageState.docSize,docTime) &&
+				m_journal.IsValid () && m_journal.GetFileSize () == m_packageState.docSize &&
+				GetFileStamp (outpath,m_packageState.fileSize,m_packageState.fileTime))
+			{
+				m_packageState.path = outpath;
+				m_packageState.docPath = inpath;
+				m_packageState.items.swap (items);
+			}
 		} 
 		else
 		{
+			// only the document and the view state images are extracted, the models and textures are read from the
+			// package when they are used. see AvocadoVirtualFiles.
+			UnmountPackage ();
+			AvocadoArchiveSharedPtr package (new AvocadoArchive);
+			if (package->Open (inpath))
+			{
+				const string folder = outpath.substr (0,outpath.find_last_of ('\\')+1);
+				bool res = true;
+				for (size_t k=0;k<package->GetEntryCount ();k++)
+				{
+					const AvocadoArchiveEntry &entry = package->GetEntry (k);
+					if (entry.name == "Main.avc")
+						res &= package->Extract (entry,outpath);
+					else if (entry.name.find (".bmp") != string::npos && entry.name.find ('/') == string::npos)
+						res &= package->Extract (entry,folder + entry.name);
+				}
+				m_package = package;
+				AvocadoVirtualFiles::Get ().Mount (folder,m_package);
+				return res;
+			}
+			// not a package the archive reads (or too large to map), everything is extracted.
 			hz = OpenZip(winp,0);
 			ZIPENTRY ze; 
 			GetZipItem(hz,-1,&ze); 
 			int numitems=ze.index;
+			std::vector<std::pair<string,string> > aliases;
 			for (int zi=0; zi<numitems; zi++)
 			{ 
 				GetZipItem(hz,zi,&ze);
@@ -328,8 +463,24 @@ namespace avocado
 					UnzipItem(hz,zi,/*ze.name*/ stripPath.c_str ());
 #endif
 				}
+				else if (string(ppbuf) == AvocadoArchive::ManifestName () && ze.unc_size > 0)
+				{
+					std::vector<char> manifest (ze.unc_size);
+					if (UnzipItem(hz,zi,&manifest[0],(unsigned int)manifest.size ()) == ZR_OK)
+						AvocadoArchive::ParseManifest (&manifest[0],manifest.size (),aliases);
+				}
 			}
 			CloseZip(hz);
+			// the items stored once are copied to every name that shares them.
+			const string folder = outpath.substr (0,outpath.find_last_of ('\\')+1);
+			for (size_t k=0;k<aliases.size ();k++)
+			{
+				string alias = aliases[k].first;
+				string blob = aliases[k].second;
+				std::replace (alias.begin (),alias.end (),'/','\\');
+				std::replace (blob.begin (),blob.end (),'/','\\');
+				CopyFileA ((folder + blob).c_str (),(folder + alias).c_str (),FALSE);
+			}
 		}
 		return true;
 	}
@@ -350,183 +501,398 @@ namespace avocado
 		}
         return subj;
     }
-	bool AvocadoEngineDoc::SerializeDocument (std::string &str,bool isStoring)
+	/* names read once per document load, resolved up front */
+	static const ParamAtom s_lastIDCountAtom ("LastIDCount");
+	static const ParamAtom s_docParamsCountAtom ("AvocadoDocParamsCount");
+	static const ParamAtom s_materialStateCountAtom ("MaterialStateCount");
+	static const ParamAtom s_viewStateCountAtom ("ViewStateCount");
+	static const ParamAtom s_currentViewStateAtom ("CurrentViewState");
+	static const ParamAtom s_docParamNamesAtom ("AvocadoDocParamNames");
+	static const ParamAtom s_docParamValuesAtom ("AvocadoDocParamValues");
+	static const ParamAtom s_materialStateNamesAtom ("MaterialStateNames");
+	static const ParamAtom s_viewLocationAtom ("ViewLocation");
+	static const ParamAtom s_viewStateLocationsAtom ("ViewStateLocations");
+	static const ParamAtom s_isRefAtom ("isRef");
+	static const ParamAtom s_ownerModuleAtom ("OwnerModule");
+
+	// elements handed to the worker pool at a time on save and load, also what bounds the memory held for them.
+	static const size_t s_elementBatchSize = 512;
+
+	/* The text of a batch of element lists, and their toc entries when entries is given. */
+	class AvocadoFormatElementsTask : public AvocadoParallelTask
 	{
-		NVSG_TRACE();
-		if (isStoring)
-		{
-			GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_DOCUMENT_STARTED,"",0);
-			NVSG_TRACE_OUT(string ("AvocadoEngine Storing "+ string(" - ") +str+ string("\n")).c_str());
-		}
-		else
+	public:
+		AvocadoFormatElementsTask (std::vector<ParamListSharedPtr> &params, std::vector<string> &texts, std::vector<AvocadoDocTocEntry> *entries) : m_params (params), m_texts (texts), m_entries (entries) {}
+		virtual void Run (size_t index)
 		{
-			
-			GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_DOCUMENT_STARTED,"",0);
-			NVSG_TRACE_OUT(string ("AvocadoEngine Storing "+ string(" - ") +str+ string("\n")).c_str());
+			m_texts[index] = m_params[index]->SerializeList ();
+			if (m_entries)
+				ReadElementTocEntry (*m_params[index],(*m_entries)[index]);
 		}
-		if (isStoring)
-		{
-			string DocString ("<AvocadoDocV1>\n");
-			ParamListSharedPtr dppl = ParamList::createNew ();
+	private:
+		std::vector<ParamListSharedPtr>		&m_params;
+		std::vector<string>					&m_texts;
+		std::vector<AvocadoDocTocEntry>		*m_entries;
+	};
+
+	/* An element block of a loaded document, parsed and ready for its module. */
+	struct AvocadoParsedElement
+	{
+		ParamListSharedPtr	params;
+		bool				isRef;
+		string				ownerModule;
+		string				binary;		// what the import module gets
+	};
 
-			dppl->PushInt ("AvocadoDocParamsCount",int(m_nvsgDocData->m_docParams->GetParamCount()));
-			for (size_t ipara = 0; ipara < m_nvsgDocData->m_docParams->GetParamCount();ipara++)
+	class AvocadoParseElementsTask : public AvocadoParallelTask
+	{
+	public:
+		AvocadoParseElementsTask (const std::vector<string> &blocks, std::vector<AvocadoParsedElement> &parsed) : m_blocks (blocks), m_parsed (parsed) {}
+		virtual void Run (size_t index)
+		{
+			AvocadoParsedElement &pe = m_parsed[index];
+			pe.params = ParamList::createFromString (m_blocks[index]);
+			pe.isRef = false;
+			pe.params->GetBoolValueByName (s_isRefAtom,pe.isRef);
+			pe.params->GetStringValueByName (s_ownerModuleAtom,pe.ownerModule);
+			if (pe.ownerModule == "" || pe.ownerModule == "ImportModule")
 			{
-				StringParam *stparam = (StringParam*)m_nvsgDocData->m_docParams->GetParam(ipara);
-				string parname,parval;
-				stparam->GetName  (parname);
-				stparam->GetValue  (parval);
-				char cc[30];
-				itoa (int (ipara),cc,10);
-				dppl->PushString (string ("AvocadoDocParamName") + string (cc),parname);
-				dppl->PushString (string ("AvocadoDocParamValue") + string (cc),parval);
+				if (pe.isRef)
+					pe.params->PushBool ("UpdateDocUI",false);
+				pe.binary = pe.params->SerializeBinary ();
 			}
-			// write material states
-			if (m_materialStates.size ())
-			{
-				dppl->PushInt (string ("MaterialStateCount"),int(m_materialStates.size ()));
-				for (size_t matStateInd = 0; matStateInd < m_materialStates.size ();matStateInd++)
+		}
+	private:
+		const std::vector<string>			&m_blocks;
+		std::vector<AvocadoParsedElement>	&m_parsed;
+	};
+
+	/* The doc params (doc properties, material and view states), the first block of a stored document. */
+	ParamListSharedPtr AvocadoEngineDoc::BuildDocParams ()
+	{
+		ParamListSharedPtr dppl = ParamList::createNew ();
+
+		/* Lists are written as array params (int[], float16[], string[]), one param per list instead of one per item.
+		   The reader still understands the per item keys of older documents. */
+		vector <string> docParamNames, docParamValues;
+		for (size_t ipara = 0; ipara < m_nvsgDocData->m_docParams->GetParamCount();ipara++)
+		{
+			StringParam *stparam = (StringParam*)m_nvsgDocData->m_docParams->GetParam(ipara);
+			string parname,parval;
+			stparam->GetName  (parname);
+			stparam->GetValue  (parval);
+			docParamNames.push_back (parname);
+			docParamValues.push_back (parval);
+		}
+		dppl->PushStringArray ("AvocadoDocParamNames",docParamNames);
+		dppl->PushStringArray ("AvocadoDocParamValues",docParamValues);
+		// write material states
+		if (m_materialStates.size ())
+		{
+			vector <string> materialStateNames;
+			for (size_t matStateInd = 0; matStateInd < m_materialStates.size ();matStateInd++)
+			{
+				char ddms[30];
+				itoa(int(matStateInd),ddms,10);
+				materialStateNames.push_back (m_materialStates[matStateInd].m_name);
+				vector <int> elemIDs;
+				vector <string> elemData;
+				for (size_t matStateElem = 0;matStateElem<m_materialStates[matStateInd].m_ss.size();matStateElem++)
 				{
-					char ddms[30];
-					itoa(int(matStateInd),ddms,10);
-					dppl->PushString (string ("MaterialStateName")+string (ddms),m_materialStates[matStateInd].m_name);
-					dppl->PushInt (string ("MaterialStateMatCount")+string (ddms),int(m_materialStates[matStateInd].m_ss.size()));
-					for (size_t matStateElem = 0;matStateElem<m_materialStates[matStateInd].m_ss.size();matStateElem++)
-					{
-						char ccms[30];
-						itoa(int(matStateElem),ccms,10);
-						dppl->PushInt (string ("MaterialStateMatElemID")+string (ddms)+string("-")+string(ccms),m_materialStates[matStateInd].m_ss[matStateElem].first);
-						string msdatapar =m_materialStates[matStateInd].m_ss[matStateElem].second;
-						for (size_t mkss = 0;mkss<msdatapar.size();mkss++)
-						{
-							if (msdatapar[mkss] == '=')
-								msdatapar[mkss] = '?';
-							if (msdatapar[mkss] == ' ')
-								msdatapar[mkss] = '+';
-							if (msdatapar[mkss] == ',')
-								msdatapar[mkss] = '&';
-						}
-						dppl->PushString (string ("MaterialStateMatElemData")+string (ddms)+string("-")+string(ccms),msdatapar);
-					}
+					elemIDs.push_back (m_materialStates[matStateInd].m_ss[matStateElem].first);
+					elemData.push_back (m_materialStates[matStateInd].m_ss[matStateElem].second);
 				}
-
+				dppl->PushIntArray (string ("MaterialStateMatElemIDs")+string (ddms),elemIDs.empty () ? 0 : &elemIDs[0],elemIDs.size ());
+				dppl->PushStringArray (string ("MaterialStateMatElemDatas")+string (ddms),elemData);
 			}
-			// end write material states
+			dppl->PushStringArray ("MaterialStateNames",materialStateNames);
+		}
+		// end write material states
 
-			//nvmath::Mat44f mat = TransformReadLock (m_elementRoot)->getMatrix ();
-			//const float * matPtr = 
-			float *matPtr = new float [16];
-			m_viewList[0]->GetCNVSGViewData ()->GetCameraLocation(&matPtr);//mat.getPtr();
+		//nvmath::Mat44f mat = TransformReadLock (m_elementRoot)->getMatrix ();
+		//const float * matPtr = 
+		float *matPtr = new float [16];
+		m_viewList[0]->GetCNVSGViewData ()->GetCameraLocation(&matPtr);//mat.getPtr();
 
-			for (int i=0;i<16;i++)
-			{
-				char cc[30];
-				itoa(i,cc,10);
+		dppl->PushFloat16 ("ViewLocation",matPtr);
 
-				dppl->PushFloat ("ViewLocation"+string(cc),matPtr[i]);		
-			}
+		if (m_viewStates.size() == 1)
+		{
+			nvmath::Mat44f cmm (matPtr[0],matPtr[1],matPtr[2],matPtr[3],
+				matPtr[4],matPtr[5],matPtr[6],matPtr[7],
+				matPtr[8],matPtr[9],matPtr[10],matPtr[11],
+				matPtr[12],matPtr[13],matPtr[14],matPtr[15]);
+			m_viewStates[0].cameraMatrix = cmm;
+		}
 
-			if (m_viewStates.size() == 1)
-			{
-				nvmath::Mat44f cmm (matPtr[0],matPtr[1],matPtr[2],matPtr[3],
-					matPtr[4],matPtr[5],matPtr[6],matPtr[7],
-					matPtr[8],matPtr[9],matPtr[10],matPtr[11],
-					matPtr[12],matPtr[13],matPtr[14],matPtr[15]);
-				m_viewStates[0].cameraMatrix = cmm;
-			}
+		delete [] matPtr;
 
-			delete [] matPtr;
+		int currentViewState = -1;
 
-			int currentViewState = -1;
+		vector <float> viewStateLocations (16 * m_viewStates.size ());
+		for (size_t vsi = 0; vsi < m_viewStates.size ();vsi++)
+		{
+			if (m_viewStates[vsi].viewID == 0)
+				currentViewState = int(vsi);
+			char dd[30];
+			itoa(int(vsi),dd,10);
+			memcpy (&viewStateLocations[16 * vsi],m_viewStates[vsi].cameraMatrix.getPtr (),16 * sizeof (float));
+
+			if (m_viewStates[vsi].html_text!=string (""))
+			{
+				//break html into lines..
+				stringstream htmlstream (m_viewStates[vsi].html_text);
+				char buf[4096];
+				vector <string> htmlLines;
+				while (!htmlstream.eof ()){
+
+					htmlstream.getline (buf,4096);
+					if (buf[0] == 0)
+						break;
+					string htmlLine (buf);
+					if (htmlLine[htmlLine.size()-1] == '\n' || htmlLine[htmlLine.size()-1] == char(13))
+						htmlLine = htmlLine.substr (0,htmlLine.size()-1);
 
-			for (size_t vsi = 0; vsi < m_viewStates.size ();vsi++)
-			{
-				if (m_viewStates[vsi].viewID == 0)
-					currentViewState = int(vsi);
-				char dd[30];
-				itoa(int(vsi),dd,10);
-/*				for (int i=0;i<16;i++)
-				{
-					char cc[30];
-					itoa(i,cc,10);
-					dppl->PushFloat ("ViewStateLocation"+string(cc) + string ("-")+string (dd),(m_viewStates[vsi].cameraMatrix.getPtr ())[i]);		
+					replaceSubString(htmlLine,"href=\"#\"","href=\"javascript:void(0)\"");
+					htmlLines.push_back (htmlLine);
 				}
-	*/			
-				dppl->PushFloat16 ("ViewStateLocation"+ string ("-")+string (dd),m_viewStates[vsi].cameraMatrix.getPtr ());
+				dppl->PushStringArray ("ViewStateHtmlLines"+string(dd),htmlLines);
+			}
+			if (m_viewStates[vsi].bg_image_file!=string(""))
+				dppl->PushString ("ViewStateImage"+string(dd),m_viewStates[vsi].bg_image_file);
 
-				if (m_viewStates[vsi].html_text!=string (""))
-				{
-					//break html into lines..
-					stringstream htmlstream (m_viewStates[vsi].html_text);
-					char buf[4096];
-					int line= 0;
-					while (!htmlstream.eof ()){
-
-						htmlstream.getline (buf,4096);
-						if (buf[0] == 0)
-							break;
-						string htmlLine (buf);
-						if (htmlLine[htmlLine.size()-1] == '\n' || htmlLine[htmlLine.size()-1] == char(13))
-							htmlLine = htmlLine.substr (0,htmlLine.size()-1);
+			const size_t elemCount = m_viewStates[vsi].elementLocation.size();
+			vector <int> elemIDs (elemCount);
+			vector <float> elemLocations (16 * elemCount);
+			for (size_t ks = 0;ks < elemCount;ks++)
+			{
+				elemIDs[ks] = m_viewStates[vsi].elementLocation[ks].first;
+				memcpy (&elemLocations[16 * ks],m_viewStates[vsi].elementLocation[ks].second.getMatrix().getPtr (),16 * sizeof (float));
+			}
+			dppl->PushIntArray ("ViewStateElementIDs"+string(dd),elemCount ? &elemIDs[0] : 0,elemCount);
+			dppl->PushFloat16Array ("ViewStateElementLocations"+string(dd),elemCount ? &elemLocations[0] : 0,elemCount);
+			if ( m_viewStates[vsi].elementVisibility.size() == elemCount)
+			{
+				vector <int> elemVisibility (elemCount);
+				for (size_t ks = 0;ks < elemCount;ks++)
+					elemVisibility[ks] = m_viewStates[vsi].elementVisibility[ks].second ? 1 : 0;
+				dppl->PushIntArray ("ViewStateElementVisibilities"+string(dd),elemCount ? &elemVisibility[0] : 0,elemCount);
+			}
+		}
+		dppl->PushFloat16Array ("ViewStateLocations",viewStateLocations.empty () ? 0 : &viewStateLocations[0],m_viewStates.size ());
+		dppl->PushInt ("CurrentViewState",currentViewState);
+		dppl->PushInt ("ViewStateCount",int(m_viewStates.size ()));
 
-						replaceSubString(htmlLine,"href=\"#\"","href=\"javascript:void(0)\"");
+		dppl->PushInt ("LastIDCount",this->GetCNVSGDocData()->getIDGenerator()->m_nextID);
+		return dppl;
+	}
 
-						stringstream linoo;
-						linoo << line;
-						dppl->PushString ("ViewStateHtml"+string(dd)+string("-")+linoo.str(),htmlLine);
-						line++;
-					}
-					dppl->PushInt ("ViewStateHtmlLineCount"+string(dd),line);
-				}
-				if (m_viewStates[vsi].bg_image_file!=string(""))
-					dppl->PushString ("ViewStateImage"+string(dd),m_viewStates[vsi].bg_image_file);
-				dppl->PushInt ("ViewStateElementCount"+string (dd),int(m_viewStates[vsi].elementLocation.size()));
-				for (size_t ks = 0;ks < m_viewStates[vsi].elementLocation.size();ks++)
-				{
-					char ianid[30];
-					itoa(int(ks),ianid,10);
-					dppl->PushInt ("ViewStateElementID"+string(dd) + string ("-")+string (ianid), m_viewStates[vsi].elementLocation[ks].first);
-				}
-				for (size_t ks = 0;ks < m_viewStates[vsi].elementLocation.size();ks++)
+	bool AvocadoEngineDoc::StoreDocument (AvocadoDocSink &sink, bool documentFile)
+	{
+		NVSG_TRACE();
+		GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_DOCUMENT_STARTED,"",0);
+		NVSG_TRACE_OUT("AvocadoEngine Storing\n");
+		{
+			bool binary = false;
+			avocado::GetEngineOptionBool ("binary_documents",&binary);
+			// only a save to the document file keeps the journal, anything else could make it describe bytes that are not there.
+			AvocadoDocWriter writer (sink,binary && sink.IsBinarySafe (),documentFile ? &m_journal : NULL);
+			if (documentFile && !writer.IsBinary ())
+				m_journal.Reset ();
+			// the package ends with the document file as it was, not as it is about to be.
+			if (documentFile)
+				m_packageState = PackageState ();
+			// the element lists are read here, where the scene graph lives, and turned into text on the worker pool a batch at a time.
+			// the text goes to the sink in element order, only one batch of it is alive at a time.
+			writer.Begin (*BuildDocParams ());
+			const size_t elemCount = m_docElems.size ();
+			std::vector<ParamListSharedPtr> elementParams;
+			std::vector<string> elementTexts;
+			std::vector<AvocadoDocTocEntry> elementEntries;
+			for (size_t first = 0;first < elemCount && writer.IsGood ();first += s_elementBatchSize)
+			{
+				const size_t batch = (elemCount - first < s_elementBatchSize ? elemCount - first : s_elementBatchSize);
+				elementParams.resize (batch);
+				elementTexts.resize (batch);
+				elementEntries.resize (writer.IsBinary () ? batch : 0);
+				for (size_t k=0;k<batch;k++)
 				{
-					
-					char ianid[30];
-					itoa(int(ks),ianid,10);
-					dppl->PushFloat16 ("ViewStateElementLocation" + string ("-")+string (dd)+string ("-") + string (ianid),
-						 m_viewStates[vsi].elementLocation[ks].second.getMatrix().getPtr ());
+					const size_t i = first + k;
+					GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_ELEMENT_STARTED,m_docElems[i]->GetName(),int (100.0f*float(i)/float(elemCount)));
+					elementParams[k] = m_docElems[i]->serializeParams ();
 				}
-				if ( m_viewStates[vsi].elementVisibility.size() ==  m_viewStates[vsi].elementLocation.size())
+				AvocadoFormatElementsTask task (elementParams,elementTexts,writer.IsBinary () ? &elementEntries : NULL);
+				AvocadoWorkerPool::Get ().ParallelFor (batch,task);
+				for (size_t k=0;k<batch && writer.IsGood ();k++)
 				{
-					for (size_t ks = 0;ks < m_viewStates[vsi].elementVisibility.size();ks++)
-					{
-						char ianid[30];
-						itoa(int(ks),ianid,10);
-						dppl->PushBool ("ViewStateElementVisibility" + string ("-")+string (dd)+string ("-") + string (ianid),
-							 m_viewStates[vsi].elementVisibility[ks].second);
-					}
+					const size_t i = first + k;
+					writer.WriteElement (elementTexts[k],writer.IsBinary () ? &elementEntries[k] : NULL);
+					string ().swap (elementTexts[k]);
+					GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_ELEMENT_COMPLETE,m_docElems[i]->GetName(),int (100.0f*float(i)/float(elemCount)));
 				}
+				elementParams.clear ();
 			}
-			dppl->PushInt ("CurrentViewState",currentViewState);
-			dppl->PushInt ("ViewStateCount",int(m_viewStates.size ()));
-
-			dppl->PushInt ("LastIDCount",this->GetCNVSGDocData()->getIDGenerator()->m_nextID);
-
-			DocString += dppl->SerializeList () + "\n";
-			for (size_t i=0;i < m_docElems.size ();i++)
+			// elements of a binary document that were never created go back the way they were read.
+			for (size_t k=0;k<m_pendingElements.size () && writer.IsGood ();k++)
+				if (!m_pendingLoaded[k])
+					writer.WriteElement (m_pendingDoc.GetBlock (m_pendingElements[k]),&m_pendingDoc.GetEntry (m_pendingElements[k]));
+			writer.End ();
+			if (documentFile && writer.IsBinary () && writer.IsGood ())
 			{
-				GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_ELEMENT_STARTED,m_docElems[i]->GetName(),int (100.0f*float(i)/float(m_docElems.size ())));
-				DocString += "<Element>\n";
-				DocString += m_docElems[i]->serialize () + string ("\n");
-				DocString += "</Element>\n";
-				GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_ELEMENT_COMPLETE,m_docElems[i]->GetName(),int (100.0f*float(i)/float(m_docElems.size ())));
+				for (size_t i=0;i<elemCount;i++)
+					m_docElems[i]->MarkSaved ();
+				m_unsavedRemovals.clear ();
 			}
-
-			DocString += "</AvocadoDocV1>\n";
-			str = DocString.c_str();
 			GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_DOCUMENT_COMPLETE,"",0);
+			return writer.IsGood ();
+		}
+	}
+
+	/* Appends the elements that changed since the document file was last read or written to the end of it, see AvocadoDocJournal.
+	   false when the journal can not be used (journaled_save off, a text document, a file that changed under us or one that
+	   needs a full save to compact it), nothing was written then and the caller stores the whole document. */
+	bool AvocadoEngineDoc::SaveDocumentJournal (const std::string &path)
+	{
+		NVSG_TRACE();
+		bool journaled = true, binary = false;
+		int maxEntries = 32;
+		avocado::GetEngineOptionBool ("journaled_save",&journaled);
+		avocado::GetEngineOptionBool ("binary_documents",&binary);
+		avocado::GetEngineOptionInt ("journal_compaction_saves",&maxEntries);
+		if (!journaled || !binary || !m_journal.IsValid () || m_journal.NeedsCompaction (maxEntries))
+			return false;
+		AvocadoDocJournalFile file (path,m_journal);
+		if (!file.IsOpen ())
+			return false;
+
+		GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_DOCUMENT_STARTED,"",0);
+		AvocadoDocWriter writer (file,true,&m_journal);
+		writer.BeginJournal (*BuildDocParams ());
+		for (size_t k=0;k<m_unsavedRemovals.size ();k++)
+			writer.RemoveElement (m_unsavedRemovals[k]);
+		std::vector<size_t> saved;
+		const size_t elemCount = m_docElems.size ();
+		for (size_t i=0;i<elemCount && writer.IsGood ();i++)
+		{
+			if (!m_docElems[i]->NeedsSave ())
+				continue;
+			ParamListSharedPtr pl = m_docElems[i]->serializeParams ();
+			AvocadoDocTocEntry entry;
+			ReadElementTocEntry (*pl,entry);
+			writer.WriteElement (pl->SerializeList (),&entry);
+			saved.push_back (i);
+		}
+		writer.End ();
+		const bool res = writer.IsGood () && file.Close (true);
+		if (!res)
+		{
+			file.Close (false);
+			m_journal.Reset ();
 		}
 		else
 		{
+			for (size_t k=0;k<saved.size ();k++)
+				m_docElems[saved[k]]->MarkSaved ();
+			m_unsavedRemovals.clear ();
+		}
+		GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::SAVE_DOCUMENT_COMPLETE,"",0);
+		return res;
+	}
+
+	// save_compression_level, read where the options live for the autosave thread.
+	static volatile LONG s_autoSaveZipLevel = 3;
+
+	/* Puts the autosave in a zip as Main.avc, where CompressFile puts a saved document. Runs on the autosave thread. */
+	static bool ZipAutoSave (const std::string &written, const std::string &path)
+	{
+		const std::string zipped = path + ".zip.tmp";
+#ifdef UNICODE
+		wchar_t wzipped [MAX_PATH];
+		wchar_t wwritten [MAX_PATH];
+		size_t bc = 0;
+		::mbstowcs_s<MAX_PATH> (&bc,wzipped,zipped.c_str (),MAX_PATH);
+		::mbstowcs_s<MAX_PATH> (&bc,wwritten,written.c_str (),MAX_PATH);
+		HZIP hz = CreateZip (wzipped,0);
+		if (hz != 0)
+			ZipSetCompression (hz,int (InterlockedCompareExchange (&s_autoSaveZipLevel,0,0)),false);
+		bool res = (hz != 0 && ZipAdd (hz,L"Main.avc",wwritten) == ZR_OK);
+#else
+		HZIP hz = CreateZip (zipped.c_str (),0);
+		if (hz != 0)
+			ZipSetCompression (hz,int (InterlockedCompareExchange (&s_autoSaveZipLevel,0,0)),false);
+		bool res = (hz != 0 && ZipAdd (hz,"Main.avc",written.c_str ()) == ZR_OK);
+#endif
+		if (hz != 0 && CloseZip (hz) != ZR_OK)
+			res = false;
+		DeleteFileA (written.c_str ());
+		if (res)
+			res = AvocadoAutoSave::MoveToPath (zipped,path);
+		if (!res)
+			DeleteFileA (zipped.c_str ());
+		return res;
+	}
+
+	/* The snapshot is taken here, where the scene graph lives : the doc params, and per element the serializeParams list
+	   of what changed since the last autosave (the text of the rest is shared with it). Turning it into text, writing and
+	   zipping it happen on the autosave thread while the user goes on working. */
+	bool AvocadoEngineDoc::AutoSaveDocument (const std::string &path, bool zipped)
+	{
+		NVSG_TRACE();
+		bool background = true;
+		avocado::GetEngineOptionBool ("background_autosave",&background);
+		if (!background)
+			return false;
+		// the one still running is recent enough, this one is skipped.
+		if (m_autoSave.IsRunning ())
+			return true;
+		AvocadoDocSnapshot snapshot;
+		snapshot.docParams = BuildDocParams ();
+		snapshot.elements.reserve (m_docElems.size () + m_pendingCount);
+		for (size_t i=0;i<m_docElems.size ();i++)
+		{
+			AvocadoEngineDocElement *elem = m_docElems[i];
+			nvmath::Mat44f location (true);
+			if (elem->m_elementRoot)
+				location = nvsg::TransformReadLock (elem->m_elementRoot)->getMatrix ();
+			AvocadoSnapshotBlockPtr block = m_autoSave.FindBlock (elem->GetID (),elem->GetRevision (),location.getPtr ());
+			if (!block)
+				block = AvocadoAutoSave::NewBlock (elem->GetID (),elem->GetRevision (),location.getPtr (),elem->serializeParams ());
+			snapshot.elements.push_back (block);
+		}
+		// elements of a binary document that were never created, as StoreDocument writes them.
+		for (size_t k=0;k<m_pendingElements.size ();k++)
+		{
+			if (m_pendingLoaded[k])
+				continue;
+			const AvocadoDocTocEntry &entry = m_pendingDoc.GetEntry (m_pendingElements[k]);
+			AvocadoSnapshotBlockPtr block = m_autoSave.FindBlock (entry.id,0,NULL);
+			if (!block)
+				block = AvocadoAutoSave::NewTextBlock (m_pendingDoc.GetBlock (m_pendingElements[k]),entry);
+			snapshot.elements.push_back (block);
+		}
+		int level = 3;
+		avocado::GetEngineOptionInt ("save_compression_level",&level);
+		InterlockedExchange (&s_autoSaveZipLevel,level);
+		return m_autoSave.Start (snapshot,path,zipped ? ZipAutoSave : NULL);
+	}
+
+	bool AvocadoEngineDoc::SerializeDocument (std::string &str,bool isStoring)
+	{
+		NVSG_TRACE();
+		if (isStoring)
+		{
+			str.clear ();
+			AvocadoStringDocSink sink (str);
+			return StoreDocument (sink);
+		}
+		else if (AvocadoDocReader::IsBinary (str.data (),str.size ()))
+		{
+			return LoadBinaryDocument (str);
+		}
+		else
+		{
+			GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_DOCUMENT_STARTED,"",0);
+			NVSG_TRACE_OUT(string ("AvocadoEngine Loading "+ string(" - ") +str+ string("\n")).c_str());
 			//string DocParamString = string ("");
 			string DocString  = str;
 			int totalElementsCount = 1; // init to 1 to avoid division by zero.
@@ -540,432 +906,617 @@ namespace avocado
 				bool elStarted = false;
 				bool docValid = false;
 				string accum ("");
+				std::vector<string> elementBlocks;
 				while ( ty.good() )
 				{
 					getline (ty,DocLine);
 					if (DocLine == "<AvocadoDocV1>")
 					{
+						LoadElementBlocks (elementBlocks,totalElementsCount);
 						string DocPropLine;
 						getline (ty,DocPropLine);
-						ParamListSharedPtr dppl = ParamList::createFromString (DocPropLine);
+						ReadDocParams (DocPropLine,newParamList,mat,hasLocation,totalElementsCount);
+						ClearDocElements ();
+						docValid = true;
+					}
+					else if (DocLine == "</AvocadoDocV1>")
+					{
+						LoadElementBlocks (elementBlocks,totalElementsCount);
+						CompleteDocLoad (newParamList,hasLocation,mat);
 
-						int lastKey;
-						IntParam *lid = (IntParam*)(dppl->GetParam ("LastIDCount"));
-						lid->GetValue(lastKey);
+						break;
+					} 
+					else if (DocLine == "<Element>")
+					{
+						if (elStarted)
+							docValid = false;
+						if (!docValid)
+							break;
+						elStarted = true;
+					}
+					else if (DocLine == "</Element>")
+					{
+						if (!elStarted)
+							docValid = false;
+						if (!docValid)
+							break;
+						// parsed on the worker pool a batch at a time, the elements are still added one by one in document order.
+						elementBlocks.push_back (accum);
+						if (elementBlocks.size () >= s_elementBatchSize)
+							LoadElementBlocks (elementBlocks,totalElementsCount);
+						elStarted = false;
+						accum = "";
+					}
+					else
+					{
+						if (elStarted && docValid)
+							accum += DocLine;
+					}
+				}
+				// a document cut short keeps the elements read so far.
+				LoadElementBlocks (elementBlocks,totalElementsCount);
+			}
+		}
 
-						
-						/* Get doc pararms */
-						if (dppl->GetParam("AvocadoDocParamsCount"))
-						{
-						    newParamList = ParamList::createNew ();
-							IntParam *docparCount = (IntParam*)dppl->GetParam("AvocadoDocParamsCount");
-							int idoccount;
-							docparCount->GetValue (idoccount);
+		return true;
+	}
 
-							for (int parK = 0;parK < idoccount;parK++)
-							{
-								char cc[30];
-								itoa (parK,cc,10);
-								if (dppl->GetParam("AvocadoDocParamName"+ string (cc)))
-								{
+	/* The header and state blocks are applied right away and the toc lists the elements, so the document shows its structure
+	   before any element exists. The element blocks wait in m_pendingDoc until LoadPendingElements (the app calls it when idle)
+	   or a lookup by id (GetDocElementPtrById) creates them, all of them are created here when lazy_element_loading is off. */
+	bool AvocadoEngineDoc::LoadBinaryDocument (const std::string &bytes)
+	{
+		GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_DOCUMENT_STARTED,"",0);
+		NVSG_TRACE_OUT("AvocadoEngine Loading a binary document\n");
+		AvocadoDocReader reader;
+		if (!reader.Open (bytes))
+		{
+			GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_DOCUMENT_COMPLETE,"",int (100.0f));
+			avocado::RaiseAvocadoDocErrorMessage (m_id,"The document is damaged or was written by a newer version");
+			return false;
+		}
 
-									StringParam *docparName = (StringParam*)dppl->GetParam("AvocadoDocParamName"+string (cc));
-									StringParam *docparValue = (StringParam*)dppl->GetParam("AvocadoDocParamValue"+string (cc));
-									string parname,parval;
-									docparName->GetValue (parname);
-									docparValue->GetValue (parval);
+		ParamListSharedPtr newParamList;
+		float mat[16];
+		bool hasLocation = false;
+		int totalElementsCount = 1;
+		ReadDocParams (reader.GetDocParams (),newParamList,mat,hasLocation,totalElementsCount);
+		ClearDocElements ();
 
-									newParamList->PushString (parname,parval);
-								}
-							}
-						//	m_nvsgDocData->m_docParams = newParamList;//ParamList::createFromString (parstr);
-							//DocParamString = ;
-						}
-						/* end get do params*/
+		m_pendingDoc.Swap (reader);
+		m_pendingDoc.FillJournal (m_journal);
+		for (size_t i=0;i<m_pendingDoc.GetEntryCount ();i++)
+		{
+			const AvocadoDocTocEntry &entry = m_pendingDoc.GetEntry (i);
+			if (entry.kind != AVC_DOC_BLOCK_ELEMENT)
+				continue;
+			if (entry.id >= 0)
+				m_pendingById[entry.id] = m_pendingElements.size ();
+			m_pendingElements.push_back (i);
+		}
+		m_pendingLoaded.assign (m_pendingElements.size (),false);
+		m_pendingNext = 0;
+		m_pendingCount = m_pendingElements.size ();
+		m_pendingTotal = (m_pendingCount > 1 ? int (m_pendingCount) : 1);
+
+		bool lazy = true;
+		avocado::GetEngineOptionBool ("lazy_element_loading",&lazy);
+		if (!lazy)
+			LoadPendingElements (m_pendingCount);
+		CompleteDocLoad (newParamList,hasLocation,mat);
+		return true;
+	}
 
-						for (int j=0;j<16;j++)
-						{
-							char cc[30];
-							itoa(j,cc,10);
-							mat[j] = 1.0f;
-							if (dppl->GetParam ("ViewLocation" + string (cc)))
-							{
-								FloatParam *irm_vn = (FloatParam*)dppl->GetParam ("ViewLocation" + string (cc));
-								if (irm_vn)
-								{
-									irm_vn->GetValue (mat[j]);
-									hasLocation = true;
-								}
-							}	
-						}
-						// hack - set the view location here...
-						if (hasLocation)
-						{
-							for (size_t viewDD = 0;viewDD<this->m_viewList.size();viewDD++)
-							{
-								(*GetViewById (int(viewDD)))->GetCNVSGViewData ()->SetCameraLocation (mat);
-							}
-						}
-						
-						// read material states;
-						m_materialStates.clear();
-						if (dppl->GetParam ("MaterialStateCount"))
-						{
-							IntParam *imaterialStateCount = (IntParam*)(dppl->GetParam ("MaterialStateCount"));
-							int ms_count;
-							imaterialStateCount->GetValue(ms_count);
-							for (int imscx = 0; imscx <ms_count;imscx++)
-							{
-								
-							    char ddms[30];
-								itoa(imscx,ddms,10);
-								string ms_name = "";
-								int ms_value = 0;
-								if (dppl->GetParam (string ("MaterialStateName") + string (ddms)))
-								{
-									StringParam *smaterialStateName = (StringParam*)dppl->GetParam (string ("MaterialStateName")+ string (ddms));
-									smaterialStateName->GetValue (ms_name);
-								}
-								if (dppl->GetParam (string ("MaterialStateMatCount") + string (ddms)))
-								{
-									IntParam *smaterialStateMatCount = (IntParam*)dppl->GetParam (string ("MaterialStateMatCount")+ string (ddms));
-									smaterialStateMatCount->GetValue (ms_value);
-								}
-								AvocadoMaterialStateData msd;
-								msd.m_name = ms_name;
+	std::string AvocadoEngineDoc::TakePendingElement (size_t k)
+	{
+		DropPendingElement (k);
+		return m_pendingDoc.GetBlock (m_pendingElements[k]);
+	}
 
-								for (int msmc = 0;msmc < ms_value ; msmc++)
-								{
-									int ms_elemid = 0;
-									string ms_elemmatdata = "";
-									char ccms[30];
-									itoa(msmc,ccms,10);
-									if (dppl->GetParam (string ("MaterialStateMatElemID") + string (ddms)+ string("-") + string (ccms)))
-									{
-										IntParam *smaterialStateMatElemID = (IntParam*)dppl->GetParam (string ("MaterialStateMatElemID")+ string (ddms) + string("-") + string (ccms));
-										smaterialStateMatElemID->GetValue (ms_elemid);
-									}	
-									if (dppl->GetParam (string ("MaterialStateMatElemData") + string (ddms)+ string("-") + string (ccms)))
-									{
-										StringParam *smaterialStateMatElemID = (StringParam*)dppl->GetParam (string ("MaterialStateMatElemData")+ string (ddms) + string("-") + string (ccms));
-										smaterialStateMatElemID->GetValue (ms_elemmatdata);
-										for (size_t mkss = 0;mkss<ms_elemmatdata.size();mkss++)
-										{
-											if (ms_elemmatdata[mkss] == '?')
-												ms_elemmatdata[mkss] = '=';
-											if (ms_elemmatdata[mkss] == '+')
-												ms_elemmatdata[mkss] = ' ';
-											if (ms_elemmatdata[mkss] == '&')
-												ms_elemmatdata[mkss] = ',';
-										}
-
-									}	
-									msd.m_ss.push_back(std::pair<int,string>(ms_elemid,ms_elemmatdata));
-								
-								}
-								m_materialStates.push_back(msd);
-							}
-						}
-						// end read material states
+	void AvocadoEngineDoc::DropPendingElement (size_t k)
+	{
+		m_pendingLoaded[k] = true;
+		m_pendingCount--;
+		PendingElementHash::iterator it = m_pendingById.find (m_pendingDoc.GetEntry (m_pendingElements[k]).id);
+		if (it != m_pendingById.end () && it->second == k)
+			m_pendingById.erase (it);
+	}
 
-						// read view states..
-						m_viewStates.clear ();
-						int current_view_state = -1;
-						if (dppl->GetParam ("ViewStateCount"))
-						{
-							float matVS[16];
-							IntParam *iviewStateCount = (IntParam*)(dppl->GetParam ("ViewStateCount"));
-							int vs_count;
-							iviewStateCount->GetValue(vs_count);
-							if (dppl->GetParam ("CurrentViewState"))
-							{
-								IntParam *icurrent_viewState = (IntParam*)(dppl->GetParam ("CurrentViewState"));
-								icurrent_viewState->GetValue(current_view_state);
-							}
-							for (int vsK = 0; vsK < vs_count; vsK++)
-							{
-								AvocadoViewStateData new_vs;
-								//new_vs.cameraMatrix = mat;
-								new_vs.viewID = -1;
-
-								char dd[30];
-								itoa(vsK,dd,10);
-								bool useIDMat = false;
-								if (!dppl->GetFloat16ValueByName ("ViewStateLocation" +  string ("-")+ string (dd),matVS))
-								{
-									//
-									useIDMat = true;
-									//for (int kiiid = 0; kiiid < 16; kiiid ++)
-										//matVS[kiiid] = iddddmat.getPtr ()[kiiid];
-								} 
+	/* Creates up to maxCount pending elements in document order, an element creating another one by id (an instance and
+	   what it refers to) goes through LoadPendingElement. */
+	bool AvocadoEngineDoc::LoadPendingElements (size_t maxCount)
+	{
+		std::vector<string> blocks;
+		size_t taken = 0;
+		while (taken < maxCount && m_pendingNext < m_pendingElements.size ())
+		{
+			const size_t k = m_pendingNext++;
+			if (m_pendingLoaded[k])
+				continue;
+			blocks.push_back (TakePendingElement (k));
+			taken++;
+			if (blocks.size () >= s_elementBatchSize)
+				LoadElementBlocks (blocks,m_pendingTotal);
+		}
+		LoadElementBlocks (blocks,m_pendingTotal);
+		if (m_pendingCount == 0 && !m_pendingElements.empty ())
+			ClearPendingElements ();
+		return HasPendingElements ();
+	}
 
+	bool AvocadoEngineDoc::LoadPendingElement (int elemId)
+	{
+		PendingElementHash::iterator it = m_pendingById.find (elemId);
+		if (it == m_pendingById.end ())
+			return false;
+		std::vector<string> blocks (1,TakePendingElement (it->second));
+		LoadElementBlocks (blocks,m_pendingTotal);
+		return true;
+	}
 
-								nvmath::Mat44f mmat (true);
-								if (!useIDMat)
-								{
-									for (int xj=0;xj<4;xj++)
-										for (int xi=0;xi<4;xi++)
-											mmat[xj][xi] = matVS[xi+4*xj];
-								}
-								new_vs.cameraMatrix = mmat; 
-								
-								if (dppl->GetParam (string("ViewStateHtmlLineCount")+string(dd)))
-								{
-									IntParam *ivs_html = (IntParam*)dppl->GetParam (string("ViewStateHtmlLineCount")+string(dd));
-									if (ivs_html)
-									{
-										int lineCount = 0;
-										ivs_html->GetValue (lineCount);
-										for (size_t lipos=0;lipos< (size_t)lineCount;lipos++)
-										{
-											char cc[30];
-											itoa(int(lipos),cc,10);
-											if (dppl->GetParam (string("ViewStateHtml")+string(dd)+string("-")+string(cc)))
-											{
-												StringParam *ivs_html_line = (StringParam*)dppl->GetParam (string("ViewStateHtml")+string(dd) + string ("-") + string (cc));
-												if (ivs_html_line)
-												{
-													string linestring ;
-													ivs_html_line->GetValue(linestring);
-													new_vs.html_text += linestring ;//+ string("\n");
-												}
-											}
-
-										}
-									}
+	void AvocadoEngineDoc::ClearPendingElements ()
+	{
+		m_pendingDoc.Close ();
+		std::vector<size_t> ().swap (m_pendingElements);
+		std::vector<bool> ().swap (m_pendingLoaded);
+		m_pendingById.clear ();
+		m_pendingNext = 0;
+		m_pendingCount = 0;
+		m_pendingTotal = 1;
+	}
 
-								}
-								if (dppl->GetParam (string("ViewStateImage")+string(dd)))
-								{
-									StringParam *ivs_html = (StringParam*)dppl->GetParam (string("ViewStateImage")+string(dd));
-									if (ivs_html)
-									{
-										ivs_html->GetValue (new_vs.bg_image_file);
-									}
+	/* The doc params list, the <AvocadoDocV1> line of a text document or the header and state blocks of a binary one.
+	   Applies the view location, the material and view states and the id counter, the doc params are applied by CompleteDocLoad. */
+	void AvocadoEngineDoc::ReadDocParams (const std::string &docParams, ParamListSharedPtr &newParamList, float *mat, bool &hasLocation, int &totalElementsCount)
+	{
+		ParamListSharedPtr dppl = ParamList::createFromString (docParams);
 
-								}
-								if (dppl->GetParam (string("ViewStateElementCount")+string(dd)))
-								{
-									IntParam *ivs_elemcnt = (IntParam*)dppl->GetParam (string("ViewStateElementCount")+string(dd));
-									int elemtCount=0;
-									if (ivs_elemcnt)
-									{
-										ivs_elemcnt->GetValue (elemtCount);
-										if (totalElementsCount < elemtCount)
-											totalElementsCount = elemtCount;
-									}
-									for (int ks = 0;ks < elemtCount ;ks ++)
-									{
-										bool apply_matrix = true;
-										int vselemId = 0;
-										float matVSElem[16];
-											char cc[30];
-											itoa(int(ks),cc,10);
-											//if (dppl->GetParam (string("ViewStateElementID")+string(dd)+string("-")+string(cc)))
-											{
-												bool res = dppl->GetIntValueByName (string("ViewStateElementID")+string(dd)+string("-")+string(cc),vselemId);
-												if (!res)
-													apply_matrix = false;
-												//IntParam *vselemIdprm = (IntParam*)dppl->GetParam (string("ViewStateElementID")+string(dd)+string("-")+string(cc));
-												//vselemIdprm->GetValue (vselemId);
-
-											}
-											if (!dppl->GetFloat16ValueByName ("ViewStateElementLocation" + string ("-")+ string (dd) + string ("-")+ string (cc),matVSElem))
-											{
-												apply_matrix = false;
-											}
-											if (apply_matrix)
-											{
-												nvmath::Mat44f matElementLoca
-													(matVSElem[0],matVSElem[1],matVSElem[2],matVSElem[3],matVSElem[4],matVSElem[5],matVSElem[6],matVSElem[7],matVSElem[8],
-													matVSElem[9],matVSElem[10],matVSElem[11],matVSElem[12],matVSElem[13],matVSElem[14],matVSElem[15]);
-												nvmath::Trafo matElementLocaTraf;
-												matElementLocaTraf.setMatrix (matElementLoca);
-												matElementLocaTraf.setCenter (nvmath::Vec3f (0.0f,0.0f,0.0f));//
-												new_vs.elementLocation.push_back (pair<int,nvmath::Trafo>(vselemId,matElementLocaTraf));
-											}
-											if (apply_matrix)
-											{
-												bool vselemVis = true;
-												if (dppl->GetBoolValueByName ("ViewStateElementVisibility" + string ("-")+ string (dd) + string ("-")+ string (cc),vselemVis))
-												{
-														new_vs.elementVisibility.push_back (pair<int,bool>(vselemId,vselemVis));
-												}
-											}
-									}
-								}
-								m_viewStates.push_back(new_vs);
-							}
-							//if (current_view_state >= 0)
-							m_viewStates[0].viewID=0;//current_view_state].viewID = 0;
-						}
-						//end read view states;
-						GetCNVSGDocData()->getIDGenerator()->m_nextID = (unsigned int)lastKey;
-						ClearDocElements ();
-						docValid = true;
-					}
-					else if (DocLine == "</AvocadoDocV1>")
+		int lastKey = 0;
+		bool hasLastKey = dppl->GetIntValueByName (s_lastIDCountAtom,lastKey);
+
+		
+		/* Get doc pararms */
+		vector <string> docParamNames, docParamValues;
+		int idoccount;
+		if (dppl->GetStringArrayByName (s_docParamNamesAtom,docParamNames) &&
+			dppl->GetStringArrayByName (s_docParamValuesAtom,docParamValues))
+		{
+		    newParamList = ParamList::createNew ();
+			for (size_t parK = 0;parK < docParamNames.size () && parK < docParamValues.size ();parK++)
+				newParamList->PushString (docParamNames[parK],docParamValues[parK]);
+		}
+		else if (dppl->GetIntValueByName (s_docParamsCountAtom,idoccount))
+		{
+		    newParamList = ParamList::createNew ();
+
+			for (int parK = 0;parK < idoccount;parK++)
+			{
+				char cc[30];
+				itoa (parK,cc,10);
+				if (dppl->GetParam("AvocadoDocParamName"+ string (cc)))
+				{
+
+					StringParam *docparName = (StringParam*)dppl->GetParam("AvocadoDocParamName"+string (cc));
+					StringParam *docparValue = (StringParam*)dppl->GetParam("AvocadoDocParamValue"+string (cc));
+					string parname,parval;
+					docparName->GetValue (parname);
+					docparValue->GetValue (parval);
+
+					newParamList->PushString (parname,parval);
+				}
+			}
+		//	m_nvsgDocData->m_docParams = newParamList;//ParamList::createFromString (parstr);
+			//DocParamString = ;
+		}
+		/* end get do params*/
+
+		if (dppl->GetFloat16ValueByName (s_viewLocationAtom,mat))
+		{
+			hasLocation = true;
+		}
+		else
+		{
+			for (int j=0;j<16;j++)
+			{
+				char cc[30];
+				itoa(j,cc,10);
+				mat[j] = 1.0f;
+				if (dppl->GetParam ("ViewLocation" + string (cc)))
+				{
+					FloatParam *irm_vn = (FloatParam*)dppl->GetParam ("ViewLocation" + string (cc));
+					if (irm_vn)
 					{
-						GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_DOCUMENT_COMPLETE,"",int (100.0f));
-						if (hasLocation)
-							m_viewList[0]->GetCNVSGViewData()->SetCameraLocation (mat);
+						irm_vn->GetValue (mat[j]);
+						hasLocation = true;
+					}
+				}	
+			}
+		}
+		// hack - set the view location here...
+		if (hasLocation)
+		{
+			for (size_t viewDD = 0;viewDD<this->m_viewList.size();viewDD++)
+			{
+				(*GetViewById (int(viewDD)))->GetCNVSGViewData ()->SetCameraLocation (mat);
+			}
+		}
+		
+		// read material states;
+		m_materialStates.clear();
+		vector <string> materialStateNames;
+		int ms_count;
+		if (dppl->GetStringArrayByName (s_materialStateNamesAtom,materialStateNames))
+		{
+			for (size_t imscx = 0; imscx < materialStateNames.size ();imscx++)
+			{
+			    char ddms[30];
+				itoa(int(imscx),ddms,10);
+				AvocadoMaterialStateData msd;
+				msd.m_name = materialStateNames[imscx];
+				vector <int> elemIDs;
+				vector <string> elemData;
+				dppl->GetIntArrayByName (string ("MaterialStateMatElemIDs")+string (ddms),elemIDs);
+				dppl->GetStringArrayByName (string ("MaterialStateMatElemDatas")+string (ddms),elemData);
+				for (size_t msmc = 0;msmc < elemIDs.size () && msmc < elemData.size ();msmc++)
+					msd.m_ss.push_back(std::pair<int,string>(elemIDs[msmc],elemData[msmc]));
+				m_materialStates.push_back(msd);
+			}
+		}
+		else if (dppl->GetIntValueByName (s_materialStateCountAtom,ms_count))
+		{
+			for (int imscx = 0; imscx <ms_count;imscx++)
+			{
+				
+			    char ddms[30];
+				itoa(imscx,ddms,10);
+				string ms_name = "";
+				int ms_value = 0;
+				if (dppl->GetParam (string ("MaterialStateName") + string (ddms)))
+				{
+					StringParam *smaterialStateName = (StringParam*)dppl->GetParam (string ("MaterialStateName")+ string (ddms));
+					smaterialStateName->GetValue (ms_name);
+				}
+				if (dppl->GetParam (string ("MaterialStateMatCount") + string (ddms)))
+				{
+					IntParam *smaterialStateMatCount = (IntParam*)dppl->GetParam (string ("MaterialStateMatCount")+ string (ddms));
+					smaterialStateMatCount->GetValue (ms_value);
+				}
+				AvocadoMaterialStateData msd;
+				msd.m_name = ms_name;
 
-						m_nvsgDocData->m_docParams->Clear ();
-//#if 0
-						for (size_t pari = 0;pari < newParamList->GetParamCount(); /*m_nvsgDocData->m_docParams->GetParamCount()*/pari++)
+				for (int msmc = 0;msmc < ms_value ; msmc++)
+				{
+					int ms_elemid = 0;
+					string ms_elemmatdata = "";
+					char ccms[30];
+					itoa(msmc,ccms,10);
+					if (dppl->GetParam (string ("MaterialStateMatElemID") + string (ddms)+ string("-") + string (ccms)))
+					{
+						IntParam *smaterialStateMatElemID = (IntParam*)dppl->GetParam (string ("MaterialStateMatElemID")+ string (ddms) + string("-") + string (ccms));
+						smaterialStateMatElemID->GetValue (ms_elemid);
+					}	
+					if (dppl->GetParam (string ("MaterialStateMatElemData") + string (ddms)+ string("-") + string (ccms)))
+					{
+						StringParam *smaterialStateMatElemID = (StringParam*)dppl->GetParam (string ("MaterialStateMatElemData")+ string (ddms) + string("-") + string (ccms));
+						smaterialStateMatElemID->GetValue (ms_elemmatdata);
+						for (size_t mkss = 0;mkss<ms_elemmatdata.size();mkss++)
 						{
-							//Param *p = m_nvsgDocData->m_docParams->GetParam (pari);
-							Param *p =  newParamList->GetParam (pari);
-							string paramName;
-							string paramVal;
-							p->GetName(paramName);
-							p->GetValue (paramVal);
-							if (paramName == "backimage" )
-							{
-								ParamListSharedPtr newParam = ParamList::createNew ();
-								newParam->PushString (paramName,paramVal);
-								NotifyDocParamChanged (newParam->SerializeList());
-								bool needRepaint = false;
-								HandleAvocadoDocGeneralStringMessage ("SetDocParam",m_id,newParam->SerializeList (),needRepaint);
-							}
+							if (ms_elemmatdata[mkss] == '?')
+								ms_elemmatdata[mkss] = '=';
+							if (ms_elemmatdata[mkss] == '+')
+								ms_elemmatdata[mkss] = ' ';
+							if (ms_elemmatdata[mkss] == '&')
+								ms_elemmatdata[mkss] = ',';
 						}
-//#endif
-						for (size_t pari = 0;pari < newParamList->GetParamCount(); /*m_nvsgDocData->m_docParams->GetParamCount()*/pari++)
+
+					}	
+					msd.m_ss.push_back(std::pair<int,string>(ms_elemid,ms_elemmatdata));
+				
+				}
+				m_materialStates.push_back(msd);
+			}
+		}
+		// end read material states
+
+		// read view states..
+		m_viewStates.clear ();
+		int current_view_state = -1;
+		int vs_count;
+		if (dppl->GetIntValueByName (s_viewStateCountAtom,vs_count))
+		{
+			float matVS[16];
+			vector <float> viewStateLocations;
+			dppl->GetFloat16ArrayByName (s_viewStateLocationsAtom,viewStateLocations);
+			dppl->GetIntValueByName (s_currentViewStateAtom,current_view_state);
+			for (int vsK = 0; vsK < vs_count; vsK++)
+			{
+				AvocadoViewStateData new_vs;
+				//new_vs.cameraMatrix = mat;
+				new_vs.viewID = -1;
+
+				char dd[30];
+				itoa(vsK,dd,10);
+				bool useIDMat = false;
+				if (size_t (vsK + 1) * 16 <= viewStateLocations.size ())
+				{
+					memcpy (matVS,&viewStateLocations[16 * vsK],16 * sizeof (float));
+				}
+				else if (!dppl->GetFloat16ValueByName ("ViewStateLocation" +  string ("-")+ string (dd),matVS))
+				{
+					//
+					useIDMat = true;
+					//for (int kiiid = 0; kiiid < 16; kiiid ++)
+						//matVS[kiiid] = iddddmat.getPtr ()[kiiid];
+				} 
+
+
+				nvmath::Mat44f mmat (true);
+				if (!useIDMat)
+				{
+					for (int xj=0;xj<4;xj++)
+						for (int xi=0;xi<4;xi++)
+							mmat[xj][xi] = matVS[xi+4*xj];
+				}
+				new_vs.cameraMatrix = mmat; 
+				
+				vector <string> htmlLines;
+				if (dppl->GetStringArrayByName (string("ViewStateHtmlLines")+string(dd),htmlLines))
+				{
+					for (size_t lipos=0;lipos<htmlLines.size();lipos++)
+						new_vs.html_text += htmlLines[lipos];
+				}
+				else if (dppl->GetParam (string("ViewStateHtmlLineCount")+string(dd)))
+				{
+					IntParam *ivs_html = (IntParam*)dppl->GetParam (string("ViewStateHtmlLineCount")+string(dd));
+					if (ivs_html)
+					{
+						int lineCount = 0;
+						ivs_html->GetValue (lineCount);
+						for (size_t lipos=0;lipos< (size_t)lineCount;lipos++)
 						{
-							//Param *p = m_nvsgDocData->m_docParams->GetParam (pari);
-							Param *p =  newParamList->GetParam (pari);
-							string paramName;
-							string paramVal;
-							p->GetName(paramName);
-							p->GetValue (paramVal);
-							if (paramName == "lightpreset" || paramName == "roomType" ) 
+							char cc[30];
+							itoa(int(lipos),cc,10);
+							if (dppl->GetParam (string("ViewStateHtml")+string(dd)+string("-")+string(cc)))
 							{
-								if (paramName == "backimage")
- 								continue;
-								ParamListSharedPtr newParam = ParamList::createNew ();
-								newParam->PushString (paramName,paramVal);
-								NotifyDocParamChanged (newParam->SerializeList());
-								bool needRepaint = false;
-								HandleAvocadoDocGeneralStringMessage ("SetDocParam",m_id,newParam->SerializeList (),needRepaint);
+								StringParam *ivs_html_line = (StringParam*)dppl->GetParam (string("ViewStateHtml")+string(dd) + string ("-") + string (cc));
+								if (ivs_html_line)
+								{
+									string linestring ;
+									ivs_html_line->GetValue(linestring);
+									new_vs.html_text += linestring ;//+ string("\n");
+								}
 							}
-						}
-					
-						for (size_t pari = 0;pari <  newParamList->GetParamCount();/*m_nvsgDocData->m_docParams->GetParamCount();*/pari++)
-						{
-							//Param *p = m_nvsgDocData->m_docParams->GetParam (pari);
-							Param *p =  newParamList->GetParam (pari);
-							string paramName;
-							string paramVal;
-							p->GetName(paramName);
-							p->GetValue (paramVal);
-							if (paramName != "lightpreset" && paramName != "roomType")
-							{
-								if (paramName == "backimage")
-									continue;
 
-							ParamListSharedPtr newParam = ParamList::createNew ();
-							newParam->PushString (paramName,paramVal);
-							NotifyDocParamChanged (newParam->SerializeList());
-							bool needRepaint = false;
-							HandleAvocadoDocGeneralStringMessage ("SetDocParam",m_id,newParam->SerializeList (),needRepaint);
-							}
 						}
-						
-						NotifyViewStateChanged(0);
-						NotifyMaterialStateChanged();
+					}
 
-						break;
-					} 
-					else if (DocLine == "<Element>")
+				}
+				if (dppl->GetParam (string("ViewStateImage")+string(dd)))
+				{
+					StringParam *ivs_html = (StringParam*)dppl->GetParam (string("ViewStateImage")+string(dd));
+					if (ivs_html)
 					{
-						if (elStarted)
-							docValid = false;
-						if (!docValid)
-							break;
-						elStarted = true;
-						const float progressFactor = (totalElementsCount == 1 ? 1.0f : 100.0f);
-						GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_ELEMENT_STARTED,"",int (progressFactor*float(float(m_docElems.size())/float(totalElementsCount))));
+						ivs_html->GetValue (new_vs.bg_image_file);
 					}
-					else if (DocLine == "</Element>")
+
+				}
+				vector <int> elemIDs, elemVisibility;
+				vector <float> elemLocations;
+				if (dppl->GetIntArrayByName (string("ViewStateElementIDs")+string(dd),elemIDs) &&
+					dppl->GetFloat16ArrayByName (string("ViewStateElementLocations")+string(dd),elemLocations))
+				{
+					bool hasVisibility = dppl->GetIntArrayByName (string("ViewStateElementVisibilities")+string(dd),elemVisibility);
+					if (totalElementsCount < int (elemIDs.size ()))
+						totalElementsCount = int (elemIDs.size ());
+					for (size_t ks = 0;ks < elemIDs.size () && (ks + 1) * 16 <= elemLocations.size ();ks++)
 					{
-						string namefortracing = "";
-						if (m_docElems.size() > 0) 
-								namefortracing = m_docElems[m_docElems.size()-1]->GetName();
-						const float progressFactor = (totalElementsCount == 1 ? 1.0f : 100.0f);
-						GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_ELEMENT_COMPLETE,namefortracing,int(progressFactor*float(float(m_docElems.size())/float(totalElementsCount))));
-						if (!elStarted)
-							docValid = false;
-						if (!docValid)
-							break;
-						// Do parse accum element
-						bool needRepaint = false;
+						const float *matVSElem = &elemLocations[16 * ks];
+						nvmath::Mat44f matElementLoca
+							(matVSElem[0],matVSElem[1],matVSElem[2],matVSElem[3],matVSElem[4],matVSElem[5],matVSElem[6],matVSElem[7],matVSElem[8],
+							matVSElem[9],matVSElem[10],matVSElem[11],matVSElem[12],matVSElem[13],matVSElem[14],matVSElem[15]);
+						nvmath::Trafo matElementLocaTraf;
+						matElementLocaTraf.setMatrix (matElementLoca);
+						matElementLocaTraf.setCenter (nvmath::Vec3f (0.0f,0.0f,0.0f));//
+						new_vs.elementLocation.push_back (pair<int,nvmath::Trafo>(elemIDs[ks],matElementLocaTraf));
+						if (hasVisibility && ks < elemVisibility.size ())
+							new_vs.elementVisibility.push_back (pair<int,bool>(elemIDs[ks],elemVisibility[ks] != 0));
+					}
+				}
+				else if (dppl->GetParam (string("ViewStateElementCount")+string(dd)))
+				{
+					IntParam *ivs_elemcnt = (IntParam*)dppl->GetParam (string("ViewStateElementCount")+string(dd));
+					int elemtCount=0;
+					if (ivs_elemcnt)
+					{
+						ivs_elemcnt->GetValue (elemtCount);
+						if (totalElementsCount < elemtCount)
+							totalElementsCount = elemtCount;
+					}
+					for (int ks = 0;ks < elemtCount ;ks ++)
+					{
+						bool apply_matrix = true;
+						int vselemId = 0;
+						float matVSElem[16];
+							char cc[30];
+							itoa(int(ks),cc,10);
+							//if (dppl->GetParam (string("ViewStateElementID")+string(dd)+string("-")+string(cc)))
+							{
+								bool res = dppl->GetIntValueByName (string("ViewStateElementID")+string(dd)+string("-")+string(cc),vselemId);
+								if (!res)
+									apply_matrix = false;
+								//IntParam *vselemIdprm = (IntParam*)dppl->GetParam (string("ViewStateElementID")+string(dd)+string("-")+string(cc));
+								//vselemIdprm->GetValue (vselemId);
 
-						{
-							// check if element is a reference or a real file.
-							bool isRef = false;
-							ParamListSharedPtr ppl = ParamList::createFromString (accum);
-							BoolParam *bp = (BoolParam*)ppl->GetParam ("isRef");
-							bp->GetValue (isRef);
-							string ownerModuleForElement = "";
-							if (ppl->GetParam ("OwnerModule"))
+							}
+							if (!dppl->GetFloat16ValueByName ("ViewStateElementLocation" + string ("-")+ string (dd) + string ("-")+ string (cc),matVSElem))
 							{
-								StringParam *ownerModuleParam = (StringParam*)ppl->GetParam ("OwnerModule");
-								ownerModuleParam->GetValue (ownerModuleForElement);
+								apply_matrix = false;
 							}
-							if (ownerModuleForElement != "") 
+							if (apply_matrix)
 							{
-								for (size_t i=0;i<m_modules.size();i++)
-								{
-									if (m_modules[i]->m_name == ownerModuleForElement)
-									{
-										if (ownerModuleForElement == "ImportModule")
-										{
-											if (isRef)
-											{
-												ppl->PushBool ("UpdateDocUI",false);
-												m_modules[i]->HandleAvocadoDocGeneralStringMessage("AddDocInstancedElement",m_id,ppl->SerializeList (),needRepaint);
-											}
-											else
-											{
-												HandleAvocadoDocGeneralStringMessage("AddDocFileElement",m_id,accum,needRepaint);
-											}
-										}
-										else if (ownerModuleForElement == "AnnotationsModule")
-										{
-											HandleAvocadoDocGeneralStringMessage("AddAnnotationElement",m_id,accum,needRepaint);
-										}
-									}
-								}
+								nvmath::Mat44f matElementLoca
+									(matVSElem[0],matVSElem[1],matVSElem[2],matVSElem[3],matVSElem[4],matVSElem[5],matVSElem[6],matVSElem[7],matVSElem[8],
+									matVSElem[9],matVSElem[10],matVSElem[11],matVSElem[12],matVSElem[13],matVSElem[14],matVSElem[15]);
+								nvmath::Trafo matElementLocaTraf;
+								matElementLocaTraf.setMatrix (matElementLoca);
+								matElementLocaTraf.setCenter (nvmath::Vec3f (0.0f,0.0f,0.0f));//
+								new_vs.elementLocation.push_back (pair<int,nvmath::Trafo>(vselemId,matElementLocaTraf));
 							}
-							else
+							if (apply_matrix)
 							{
-								// default . ownder module not found.. should actually raise an error here. but this code is still alive
-								// for bw compatability reasons.
-								if (isRef)
-								{
-									ppl->PushBool ("UpdateDocUI",false);
-									HandleAvocadoDocGeneralStringMessage("AddDocInstancedElement",m_id,ppl->SerializeList (),needRepaint);
-								}
-								else
+								bool vselemVis = true;
+								if (dppl->GetBoolValueByName ("ViewStateElementVisibility" + string ("-")+ string (dd) + string ("-")+ string (cc),vselemVis))
 								{
-									HandleAvocadoDocGeneralStringMessage("AddDocFileElement",m_id,accum,needRepaint);
+										new_vs.elementVisibility.push_back (pair<int,bool>(vselemId,vselemVis));
 								}
 							}
-						}
-						//HandleAvocadoDocGeneralStringMessage("AddDocFileElement",m_id,accum,needRepaint);
-						elStarted = false;
-						accum = "";
 					}
-					else
+				}
+				m_viewStates.push_back(new_vs);
+			}
+			//if (current_view_state >= 0)
+			m_viewStates[0].viewID=0;//current_view_state].viewID = 0;
+		}
+		//end read view states;
+		if (hasLastKey)
+			GetCNVSGDocData()->getIDGenerator()->m_nextID = (unsigned int)lastKey;
+	}
+
+	void AvocadoEngineDoc::CompleteDocLoad (ParamListSharedPtr newParamList, bool hasLocation, float *mat)
+	{
+		GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_DOCUMENT_COMPLETE,"",int (100.0f));
+		if (hasLocation)
+			m_viewList[0]->GetCNVSGViewData()->SetCameraLocation (mat);
+
+		m_nvsgDocData->m_docParams->Clear ();
+//#if 0
+		for (size_t pari = 0;pari < newParamList->GetParamCount(); /*m_nvsgDocData->m_docParams->GetParamCount()*/pari++)
+		{
+			//Param *p = m_nvsgDocData->m_docParams->GetParam (pari);
+			Param *p =  newParamList->GetParam (pari);
+			string paramName;
+			string paramVal;
+			p->GetName(paramName);
+			p->GetValue (paramVal);
+			if (paramName == "backimage" )
+			{
+				ParamListSharedPtr newParam = ParamList::createNew ();
+				newParam->PushString (paramName,paramVal);
+				NotifyDocParamChanged (newParam->SerializeList());
+				bool needRepaint = false;
+				HandleAvocadoDocGeneralStringMessage ("SetDocParam",m_id,newParam->SerializeList (),needRepaint);
+			}
+		}
+//#endif
+		for (size_t pari = 0;pari < newParamList->GetParamCount(); /*m_nvsgDocData->m_docParams->GetParamCount()*/pari++)
+		{
+			//Param *p = m_nvsgDocData->m_docParams->GetParam (pari);
+			Param *p =  newParamList->GetParam (pari);
+			string paramName;
+			string paramVal;
+			p->GetName(paramName);
+			p->GetValue (paramVal);
+			if (paramName == "lightpreset" || paramName == "roomType" ) 
+			{
+				if (paramName == "backimage")
+ 								continue;
+				ParamListSharedPtr newParam = ParamList::createNew ();
+				newParam->PushString (paramName,paramVal);
+				NotifyDocParamChanged (newParam->SerializeList());
+				bool needRepaint = false;
+				HandleAvocadoDocGeneralStringMessage ("SetDocParam",m_id,newParam->SerializeList (),needRepaint);
+			}
+		}
+	
+		for (size_t pari = 0;pari <  newParamList->GetParamCount();/*m_nvsgDocData->m_docParams->GetParamCount();*/pari++)
+		{
+			//Param *p = m_nvsgDocData->m_docParams->GetParam (pari);
+			Param *p =  newParamList->GetParam (pari);
+			string paramName;
+			string paramVal;
+			p->GetName(paramName);
+			p->GetValue (paramVal);
+			if (paramName != "lightpreset" && paramName != "roomType")
+			{
+				if (paramName == "backimage")
+					continue;
+
+			ParamListSharedPtr newParam = ParamList::createNew ();
+			newParam->PushString (paramName,paramVal);
+			NotifyDocParamChanged (newParam->SerializeList());
+			bool needRepaint = false;
+			HandleAvocadoDocGeneralStringMessage ("SetDocParam",m_id,newParam->SerializeList (),needRepaint);
+			}
+		}
+		
+		NotifyViewStateChanged(0);
+		NotifyMaterialStateChanged();
+	}
+
+	void AvocadoEngineDoc::LoadElementBlocks (std::vector<string> &blocks, int totalElementsCount)
+	{
+		if (blocks.empty ())
+			return;
+		std::vector<AvocadoParsedElement> parsed (blocks.size ());
+		AvocadoParseElementsTask task (blocks,parsed);
+		AvocadoWorkerPool::Get ().ParallelFor (blocks.size (),task);
+
+		// the files of the batch are imported at once on the import scheduler, AddDocFileElement takes them in order.
+		for (size_t k=0;k<parsed.size ();k++)
+		{
+			const AvocadoParsedElement &pe = parsed[k];
+			bool needRepaint = false;
+			if (!pe.isRef && (pe.ownerModule == "" || pe.ownerModule == "ImportModule"))
+				HandleAvocadoDocGeneralStringMessage ("PrefetchDocFileElement",m_id,pe.binary,needRepaint);
+		}
+
+		// creating the elements touches the scene graph, it stays here and in document order.
+		const size_t firstNew = m_docElems.size ();
+		const float progressFactor = (totalElementsCount == 1 ? 1.0f : 100.0f);
+		for (size_t k=0;k<parsed.size ();k++)
+		{
+			GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_ELEMENT_STARTED,"",int (progressFactor*float(float(m_docElems.size())/float(totalElementsCount))));
+			const AvocadoParsedElement &pe = parsed[k];
+			bool needRepaint = false;
+			if (pe.ownerModule != "") 
+			{
+				for (size_t i=0;i<m_modules.size();i++)
+				{
+					if (m_modules[i]->m_name == pe.ownerModule)
 					{
-						if (elStarted && docValid)
-							accum += DocLine;
+						if (pe.ownerModule == "ImportModule")
+						{
+							if (pe.isRef)
+								m_modules[i]->HandleAvocadoDocGeneralStringMessage("AddDocInstancedElement",m_id,pe.binary,needRepaint);
+							else
+								HandleAvocadoDocGeneralStringMessage("AddDocFileElement",m_id,pe.binary,needRepaint);
+						}
+						else if (pe.ownerModule == "AnnotationsModule")
+						{
+							HandleAvocadoDocGeneralStringMessage("AddAnnotationElement",m_id,blocks[k],needRepaint);
+						}
 					}
 				}
 			}
+			else
+			{
+				// default . ownder module not found.. should actually raise an error here. but this code is still alive
+				// for bw compatability reasons.
+				if (pe.isRef)
+					HandleAvocadoDocGeneralStringMessage("AddDocInstancedElement",m_id,pe.binary,needRepaint);
+				else
+					HandleAvocadoDocGeneralStringMessage("AddDocFileElement",m_id,pe.binary,needRepaint);
+			}
+			string namefortracing = "";
+			if (m_docElems.size() > 0) 
+				namefortracing = m_docElems[m_docElems.size()-1]->GetName();
+			GetDocInterface()->DocuemntStatusCallback (AvocadoDocInterface::LOAD_ELEMENT_COMPLETE,namefortracing,int(progressFactor*float(float(m_docElems.size())/float(totalElementsCount))));
 		}
-
-		return true;
+		// what was just read from the document file is what it holds.
+		for (size_t i=firstNew;i<m_docElems.size ();i++)
+			if (m_journal.HasElement (m_docElems[i]->GetID ()))
+				m_docElems[i]->MarkSaved ();
+		blocks.clear ();
 	}
 	void AvocadoEngineDoc::ClearViewStates ()
 	{
@@ -983,6 +1534,8 @@ namespace avocado
 	}
 	void AvocadoEngineDoc::PopulateViewStateWithElementLocation (int idx)
 	{
+		// a view state covers every element.
+		LoadPendingElements (m_pendingCount);
 		std::vector<std::pair<int,nvmath::Trafo>> elementLocation;
 		std::vector<std::pair<int,bool>> elementVisibility;
 		std::vector<AvocadoEngineDocElement *>::iterator it = m_docElems.begin ();
@@ -1002,6 +1555,7 @@ namespace avocado
 	}
 	void AvocadoEngineDoc::RestoreElementLocationFromViewState (int idx)
 	{
+		LoadPendingElements (m_pendingCount);
 		int vismask = 1;//~0;
 		int nonvismask = 0;
 //		for (int vid = 0; vid < 8 ; vid++)
@@ -1164,22 +1718,14 @@ namespace avocado
 	}
 	bool AvocadoEngineDocElement::ApplyStateSet (nvsg::StateSetSharedPtr newStateSet, bool cache,bool overwrite,bool convertFFP)
 	{
+		MarkChanged ();
 		if (cache)
 				m_cachedStateSet = newStateSet;
 				
-				NodeSharedPtr root = m_elementRoot;
-				nvutil::SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-				NVSG_ASSERT(st);
-				st->setClassName("class nvsg::GeoNode");
-				st->setBaseClassSearch(true);
-				st->apply( root );
-
-				const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-				std::vector<ObjectWeakPtr>::const_iterator its;
-				for(its=searchResults.begin(); its!=searchResults.end(); its++)
+				const std::vector<GeoNodeSharedPtr> geoNodes = AvocadoSceneQuery ().Find<GeoNode> (m_elementRoot);
+				for (size_t i=0;i<geoNodes.size ();i++)
 				{
-					GeoNodeSharedPtr node(dynamic_cast<GeoNodeWeakPtr>(*its));
-					GeoNodeWriteLock (node)->replaceAllStateSets (newStateSet);			
+					GeoNodeWriteLock (geoNodes[i])->replaceAllStateSets (newStateSet);			
 				}
 				return true;
 	}
@@ -1463,6 +2009,7 @@ namespace avocado
 					if (m_docElems[i]->GetID () == eid)
 					{
 						m_docElems[i]->SetName (newName);
+						m_docElems[i]->MarkChanged ();
 						NotifyElementsChanged ();
 						break;
 					}
@@ -1521,6 +2068,33 @@ namespace avocado
 			OnAddDocElement(&elem);
 			return true;
 		}
+		else if (msg == "LoadPendingElements")
+		{
+			// "int count=n," elements at a time, returns true while some are left.
+			int count = int (s_elementBatchSize);
+			if (paramStr != "")
+				ParamList::createFromString (paramStr)->GetIntValueByName ("count",count);
+			return LoadPendingElements (count > 0 ? size_t (count) : m_pendingCount);
+		}
+		else if (msg == "SaveDocumentJournal")
+		{
+			return SaveDocumentJournal (paramStr);
+		}
+		else if (msg == "ResetDocumentJournal")
+		{
+			m_journal.Reset ();
+			return true;
+		}
+		else if (msg == "SetPackageCompression")
+		{
+			// "publish" before DoCompressDoc packs the document at publish_compression_level, once.
+			m_publishPackage = (paramStr == "publish");
+			return true;
+		}
+		else if (msg == "AutoSaveDocument" || msg == "AutoSaveZippedDocument")
+		{
+			return AutoSaveDocument (paramStr,msg == "AutoSaveZippedDocument");
+		}
 		else if (msg == "NewDocument")
 		{
 			FreeGlobalMaterialCache ();
@@ -1567,6 +2141,7 @@ namespace avocado
 				pair<string,string> newMeta (varname,data);
 				(it)->m_intr.metaData.push_back (newMeta);
 			}
+			(it)->MarkChanged ();
 			//SetElementMetaData (eid,varname,data);
 		} 
 		else if (msg == "DeleteMaterialState")
@@ -2170,11 +2745,14 @@ namespace avocado
 			
 			this->GetDocInterface ()->DocuemntStatusCallback ((AvocadoDocInterface::DocumentStatus)type,filename,prog);
 		}
-		for (size_t i=0;i<m_modules.size();i++)
+		// only the modules that subscribed to the message, in the order they were added.
+		const AvocadoMessageId msgId = AvocadoMessageRegistry::FindMessage (msg);
+		for (size_t i=0;i<m_dispatch.GetHandlerCount (msgId);i++)
 		{
-			// TODO : Send the message to all modules , no break. each module will decide wheather or not to implement its virtual handlers.
 			/* later on , set priorites for each module */
-			if (m_modules[i]->HandleAvocadoDocGeneralStringMessage(msg,docId,paramStr,needRepaint))
+			AvocadoMessageHandler *handler = m_dispatch.GetHandler (msgId,i);
+			AvocadoStatsScope stats (msg,msgId,handler);
+			if (handler->HandleAvocadoDocGeneralStringMessage(msg,docId,paramStr,needRepaint))
 				return true; // Message was handled succsusfully 
 		}
 		{
@@ -2437,6 +3015,11 @@ namespace avocado
 				//m_cachedElement = ret;
 				m_elementHash.insert (std::pair<int,AvocadoEngineDocElement *>(elemId,ret));
 			}
+			else if (LoadPendingElement (elemId))
+			{
+				// not created yet, the id left the pending list so this finds it or gives up.
+				ret = GetDocElementPtrById (elemId);
+			}
 		}
 		return ret;
 	}
@@ -2464,6 +3047,14 @@ namespace avocado
 
 	void AvocadoEngineDoc::OnDeleteDocElement(int elemId)
 	{
+		if (m_journal.HasElement (elemId))
+			m_unsavedRemovals.push_back (elemId);
+		PendingElementHash::iterator pit = m_pendingById.find (elemId);
+		if (pit != m_pendingById.end ())
+		{
+			DropPendingElement (pit->second);
+			return;
+		}
 		std::vector<AvocadoEngineDocElement *>::iterator it = GetDocElementById(elemId);
 		//delete *it;
 		DocElementHasIterator hit= m_elementHash.find ((*it)->GetID());
@@ -2478,6 +3069,7 @@ namespace avocado
 		AvocadoEngineDoc::ClearDocElements ()
 	{
 		NVSG_TRACE();
+		ClearPendingElements ();
 		m_elementHash.clear();
 		vector<AvocadoEngineDocElement*>::iterator elit = m_docElems.begin();
 		size_t orgSize = m_docElems.size();
@@ -2516,7 +3108,10 @@ namespace avocado
 		if (orgSize >0 &&m_docInterface&& (GetDocInterface())->m_isAvailable)
 			NotifyElementsChanged ();
 		m_docElems.clear();
-		
+		m_unsavedRemovals.clear ();
+		m_journal.Reset ();
+		m_packageState = PackageState ();
+		m_autoSave.ClearBlocks ();
 	}
 
 	bool AvocadoEngineDoc::OnSizeView (int id, int px, int py)
@@ -2545,23 +3140,18 @@ namespace avocado
 		if (view->GetViewInterface () != 0 )
 			view->GetViewInterface ()->SelectionChanged (eids);
 	}
-	static bool IsFileUnique (vector<AvocadoFileLinkInterface> &f,AvocadoFileLinkInterface &i)
+	/* names holds every file name f has, so that a scene with thousands of textured elements is not quadratic. */
+	static bool IsFileUnique (std::set<string> &names,AvocadoFileLinkInterface &i)
 	{
-		for (size_t xi=0;xi<f.size();xi++)
-		{
-			if (f[xi].m_fileName == i.m_fileName)
-			{
-				return false;
-			}
-		}
-		return true;
+		return names.insert (i.m_fileName).second;
 	}
 	void AvocadoEngineDoc::NotifyElementsChanged ()
 	{
 		NVSG_TRACE();
 		if (m_docInterface->m_isAvailable)
 		{
-			vector<string> environmentFirst; 
+			std::set<string> environmentFirst; 
+			std::set<string> fileNames;
 			vector<AvocadoFileLinkInterface> f;
 			vector <AvocadoElementInterface> v;
 			for (size_t i=0;i<m_docElems.size();i++)
@@ -2602,7 +3192,7 @@ namespace avocado
 					AvocadoFileLinkInterface tf;
 					tf.m_fileName = bumptextureFile;
 					tf.m_type = AvocadoFileLinkInterface::IMAGE;
-					if (IsFileUnique (f,tf))
+					if (IsFileUnique (fileNames,tf))
 						f.push_back (tf);	
 				}
 				string skintextureFile = m_docElems[i]->m_intr.materialData.skinTex;
@@ -2612,7 +3202,7 @@ namespace avocado
 					AvocadoFileLinkInterface tf;
 					tf.m_fileName = skintextureFile;
 					tf.m_type = AvocadoFileLinkInterface::IMAGE;
-					if (IsFileUnique (f,tf))
+					if (IsFileUnique (fileNames,tf))
 						f.push_back (tf);	
 				}
 				string hairtextureFile = m_docElems[i]->m_intr.materialData.hairTex;
@@ -2622,7 +3212,7 @@ namespace avocado
 					AvocadoFileLinkInterface tff;
 					tff.m_fileName = hairtextureFile;
 					tff.m_type = AvocadoFileLinkInterface::IMAGE;
-					if (IsFileUnique (f,tff))
+					if (IsFileUnique (fileNames,tff))
 						f.push_back (tff);	
 				}
 				string textureFile = m_docElems[i]->m_intr.materialData.textureFilename;
@@ -2631,26 +3221,38 @@ namespace avocado
 					AvocadoFileLinkInterface tf;
 					tf.m_fileName = textureFile;
 					tf.m_type = AvocadoFileLinkInterface::IMAGE;
-					if (IsFileUnique (f,tf))
+					if (IsFileUnique (fileNames,tf))
 						f.push_back (tf);	
 				}
 				string environmentTextureFile = m_docElems[i]->m_intr.materialData.environmentMap;
 				if ( environmentTextureFile!= "")
 				{
-					bool skip = false;
-					for (size_t ie=0;ie<environmentFirst.size();ie++)
-						if (environmentFirst[ie] == environmentTextureFile)
-							skip = true;
-					if (!skip)
+					if (environmentFirst.insert (environmentTextureFile).second)
 					{
 						AvocadoFileLinkInterface tf;
 						tf.m_fileName = environmentTextureFile;
 						tf.m_type = AvocadoFileLinkInterface::IMAGE;
-						environmentFirst.push_back (environmentTextureFile);
+						fileNames.insert (environmentTextureFile);
 						f.push_back (tf);	
 					}
 				}
 			}
+			// elements of a binary document that are not created yet, as its toc lists them.
+			for (size_t k=0;k<m_pendingElements.size ();k++)
+			{
+				if (m_pendingLoaded[k])
+					continue;
+				const AvocadoDocTocEntry &entry = m_pendingDoc.GetEntry (m_pendingElements[k]);
+				AvocadoElementInterface t;
+				t.id = entry.id;
+				t.name = entry.name;
+				t.color[0] = t.color[1] = t.color[2] = 0;
+				t.materialID = 0;
+				t.isVisible = entry.isVisible;
+				t.parentID = (entry.isRef ? entry.parentID : -1);
+				t.elementType = entry.ownerModule;
+				v.push_back (t);
+			}
 			//vector <AvocadoFileLinkInterface> f;
 			// These are model files.. 3ds, nbf, etc'..
 			for (size_t i=0;i<m_files.size();i++)
@@ -2658,7 +3260,7 @@ namespace avocado
 				AvocadoFileLinkInterface t;
 				t.m_fileName = m_files[i].m_fileName;
 				t.m_type = AvocadoFileLinkInterface::MODEL;
-				if (IsFileUnique (f,t))
+				if (IsFileUnique (fileNames,t))
 					f.push_back (t);	
 			}
 			// These are referenced files, i.e textures, bumps maps, environement
@@ -2746,6 +3348,7 @@ namespace avocado
 
 		NVSG_TRACE();
 		m_modules.push_back (module);
+		m_dispatch.AddHandler (module);
 		module->registerModule (m_nvsgDocData->GetScene(),m_nvsgDocData->getIDGenerator(),GetID(),m_sessionFolder);
 	}
 
@@ -2775,6 +3378,7 @@ namespace avocado
 			m_modules[i] = NULL;
 		}
 		m_modules.clear ();
+		m_dispatch.Clear ();
 	}
 
 }
\ No newline at end of file
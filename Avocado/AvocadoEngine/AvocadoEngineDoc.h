@@ -4,6 +4,9 @@
 #pragma once
 #include "AvocadoEngineView.h"
 #include "AvocadoEngineObject.h"
+#include "AvocadoDocStream.h"
+#include "AvocadoAutoSave.h"
+#include "AvocadoArchive.h"
 #include <hash_map>
 
 namespace avocado
@@ -30,6 +33,8 @@ namespace avocado
 	{
 		typedef std::hash_map<int,AvocadoEngineDocElement*> DocElementHash;
     	typedef std::hash_map<int,AvocadoEngineDocElement*>::iterator DocElementHasIterator;
+		// what goes into a package besides the document, see ListPackageItems
+		typedef std::vector<std::pair<std::string,unsigned __int64> > PackageItems;
 
 	public:
 		AvocadoEngineDoc() ;
@@ -51,6 +56,7 @@ namespace avocado
 		void										ClearViewStates();
 		void										ClearMaterialStates ();
 		std::vector<AvocadoEngineView *>::iterator	GetViewById(int id);
+		bool										HasView(int id) { return GetViewById (id) != m_viewList.end (); }
 		int											AddView(); 
 		bool										DeleteView(int id);
 		void										InvokePaintView(int id);
@@ -70,6 +76,21 @@ namespace avocado
 		void										SetDocInterface (AvocadoDocInterface *docInterface) ;
 		void										ClearDocModules ();
 		bool										SerializeDocument (std::string &serializedStr,bool isStoring);
+		// documentFile : the sink is the document file itself, the journal then follows what is written to it.
+		bool										StoreDocument (AvocadoDocSink &sink, bool documentFile = false);
+		bool										SaveDocumentJournal (const std::string &path);
+		// Writes the document to path on the autosave thread, see AvocadoAutoSave. false when the caller has to save it itself.
+		bool										AutoSaveDocument (const std::string &path, bool zipped);
+		ParamListSharedPtr							BuildDocParams ();
+		void										LoadElementBlocks (std::vector<string> &blocks, int totalElementsCount);
+		bool										LoadBinaryDocument (const std::string &bytes);
+		void										ReadDocParams (const std::string &docParams, ParamListSharedPtr &newParamList, float *mat, bool &hasLocation, int &totalElementsCount);
+		void										CompleteDocLoad (ParamListSharedPtr newParamList, bool hasLocation, float *mat);
+		// Elements of a binary document are created on demand, see LoadBinaryDocument. true while some are still pending.
+		bool										LoadPendingElements (size_t maxCount);
+		bool										LoadPendingElement (int elemId);
+		bool										HasPendingElements () const { return m_pendingCount != 0; }
+		void										ClearPendingElements ();
 		bool										InsertFile (std::string filename,AvocadoFileLinkInterface::FileType type,bool embed);
 		bool										RemoveFile (std::string filename);
 		bool										CompressFile (std::string &inpath,std::string &outpath, 
@@ -77,7 +98,7 @@ namespace avocado
 													std::vector<std::string> embeddedModels,
 													std::vector<std::string> embeddedTextures, 
 													bool unzip);
-		bool										isEmpty () { return (m_docElems.size() == 0);}
+		bool										isEmpty () { return (m_docElems.size() == 0 && m_pendingCount == 0);}
 		bool										NotifyDocParamChanged (string paramStr);
 		bool										NotifyViewStateChanged (int vsid);
 		bool										UpdateDocParam (std::string paramStr);
@@ -95,9 +116,40 @@ namespace avocado
 		std::vector<AvocadoMaterialStateData>       m_materialStates;
 		std::vector<AvocadoViewStateData>			m_viewStates;
 		std::vector<AvocadoDocModule *>				m_modules;
+		AvocadoDispatchTable						m_dispatch;
 		std::vector<AvocadoFileLinkInterface>				m_files;
 		std::vector<AnimatedTransformSharedPtr>	m_animationWaitList;
 		DocElementHash                                m_elementHash;
 		std::string									m_sessionFolder;
+		std::string									TakePendingElement (size_t k);
+		void										DropPendingElement (size_t k);
+		AvocadoDocReader							m_pendingDoc;			// the binary document the pending elements come from
+		std::vector<size_t>							m_pendingElements;		// toc entries, in document order
+		std::vector<bool>							m_pendingLoaded;
+		PendingElementHash							m_pendingById;			// element id to m_pendingElements index
+		size_t										m_pendingNext;
+		size_t										m_pendingCount;
+		int											m_pendingTotal;
+		AvocadoDocJournal							m_journal;				// what the document file holds, for SaveDocumentJournal
+		std::vector<int>							m_unsavedRemovals;		// ids removed since, that the file still holds
+		AvocadoAutoSave								m_autoSave;
+		void										UnmountPackage ();
+		AvocadoArchiveSharedPtr						m_package;				// the opened .avc, mounted on the session folder
+		bool										m_publishPackage;		// the next CompressFile is a publish, see SetPackageCompression
+		/* The package CompressFile wrote last with the document file stored at its end, for the next journaled save to
+		   append to. Empty path once the document file was written whole, the package no longer ends with it then. */
+		struct PackageState
+		{
+			PackageState () : docSize (0), fileSize (0), fileTime (0) {}
+
+			std::string								path;
+			std::string								docPath;		// the document file, Main.avc of the package
+			unsigned __int64						docSize;		// of Main.avc
+			unsigned __int64						fileSize;		// of the package, with its write time : nobody wrote it since
+			unsigned __int64						fileTime;
+			PackageItems							items;
+		};
+		bool										AppendToPackage (const std::string &inpath, const std::string &outpath, const PackageItems &items);
+		PackageState								m_packageState;
 	};
 }
\ No newline at end of file
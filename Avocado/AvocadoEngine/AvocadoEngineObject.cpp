@@ -6,6 +6,8 @@
 #include "AvocadoParams.h"
 #include "AvocadoEngineObject.h"
 #include <nvsg/Group.h>
+#include <nvsg/Transform.h>
+#include <cstring>
 #include <nvutil/DbgNew.h>
 namespace avocado
 {
@@ -30,6 +32,7 @@ namespace avocado
 		if (m_intr.isVisible != isVisible)
 		{
 			m_intr.isVisible = isVisible;
+			MarkChanged ();
 			if (m_elementRoot)
 			{
 				int oldtravmask = nvsg::GroupWriteLock (m_elementRoot)->getTraversalMask ();
@@ -43,4 +46,24 @@ namespace avocado
 		}
 		return false;
 	}
+
+	bool AvocadoEngineDocElement::NeedsSave ()
+	{
+		if (m_needsSave)
+			return true;
+		// manipulators move the element root directly.
+		if (m_elementRoot)
+		{
+			nvmath::Mat44f mat = nvsg::TransformReadLock (m_elementRoot)->getMatrix ();
+			return memcmp (mat.getPtr (),m_savedLocation.getPtr (),16 * sizeof (float)) != 0;
+		}
+		return false;
+	}
+
+	void AvocadoEngineDocElement::MarkSaved ()
+	{
+		m_needsSave = false;
+		if (m_elementRoot)
+			m_savedLocation = nvsg::TransformReadLock (m_elementRoot)->getMatrix ();
+	}
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 // Want to avoid nvidia includes here.. no time..
 #include <nvmath/Matnnt.h>
 #include "AvocadoAppInterface.h"
+#include "AvocadoParams.h"
 using namespace std;
 
 namespace nvutil
@@ -92,18 +93,32 @@ namespace avocado
 			m_parentGroupID = -1;
 			m_refDrawableIdx = 0;
 			m_elementRoot = 0;
+			m_needsSave = true;
+			m_revision = 0;
+			m_savedLocation = nvmath::Mat44f (true);
 		}
 		~AvocadoEngineDocElement () {}
 		virtual bool ApplyStateSet (nvsg::StateSetSharedPtr newStateSet, bool cache,bool overwrite,bool convertFFP = false) ;
 		virtual void attachmentMoved (int attID,nvsg::GroupSharedPtr &node,nvsg::SceneSharedPtr &scene) {};
 		virtual void removeFromScene(nvsg::SceneSharedPtr &scene) {};
 		virtual void createScene(nvsg::SceneSharedPtr &scene,std::string sessionFolder,bool skip_optimization = false) {}
-		virtual string serialize() = 0;
+		/* The element state as a list, read where the scene graph lives. Saving turns the lists into text on the worker pool. */
+		virtual ParamListSharedPtr serializeParams () = 0;
+		virtual string serialize() { return serializeParams ()->SerializeList (); }
 		virtual bool  SetVisibility (bool isVisible ) ;
 
 		static	AvocadoEngineDocElement *			GetElementFromParams (string paramStr);
 		static  string								GetParamsFromElement (AvocadoEngineDocElement *e);
 
+		/* Changed since the document file was last written : m_needsSave, or moved away from where it was saved.
+		   Journaled saves write only these. */
+		bool										NeedsSave ();
+		void										MarkSaved ();
+		/* Called by whatever changes what serializeParams gives back (the location is compared on its own).
+		   The revision counts the changes, an autosave snapshot keeps the text of an element while it stays the same. */
+		void										MarkChanged () { m_needsSave = true; m_revision++; }
+		unsigned int								GetRevision () const { return m_revision; }
+
 		nvsg::DrawableSharedPtr m_subDrawable;
 		nvsg::DrawableSharedPtr m_cachedDrawable;
 		nvsg::GroupSharedPtr	m_elementRoot;
@@ -127,6 +142,9 @@ namespace avocado
 		nvsg::StateSetSharedPtr            m_cachedStateSet;
 		std::string                            m_shaderFileName;
 		nvmath::Mat44f							m_lastSavedLocation;
+		bool									m_needsSave;
+		unsigned int							m_revision;
+		nvmath::Mat44f							m_savedLocation;
 
 		// here we keep a list of attached elements for each element.
 		// when the element moves (or something else) it will call attachmentMoved () 
@@ -1,6 +1,11 @@
 #include "AvocadoEngine.h"
 #include "AvocadoScenixAdapter.h"
 #include "AvocadoInternalModules.h"
+#include "AvocadoMessageStats.h"
+#include "AvocadoWorkerPool.h"
+#include "AvocadoImportScheduler.h"
+#include "AvocadoSceneCache.h"
+#include "AvocadoGeometryPool.h"
 
 #include <nvui/SceneRenderer.h>
 #include <nvgl/SceneRendererGL2.h>
@@ -36,6 +41,70 @@ void AvocadoEngine::AvocadoInitDefaultOptions ()
 			opt.UIType = AvocadoOption::CHECKBOX;
 			pages[curPage].options.push_back (opt);
 		}
+		{
+			AvocadoOption opt;
+			opt.Name = "lazy_element_loading";
+			opt.Label = "Create elements of binary documents in the background";
+			opt.Description = "The document opens with its element list, the elements are created when idle or when first used";
+			opt.valueBool = true;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "import_in_background";
+			opt.Label = "Import models in the background";
+			opt.Description = "Imported files are loaded and optimized on a separate thread, the application stays usable meanwhile";
+			opt.valueBool = true;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "import_threads";
+			opt.Label = "Import threads";
+			opt.Description = "Files imported at once, when opening documents and importing several models, 0 is one per core";
+			opt.valueInt = 0;
+			opt.Type = AvocadoOption::INT;
+			opt.UIType = AvocadoOption::SPINBOX;
+			opt.scrollMax = 64;
+			opt.scrollMin = 0;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "scene_cache";
+			opt.Label = "Keep optimized models between sessions";
+			opt.Description = "Imported models are stored optimized, opening them again skips the optimization";
+			opt.valueBool = true;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "scene_cache_size_mb";
+			opt.Label = "Optimized models cache size (MB)";
+			opt.Description = "The models used least recently are removed past it";
+			opt.valueInt = 2048;
+			opt.Type = AvocadoOption::INT;
+			opt.UIType = AvocadoOption::SPINBOX;
+			opt.scrollMax = 65536;
+			opt.scrollMin = 0;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "share_geometry";
+			opt.Label = "Share identical geometry between models";
+			opt.Description = "Parts found again in imported models, like the bolts of an assembly, use the vertex data already loaded";
+			opt.valueBool = true;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
 		
 		// NEW PAGE -----------------------------
 		curPage++;
@@ -60,6 +129,82 @@ void AvocadoEngine::AvocadoInitDefaultOptions ()
 			opt.UIType = AvocadoOption::CHECKBOX;
 			pages[curPage].options.push_back (opt);
 		}
+		{
+			AvocadoOption opt;
+			opt.Name = "binary_documents";
+			opt.Label = "Save documents in the binary format";
+			opt.Description = "Indexed binary documents open faster, older versions only read the text format";
+			opt.valueBool = true;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "journaled_save";
+			opt.Label = "Save only what changed";
+			opt.Description = "Saving a binary document appends the changed elements to it and to its package instead of writing them again";
+			opt.valueBool = true;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "journal_compaction_saves";
+			opt.Label = "Saves before a full save";
+			opt.Description = "The document is written again after this many appending saves";
+			opt.valueInt = 32;
+			opt.Type = AvocadoOption::INT;
+			opt.UIType = AvocadoOption::SPINBOX;
+			opt.scrollMax = 1000;
+			opt.scrollMin = 1;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "background_autosave";
+			opt.Label = "Autosave in the background";
+			opt.Description = "Autosave writes the document on a thread of its own, the document stays usable meanwhile";
+			opt.valueBool = true;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "save_compression_level";
+			opt.Label = "Package compression when saving";
+			opt.Description = "Deflate level of saved and autosaved documents, 1 is the fastest, 9 the smallest, 0 does not compress";
+			opt.valueInt = 3;
+			opt.Type = AvocadoOption::INT;
+			opt.UIType = AvocadoOption::SPINBOX;
+			opt.scrollMax = 9;
+			opt.scrollMin = 0;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "publish_compression_level";
+			opt.Label = "Package compression when publishing";
+			opt.Description = "Deflate level of published documents, 1 is the fastest, 9 the smallest, 0 does not compress";
+			opt.valueInt = 9;
+			opt.Type = AvocadoOption::INT;
+			opt.UIType = AvocadoOption::SPINBOX;
+			opt.scrollMax = 9;
+			opt.scrollMin = 0;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "store_incompressible_assets";
+			opt.Label = "Do not compress what is compressed already";
+			opt.Description = "Jpeg, png, hdr.. files that deflating would not make smaller are stored in the package as they are";
+			opt.valueBool = true;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
 		{
 			AvocadoOption opt;
 			opt.Name = "use_optix_for_image_export";
@@ -177,6 +322,48 @@ void AvocadoEngine::AvocadoInitDefaultOptions ()
 			opt.listValueNames.push_back ("Medium");
 			pages[curPage].options.push_back (opt);
 		}
+		{
+			AvocadoOption opt;
+			opt.Name = "queued_messages";
+			opt.Label = "Queue view input, one repaint per frame";
+			opt.Description = "Mouse moves and camera notifications are merged and handled once per frame";
+			opt.valueBool = false;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "engine_stats";
+			opt.Label = "Collect message latency statistics";
+			opt.Description = "Time every message and module, see the GetEngineStats and DumpEngineStats messages";
+			opt.valueBool = false;
+			opt.Type = AvocadoOption::BOOL;
+			opt.UIType = AvocadoOption::CHECKBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "record_messages_file";
+			opt.Label = "Record the session to";
+			opt.Description = "Every engine call is written to this file on start up, replay it with AvocadoReplay";
+			opt.valueString = "";
+			opt.Type = AvocadoOption::STRING;
+			opt.UIType = AvocadoOption::EDITBOX;
+			pages[curPage].options.push_back (opt);
+		}
+		{
+			AvocadoOption opt;
+			opt.Name = "worker_threads";
+			opt.Label = "Worker threads";
+			opt.Description = "Threads used to write, parse and zip documents, 0 is one per core";
+			opt.valueInt = 0;
+			opt.Type = AvocadoOption::INT;
+			opt.UIType = AvocadoOption::SPINBOX;
+			opt.scrollMax = 64;
+			opt.scrollMin = 0;
+			pages[curPage].options.push_back (opt);
+		}
 
 		m_optionStructure.name = "Avocado Engine Options";
 		for (size_t K=0;K < numOfPages;K++)
@@ -337,6 +524,21 @@ bool AvocadoEngine::SetAvocadoOption (std::string optionName,void *value, Avocad
 		   }
 		}
 		
+		if (optionName == "queued_messages" && type == AvocadoOption::BOOL)
+			SetQueuedMessages (*((bool*)value));
+		if (optionName == "engine_stats" && type == AvocadoOption::BOOL)
+			AvocadoMessageStats::SetEnabled (*((bool*)value));
+		if (optionName == "worker_threads" && type == AvocadoOption::INT)
+			AvocadoWorkerPool::Get ().SetThreadCount (*((int*)value));
+		if (optionName == "import_threads" && type == AvocadoOption::INT)
+			AvocadoImportScheduler::Get ().SetThreadCount (*((int*)value));
+		if (optionName == "scene_cache" && type == AvocadoOption::BOOL)
+			AvocadoSceneCache::Get ().SetEnabled (*((bool*)value));
+		if (optionName == "scene_cache_size_mb" && type == AvocadoOption::INT)
+			AvocadoSceneCache::Get ().SetMaxBytes ((unsigned __int64)(*((int*)value)) * 1024 * 1024);
+		if (optionName == "share_geometry" && type == AvocadoOption::BOOL)
+			AvocadoGeometryPool::Get ().SetEnabled (*((bool*)value));
+
 		bool needRepaint;
 		if (this->GetActiveDoc())
 		  HandleAvocadoDocGeneralStringMessage ("AvocadoOptionChanged",this->GetActiveDoc()->GetID(),plmsg->SerializeList(),needRepaint);
@@ -3,6 +3,7 @@
 /* --------------------------------*/
 #include "AvocadoEngineView.h"
 #include "AvocadoScenixAdapter.h"
+#include "AvocadoMessageStats.h"
 #include <nvgl/SceneRendererGL2.h>
 #include <nvgl/RenderTargetGLFBO.h>
 #include "AvocadoInternalModules.h"
@@ -29,9 +30,11 @@ namespace avocado
 
 	bool AvocadoEngineView::HandleAvocadoMouseStringMessage (AvcMouseActType msg, int viewId, int x, int y, int zDelta, bool &needRepaint)
 	{
-		for (size_t i=0;i<m_modules.size();i++)
+		for (size_t i=0;i<m_dispatch.GetMouseHandlerCount (msg);i++)
 		{
-			m_modules[i]->HandleAvocadoMouseStringMessage(msg,viewId,x,y,zDelta,needRepaint);
+			AvocadoMessageHandler *handler = m_dispatch.GetMouseHandler (msg,i);
+			AvocadoStatsScope stats (msg,handler);
+			handler->HandleAvocadoMouseStringMessage(msg,viewId,x,y,zDelta,needRepaint);
 		}
 		return true;
 	}
@@ -125,11 +128,14 @@ namespace avocado
 
 			m_nvsgViewData->SaveContextToFile (filename,width,height,true,false);//forceOptix);
 		}
-		for (size_t i=0;i<m_modules.size();i++)
+		// only the modules that subscribed to the message, in the order they were added.
+		const AvocadoMessageId msgId = AvocadoMessageRegistry::FindMessage (msg);
+		for (size_t i=0;i<m_dispatch.GetHandlerCount (msgId);i++)
 		{
-			// TODO : Send the message to all modules , no break. each module will decide wheather or not to implement its virtual handlers.
 			/* later on , set priorites for each module */
-			ret = m_modules[i]->HandleAvocadoViewGeneralStringMessage(msg,viewId,paramStr,needRepaint);
+			AvocadoMessageHandler *handler = m_dispatch.GetHandler (msgId,i);
+			AvocadoStatsScope stats (msg,msgId,handler);
+			ret = handler->HandleAvocadoViewGeneralStringMessage(msg,viewId,paramStr,needRepaint);
 			if (ret)
 				break; // Message was handled succsusfully 
 		}
@@ -140,6 +146,7 @@ namespace avocado
 	AvocadoEngineView::AddViewModule (AvocadoViewModule *module)
 	{
 		m_modules.push_back (module);
+		m_dispatch.AddHandler (module);
 		module->registerModule (m_nvsgViewData->GetFrontViewState(),m_nvsgViewData->GetViewState(),m_nvsgViewData->m_renderTargetGL,m_nvsgViewData->m_sceneRendererGL2,m_nvsgViewData->m_renderContextGL,m_nvsgViewData->m_sceneRendererRT,m_nvsgViewData->m_renderContextRT,GetID());
 	}
 
@@ -178,5 +185,6 @@ namespace avocado
 			m_modules[i] = NULL;
 		}
 		m_modules.clear ();
+		m_dispatch.Clear ();
 	}
 }
\ No newline at end of file
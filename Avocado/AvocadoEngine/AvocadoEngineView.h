@@ -29,6 +29,7 @@ namespace avocado
 		CNVSGViewData						*m_nvsgViewData;
 		AvocadoViewInterface				*m_viewInterface;
 		std::vector<AvocadoViewModule*>		m_modules;
+		AvocadoDispatchTable				m_dispatch;
 		
 	};
 }
\ No newline at end of file
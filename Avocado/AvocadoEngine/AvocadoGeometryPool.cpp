@@ -0,0 +1,222 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoGeometryPool.h"
+#include "AvocadoSceneQuery.h"
+#include "AvocadoArchive.h"
+#include <nvsg/Primitive.h>
+#include <nvsg/VertexAttributeSet.h>
+#include <nvsg/IndexSet.h>
+#include <nvsg/Types.h>
+#include <hash_map>
+#include <vector>
+
+using namespace nvsg;
+
+namespace avocado
+{
+	typedef std::hash_map<unsigned __int64,std::vector<VertexAttributeSetSharedPtr> > VertexSetBuckets;
+	typedef std::hash_map<unsigned __int64,std::vector<IndexSetSharedPtr> > IndexSetBuckets;
+
+	static void AppendGeometryBytes (std::string &bytes, const void *data, size_t size)
+	{
+		bytes.append ((const char*)data,size);
+	}
+
+	/* Positions and normals, what tells two meshes apart. The rest of the set is compared when the hash meets. */
+	static unsigned __int64 HashVertexSet (const VertexAttributeSet *set)
+	{
+		std::string bytes;
+		const unsigned int attribs[2] = { VertexAttributeSet::NVSG_POSITION, VertexAttributeSet::NVSG_NORMAL };
+		for (int a=0;a<2;a++)
+		{
+			const unsigned int header[3] = { set->getTypeOfVertexData (attribs[a]), set->getSizeOfVertexData (attribs[a]), set->getNumberOfVertexData (attribs[a]) };
+			AppendGeometryBytes (bytes,header,sizeof (header));
+			if (header[0] != NVSG_FLOAT || header[1] != 3)
+				continue;
+			bytes.reserve (bytes.size () + header[2] * sizeof (nvmath::Vec3f));
+			Buffer::ConstIterator<nvmath::Vec3f>::Type it = a == 0 ? set->getVertices () : set->getNormals ();
+			for (unsigned int i=0;i<header[2];i++,++it)
+				AppendGeometryBytes (bytes,&(*it)[0],sizeof (nvmath::Vec3f));
+		}
+		return AvocadoArchiveBlobs::ContentHash (bytes.data (),bytes.size ());
+	}
+
+	static unsigned __int64 VertexSetBytes (const VertexAttributeSet *set)
+	{
+		unsigned __int64 bytes = 0;
+		for (unsigned int a=0;a<VertexAttributeSet::NVSG_VERTEX_ATTRIB_COUNT;a++)
+		{
+			const unsigned int count = set->getNumberOfVertexData (a);
+			if (count)
+				bytes += (unsigned __int64)count * set->getSizeOfVertexData (a) * sizeOfType (set->getTypeOfVertexData (a));
+		}
+		return bytes;
+	}
+
+	static unsigned __int64 IndexSetBytes (const IndexSet *set)
+	{
+		return (unsigned __int64)set->getNumberOfIndices () * sizeOfType (set->getIndexDataType ());
+	}
+
+	static unsigned __int64 HashIndexSet (const IndexSet *set)
+	{
+		const unsigned int header[3] = { set->getIndexDataType (), set->getNumberOfIndices (), set->getPrimitiveRestartIndex () };
+		std::string bytes ((const char*)header,sizeof (header));
+		const size_t size = (size_t)IndexSetBytes (set);
+		if (size)
+		{
+			bytes.resize (sizeof (header) + size);
+			set->getData (&bytes[sizeof (header)]);
+		}
+		return AvocadoArchiveBlobs::ContentHash (bytes.data (),bytes.size ());
+	}
+
+	/* Drops the entries only the pool holds on to. */
+	template <class Buckets>
+	static void PruneGeometryBuckets (Buckets &buckets)
+	{
+		for (typename Buckets::iterator it = buckets.begin ();it != buckets.end ();)
+		{
+			for (size_t i=it->second.size ();i-- > 0;)
+			{
+				if (!it->second[i]->isShared ())
+					it->second.erase (it->second.begin () + i);
+			}
+			if (it->second.empty ())
+				it = buckets.erase (it);
+			else
+				++it;
+		}
+	}
+
+	struct AvocadoGeometryPool::Impl
+	{
+		Impl () : m_enabled (true), m_sharedBytes (0) {}
+
+		VertexAttributeSetSharedPtr FindVertexSet (const VertexAttributeSetSharedPtr &vas)
+		{
+			VertexAttributeSetReadLock set (vas);
+			// an animated set changes per frame, it is the element's own.
+			if (set->getObjectCode () != OC_VERTEX_ATTRIBUTE_SET)
+				return vas;
+			std::vector<VertexAttributeSetSharedPtr> &bucket = m_vertexSets[HashVertexSet (set)];
+			for (size_t i=0;i<bucket.size ();i++)
+			{
+				if (bucket[i] == vas)
+					return vas;
+				if (VertexAttributeSetReadLock (bucket[i])->isEquivalent ((const VertexAttributeSet*)set,true,true))
+				{
+					m_sharedBytes += VertexSetBytes (set);
+					return bucket[i];
+				}
+			}
+			bucket.push_back (vas);
+			return vas;
+		}
+
+		IndexSetSharedPtr FindIndexSet (const IndexSetSharedPtr &iset)
+		{
+			IndexSetReadLock set (iset);
+			std::vector<IndexSetSharedPtr> &bucket = m_indexSets[HashIndexSet (set)];
+			for (size_t i=0;i<bucket.size ();i++)
+			{
+				if (bucket[i] == iset)
+					return iset;
+				if (IndexSetReadLock (bucket[i])->isEquivalent ((const IndexSet*)set,true))
+				{
+					m_sharedBytes += IndexSetBytes (set);
+					return bucket[i];
+				}
+			}
+			bucket.push_back (iset);
+			return iset;
+		}
+
+		bool							m_enabled;
+		unsigned __int64				m_sharedBytes;
+		VertexSetBuckets				m_vertexSets;		// by HashVertexSet
+		IndexSetBuckets					m_indexSets;		// by HashIndexSet
+	};
+
+	AvocadoGeometryPool::AvocadoGeometryPool () : m_impl (new Impl ())
+	{
+	}
+
+	AvocadoGeometryPool& AvocadoGeometryPool::Get ()
+	{
+		// never destroyed, Clear releases the sets before SceniX goes.
+		static AvocadoGeometryPool *s_pool = new AvocadoGeometryPool ();
+		return *s_pool;
+	}
+
+	void AvocadoGeometryPool::SetEnabled (bool enabled)
+	{
+		m_impl->m_enabled = enabled;
+	}
+
+	bool AvocadoGeometryPool::IsEnabled () const
+	{
+		return m_impl->m_enabled;
+	}
+
+	void AvocadoGeometryPool::Share (const NodeSharedPtr &root)
+	{
+		if (!m_impl->m_enabled || !root)
+			return;
+		// a set the loader already shares between primitives of the model is looked up once.
+		std::hash_map<const void*,VertexAttributeSetSharedPtr> vertexSets;
+		std::hash_map<const void*,IndexSetSharedPtr> indexSets;
+		const std::vector<PrimitiveSharedPtr> primitives = AvocadoSceneQuery ().Find<Primitive> (root);
+		for (size_t i=0;i<primitives.size ();i++)
+		{
+			PrimitiveWriteLock primitive (primitives[i]);
+			const VertexAttributeSetSharedPtr vas = primitive->getVertexAttributeSet ();
+			if (vas)
+			{
+				std::hash_map<const void*,VertexAttributeSetSharedPtr>::iterator it = vertexSets.find (vas.get ());
+				if (it == vertexSets.end ())
+					it = vertexSets.insert (std::make_pair ((const void*)vas.get (),m_impl->FindVertexSet (vas))).first;
+				if (it->second != vas)
+					primitive->setVertexAttributeSet (it->second);
+			}
+			const IndexSetSharedPtr iset = primitive->getIndexSet ();
+			if (iset)
+			{
+				std::hash_map<const void*,IndexSetSharedPtr>::iterator it = indexSets.find (iset.get ());
+				if (it == indexSets.end ())
+					it = indexSets.insert (std::make_pair ((const void*)iset.get (),m_impl->FindIndexSet (iset))).first;
+				if (it->second != iset)
+					primitive->setIndexSet (it->second);
+			}
+		}
+	}
+
+	void AvocadoGeometryPool::Prune ()
+	{
+		PruneGeometryBuckets (m_impl->m_vertexSets);
+		PruneGeometryBuckets (m_impl->m_indexSets);
+	}
+
+	void AvocadoGeometryPool::Clear ()
+	{
+		m_impl->m_vertexSets.clear ();
+		m_impl->m_indexSets.clear ();
+		m_impl->m_sharedBytes = 0;
+	}
+
+	size_t AvocadoGeometryPool::GetSetCount () const
+	{
+		size_t count = 0;
+		for (VertexSetBuckets::const_iterator it = m_impl->m_vertexSets.begin ();it != m_impl->m_vertexSets.end ();++it)
+			count += it->second.size ();
+		for (IndexSetBuckets::const_iterator it = m_impl->m_indexSets.begin ();it != m_impl->m_indexSets.end ();++it)
+			count += it->second.size ();
+		return count;
+	}
+
+	unsigned __int64 AvocadoGeometryPool::GetSharedBytes () const
+	{
+		return m_impl->m_sharedBytes;
+	}
+}
@@ -0,0 +1,37 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include <nvsg/Object.h>
+
+namespace avocado
+{
+	/* The vertex and index data of every imported model, each content loaded once. An assembly brings the same
+	   bolt hundreds of times, often the same file imported again : Share gives the primitives of an element root
+	   the VertexAttributeSet and IndexSet already loaded when their positions, normals and indices hash the same
+	   and the sets compare equal. Only the sets are shared, every GeoNode keeps its own transform above it and its
+	   own state sets. Animated vertex sets are left alone. Main thread only, as the scene is. */
+	class AvocadoGeometryPool
+	{
+	public:
+		static AvocadoGeometryPool&		Get ();
+
+		void							SetEnabled (bool enabled);
+		bool							IsEnabled () const;
+
+		/* Replaces the sets of the primitives under root by the equal ones of the pool, adds the new ones. */
+		void							Share (const nvsg::NodeSharedPtr &root);
+		/* Drops the sets no primitive uses any more, called as elements are removed. */
+		void							Prune ();
+		void							Clear ();
+
+		size_t							GetSetCount () const;
+		/* The bytes of vertex and index data not loaded twice since the last Clear. */
+		unsigned __int64				GetSharedBytes () const;
+	private:
+		AvocadoGeometryPool ();
+
+		struct Impl;
+		Impl							*m_impl;
+	};
+}
@@ -0,0 +1,57 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoImportJob.h"
+#include "AvocadoImportModule.h"
+
+using namespace nvsg;
+
+namespace avocado
+{
+	AvocadoImportJob::AvocadoImportJob (const std::string &fileName, const std::string &sessionFolder, bool skipOptimization, bool flipYZ)
+		: m_fileName (fileName), m_sessionFolder (sessionFolder), m_skipOptimization (skipOptimization), m_flipYZ (flipYZ)
+	{
+	}
+
+	AvocadoImportJob::~AvocadoImportJob ()
+	{
+		Finish ();
+	}
+
+	/* The same stages as AvocadoEngineDocFileElement::createScene, the progress is a rough share of the work each takes. */
+	AvocadoImportJob::Result AvocadoImportJob::Run ()
+	{
+		SceneSharedPtr fileScene;
+		std::string cacheKey;
+		if (!m_skipOptimization && AvocadoEngineDocFileElement::loadCachedFileScene (m_fileName,m_sessionFolder,m_flipYZ,fileScene,cacheKey))
+			SetProgress (90);
+		else
+		{
+			if (!AvocadoEngineDocFileElement::loadFileScene (m_fileName,m_sessionFolder,fileScene))
+				return IMPORT_FAILED;
+			SetProgress (60);
+			if (IsCancelled ())
+				return IMPORT_CANCELLED;
+			if (!m_skipOptimization)
+			{
+				AvocadoEngineDocFileElement::optimizeFileScene (fileScene);
+				SetProgress (75);
+				if (IsCancelled ())
+					return IMPORT_CANCELLED;
+				AvocadoEngineDocFileElement::convertFileScene (fileScene,m_flipYZ);
+				AvocadoEngineDocFileElement::storeCachedFileScene (cacheKey,fileScene);
+				SetProgress (90);
+				if (IsCancelled ())
+					return IMPORT_CANCELLED;
+			}
+		}
+		m_elementRoot = AvocadoEngineDocFileElement::prepareElementRoot (fileScene);
+		SetProgress (100);
+		if (IsCancelled ())
+		{
+			m_elementRoot = GroupSharedPtr ();
+			return IMPORT_CANCELLED;
+		}
+		return m_elementRoot ? IMPORT_SUCCEEDED : IMPORT_FAILED;
+	}
+}
@@ -0,0 +1,36 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include "AvocadoEngineObject.h"
+#include "AvocadoImportScheduler.h"
+#include <memory>
+#include <string>
+
+namespace avocado
+{
+	/* Imports a model file on the import scheduler : the file is loaded into a private scene, optimized, converted to
+	   CgFX and its drawables named under an element root that nothing else sees yet. Attaching that root under the
+	   document scene is left to the engine thread, which polls the job (see the import module PollImportJobs) or
+	   waits for it when it loads a document. */
+	class AvocadoImportJob : public AvocadoImportTask
+	{
+	public:
+		AvocadoImportJob (const std::string &fileName, const std::string &sessionFolder, bool skipOptimization, bool flipYZ);
+		/* Cancels the import and waits for it. */
+		~AvocadoImportJob ();
+
+		/* The element root, with the file scene under it. Good once the job is done and succeeded. */
+		nvsg::GroupSharedPtr		GetElementRoot () const { return m_elementRoot; }
+		const std::string&			GetFileName () const { return m_fileName; }
+	protected:
+		virtual Result				Run ();
+	private:
+		std::string					m_fileName;
+		std::string					m_sessionFolder;
+		bool						m_skipOptimization;
+		bool						m_flipYZ;
+		nvsg::GroupSharedPtr		m_elementRoot;		// the scheduler thread owns it until the job is done
+	};
+	typedef std::shared_ptr<AvocadoImportJob> AvocadoImportJobSharedPtr;
+}
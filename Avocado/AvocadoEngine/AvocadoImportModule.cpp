@@ -15,8 +15,13 @@
 #include <nvutil\Trace.h>
 #include <nvutil/Tools.h>
 #include "AvocadoMaterials.h"
+#include "AvocadoArchive.h"
+#include "AvocadoSceneCache.h"
+#include "AvocadoSceneQuery.h"
+#include "AvocadoGeometryPool.h"
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 using namespace nvmath;
 using namespace nvsg;
 namespace avocado
@@ -42,6 +47,16 @@ namespace avocado
 		m_children.clear();
 	}
 
+	/* The traversal mask of every drawable of the element, through the children of a group. */
+	void AvocadoEngineDocFileElement::setDrawablesTraversalMask (int mask)
+	{
+		for (size_t ch=0;ch<m_children.size ();ch++)
+			m_children[ch]->setDrawablesTraversalMask (mask);
+		const std::vector<AvocadoElementDrawable> &drawables = m_sceneIndex.GetDrawables ();
+		for (size_t i=0;i<drawables.size ();i++)
+			DrawableWriteLock(drawables[i].drawable)->setTraversalMask (mask);
+	}
+
 	bool AvocadoImport::deserializeMaterial (ParamListSharedPtr &ppl,AvocadoMaterialInterface *materialData)
 	{
 			// Note that deserialize is  done in the module  whlile serialization is performed in the element class.. 
@@ -94,12 +109,18 @@ namespace avocado
 
 			if (!m_isGroup)
 			{
-				bool result = AvocadoEngineDocElement::ApplyStateSet ( newStateSet,(cache || level == 1),false);
-				if (result && convertFFP)
+				// what AvocadoEngineDocElement::ApplyStateSet does, over the indexed GeoNodes.
+				MarkChanged ();
+				if (cache || level == 1)
+					m_cachedStateSet = newStateSet;
+				const std::vector<GeoNodeSharedPtr> &geoNodes = m_sceneIndex.GetGeoNodes ();
+				for (size_t i=0;i<geoNodes.size ();i++)
+					GeoNodeWriteLock (geoNodes[i])->replaceAllStateSets (newStateSet);
+				if (convertFFP)
 				{
 					nvutil::convertFFPToCGFXNode (nvutil::sharedPtr_cast<Node>(m_elementRoot));
 				}
-				return (result);
+				return true;
 				//elmtPtr->ApplyStateSet (newStateSet,(level == 1),convertFFP);
 			}
 			else
@@ -160,7 +181,7 @@ namespace avocado
 		}
 	}
 #endif
-	string AvocadoEngineDocFileElement::serialize()
+	ParamListSharedPtr AvocadoEngineDocFileElement::serializeParams ()
 	{
 		//string res = "filename=" + m_fileName + ";";
 
@@ -245,7 +266,7 @@ namespace avocado
 			m_lastSavedLocation = mat;
 		}
 		
-		return (ppl->SerializeList ());
+		return ppl;
 		//return (m_fileName);
 	}
 		bool AvocadoEngineDocFileElement::addToGroup (SceneSharedPtr &scene,std::vector<AvocadoEngineDocFileElement*>	&children)
@@ -257,6 +278,7 @@ namespace avocado
 
 			m_children.push_back ( children[kc] );
 			}
+			MarkChanged ();
 
 
 			NodeSharedPtr root = SceneWriteLock(scene)->getRootNode();
@@ -443,22 +465,7 @@ namespace avocado
 		GroupWriteLock (root)->addChild(NewGroupTop);
 		m_elementRoot = NewGroupTop;
 		
-		NodeSharedPtr newRoot = NewGroupTop;
-		nvutil::SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-		NVSG_ASSERT(st);
-		st->setClassName("class nvsg::Drawable");
-		st->setBaseClassSearch(true);
-		st->apply ( newRoot );
-				
-		const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-		std::vector<ObjectWeakPtr>::const_iterator it;
-		for(it=searchResults.begin(); it!=searchResults.end(); it++)
-		{
-			//DrawableWeakPtr node = static_cast<GeoNodeWeakPtr>(*it);
-			DrawableSharedPtr node(dynamic_cast<DrawableWeakPtr>(*it));
-			
-			DrawableWriteLock(node)->setTraversalMask (mask);
-		}
+		setDrawablesTraversalMask (mask);
 
 		return true;
 		//GroupWriteLock (root)->addChild (newGroup);
@@ -507,41 +514,20 @@ namespace avocado
 			return false;
 		DrawableSharedPtr orgchild =  el->m_cachedDrawable;
 		NodeSharedPtr root = SceneWriteLock(scene)->getRootNode();
-		NodeSharedPtr searchRoot;
-		if (el->m_elementRoot)
-				//root = nvutil::sharedPtr_cast<nvsg::Node>(el->m_elementRoot);
-					searchRoot = el->m_elementRoot;
-				else
-				{
-					searchRoot = root;
-					// shoult not reach here..assert or something..
-				}
 		//if (geoName != string ("new"))
 		{
 			// search the original item. we are here when loading from file.
-				nvutil::SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-				NVSG_ASSERT(st);
-				st->setClassName("class nvsg::GeoNode");
-				st->setBaseClassSearch(true);
-
-				if (geoName != string ("new"))
-					st->setObjectName (geoName);
-				else
+				std::string searchName = geoName;
+				if (geoName == string ("new"))
 				{
-					DrawableReadLock (orgchild)->ownersBegin ();
 					Drawable::OwnerIterator ixt = DrawableWriteLock(orgchild)->ownersBegin();
 					ObjectWeakPtr objxx = DrawableWriteLock(orgchild)->getOwner(ixt);
-					st->setObjectName (GeoNodeReadLock(objxx)->getName ());
+					searchName = GeoNodeReadLock(objxx)->getName ();
 				}
-				st->setTraversalMask (~0);
-				st->apply( searchRoot );
-
-				const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-				std::vector<ObjectWeakPtr>::const_iterator it;
-				for(it=searchResults.begin(); it!=searchResults.end(); it++)
+				const std::vector<GeoNodeSharedPtr> *searchResults = el->m_sceneIndex.FindGeoNodes (searchName);
+				for(size_t it=0; searchResults && it<searchResults->size (); it++)
 				{
-					//DrawableWeakPtr node = static_cast<GeoNodeWeakPtr>(*it);
-					GeoNodeSharedPtr resnode(dynamic_cast<GeoNodeWeakPtr>(*it));
+					GeoNodeSharedPtr resnode((*searchResults)[it]);
 					
 
 					if (GeoNodeReadLock (resnode)->getNumberOfStateSets ())
@@ -724,6 +710,7 @@ namespace avocado
 
 		// end scale to scene
 			GeoNodeWriteLock (orgParent)->removeDrawable (orgchild);
+			el->m_sceneIndex.RemoveDrawable (orgchild);
 			if (GeoNodeReadLock(orgParent)->getNumberOfDrawables () == 0)
 			{
 				// geo node is empty.. we must emove it or optix goes crazy.. thank the good lord for catching this bug :).
@@ -747,6 +734,7 @@ namespace avocado
 		TransformWriteLock (root)->addChild(elementRoot);
 		m_elementRoot = elementRoot;
 		TransformWriteLock(elementRoot)->setTraversalMask (1);
+		m_sceneIndex.Build (m_elementRoot);
 		return true;
 	}
 	void AvocadoEngineDocFileElement::setLocation (float *mat,bool updateLastSaved)
@@ -757,41 +745,39 @@ namespace avocado
 			mmat[j][i] = mat[i+4*j];
 		if (updateLastSaved)
 			m_lastSavedLocation = mmat;
+		MarkChanged ();
 		TransformWriteLock (m_elementRoot)->setMatrix (mmat );//* TransformWriteLock (m_elementRoot)->getMatrix ());
 	}
 	void AvocadoEngineDocFileElement::removeGeoNodes (vector<string> geonodes)
 	{
 		for (size_t i_geo = 0;i_geo < geonodes.size ();i_geo++)
 		{
-				NodeSharedPtr root = this->m_elementRoot;
-				nvutil::SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-				NVSG_ASSERT(st);
-				st->setClassName("class nvsg::GeoNode");
-				st->setBaseClassSearch(true);
-				st->setObjectName (geonodes[i_geo]);
-				st->apply( root );
-
-				const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-				std::vector<ObjectWeakPtr>::const_iterator it;
-				for(it=searchResults.begin(); it!=searchResults.end(); it++)
+				const std::vector<GeoNodeSharedPtr> *found = m_sceneIndex.FindGeoNodes (geonodes[i_geo]);
+				if (!found)
+					continue;
+				// a copy, the index lets go of them as they go.
+				const std::vector<GeoNodeSharedPtr> searchResults (*found);
+				for(size_t it=0; it<searchResults.size(); it++)
 				{
-					//DrawableWeakPtr node = static_cast<GeoNodeWeakPtr>(*it);
-					GeoNodeSharedPtr resnode(dynamic_cast<GeoNodeWeakPtr>(*it));
+					GeoNodeSharedPtr resnode(searchResults[it]);
 					GroupWeakPtr gg = GeoNodeReadLock(resnode)->getOwner (GeoNodeReadLock(resnode)->ownersBegin());
 					GroupSharedPtr pargroup (dynamic_cast<GroupWeakPtr>(gg));
 					GroupWriteLock (pargroup)->removeChild (resnode);
+					m_sceneIndex.RemoveGeoNode (resnode);
 				}
 		}
 	}
 	void AvocadoEngineDocFileElement::setMaterial (int materialID)
 	{
 		m_intr.materialID = materialID;
+		MarkChanged ();
 	}
 	void AvocadoEngineDocFileElement::setColor (int color[])
 	{
 		m_intr.color[0] = color[0];
 		m_intr.color[1] = color[1];
 		m_intr.color[2] = color[2];
+		MarkChanged ();
 	}
 	void AvocadoEngineDocFileElement::removeFromScene(SceneSharedPtr &scene) 
 	{
@@ -802,34 +788,123 @@ namespace avocado
 	void AvocadoEngineDocFileElement::createScene(SceneSharedPtr &scene,std::string sessionFolder,bool skip_optimization ) 
 	{
 		SceneSharedPtr tempScene ;
+		//bool flipYZ = (ext == string( ".3ds" ) || ext == string (".obj")) ? true : false;
+		// Dont flip for now. 
+		bool flipYZ = false;
+		bool fl;
+		if (avocado::GetEngineOptionBool ("flip_yz_on_import", &fl))
+		{
+			flipYZ = fl;
+		}
+		std::string cacheKey;
+		if (!skip_optimization && loadCachedFileScene (m_fileName,sessionFolder,flipYZ,tempScene,cacheKey))
+		{
+			attachElementRoot (scene,prepareElementRoot (tempScene));
+			return;
+		}
+		if (!loadFileScene (m_fileName,sessionFolder,tempScene))
+			return;
+		//lets optimize
+		if (!skip_optimization)
+		{
+			optimizeFileScene (tempScene);
+			convertFileScene (tempScene, flipYZ);
+			storeCachedFileScene (cacheKey,tempScene);
+		}
+		attachElementRoot (scene,prepareElementRoot (tempScene));
+	}
+
+	// the loader plug-ins are shared by every import and keep state between calls, one file is parsed at a time.
+	static AvocadoImportLock s_loaderLock;
+
+	static std::vector<std::string> fileSceneSearchPaths (const std::string &sessionFolder)
+	{
 		std::vector<std::string> searchPaths;
 		searchPaths.push_back (sessionFolder + "\\models\\");
 		searchPaths.push_back (sessionFolder + "\\textures\\");
 		searchPaths.push_back (sessionFolder);
-		nvutil::loadScene (m_fileName,tempScene,searchPaths);
-		//lets optimize
-		if (!skip_optimization)
+		return searchPaths;
+	}
+
+	/* The stages of createScene, split so AvocadoImportJob can run all but the last one on an import thread.
+	   Until attachElementRoot they only touch the file scene, which nothing else sees. */
+	bool AvocadoEngineDocFileElement::loadFileScene (const std::string &fileName,const std::string &sessionFolder,SceneSharedPtr &fileScene)
+	{
+		const std::vector<std::string> searchPaths = fileSceneSearchPaths (sessionFolder);
+		// a model of an opened package is written out when it is first loaded, the loader plug-ins only open files.
+		std::string packaged;
+		if (AvocadoVirtualFiles::Get ().FindFile (fileName,searchPaths,packaged))
+			AvocadoVirtualFiles::Get ().Materialize (packaged);
+		AvocadoImportLock::Scope scope (s_loaderLock);
+		nvutil::loadScene (fileName,fileScene,searchPaths);
+		return fileScene && SceneReadLock (fileScene)->getRootNode ();
+	}
+
+	// what shapes a cached scene besides its source file. Bump the version when optimizeFileScene or
+	// convertFileScene change what they make.
+	static std::string fileSceneCacheOptions (bool flipYZ)
+	{
+		return flipYZ ? "import=1;flip_yz=1;" : "import=1;flip_yz=0;";
+	}
+
+	/* The scene an earlier import of the same file made, optimized and converted. On a miss cacheKey is what
+	   storeCachedFileScene takes, empty when the cache is off. */
+	bool AvocadoEngineDocFileElement::loadCachedFileScene (const std::string &fileName,const std::string &sessionFolder,bool flipYZ,SceneSharedPtr &fileScene,std::string &cacheKey)
+	{
+		cacheKey = "";
+		if (!AvocadoSceneCache::Get ().IsEnabled ())
+			return false;
+		const std::vector<std::string> searchPaths = fileSceneSearchPaths (sessionFolder);
+		std::string source;
+		if (!AvocadoVirtualFiles::Get ().FindFile (fileName,searchPaths,source))
+			return false;
+		AvocadoVirtualFiles::Get ().Materialize (source);
+		cacheKey = AvocadoSceneCache::Get ().MakeKey (source,fileSceneCacheOptions (flipYZ));
+		std::string cached;
+		if (cacheKey == "" || !AvocadoSceneCache::Get ().Find (cacheKey,cached))
+			return false;
 		{
-			nvutil::optimizeForRaytracing (tempScene);
-			string ext;
-			nvutil::GetFileExtFromPath( m_fileName, ext );
-			//bool flipYZ = (ext == string( ".3ds" ) || ext == string (".obj")) ? true : false;
-			// Dont flip for now. 
-			bool flipYZ = false;
-			bool fl;
-			if (avocado::GetEngineOptionBool ("flip_yz_on_import", &fl))
-			{
-				flipYZ = fl;
-			}
+			AvocadoImportLock::Scope scope (s_loaderLock);
+			nvutil::loadScene (cached,fileScene,searchPaths);
+		}
+		if (fileScene && SceneReadLock (fileScene)->getRootNode ())
+			return true;
+		// it is made and written again.
+		fileScene = SceneSharedPtr ();
+		AvocadoSceneCache::Get ().Remove (cacheKey);
+		return false;
+	}
 
-			//bool flipYZ ;
-			nvutil::convertFFPToCGFX (tempScene, flipYZ);
-	 		//nvutil::optimizeUnifyVertices (tempScene);
+	void AvocadoEngineDocFileElement::storeCachedFileScene (const std::string &cacheKey,SceneSharedPtr &fileScene)
+	{
+		if (cacheKey == "")
+			return;
+		const std::string written = AvocadoSceneCache::Get ().GetWritePath (cacheKey);
+		bool saved = false;
+		{
+			AvocadoImportLock::Scope scope (s_loaderLock);
+			saved = nvutil::saveScene (written,fileScene,ViewStateSharedPtr ());
 		}
-		// add the new scene root under the current view root node
-		NodeSharedPtr root = SceneWriteLock(scene)->getRootNode();
-		NodeSharedPtr child = SceneWriteLock(tempScene)->getRootNode();
-		
+		if (saved)
+			AvocadoSceneCache::Get ().Add (cacheKey,written);
+		else
+			AvocadoSceneCache::Get ().Discard (written);
+	}
+
+	void AvocadoEngineDocFileElement::optimizeFileScene (SceneSharedPtr &fileScene)
+	{
+		nvutil::optimizeForRaytracing (fileScene);
+	}
+
+	void AvocadoEngineDocFileElement::convertFileScene (SceneSharedPtr &fileScene,bool flipYZ)
+	{
+		nvutil::convertFFPToCGFX (fileScene, flipYZ);
+		//nvutil::optimizeUnifyVertices (fileScene);
+	}
+
+	GroupSharedPtr AvocadoEngineDocFileElement::prepareElementRoot (SceneSharedPtr &fileScene)
+	{
+		NodeSharedPtr child = SceneWriteLock(fileScene)->getRootNode();
 
 		TransformSharedPtr elementRoot = Transform::create();
 		Mat44f idmat = Mat44f(true);
@@ -852,27 +927,15 @@ namespace avocado
 			//TransformWriteLock (elementRoot)->setScaling(Vec3f(sc,sc,sc));
 		// end scale to scene
 
-		TransformWriteLock (elementRoot)->setUserData ((void*)this);
 		TransformWriteLock (elementRoot)->setName ("AvocadoElement");
-		TransformWriteLock (root)->addChild(elementRoot);
-		m_elementRoot = elementRoot;
 		//int geoIDcount = 1;
 		std::vector <GeoNodeSharedPtr> GeoNodesList;
 		/* TODO : MOVE THIS TO PIPELINE MODULE !!! */
 		TransformWriteLock(elementRoot)->setTraversalMask (1);
-		nvutil::SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-		NVSG_ASSERT(st);
-		st->setClassName("class nvsg::Drawable");
-		st->setBaseClassSearch(true);
-				
-		st->apply( child );
-				
-		const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-		std::vector<ObjectWeakPtr>::const_iterator it;
-		for(it=searchResults.begin(); it!=searchResults.end(); it++)
+		const std::vector<DrawableSharedPtr> drawables = AvocadoSceneQuery ().Find<Drawable> (child);
+		for (size_t i=0;i<drawables.size ();i++)
 		{
-			//DrawableWeakPtr node = static_cast<GeoNodeWeakPtr>(*it);
-			DrawableSharedPtr node(dynamic_cast<DrawableWeakPtr>(*it));
+			const DrawableSharedPtr &node = drawables[i];
 			int mask = 1;
 			for (int viewId=0;viewId<8;viewId++)
 					mask |= (int(pow(2.0,2*viewId+4)));// >> 1);
@@ -938,6 +1001,19 @@ namespace avocado
 				}	
 				///
 		}
+		return elementRoot;
+	}
+
+	void AvocadoEngineDocFileElement::attachElementRoot (SceneSharedPtr &scene,GroupSharedPtr elementRoot)
+	{
+		// add the new scene root under the current view root node
+		NodeSharedPtr root = SceneWriteLock(scene)->getRootNode();
+		GroupWriteLock (elementRoot)->setUserData ((void*)this);
+		// the vertex and index data of parts loaded before, by this file or another one, is used again.
+		AvocadoGeometryPool::Get ().Share (elementRoot);
+		TransformWriteLock (root)->addChild(elementRoot);
+		m_elementRoot = elementRoot;
+		m_sceneIndex.Build (m_elementRoot);
 	}
 
 	AvocadoImport::AvocadoImport (): AvocadoDocModule ("ImportModule")
@@ -958,17 +1034,30 @@ namespace avocado
 	bool AvocadoImport::OnUnload()
 	{
 		FreeGlobalMaterialCache();
+		AvocadoGeometryPool::Get ().Clear ();
 
 		return true;
 	}
 
 	bool AvocadoImport::OnRegister()
 	{
+		// only these messages are dispatched to this module, keep the list in sync with the handlers below.
+		static const char *s_messages[] = { "AddToGroup", "AddDocFileElement", "AddDocInstancedElement", "DeleteDocCommonElement", "SetDocParam", "ViewSelectionChanged", "NotifyDocElementMove", "RestoreToOrigin", "RestoreToDefault", "MouseOverElement", "ChangeElementColor", "ChangeElementMaterial", "ChangeElementMaterialPropAll", "ChangeElementMaterialPropAllColor", "ChangeElementMaterialProp", "ChangeElementMaterialPropString", "ChangeElementMaterialProp3Float", "HideElement", "UnHideElement", "UnHideAllElements", "LookAt", "PrefetchDocFileElement", "PollImportJobs", "CancelImport" };
+		for (size_t i=0;i<sizeof (s_messages) / sizeof (s_messages[0]);i++)
+			SubscribeMessage (s_messages[i]);
 		return true;
 	}
 
 	void AvocadoImport::ClearDocFileElements()
 	{
+		// the jobs are cancelled and waited for as they go.
+		for (size_t i=0;i<m_pendingFileElements.size();i++)
+		{
+			m_pendingFileElements[i].job = AvocadoImportJobSharedPtr ();
+			delete m_pendingFileElements[i].elem;
+		}
+		m_pendingFileElements.clear ();
+		m_prefetchedImports.clear ();
 		for (size_t i=0;i<m_docFileElements.size();i++)
 		{
 			delete m_docFileElements[i];
@@ -976,6 +1065,7 @@ namespace avocado
 		}
 		m_docFileElements.clear ();
 		m_elementHash.clear();
+		AvocadoGeometryPool::Get ().Prune ();
 	}
 
 	std::vector<AvocadoEngineDocFileElement *>::iterator AvocadoImport::GetDocFileElemById (int elemId)
@@ -1039,6 +1129,14 @@ namespace avocado
 		return docElem;
 	}
 	AvocadoEngineDocFileElement *AvocadoImport::AddDocFileElement(std::string filename,  AvocadoElementInterface::MetaDataList *metaData, float *mat, int inputID,string inputName,bool isGroup , string groupType   )
+	{
+		AvocadoEngineDocFileElement *docElem = NewDocFileElement (filename,metaData,inputID,inputName,isGroup,groupType);
+		m_docFileElements.push_back (docElem);
+
+		return docElem;
+	}
+	/* An element that is not in the document yet, its ID is taken. */
+	AvocadoEngineDocFileElement *AvocadoImport::NewDocFileElement(std::string filename,  AvocadoElementInterface::MetaDataList *metaData, int inputID,string inputName,bool isGroup , string groupType   )
 	{
 		AvocadoEngineDocFileElement *docElem = new AvocadoEngineDocFileElement(m_docId,m_name,filename);
 		int id = inputID;
@@ -1058,10 +1156,162 @@ namespace avocado
 			docElem->m_intr.metaData = (*metaData);
 		}
 
-		m_docFileElements.push_back (docElem);
-
 		return docElem;
 	}
+	/* The part of AddDocFileElement that comes once the element scene is in. */
+	bool AvocadoImport::CompleteDocFileElement (AvocadoPendingFileElement &pending, bool &needRepaint)
+	{
+		AvocadoEngineDocFileElement *docElem = pending.elem;
+		if (pending.hasLocation)
+			docElem->setLocation (pending.location,true);
+		
+		//if (materialID != -1)
+		if (pending.color[0] != -1 && pending.color[1] != -1 && pending.color[2] != -1)
+			SetElementColor (docElem,pending.color[0],pending.color[1],pending.color[2], (pending.materialID == -1 ? true : false),false);
+		if (pending.hasMaterialData)
+			docElem->m_intr.materialData = pending.materialData;
+		if (pending.materialID != -1)
+		//docElem->setMaterial (materialID);
+			SetElementMaterial (docElem,pending.materialID);
+	
+		if (!pending.isVisible)
+			HideElement (docElem->GetID ());
+
+		if (pending.removedGeoNodes.size ())
+		{
+			docElem->removeGeoNodes (pending.removedGeoNodes);
+			docElem->m_removedGeoNodes = pending.removedGeoNodes;
+		}
+		ParamListSharedPtr ppl = ParamList::createNew();
+		//ppl->PushInt("eid",elemId);
+		ParamListWriteLock(ppl)->PushPtr("elem",(void *)docElem);
+		bool ret = OnSendAvocadoDocGeneralStringMessage("AddDocElement",m_docId,ParamListWriteLock(ppl)->SerializeList());
+		if (pending.updateUI)
+		{
+			NotifyElementsChanged();
+						std::stringstream pStr;
+				pStr <<   "string owner=ImportModule"
+					 <<  ",bool prePick=0" 
+					 <<  ",int eid=" << docElem->GetID()
+					 <<  ",int vid=0"// << viewID 
+					 << ",bool multi=0;";
+			
+			avocado::OnSendAvocadoDocGeneralStringMessage("OnPick",docElem->m_docId,pStr.str());
+		}
+		needRepaint = true;
+		return ret;
+	}
+
+	bool AvocadoImport::StartImportJob (AvocadoPendingFileElement &pending)
+	{
+		bool flipYZ = false;
+		avocado::GetEngineOptionBool ("flip_yz_on_import", &flipYZ);
+		pending.job = AvocadoImportJobSharedPtr (new AvocadoImportJob (pending.elem->getFileName (),m_sessionFolder,false,flipYZ));
+		if (!pending.job->Start ())
+			return false;
+		m_pendingFileElements.push_back (pending);
+		SendImportStatus (AvocadoDocInterface::IMPORT_STARTED,pending.elem->getFileName (),0);
+		return true;
+	}
+
+	/* Called on the engine thread between frames while jobs are pending : reports their progress and puts the
+	   finished ones in the document, in the order they were started. */
+	void AvocadoImport::PollImportJobs (bool &needRepaint)
+	{
+		while (!m_pendingFileElements.empty ())
+		{
+			for (size_t i=0;i<m_pendingFileElements.size ();i++)
+			{
+				AvocadoPendingFileElement &pending = m_pendingFileElements[i];
+				const int progress = pending.job->GetProgress ();
+				if (progress != pending.lastProgress && !pending.job->IsDone ())
+				{
+					pending.lastProgress = progress;
+					SendImportStatus (AvocadoDocInterface::IMPORT_PROGRESS,pending.elem->getFileName (),progress);
+				}
+			}
+			AvocadoPendingFileElement pending = m_pendingFileElements.front ();
+			if (!pending.job->IsDone ())
+				break;
+			m_pendingFileElements.erase (m_pendingFileElements.begin ());
+			const AvocadoImportJob::Result result = pending.job->GetResult ();
+			const std::string fileName = pending.elem->getFileName ();
+			if (result != AvocadoImportJob::IMPORT_SUCCEEDED)
+			{
+				delete pending.elem;
+				if (result == AvocadoImportJob::IMPORT_FAILED)
+					avocado::RaiseAvocadoDocErrorMessage (m_docId,"Could not import " + fileName);
+				SendImportStatus (result == AvocadoImportJob::IMPORT_FAILED ? AvocadoDocInterface::IMPORT_FAILED : AvocadoDocInterface::IMPORT_CANCELLED,fileName,0);
+				continue;
+			}
+			const bool firstImport = m_docFileElements.empty ();
+			ParamListSharedPtr fileppl = ParamList::createNew ();
+			fileppl->PushBool ("embed",0);
+			fileppl->PushString ("filename",fileName);
+			fileppl->PushInt ("type",0);
+			OnSendAvocadoDocGeneralStringMessage("InsertFileLink",m_docId,ParamListWriteLock(fileppl)->SerializeList());
+			m_docFileElements.push_back (pending.elem);
+			pending.elem->attachElementRoot (m_scene,pending.job->GetElementRoot ());
+			pending.job = AvocadoImportJobSharedPtr ();
+			CompleteDocFileElement (pending,needRepaint);
+			if (pending.fitToPage && firstImport)
+				OnSendAvocadoDocGeneralStringMessage("FitToPage",m_docId,fileName);
+			NotifyElementsChanged();
+			SendImportStatus (AvocadoDocInterface::IMPORT_COMPLETE,fileName,100);
+		}
+	}
+
+	/* A document being opened starts the imports of a batch of its file elements at once, AddDocFileElement then
+	   takes them in document order, so the element IDs and the scene come out as a one by one load makes them. */
+	void AvocadoImport::PrefetchDocFileElement (const std::string &paramStr)
+	{
+		ParamListSharedPtr i_ppl = ParamList::createFromString (paramStr);
+		bool isRef = false, isGroup = false;
+		i_ppl->GetBoolValueByName ("isRef",isRef);
+		i_ppl->GetBoolValueByName ("isGroup",isGroup);
+		int elementID = -1;
+		if (i_ppl->GetParam ("elementID"))
+			((IntParam*)i_ppl->GetParam ("elementID"))->GetValue (elementID);
+		StringParam *prm = (StringParam*)i_ppl->GetParam ("fileName");
+		if (isRef || isGroup || elementID == -1 || !prm || m_prefetchedImports.find (elementID) != m_prefetchedImports.end ())
+			return;
+		std::string fileName;
+		prm->GetValue (fileName);
+		bool flipYZ = false;
+		avocado::GetEngineOptionBool ("flip_yz_on_import", &flipYZ);
+		AvocadoImportJobSharedPtr job (new AvocadoImportJob (fileName,m_sessionFolder,false,flipYZ));
+		if (job->Start ())
+			m_prefetchedImports[elementID] = job;
+	}
+
+	/* The prefetched import of the element, done. Its scene goes under the document as createScene would put it. */
+	bool AvocadoImport::AttachPrefetchedImport (AvocadoEngineDocFileElement *docElem)
+	{
+		PrefetchedImportHash::iterator it = m_prefetchedImports.find (docElem->GetID ());
+		if (it == m_prefetchedImports.end ())
+			return false;
+		AvocadoImportJobSharedPtr job = it->second;
+		m_prefetchedImports.erase (it);
+		if (job->GetFileName () != docElem->getFileName () || job->Wait () != AvocadoImportJob::IMPORT_SUCCEEDED)
+			return false;
+		docElem->attachElementRoot (m_scene,job->GetElementRoot ());
+		return true;
+	}
+
+	/* -1 for every running import. The job stops at its next stage, PollImportJobs drops the element. */
+	void AvocadoImport::CancelImportJobs (int elemId)
+	{
+		for (size_t i=0;i<m_pendingFileElements.size ();i++)
+			if (elemId == -1 || m_pendingFileElements[i].elem->GetID () == elemId)
+				m_pendingFileElements[i].job->Cancel ();
+	}
+
+	void AvocadoImport::SendImportStatus (int status, const std::string &fileName, int progress)
+	{
+		std::stringstream params;
+		params << "int type=" << status << ",int prog=" << progress << ",string filename=" << fileName << ";";
+		OnSendAvocadoDocGeneralStringMessage ("UpdateDocumentStatus",m_docId,params.str ());
+	}
 	bool AvocadoImport::DeleteElementChildren (int elemId,int docId)
 	{
 		std::vector<AvocadoEngineDocFileElement *>::iterator it=m_docFileElements.begin();
@@ -1111,7 +1361,10 @@ namespace avocado
 			std::string refNode = (*it)->m_refGeoNode;
 			// Parent might be deleted already...
 			if (parent_it != 0)//this->m_docFileElements.end())
+			{
 				(parent_it)->m_removedGeoNodes.push_back (refNode);
+				(parent_it)->MarkChanged ();
+			}
 		}
 
 		DocFileElementHasIterator hit= m_elementHash.find ((*it)->GetID());
@@ -1121,6 +1374,7 @@ namespace avocado
 		(*it)->removeFromScene (m_scene);
 		delete *it;
 		m_docFileElements.erase (it);
+		AvocadoGeometryPool::Get ().Prune ();
 		return true;
 	}
 	
@@ -2277,6 +2531,35 @@ namespace avocado
 			
 			//
 			//add to files list..
+			AvocadoPendingFileElement pending;
+			pending.hasLocation = hasLocation;
+			if (hasLocation)
+				memcpy (pending.location,mat,sizeof (pending.location));
+			pending.color[0] = color[0];
+			pending.color[1] = color[1];
+			pending.color[2] = color[2];
+			pending.materialID = materialID;
+			pending.hasMaterialData = hasMaterialData;
+			if (hasMaterialData)
+				pending.materialData = mat_intr;
+			pending.isVisible = isVisible;
+			pending.removedGeoNodes = t_removed_geo_nodes;
+			pending.updateUI = updateUI;
+
+			// an import from the UI parses its file on an import thread, the element joins the document when it is done.
+			bool background = false;
+			i_ppl->GetBoolValueByName ("background",background);
+			if (background && !isRef && !isGroup)
+			{
+				i_ppl->GetBoolValueByName ("fitToPage",pending.fitToPage);
+				pending.elem = NewDocFileElement(fileName,&t_meta,elementIDInput,elementNameInput,false,lgrouptype);
+				if (StartImportJob (pending))
+					return true;
+				delete pending.elem;
+				pending.elem = NULL;
+				pending.job = AvocadoImportJobSharedPtr ();
+			}
+
 			ParamListSharedPtr fileppl = ParamList::createNew ();
 			fileppl->PushBool ("embed",0);
 			fileppl->PushString ("filename",fileName);
@@ -2300,7 +2583,10 @@ namespace avocado
 				docElem->setChildren (l_children);
 			}
 			if (!isRef && !isGroup)
-				docElem->createScene(m_scene,m_sessionFolder);
+			{
+				if (!AttachPrefetchedImport (docElem))
+					docElem->createScene(m_scene,m_sessionFolder);
+			}
 			else if (isGroup)
 			{
 				if (updateUI)
@@ -2315,43 +2601,20 @@ namespace avocado
 				docElem->createGroup (m_scene);
 			}
 
-			if (hasLocation)
-				docElem->setLocation (mat,true);
-			
-			//if (materialID != -1)
-			if (color[0] != -1 && color[1] != -1 && color[2] != -1)
-				SetElementColor (docElem,color[0],color[1],color[2], (materialID == -1 ? true : false),false);
-			if (hasMaterialData)
-				docElem->m_intr.materialData = mat_intr;
-			if (materialID != -1)
-			//docElem->setMaterial (materialID);
-				SetElementMaterial (docElem,materialID);
-		
-			if (!isVisible)
-				HideElement (docElem->GetID ());
-
-			if (t_removed_geo_nodes.size ())
-			{
-				docElem->removeGeoNodes (t_removed_geo_nodes);
-				docElem->m_removedGeoNodes = t_removed_geo_nodes;
-			}
-			ParamListSharedPtr ppl = ParamList::createNew();
-			//ppl->PushInt("eid",elemId);
-			ParamListWriteLock(ppl)->PushPtr("elem",(void *)docElem);
-			ret = OnSendAvocadoDocGeneralStringMessage("AddDocElement",docId,ParamListWriteLock(ppl)->SerializeList());
-			if (updateUI)
-			{
-				NotifyElementsChanged();
-							std::stringstream pStr;
-					pStr <<   "string owner=ImportModule"
-						 <<  ",bool prePick=0" 
-						 <<  ",int eid=" << docElem->GetID()
-						 <<  ",int vid=0"// << viewID 
-						 << ",bool multi=0;";
-				
-				avocado::OnSendAvocadoDocGeneralStringMessage("OnPick",docElem->m_docId,pStr.str());
-			}
-			needRepaint = true;
+			pending.elem = docElem;
+			ret = CompleteDocFileElement (pending,needRepaint);
+		}
+		else if (msg == "PrefetchDocFileElement")
+		{
+			PrefetchDocFileElement (paramStr);
+		}
+		else if (msg == "PollImportJobs")
+		{
+			PollImportJobs (needRepaint);
+		}
+		else if (msg == "CancelImport")
+		{
+			CancelImportJobs (paramStr == "" ? -1 : atoi (paramStr.c_str ()));
 		}
 		else if (msg == "AddDocInstancedElement")
 		{
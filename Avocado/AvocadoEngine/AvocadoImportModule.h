@@ -1,6 +1,8 @@
 #pragma once
 #include "AvocadoModuleInterface.h"
 #include "AvocadoEngineObject.h"
+#include "AvocadoImportJob.h"
+#include "AvocadoElementSceneIndex.h"
 #include <hash_map>
 
 namespace avocado 
@@ -23,8 +25,18 @@ namespace avocado
 		virtual void removeFromScene(SceneSharedPtr &scene); 
 		bool createFromElement (SceneSharedPtr &scene, AvocadoEngineDocFileElement *el,std::string geoName,bool &hasColor);
 		virtual void createScene(SceneSharedPtr &scene,std::string sessionFolder,bool skip_optimization = false);
+		// createScene stages, the static ones run on an import thread too (see AvocadoImportJob).
+		static bool loadFileScene (const std::string &fileName,const std::string &sessionFolder,SceneSharedPtr &fileScene);
+		static bool loadCachedFileScene (const std::string &fileName,const std::string &sessionFolder,bool flipYZ,SceneSharedPtr &fileScene,std::string &cacheKey);
+		static void storeCachedFileScene (const std::string &cacheKey,SceneSharedPtr &fileScene);
+		static void optimizeFileScene (SceneSharedPtr &fileScene);
+		static void convertFileScene (SceneSharedPtr &fileScene,bool flipYZ);
+		static nvsg::GroupSharedPtr prepareElementRoot (SceneSharedPtr &fileScene);
+		void attachElementRoot (SceneSharedPtr &scene,nvsg::GroupSharedPtr elementRoot);
+		const std::string& getFileName () const { return m_fileName; }
+		const AvocadoElementSceneIndex& getSceneIndex () const { return m_sceneIndex; }
 		void removeGeoNodes(std::vector<std::string>);	
-		virtual string serialize() ;
+		virtual ParamListSharedPtr serializeParams () ;
 	
 		void setColor (int color[]);
 		void setMaterial (int materialID);
@@ -38,6 +50,9 @@ namespace avocado
 		std::string					m_fileName;
 	
 		std::vector<AvocadoEngineDocFileElement*>	m_children;
+		// empty for a group, its GeoNodes are in the indices of the children.
+		AvocadoElementSceneIndex		m_sceneIndex;
+		void setDrawablesTraversalMask (int mask);
 		// utility functions to help out with 25 (and maybe growing!!) material properties. 
 		void serializeMaterial (ParamListSharedPtr &ppl);
 
@@ -46,8 +61,34 @@ namespace avocado
 	};
 	
 
+	/* What AddDocFileElement applies to a file element once its scene is in. A background import keeps it, with the
+	   element that is not in the document yet, until its job is done. */
+	struct AvocadoPendingFileElement
+	{
+		AvocadoPendingFileElement () : elem (NULL), hasLocation (false), materialID (-1), hasMaterialData (false),
+			isVisible (true), updateUI (false), fitToPage (false), lastProgress (-1)
+		{
+			color[0] = color[1] = color[2] = -1;
+		}
+
+		AvocadoEngineDocFileElement		*elem;
+		AvocadoImportJobSharedPtr		job;
+		bool							hasLocation;
+		float							location[16];
+		int								color[3];
+		int								materialID;
+		bool							hasMaterialData;
+		AvocadoMaterialInterface		materialData;
+		bool							isVisible;
+		std::vector<std::string>		removedGeoNodes;
+		bool							updateUI;
+		bool							fitToPage;
+		int								lastProgress;
+	};
+
 	typedef std::hash_map<int,AvocadoEngineDocFileElement*> DocFileElementHash;
 	typedef std::hash_map<int,AvocadoEngineDocFileElement*>::iterator DocFileElementHasIterator;
+	typedef std::hash_map<int,AvocadoImportJobSharedPtr> PrefetchedImportHash;
 
 	class AvocadoImport : public AvocadoDocModule 
 	{
@@ -75,6 +116,15 @@ namespace avocado
 		// Element creation
 		AvocadoEngineDocFileElement* AddDocInstancedElement(int eid,  AvocadoElementInterface::MetaDataList *metaData,int inputID,string inputName );
 		AvocadoEngineDocFileElement* AddDocFileElement(std::string filename, AvocadoElementInterface::MetaDataList *metaData,float *mat,int inputID,std::string inputName,bool isGroup,std::string groupType);
+		AvocadoEngineDocFileElement* NewDocFileElement(std::string filename, AvocadoElementInterface::MetaDataList *metaData,int inputID,std::string inputName,bool isGroup,std::string groupType);
+		bool CompleteDocFileElement (AvocadoPendingFileElement &pending, bool &needRepaint);
+		// Background import
+		bool StartImportJob (AvocadoPendingFileElement &pending);
+		void PollImportJobs (bool &needRepaint);
+		void CancelImportJobs (int elemId);
+		void SendImportStatus (int status, const std::string &fileName, int progress);
+		void PrefetchDocFileElement (const std::string &paramStr);
+		bool AttachPrefetchedImport (AvocadoEngineDocFileElement *docElem);
 		bool DeleteDocFileElement(std::vector<AvocadoEngineDocFileElement *>::iterator &it );
 		bool DeleteElementChildren (int elemId,int docId);
 		void ClearDocFileElements();
@@ -88,6 +138,8 @@ namespace avocado
 		
 		// Members
 		std::vector<AvocadoEngineDocFileElement *>	m_docFileElements;	
+		std::vector<AvocadoPendingFileElement>	m_pendingFileElements;	// imports still running, in the order they started
+		PrefetchedImportHash			m_prefetchedImports;	// imports of a document being opened, by element ID
 		DocFileElementHash				m_elementHash;
 		std::string						 m_lastbackimage;
 	};
@@ -0,0 +1,289 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoImportScheduler.h"
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <windows.h>
+#include <process.h>
+
+namespace avocado
+{
+	static volatile LONG s_pendingImportTasks = 0;
+
+	AvocadoImportTask::AvocadoImportTask () : m_done (NULL), m_started (false), m_result (IMPORT_RUNNING), m_progress (0), m_cancelled (0)
+	{
+		m_done = CreateEvent (NULL,TRUE,FALSE,NULL);
+	}
+
+	AvocadoImportTask::~AvocadoImportTask ()
+	{
+		Finish ();
+		CloseHandle ((HANDLE)m_done);
+	}
+
+	bool AvocadoImportTask::Start ()
+	{
+		if (m_started || !m_done)
+			return false;
+		m_started = true;
+		InterlockedIncrement (&s_pendingImportTasks);
+		if (AvocadoImportScheduler::Get ().Submit (this))
+			return true;
+		m_started = false;
+		InterlockedDecrement (&s_pendingImportTasks);
+		return false;
+	}
+
+	void AvocadoImportTask::Cancel ()
+	{
+		InterlockedExchange ((LONG*)&m_cancelled,1);
+	}
+
+	bool AvocadoImportTask::IsDone () const
+	{
+		return GetResult () != IMPORT_RUNNING;
+	}
+
+	AvocadoImportTask::Result AvocadoImportTask::Wait ()
+	{
+		if (!m_started)
+			return GetResult ();
+		if (AvocadoImportScheduler::Get ().Withdraw (this))
+			Execute ();
+		WaitForSingleObject ((HANDLE)m_done,INFINITE);
+		return GetResult ();
+	}
+
+	int AvocadoImportTask::GetProgress () const
+	{
+		return (int)InterlockedCompareExchange ((LONG*)&m_progress,0,0);
+	}
+
+	AvocadoImportTask::Result AvocadoImportTask::GetResult () const
+	{
+		return (Result)InterlockedCompareExchange ((LONG*)&m_result,0,0);
+	}
+
+	long AvocadoImportTask::GetPendingCount ()
+	{
+		return InterlockedCompareExchange (&s_pendingImportTasks,0,0);
+	}
+
+	void AvocadoImportTask::Finish ()
+	{
+		if (!m_started)
+			return;
+		Cancel ();
+		Wait ();
+		m_started = false;
+		InterlockedDecrement (&s_pendingImportTasks);
+	}
+
+	bool AvocadoImportTask::IsCancelled () const
+	{
+		return InterlockedCompareExchange ((LONG*)&m_cancelled,0,0) != 0;
+	}
+
+	void AvocadoImportTask::SetProgress (int progress)
+	{
+		InterlockedExchange ((LONG*)&m_progress,progress);
+	}
+
+	void AvocadoImportTask::Execute ()
+	{
+		Result res = IMPORT_CANCELLED;
+		if (!IsCancelled ())
+		{
+			try
+			{
+				res = Run ();
+			}
+			catch (...)
+			{
+				res = IMPORT_FAILED;
+			}
+		}
+		// what Run built is complete before anyone sees the task done.
+		InterlockedExchange ((LONG*)&m_result,res);
+		SetEvent ((HANDLE)m_done);
+	}
+
+	struct AvocadoImportScheduler::Impl
+	{
+		Impl () : m_requested (0), m_stop (0)
+		{
+			InitializeCriticalSection (&m_threadLock);
+			InitializeCriticalSection (&m_queueLock);
+			m_wake = CreateSemaphore (NULL,0,0x7fffffff,NULL);
+		}
+
+		static unsigned __stdcall WorkerMain (void *arg)
+		{
+			Impl *impl = (Impl*)arg;
+			for (;;)
+			{
+				WaitForSingleObject (impl->m_wake,INFINITE);
+				if (impl->m_stop)
+					break;
+				AvocadoImportTask *task = NULL;
+				EnterCriticalSection (&impl->m_queueLock);
+				if (!impl->m_queue.empty ())
+				{
+					task = impl->m_queue.front ();
+					impl->m_queue.pop_front ();
+				}
+				LeaveCriticalSection (&impl->m_queueLock);
+				// a withdrawn task leaves its wake up behind.
+				if (task)
+					task->Execute ();
+			}
+			return 0;
+		}
+
+		int ThreadCount () const
+		{
+			if (m_requested > 0)
+				return m_requested;
+			SYSTEM_INFO info;
+			GetSystemInfo (&info);
+			return info.dwNumberOfProcessors > 0 ? int (info.dwNumberOfProcessors) : 1;
+		}
+
+		/* Under m_threadLock. */
+		void StartWorkers ()
+		{
+			const int workers = ThreadCount ();
+			m_stop = 0;
+			while (int (m_threads.size ()) < workers)
+			{
+				HANDLE h = (HANDLE)_beginthreadex (NULL,0,WorkerMain,this,0,NULL);
+				if (!h)
+					break;
+				m_threads.push_back (h);
+			}
+		}
+
+		/* Under m_threadLock, the workers only take m_queueLock. What is still queued is woken again once
+		   there are threads. */
+		void StopWorkers ()
+		{
+			if (m_threads.empty ())
+				return;
+			InterlockedExchange (&m_stop,1);
+			ReleaseSemaphore (m_wake,LONG (m_threads.size ()),NULL);
+			for (size_t i=0;i<m_threads.size ();i++)
+			{
+				WaitForSingleObject (m_threads[i],INFINITE);
+				CloseHandle (m_threads[i]);
+			}
+			m_threads.clear ();
+			while (WaitForSingleObject (m_wake,0) == WAIT_OBJECT_0)
+				;
+		}
+
+		CRITICAL_SECTION				m_threadLock;
+		CRITICAL_SECTION				m_queueLock;
+		HANDLE							m_wake;
+		std::vector<HANDLE>				m_threads;
+		std::deque<AvocadoImportTask*>	m_queue;
+		int								m_requested;
+		volatile LONG					m_stop;
+	};
+
+	AvocadoImportScheduler::AvocadoImportScheduler () : m_impl (new Impl ())
+	{
+	}
+
+	AvocadoImportScheduler& AvocadoImportScheduler::Get ()
+	{
+		// never destroyed, see Shutdown.
+		static AvocadoImportScheduler *s_scheduler = new AvocadoImportScheduler ();
+		return *s_scheduler;
+	}
+
+	void AvocadoImportScheduler::SetThreadCount (int count)
+	{
+		EnterCriticalSection (&m_impl->m_threadLock);
+		if (count < 0)
+			count = 0;
+		if (count != m_impl->m_requested)
+		{
+			m_impl->StopWorkers ();
+			m_impl->m_requested = count;
+			EnterCriticalSection (&m_impl->m_queueLock);
+			const size_t queued = m_impl->m_queue.size ();
+			LeaveCriticalSection (&m_impl->m_queueLock);
+			if (queued)
+			{
+				m_impl->StartWorkers ();
+				ReleaseSemaphore (m_impl->m_wake,LONG (queued),NULL);
+			}
+		}
+		LeaveCriticalSection (&m_impl->m_threadLock);
+	}
+
+	int AvocadoImportScheduler::GetThreadCount ()
+	{
+		EnterCriticalSection (&m_impl->m_threadLock);
+		const int count = m_impl->ThreadCount ();
+		LeaveCriticalSection (&m_impl->m_threadLock);
+		return count;
+	}
+
+	void AvocadoImportScheduler::Shutdown ()
+	{
+		EnterCriticalSection (&m_impl->m_threadLock);
+		m_impl->StopWorkers ();
+		LeaveCriticalSection (&m_impl->m_threadLock);
+	}
+
+	bool AvocadoImportScheduler::Submit (AvocadoImportTask *task)
+	{
+		EnterCriticalSection (&m_impl->m_threadLock);
+		m_impl->StartWorkers ();
+		const bool ok = !m_impl->m_threads.empty ();
+		if (ok)
+		{
+			EnterCriticalSection (&m_impl->m_queueLock);
+			m_impl->m_queue.push_back (task);
+			LeaveCriticalSection (&m_impl->m_queueLock);
+			ReleaseSemaphore (m_impl->m_wake,1,NULL);
+		}
+		LeaveCriticalSection (&m_impl->m_threadLock);
+		return ok;
+	}
+
+	bool AvocadoImportScheduler::Withdraw (AvocadoImportTask *task)
+	{
+		EnterCriticalSection (&m_impl->m_queueLock);
+		std::deque<AvocadoImportTask*>::iterator it = std::find (m_impl->m_queue.begin (),m_impl->m_queue.end (),task);
+		const bool found = (it != m_impl->m_queue.end ());
+		if (found)
+			m_impl->m_queue.erase (it);
+		LeaveCriticalSection (&m_impl->m_queueLock);
+		return found;
+	}
+
+	AvocadoImportLock::AvocadoImportLock () : m_section (new CRITICAL_SECTION)
+	{
+		InitializeCriticalSection ((CRITICAL_SECTION*)m_section);
+	}
+
+	AvocadoImportLock::~AvocadoImportLock ()
+	{
+		DeleteCriticalSection ((CRITICAL_SECTION*)m_section);
+		delete (CRITICAL_SECTION*)m_section;
+	}
+
+	void AvocadoImportLock::Enter ()
+	{
+		EnterCriticalSection ((CRITICAL_SECTION*)m_section);
+	}
+
+	void AvocadoImportLock::Leave ()
+	{
+		LeaveCriticalSection ((CRITICAL_SECTION*)m_section);
+	}
+}
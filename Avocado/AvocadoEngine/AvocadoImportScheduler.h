@@ -0,0 +1,153 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include <string>
+#include <hash_map>
+
+namespace avocado
+{
+	/* A file import that runs on the import scheduler threads (see AvocadoImportJob). Start, Cancel, Wait and the
+	   getters are called from the engine thread, Run from a scheduler thread or from Wait. */
+	class AvocadoImportTask
+	{
+	public:
+		enum Result
+		{
+			IMPORT_RUNNING,
+			IMPORT_SUCCEEDED,
+			IMPORT_FAILED,
+			IMPORT_CANCELLED
+		};
+
+		AvocadoImportTask ();
+		virtual ~AvocadoImportTask ();
+
+		/* Queues the task, false when no scheduler thread could start. */
+		bool						Start ();
+		/* The task stops at its next stage, one not taken by a thread yet does not run. */
+		void						Cancel ();
+		bool						IsDone () const;
+		/* Until the task is done, a task still queued runs right here. */
+		Result						Wait ();
+		/* 0 to 100, for DocuemntStatusCallback. */
+		int							GetProgress () const;
+		/* IMPORT_RUNNING until IsDone. */
+		Result						GetResult () const;
+
+		/* Tasks started and not yet destroyed. The engine polls while there are any. */
+		static long					GetPendingCount ();
+	protected:
+		virtual Result				Run () = 0;
+		/* Cancels the task and waits for it. Derived destructors call it first, Run uses their members. */
+		void						Finish ();
+		bool						IsCancelled () const;
+		void						SetProgress (int progress);
+	private:
+		friend class AvocadoImportScheduler;
+
+		AvocadoImportTask (const AvocadoImportTask &);
+		AvocadoImportTask &operator= (const AvocadoImportTask &);
+
+		void						Execute ();
+
+		void						*m_done;
+		bool						m_started;
+		volatile long				m_result;
+		volatile long				m_progress;
+		volatile long				m_cancelled;
+	};
+
+	/* A bounded set of threads the file imports are queued on, taken in the order they were started. Documents
+	   with many file elements and folders of models are imported a few files at a time instead of one after the
+	   other. The tasks build private scenes, what they share goes through an AvocadoImportCache. */
+	class AvocadoImportScheduler
+	{
+	public:
+		static AvocadoImportScheduler&	Get ();
+
+		/* 0 is one thread per core. */
+		void						SetThreadCount (int count);
+		int							GetThreadCount ();
+		/* Joins the threads once the tasks they run are done, queued tasks stay queued. Called from
+		   AvocadoTerminate, the scheduler itself lives for the whole process. */
+		void						Shutdown ();
+	private:
+		friend class AvocadoImportTask;
+
+		AvocadoImportScheduler ();
+
+		bool						Submit (AvocadoImportTask *task);
+		/* Takes a task that no thread took yet off the queue. */
+		bool						Withdraw (AvocadoImportTask *task);
+
+		struct Impl;
+		Impl						*m_impl;
+	};
+
+	class AvocadoImportLock
+	{
+	public:
+		AvocadoImportLock ();
+		~AvocadoImportLock ();
+
+		void						Enter ();
+		void						Leave ();
+
+		class Scope
+		{
+		public:
+			Scope (AvocadoImportLock &lock) : m_lock (lock) { m_lock.Enter (); }
+			~Scope () { m_lock.Leave (); }
+		private:
+			Scope &operator= (const Scope &);
+			AvocadoImportLock		&m_lock;
+		};
+	private:
+		AvocadoImportLock (const AvocadoImportLock &);
+		AvocadoImportLock &operator= (const AvocadoImportLock &);
+
+		void						*m_section;
+	};
+
+	/* What the import tasks share, by key : an effect by its source, with the textures it loads. Maker::Make builds
+	   the value the first time a key is asked for, Maker::Copy makes what is handed out from the cached one. Both
+	   run under the cache lock, so the makers run one at a time (Cg is not re-entrant) and the cached values are
+	   never touched by two threads at once. */
+	template <class T>
+	class AvocadoImportCache
+	{
+	public:
+		AvocadoImportCache () : m_hits (0), m_misses (0) {}
+
+		template <class Maker>
+		T							Find (const std::string &key, Maker &maker)
+		{
+			AvocadoImportLock::Scope scope (m_lock);
+			typename ValueHash::iterator it = m_values.find (key);
+			if (it == m_values.end ())
+			{
+				m_misses++;
+				it = m_values.insert (std::make_pair (key,maker.Make (key))).first;
+			}
+			else
+				m_hits++;
+			return maker.Copy (it->second);
+		}
+		void						Clear ()
+		{
+			AvocadoImportLock::Scope scope (m_lock);
+			m_values.clear ();
+			m_hits = m_misses = 0;
+		}
+		size_t						GetHits () { AvocadoImportLock::Scope scope (m_lock); return m_hits; }
+		size_t						GetMisses () { AvocadoImportLock::Scope scope (m_lock); return m_misses; }
+	private:
+		typedef std::hash_map<std::string,T> ValueHash;
+
+		AvocadoImportLock			m_lock;
+		ValueHash					m_values;
+		size_t						m_hits;
+		size_t						m_misses;
+	};
+}
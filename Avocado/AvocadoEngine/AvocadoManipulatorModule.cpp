@@ -42,6 +42,16 @@ namespace avocado
 		m_man->setViewState (m_viewState);
 		m_mouseDown = false;
 		ResetMan ();
+		// only these messages are dispatched to this module, keep the list in sync with the handlers below.
+		static const char *s_messages[] = { "OrientCamera", "FitToPage", "SetViewParam" };
+		for (size_t i=0;i<sizeof (s_messages) / sizeof (s_messages[0]);i++)
+			SubscribeMessage (s_messages[i]);
+		SubscribeMouseMessage (AVC_MOUSE_LDOWN);
+		SubscribeMouseMessage (AVC_MOUSE_LUP);
+		SubscribeMouseMessage (AVC_MOUSE_MDOWN);
+		SubscribeMouseMessage (AVC_MOUSE_MUP);
+		SubscribeMouseMessage (AVC_MOUSE_MOVE);
+		SubscribeMouseMessage (AVC_MOUSE_WHEEL);
 		return true;
 	}
 
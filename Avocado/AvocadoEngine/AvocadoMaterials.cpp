@@ -20,6 +20,9 @@
 #include <nvutil/PlugIn.h>
 #include <nvsg/PlugInterface.h>
 #include <nvsg/PlugInterfaceID.h>
+#include "AvocadoArchive.h"
+#include "../../3rdParty/jpeg-8d/Jpegfile.h"
+#include <algorithm>
 #include "nvutil/DbgNew.h" // this must be the last include
 using namespace nvsg;
 namespace avocado
@@ -171,6 +174,7 @@ namespace avocado
 		for (size_t k=0;k<GlobalShaderCache.size ();k++)
 			GlobalShaderCache[k].second=0;
 		GlobalShaderCache.clear();
+		nvutil::clearFFPToCGFXCache ();
 	}
 
 	//class MaterialBase2 {
@@ -272,6 +276,34 @@ namespace avocado
 			}
 			return result;
 		}
+		bool MaterialBase2::LoadTexture (const string &file, TextureHostSharedPtr &tex, const std::vector<std::string> &searchPaths)
+		{
+			if (!nvutil::FileExists (file))
+			{
+				string ext;
+				nvutil::GetFileExtFromPath (file,ext);
+				std::transform (ext.begin (),ext.end (),ext.begin (),::tolower);
+				AvocadoArchiveData data;
+				if ((ext == ".jpg" || ext == ".jpeg") && AvocadoVirtualFiles::Get ().Read (file,data))
+				{
+					// decoded where it lies in the package. bottom row first, as the loader plug-ins have it.
+					unsigned int width = 0;
+					unsigned int height = 0;
+					char *rgb = JpegFile::JpegBufferToRGB (data.data,data.size,&width,&height);
+					if (rgb)
+					{
+						JpegFile::VertFlipBuf (rgb,width * 3,height);
+						tex = TextureHost::create ();
+						TextureHostWriteLock (tex)->createImage (width,height,1,Image::IMG_RGB,Image::IMG_UNSIGNED_BYTE,rgb);
+						delete [] rgb;
+						return true;
+					}
+				}
+				// the other formats only load from a file.
+				AvocadoVirtualFiles::Get ().Materialize (file);
+			}
+			return nvutil::loadTextureHost (file,tex,searchPaths);
+		}
 		bool MaterialBase2::SetSamplerUniformStatic (CgFxSharedPtr tessCgFx , string paramName, string filename,unsigned int &width,unsigned int &height,string sessionFolder)
 		{
 			bool result = true;
@@ -301,9 +333,9 @@ namespace avocado
 			{
 				// not found in global cache. lets create it and add to cache.
 				string file;
-				if (  nvutil::FindFileFirst( filename, searchPaths, file ) )
+				if (  AvocadoVirtualFiles::Get ().FindFile( filename, searchPaths, file ) )
 				{
-					nvutil::loadTextureHost (file,tex,searchPaths);
+					LoadTexture (file,tex,searchPaths);
 					//tex = TextureHost::createFromFile (file,searchPaths);//,TextureHost::F_PRESERVE_IMAGE_DATA_AFTER_UPLOAD); 
 					if (tex)
 						GlobalTextureStack2.push_back (pair <string,TextureHostSharedPtr>(filename,tex));
@@ -366,7 +398,8 @@ namespace avocado
 				spats.push_back (string (GetProccessDirectory())+ string ("textures\\"));
 				spats.push_back (string (m_sessionFolder)+ string ("\\textures\\"));
 				
-				if (   !nvutil::FindFileFirst( ifilename, spats, file )
+				if (   !AvocadoVirtualFiles::Get ().FindFile( ifilename, spats, file )
+					|| !AvocadoVirtualFiles::Get ().Materialize( file )
 					|| !effect->createFromFile( file, spats, err ) )
 				{
 					NVSG_TRACE_OUT(string("Shader compilation failed with following errors: \n" + err).c_str());
@@ -29,6 +29,8 @@ namespace avocado {
 		nvmath::Vec3f GetDiffuseColor ();
 		static bool SetFloatUniform (nvsg::CgFxSharedPtr tessCgFx , string paramName, float value);
 		bool SetFloatVec3Uniform (nvsg::CgFxSharedPtr tessCgFx , string paramName, float value1,float value2,float value3,float value4);
+		/* file as found by AvocadoVirtualFiles::FindFile, it may still be in the opened package. */
+		static bool LoadTexture (const string &file, nvsg::TextureHostSharedPtr &tex, const std::vector<std::string> &searchPaths);
 		static bool SetSamplerUniformStatic (nvsg::CgFxSharedPtr tessCgFx , string paramName, string filename,unsigned int &width,unsigned int &height,std::string sessionFolder);
 		bool SetSamplerUniform (nvsg::CgFxSharedPtr tessCgFx , string paramName, string filename,unsigned int &width,unsigned int &height);
 		
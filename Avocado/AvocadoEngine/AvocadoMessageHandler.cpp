@@ -1,12 +1,209 @@
 #include "AvocadoMessageHandler.h"
+#include <hash_map>
+#include <deque>
+#include <algorithm>
+#include <windows.h>
 
 namespace avocado
 {
-	AvocadoMessageHandler::AvocadoMessageHandler()
+	//----------------------------------------------
+	// AvocadoMessageRegistry
+
+	/* Created on first use, modules subscribe from their OnRegister which may run before main. */
+	struct AvocadoMessagePool
+	{
+		AvocadoMessagePool () : m_version (0) { InitializeCriticalSection (&m_lock); }
+		~AvocadoMessagePool () { DeleteCriticalSection (&m_lock); }
+		CRITICAL_SECTION						m_lock;
+		std::hash_map<std::string,int>			m_ids;
+		std::deque<std::string>					m_names;
+		volatile LONG							m_version;
+	};
+
+	static AvocadoMessagePool& GetMessagePool ()
+	{
+		static AvocadoMessagePool pool;
+		return pool;
+	}
+
+	AvocadoMessageId AvocadoMessageRegistry::RegisterMessage (const std::string &msg)
+	{
+		AvocadoMessagePool &pool = GetMessagePool ();
+		EnterCriticalSection (&pool.m_lock);
+		std::hash_map<std::string,int>::iterator it = pool.m_ids.find (msg);
+		AvocadoMessageId id;
+		if (it != pool.m_ids.end ())
+		{
+			id = it->second;
+		}
+		else
+		{
+			id = AvocadoMessageId (pool.m_names.size ());
+			pool.m_names.push_back (msg);
+			pool.m_ids[msg] = id;
+		}
+		LeaveCriticalSection (&pool.m_lock);
+		return id;
+	}
+
+	AvocadoMessageId AvocadoMessageRegistry::FindMessage (const std::string &msg)
+	{
+		AvocadoMessagePool &pool = GetMessagePool ();
+		EnterCriticalSection (&pool.m_lock);
+		std::hash_map<std::string,int>::iterator it = pool.m_ids.find (msg);
+		AvocadoMessageId id = (it != pool.m_ids.end ()) ? it->second : AVC_INVALID_MESSAGE_ID;
+		LeaveCriticalSection (&pool.m_lock);
+		return id;
+	}
+
+	std::string AvocadoMessageRegistry::GetMessageName (AvocadoMessageId id)
+	{
+		AvocadoMessagePool &pool = GetMessagePool ();
+		std::string res;
+		EnterCriticalSection (&pool.m_lock);
+		if (id >= 0 && size_t (id) < pool.m_names.size ())
+			res = pool.m_names[id];
+		LeaveCriticalSection (&pool.m_lock);
+		return res;
+	}
+
+	size_t AvocadoMessageRegistry::GetMessageCount ()
+	{
+		AvocadoMessagePool &pool = GetMessagePool ();
+		EnterCriticalSection (&pool.m_lock);
+		size_t res = pool.m_names.size ();
+		LeaveCriticalSection (&pool.m_lock);
+		return res;
+	}
+
+	unsigned int AvocadoMessageRegistry::GetSubscriptionVersion ()
+	{
+		return (unsigned int)GetMessagePool ().m_version;
+	}
+
+	void AvocadoMessageRegistry::OnSubscriptionChanged ()
+	{
+		InterlockedIncrement (&GetMessagePool ().m_version);
+	}
+
+	//----------------------------------------------
+	// AvocadoMessageHandler
+
+	AvocadoMessageHandler::AvocadoMessageHandler() : m_subscribedMouseMask (0)
 	{
 	}
 
 	AvocadoMessageHandler::~AvocadoMessageHandler()
 	{
 	}
-}
\ No newline at end of file
+
+	void AvocadoMessageHandler::SubscribeMessage (const std::string &msg)
+	{
+		AvocadoMessageId id = AvocadoMessageRegistry::RegisterMessage (msg);
+		if (std::find (m_subscribedMessages.begin (), m_subscribedMessages.end (), id) != m_subscribedMessages.end ())
+			return;
+		m_subscribedMessages.push_back (id);
+		AvocadoMessageRegistry::OnSubscriptionChanged ();
+	}
+
+	void AvocadoMessageHandler::SubscribeMouseMessage (AvcMouseActType msg)
+	{
+		m_subscribedMouseMask |= (1u << msg);
+		AvocadoMessageRegistry::OnSubscriptionChanged ();
+	}
+
+	bool AvocadoMessageHandler::IsSubscribed (AvocadoMessageId id) const
+	{
+		if (IsSubscribedToAll ())
+			return true;
+		return std::find (m_subscribedMessages.begin (), m_subscribedMessages.end (), id) != m_subscribedMessages.end ();
+	}
+
+	bool AvocadoMessageHandler::IsSubscribedMouse (AvcMouseActType msg) const
+	{
+		if (IsSubscribedToAll ())
+			return true;
+		return (m_subscribedMouseMask & (1u << msg)) != 0;
+	}
+
+	//----------------------------------------------
+	// AvocadoDispatchTable
+
+	AvocadoDispatchTable::AvocadoDispatchTable () : m_version (0), m_dirty (true)
+	{
+	}
+
+	void AvocadoDispatchTable::AddHandler (AvocadoMessageHandler *handler)
+	{
+		m_handlers.push_back (handler);
+		m_dirty = true;
+	}
+
+	void AvocadoDispatchTable::Clear ()
+	{
+		m_handlers.clear ();
+		m_dirty = true;
+	}
+
+	void AvocadoDispatchTable::Update ()
+	{
+		m_version = AvocadoMessageRegistry::GetSubscriptionVersion ();
+		m_dirty = false;
+
+		// every message known right now gets its list, later names fall back to m_everything until the next subscription.
+		const size_t messageCount = AvocadoMessageRegistry::GetMessageCount ();
+		m_everything.clear ();
+		m_byMessage.assign (messageCount, std::vector<AvocadoMessageHandler*> ());
+		m_byMouse.assign (AVC_MOUSE_ACT_COUNT, std::vector<AvocadoMessageHandler*> ());
+		for (size_t h=0;h<m_handlers.size ();h++)
+		{
+			AvocadoMessageHandler *handler = m_handlers[h];
+			if (handler->IsSubscribedToAll ())
+				m_everything.push_back (handler);
+			for (size_t id=0;id<messageCount;id++)
+			{
+				if (handler->IsSubscribed (AvocadoMessageId (id)))
+					m_byMessage[id].push_back (handler);
+			}
+			for (int m=0;m<AVC_MOUSE_ACT_COUNT;m++)
+			{
+				if (handler->IsSubscribedMouse (AvcMouseActType (m)))
+					m_byMouse[m].push_back (handler);
+			}
+		}
+	}
+
+	const std::vector<AvocadoMessageHandler*>& AvocadoDispatchTable::GetHandlers (AvocadoMessageId id)
+	{
+		if (m_dirty || m_version != AvocadoMessageRegistry::GetSubscriptionVersion ())
+			Update ();
+		if (id < 0 || size_t (id) >= m_byMessage.size ())
+			return m_everything;
+		return m_byMessage[id];
+	}
+
+	size_t AvocadoDispatchTable::GetHandlerCount (AvocadoMessageId id)
+	{
+		return GetHandlers (id).size ();
+	}
+
+	AvocadoMessageHandler *AvocadoDispatchTable::GetHandler (AvocadoMessageId id, size_t i)
+	{
+		const std::vector<AvocadoMessageHandler*> &handlers = GetHandlers (id);
+		return i < handlers.size () ? handlers[i] : NULL;
+	}
+
+	size_t AvocadoDispatchTable::GetMouseHandlerCount (AvcMouseActType msg)
+	{
+		if (m_dirty || m_version != AvocadoMessageRegistry::GetSubscriptionVersion ())
+			Update ();
+		return m_byMouse[msg].size ();
+	}
+
+	AvocadoMessageHandler *AvocadoDispatchTable::GetMouseHandler (AvcMouseActType msg, size_t i)
+	{
+		if (m_dirty || m_version != AvocadoMessageRegistry::GetSubscriptionVersion ())
+			Update ();
+		return i < m_byMouse[msg].size () ? m_byMouse[msg][i] : NULL;
+	}
+}
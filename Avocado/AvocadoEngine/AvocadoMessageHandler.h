@@ -5,20 +5,80 @@
 #include "AvocadoAppInterface.h"
 #include "AvocadoParams.h"
 #include <string>
+#include <vector>
 
 namespace avocado
 {
+	/* Interned message name. Ids are small and dense so dispatch tables can index by them. */
+	typedef int AvocadoMessageId;
+	#define AVC_INVALID_MESSAGE_ID (-1)
+	#define AVC_MOUSE_ACT_COUNT (AVC_TIMER_TICK + 1)
+
+	/* Process wide message names. A name gets its id the first time anyone registers or subscribes to it. */
+	class AvocadoMessageRegistry
+	{
+	public:
+		static AvocadoMessageId		RegisterMessage (const std::string &msg);
+		/* AVC_INVALID_MESSAGE_ID when nobody ever registered the name */
+		static AvocadoMessageId		FindMessage (const std::string &msg);
+		static std::string			GetMessageName (AvocadoMessageId id);
+		static size_t				GetMessageCount ();
+		/* bumped on every subscription, dispatch tables use it to know they are out of date. */
+		static unsigned int			GetSubscriptionVersion ();
+		static void					OnSubscriptionChanged ();
+	};
+
 	class AvocadoMessageHandler
 	{
 	public:
 		AvocadoMessageHandler ();
-		AvocadoMessageHandler (string name) { m_name = name ; }
+		AvocadoMessageHandler (string name) : m_subscribedMouseMask (0) { m_name = name ; }
 		virtual ~AvocadoMessageHandler ();
 
 		virtual bool HandleAvocadoMouseStringMessage (AvcMouseActType msg, int viewId, int x, int y, int zDelta, bool &needRepaint) = 0;
 		virtual bool HandleAvocadoViewGeneralStringMessage (const std::string &msg, int viewId, const std::string &paramStr, bool &needRepaint) = 0;
 		virtual bool HandleAvocadoDocGeneralStringMessage (const std::string &msg, int docId, const std::string &paramStr, bool &needRepaint) = 0;
 
+		/* Subscriptions, made in OnRegister. Only subscribed messages are dispatched to the handler.
+		   A handler that never subscribes to anything keeps getting every message, like before the dispatch tables. */
+		void SubscribeMessage (const std::string &msg);
+		void SubscribeMouseMessage (AvcMouseActType msg);
+		bool IsSubscribedToAll () const { return m_subscribedMessages.empty () && m_subscribedMouseMask == 0; }
+		bool IsSubscribed (AvocadoMessageId id) const;
+		bool IsSubscribedMouse (AvcMouseActType msg) const;
+
 		string m_name;
+	private:
+		std::vector<AvocadoMessageId> m_subscribedMessages;
+		unsigned int m_subscribedMouseMask;
+	};
+
+	/* Which handlers get which message, one table per owner (the engine, a document, a view).
+	   Handlers are kept in the order they were added, so a message reaches its subscribers in the same order the old broadcast did.
+	   Finding the handlers of a message costs one hash of its name and an index, however many handlers and messages exist.
+	   Walk a message with GetHandlerCount / GetHandler rather than keeping a list around, a handler may add modules
+	   (and so rebuild the table) while it handles the message. */
+	class AvocadoDispatchTable
+	{
+	public:
+		AvocadoDispatchTable ();
+		void					AddHandler (AvocadoMessageHandler *handler);
+		void					Clear ();
+
+		size_t					GetHandlerCount (AvocadoMessageId id);
+		AvocadoMessageHandler	*GetHandler (AvocadoMessageId id, size_t i);
+		size_t					GetMouseHandlerCount (AvcMouseActType msg);
+		AvocadoMessageHandler	*GetMouseHandler (AvcMouseActType msg, size_t i);
+	private:
+		const std::vector<AvocadoMessageHandler*>& GetHandlers (AvocadoMessageId id);
+		void					Update ();
+
+		std::vector<AvocadoMessageHandler*>					m_handlers;
+		// handlers that did not subscribe, they also get the messages nobody subscribed to.
+		std::vector<AvocadoMessageHandler*>					m_everything;
+		std::vector< std::vector<AvocadoMessageHandler*> >	m_byMessage;
+		std::vector< std::vector<AvocadoMessageHandler*> >	m_byMouse;
+		unsigned int										m_version;
+		bool												m_dirty;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,254 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoMessageRecorder.h"
+#include <cstring>
+#include <windows.h>
+
+namespace avocado
+{
+	static const char s_recordingMagic[] = "AvocadoRecording 1\n";
+
+	__declspec(thread) int AvocadoRecordGuard::s_depth = 0;
+
+	std::string AvocadoRecordedCall::GetName () const
+	{
+		static const char *s_mouseNames[] = { "AVC_MOUSE_LDOWN", "AVC_MOUSE_LUP", "AVC_MOUSE_MDOWN", "AVC_MOUSE_MUP",
+			"AVC_MOUSE_RUP", "AVC_MOUSE_RDOWN", "AVC_MOUSE_MOVE", "AVC_MOUSE_WHEEL", "AVC_TIMER_TICK" };
+		switch (kind)
+		{
+		case MOUSE_MESSAGE:
+			if (mouseMsg >= 0 && size_t (mouseMsg) < sizeof (s_mouseNames) / sizeof (s_mouseNames[0]))
+				return s_mouseNames[mouseMsg];
+			return "AVC_MOUSE_UNKNOWN";
+		case VIEW_MESSAGE:
+		case DOC_MESSAGE:
+			return msg;
+		case CREATE_DOC:
+			return "OnCreateDoc";
+		case CREATE_VIEW:
+			return "OnCreateView";
+		case SIZE_VIEW:
+			return "OnSizeView";
+		case SERIALIZE_DOC:
+			return isStoring ? "OnSerializeDoc (store)" : (isImport ? "OnSerializeDoc (import)" : "OnSerializeDoc (load)");
+		case SET_ACTIVE_DOC:
+			return "SetActiveDoc";
+		}
+		return "";
+	}
+
+	struct AvocadoMessageRecorder::Lock
+	{
+		Lock () { InitializeCriticalSection (&m_section); }
+		~Lock () { DeleteCriticalSection (&m_section); }
+		CRITICAL_SECTION m_section;
+	};
+
+	AvocadoMessageRecorder::AvocadoMessageRecorder () : m_file (NULL), m_lock (new Lock ()), m_start (0)
+	{
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency (&freq);
+		m_msPerTick = 1000.0 / double (freq.QuadPart);
+	}
+
+	AvocadoMessageRecorder::~AvocadoMessageRecorder ()
+	{
+		Stop ();
+		delete m_lock;
+	}
+
+	bool AvocadoMessageRecorder::Start (const std::string &path)
+	{
+		Stop ();
+		EnterCriticalSection (&m_lock->m_section);
+		m_file = fopen (path.c_str (), "wb");
+		if (m_file)
+		{
+			fwrite (s_recordingMagic, 1, sizeof (s_recordingMagic) - 1, m_file);
+			LARGE_INTEGER now;
+			QueryPerformanceCounter (&now);
+			m_start = now.QuadPart;
+		}
+		LeaveCriticalSection (&m_lock->m_section);
+		return m_file != NULL;
+	}
+
+	void AvocadoMessageRecorder::Stop ()
+	{
+		EnterCriticalSection (&m_lock->m_section);
+		if (m_file)
+		{
+			fclose (m_file);
+			m_file = NULL;
+		}
+		LeaveCriticalSection (&m_lock->m_section);
+	}
+
+	void AvocadoMessageRecorder::Record (AvocadoRecordedCall &call)
+	{
+		EnterCriticalSection (&m_lock->m_section);
+		if (!m_file)
+		{
+			LeaveCriticalSection (&m_lock->m_section);
+			return;
+		}
+		LARGE_INTEGER now;
+		QueryPerformanceCounter (&now);
+		call.timeMs = double (now.QuadPart - m_start) * m_msPerTick;
+		// whole milliseconds and the microseconds left, an int of microseconds would only last 35 minutes.
+		const int timeMs = int (call.timeMs);
+		ParamListSharedPtr pl = ParamList::createNew ();
+		pl->PushInt ("Kind", int (call.kind));
+		pl->PushInt ("TimeMs", timeMs);
+		pl->PushInt ("TimeUs", int ((call.timeMs - timeMs) * 1000.0));
+		pl->PushInt ("Id", call.id);
+		switch (call.kind)
+		{
+		case AvocadoRecordedCall::MOUSE_MESSAGE:
+			pl->PushInt ("MouseMsg", int (call.mouseMsg));
+			pl->PushInt ("X", call.x);
+			pl->PushInt ("Y", call.y);
+			pl->PushInt ("ZDelta", call.zDelta);
+			break;
+		case AvocadoRecordedCall::VIEW_MESSAGE:
+			pl->PushString ("Msg", call.msg);
+			pl->PushString ("Params", call.paramStr);
+			pl->PushBool ("ToAllModules", call.toAllModules);
+			break;
+		case AvocadoRecordedCall::DOC_MESSAGE:
+			pl->PushString ("Msg", call.msg);
+			pl->PushString ("Params", call.paramStr);
+			pl->PushString ("TargetModule", call.targetModule);
+			break;
+		case AvocadoRecordedCall::SIZE_VIEW:
+			pl->PushInt ("X", call.x);
+			pl->PushInt ("Y", call.y);
+			break;
+		case AvocadoRecordedCall::SERIALIZE_DOC:
+			pl->PushString ("Params", call.paramStr);
+			pl->PushBool ("IsImport", call.isImport);
+			pl->PushBool ("IsStoring", call.isStoring);
+			break;
+		default:
+			break;
+		}
+		const string data = pl->SerializeBinary ();
+		unsigned char len[4];
+		for (int i=0;i<4;i++)
+			len[i] = (unsigned char)((data.size () >> (8 * i)) & 0xff);
+		fwrite (len, 1, 4, m_file);
+		fwrite (data.data (), 1, data.size (), m_file);
+		// a session that ends in a crash is the one we want to replay.
+		fflush (m_file);
+		LeaveCriticalSection (&m_lock->m_section);
+	}
+
+	void AvocadoMessageRecorder::RecordMouseMessage (AvcMouseActType msg, int viewId, int x, int y, int zDelta)
+	{
+		AvocadoRecordedCall call;
+		call.kind = AvocadoRecordedCall::MOUSE_MESSAGE;
+		call.id = viewId;
+		call.mouseMsg = msg;
+		call.x = x;
+		call.y = y;
+		call.zDelta = zDelta;
+		Record (call);
+	}
+
+	void AvocadoMessageRecorder::RecordViewMessage (const std::string &msg, int viewId, const std::string &paramStr, bool toAllModules)
+	{
+		AvocadoRecordedCall call;
+		call.kind = AvocadoRecordedCall::VIEW_MESSAGE;
+		call.id = viewId;
+		call.msg = msg;
+		call.paramStr = paramStr;
+		call.toAllModules = toAllModules;
+		Record (call);
+	}
+
+	void AvocadoMessageRecorder::RecordDocMessage (const std::string &msg, int docId, const std::string &paramStr, const std::string &targetModule)
+	{
+		AvocadoRecordedCall call;
+		call.kind = AvocadoRecordedCall::DOC_MESSAGE;
+		call.id = docId;
+		call.msg = msg;
+		call.paramStr = paramStr;
+		call.targetModule = targetModule;
+		Record (call);
+	}
+
+	void AvocadoMessageRecorder::RecordCall (AvocadoRecordedCall::Kind kind, int id, int x, int y)
+	{
+		AvocadoRecordedCall call;
+		call.kind = kind;
+		call.id = id;
+		call.x = x;
+		call.y = y;
+		Record (call);
+	}
+
+	void AvocadoMessageRecorder::RecordSerializeDoc (int docId, const std::string &path, bool isImport, bool isStoring)
+	{
+		AvocadoRecordedCall call;
+		call.kind = AvocadoRecordedCall::SERIALIZE_DOC;
+		call.id = docId;
+		call.paramStr = path;
+		call.isImport = isImport;
+		call.isStoring = isStoring;
+		Record (call);
+	}
+
+	bool AvocadoMessageRecorder::ReadRecording (const std::string &path, std::vector<AvocadoRecordedCall> &calls)
+	{
+		FILE *f = fopen (path.c_str (), "rb");
+		if (!f)
+			return false;
+		char magic[sizeof (s_recordingMagic) - 1];
+		if (fread (magic, 1, sizeof (magic), f) != sizeof (magic) || memcmp (magic, s_recordingMagic, sizeof (magic)) != 0)
+		{
+			fclose (f);
+			return false;
+		}
+		string data;
+		unsigned char len[4];
+		// a recording cut short by a crash keeps every complete call.
+		while (fread (len, 1, 4, f) == 4)
+		{
+			const size_t size = size_t (len[0]) | (size_t (len[1]) << 8) | (size_t (len[2]) << 16) | (size_t (len[3]) << 24);
+			if (size > (1u << 28))
+				break;
+			data.resize (size);
+			if (size > 0 && fread (&data[0], 1, size, f) != size)
+				break;
+			ParamListSharedPtr pl = ParamList::createFromBinary (data);
+			AvocadoRecordedCall call;
+			int kind = 0, timeMs = 0, timeUs = 0, mouseMsg = 0;
+			if (!pl->GetIntValueByName ("Kind", kind) || kind < AvocadoRecordedCall::MOUSE_MESSAGE || kind > AvocadoRecordedCall::SET_ACTIVE_DOC)
+				break;
+			call.kind = AvocadoRecordedCall::Kind (kind);
+			pl->GetIntValueByName ("TimeMs", timeMs);
+			pl->GetIntValueByName ("TimeUs", timeUs);
+			call.timeMs = timeMs + timeUs / 1000.0;
+			pl->GetIntValueByName ("Id", call.id);
+			if (pl->GetIntValueByName ("MouseMsg", mouseMsg))
+			{
+				if (mouseMsg < AVC_MOUSE_LDOWN || mouseMsg > AVC_TIMER_TICK)
+					break;
+				call.mouseMsg = AvcMouseActType (mouseMsg);
+			}
+			pl->GetIntValueByName ("X", call.x);
+			pl->GetIntValueByName ("Y", call.y);
+			pl->GetIntValueByName ("ZDelta", call.zDelta);
+			pl->GetStringValueByName ("Msg", call.msg);
+			pl->GetStringValueByName ("Params", call.paramStr);
+			pl->GetStringValueByName ("TargetModule", call.targetModule);
+			pl->GetBoolValueByName ("ToAllModules", call.toAllModules);
+			pl->GetBoolValueByName ("IsImport", call.isImport);
+			pl->GetBoolValueByName ("IsStoring", call.isStoring);
+			calls.push_back (call);
+		}
+		fclose (f);
+		return true;
+	}
+}
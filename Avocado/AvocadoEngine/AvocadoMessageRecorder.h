@@ -0,0 +1,88 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include "AvocadoAppInterface.h"
+#include "AvocadoParams.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+
+namespace avocado
+{
+	/* One call to an engine entry point, as the host made it. */
+	struct AvocadoRecordedCall
+	{
+		enum Kind
+		{
+			MOUSE_MESSAGE = 0,
+			VIEW_MESSAGE,
+			DOC_MESSAGE,
+			CREATE_DOC,
+			CREATE_VIEW,
+			SIZE_VIEW,
+			SERIALIZE_DOC,
+			SET_ACTIVE_DOC
+		};
+		AvocadoRecordedCall () : kind (MOUSE_MESSAGE), timeMs (0.0), id (-1), mouseMsg (AVC_MOUSE_MOVE), x (0), y (0), zDelta (0),
+			toAllModules (true), isImport (false), isStoring (false) {}
+		/* the message name, or the entry point name for the other kinds. */
+		std::string		GetName () const;
+
+		Kind			kind;
+		double			timeMs;		// since the recording started
+		int				id;			// view or doc id, the created one for CREATE_DOC and CREATE_VIEW
+		std::string		msg;
+		AvcMouseActType	mouseMsg;
+		int				x;			// SIZE_VIEW keeps the size in x,y
+		int				y;
+		int				zDelta;
+		std::string		paramStr;	// SERIALIZE_DOC keeps the path here
+		std::string		targetModule;
+		bool			toAllModules;
+		bool			isImport;
+		bool			isStoring;
+	};
+
+	/* Writes every call the host makes into the engine to a file, for AvocadoReplay.
+	   Only outermost calls are written, whatever the engine sends to itself while handling them is replayed by the engine.
+	   The file is a magic line followed by length prefixed binary ParamLists, one per call. */
+	class AvocadoMessageRecorder
+	{
+	public:
+		AvocadoMessageRecorder ();
+		~AvocadoMessageRecorder ();
+
+		bool			Start (const std::string &path);
+		void			Stop ();
+		bool			IsRecording () const { return m_file != NULL; }
+
+		void			RecordMouseMessage (AvcMouseActType msg, int viewId, int x, int y, int zDelta);
+		void			RecordViewMessage (const std::string &msg, int viewId, const std::string &paramStr, bool toAllModules);
+		void			RecordDocMessage (const std::string &msg, int docId, const std::string &paramStr, const std::string &targetModule);
+		void			RecordCall (AvocadoRecordedCall::Kind kind, int id, int x = 0, int y = 0);
+		void			RecordSerializeDoc (int docId, const std::string &path, bool isImport, bool isStoring);
+
+		static bool		ReadRecording (const std::string &path, std::vector<AvocadoRecordedCall> &calls);
+	private:
+		void			Record (AvocadoRecordedCall &call);
+
+		struct Lock;
+		FILE				*m_file;
+		Lock				*m_lock;
+		__int64				m_start;
+		double				m_msPerTick;
+	};
+
+	/* Put at the top of each engine entry point. IsOutermost tells whether the host called it,
+	   rather than the engine while handling another call on the same thread. */
+	class AvocadoRecordGuard
+	{
+	public:
+		AvocadoRecordGuard () { s_depth++; }
+		~AvocadoRecordGuard () { s_depth--; }
+		bool			IsOutermost () const { return s_depth == 1; }
+	private:
+		static __declspec(thread) int	s_depth;
+	};
+}
@@ -0,0 +1,265 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoMessageStats.h"
+#include <hash_map>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <windows.h>
+
+namespace avocado
+{
+	AvocadoLatencyCounter::AvocadoLatencyCounter () : count (0), totalMs (0.0), maxMs (0.0)
+	{
+		for (int b=0;b<AVC_STATS_BUCKETS;b++)
+			histogram[b] = 0;
+	}
+
+	void AvocadoLatencyCounter::Add (double ms)
+	{
+		count++;
+		totalMs += ms;
+		if (ms > maxMs)
+			maxMs = ms;
+		int b = 0;
+		double limitMs = 0.01;
+		while (b < AVC_STATS_BUCKETS - 1 && ms >= limitMs)
+		{
+			b++;
+			limitMs *= 2.0;
+		}
+		histogram[b]++;
+	}
+
+	/* One module's counters, indexed by message id. */
+	struct AvocadoModuleCounters
+	{
+		std::string								name;
+		std::vector<AvocadoLatencyCounter>		messages;
+	};
+
+	struct AvocadoStatsPool
+	{
+		AvocadoStatsPool ()
+		{
+			InitializeCriticalSection (&m_lock);
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency (&freq);
+			m_msPerTick = 1000.0 / double (freq.QuadPart);
+		}
+		~AvocadoStatsPool () { DeleteCriticalSection (&m_lock); }
+		CRITICAL_SECTION						m_lock;
+		double									m_msPerTick;
+		std::vector<AvocadoLatencyCounter>		m_messages;
+		std::hash_map<std::string,size_t>		m_moduleIndex;
+		std::vector<AvocadoModuleCounters>		m_modules;
+	};
+
+	static AvocadoStatsPool& GetStatsPool ()
+	{
+		static AvocadoStatsPool pool;
+		return pool;
+	}
+
+	bool AvocadoMessageStats::s_enabled = false;
+
+	void AvocadoMessageStats::SetEnabled (bool enabled)
+	{
+		GetStatsPool ();
+		s_enabled = enabled;
+	}
+
+	void AvocadoMessageStats::Reset ()
+	{
+		AvocadoStatsPool &pool = GetStatsPool ();
+		EnterCriticalSection (&pool.m_lock);
+		pool.m_messages.clear ();
+		pool.m_moduleIndex.clear ();
+		pool.m_modules.clear ();
+		LeaveCriticalSection (&pool.m_lock);
+	}
+
+	__int64 AvocadoMessageStats::GetTicks ()
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter (&now);
+		return now.QuadPart;
+	}
+
+	double AvocadoMessageStats::TicksToMs (__int64 ticks)
+	{
+		return double (ticks) * GetStatsPool ().m_msPerTick;
+	}
+
+	AvocadoMessageId AvocadoMessageStats::GetMouseMessageId (AvcMouseActType msg)
+	{
+		static const char *s_names[AVC_MOUSE_ACT_COUNT] = { "AVC_MOUSE_LDOWN", "AVC_MOUSE_LUP", "AVC_MOUSE_MDOWN", "AVC_MOUSE_MUP",
+			"AVC_MOUSE_RUP", "AVC_MOUSE_RDOWN", "AVC_MOUSE_MOVE", "AVC_MOUSE_WHEEL", "AVC_TIMER_TICK" };
+		static AvocadoMessageId s_ids[AVC_MOUSE_ACT_COUNT];
+		static bool s_registered = false;
+		if (msg < 0 || msg >= AVC_MOUSE_ACT_COUNT)
+			return AVC_INVALID_MESSAGE_ID;
+		if (!s_registered)
+		{
+			for (int m=0;m<AVC_MOUSE_ACT_COUNT;m++)
+				s_ids[m] = AvocadoMessageRegistry::RegisterMessage (s_names[m]);
+			s_registered = true;
+		}
+		return s_ids[msg];
+	}
+
+	void AvocadoMessageStats::Add (const std::string &msg, AvocadoMessageId msgId, const AvocadoMessageHandler *module, double ms)
+	{
+		if (msgId == AVC_INVALID_MESSAGE_ID)
+			msgId = AvocadoMessageRegistry::RegisterMessage (msg);
+		AvocadoStatsPool &pool = GetStatsPool ();
+		EnterCriticalSection (&pool.m_lock);
+		std::vector<AvocadoLatencyCounter> *counters = &pool.m_messages;
+		if (module)
+		{
+			std::hash_map<std::string,size_t>::iterator it = pool.m_moduleIndex.find (module->m_name);
+			size_t index;
+			if (it != pool.m_moduleIndex.end ())
+			{
+				index = it->second;
+			}
+			else
+			{
+				index = pool.m_modules.size ();
+				pool.m_moduleIndex[module->m_name] = index;
+				pool.m_modules.push_back (AvocadoModuleCounters ());
+				pool.m_modules.back ().name = module->m_name;
+			}
+			counters = &pool.m_modules[index].messages;
+		}
+		if (counters->size () <= size_t (msgId))
+			counters->resize (size_t (msgId) + 1);
+		(*counters)[msgId].Add (ms);
+		LeaveCriticalSection (&pool.m_lock);
+	}
+
+	static void PushCounter (ParamListSharedPtr &pl, const std::string &prefix, size_t row, const AvocadoLatencyCounter &counter)
+	{
+		std::stringstream rowStr;
+		rowStr << row;
+		pl->PushInt (prefix + "Count" + rowStr.str (), int (counter.count));
+		pl->PushFloat (prefix + "TotalMs" + rowStr.str (), float (counter.totalMs));
+		pl->PushFloat (prefix + "MaxMs" + rowStr.str (), float (counter.maxMs));
+		int histogram[AVC_STATS_BUCKETS];
+		for (int b=0;b<AVC_STATS_BUCKETS;b++)
+			histogram[b] = int (counter.histogram[b]);
+		pl->PushIntArray (prefix + "Histogram" + rowStr.str (), histogram, AVC_STATS_BUCKETS);
+	}
+
+	ParamListSharedPtr AvocadoMessageStats::GetStats ()
+	{
+		ParamListSharedPtr pl = ParamList::createNew ();
+		pl->PushBool ("Enabled", s_enabled);
+		int limits[AVC_STATS_BUCKETS - 1];
+		for (int b=0;b<AVC_STATS_BUCKETS - 1;b++)
+			limits[b] = 10 << b;
+		pl->PushIntArray ("HistogramLimitsUs", limits, AVC_STATS_BUCKETS - 1);
+
+		AvocadoStatsPool &pool = GetStatsPool ();
+		EnterCriticalSection (&pool.m_lock);
+		int row = 0;
+		for (size_t id=0;id<pool.m_messages.size ();id++)
+		{
+			if (pool.m_messages[id].count == 0)
+				continue;
+			std::stringstream rowStr;
+			rowStr << row;
+			pl->PushString ("Message" + rowStr.str (), AvocadoMessageRegistry::GetMessageName (AvocadoMessageId (id)));
+			PushCounter (pl, "", row, pool.m_messages[id]);
+			row++;
+		}
+		pl->PushInt ("MessageCount", row);
+		row = 0;
+		for (size_t m=0;m<pool.m_modules.size ();m++)
+		{
+			const AvocadoModuleCounters &module = pool.m_modules[m];
+			for (size_t id=0;id<module.messages.size ();id++)
+			{
+				if (module.messages[id].count == 0)
+					continue;
+				std::stringstream rowStr;
+				rowStr << row;
+				pl->PushString ("ModuleName" + rowStr.str (), module.name);
+				pl->PushString ("ModuleMessage" + rowStr.str (), AvocadoMessageRegistry::GetMessageName (AvocadoMessageId (id)));
+				PushCounter (pl, "Module", row, module.messages[id]);
+				row++;
+			}
+		}
+		pl->PushInt ("ModuleRowCount", row);
+		LeaveCriticalSection (&pool.m_lock);
+		return pl;
+	}
+
+	struct AvocadoStatsRow
+	{
+		std::string				name;
+		AvocadoLatencyCounter	counter;
+		bool operator < (const AvocadoStatsRow &other) const { return counter.totalMs > other.counter.totalMs; }
+	};
+
+	static void DumpRows (std::ofstream &out, std::vector<AvocadoStatsRow> &rows)
+	{
+		std::sort (rows.begin (), rows.end ());
+		for (size_t i=0;i<rows.size ();i++)
+		{
+			const AvocadoLatencyCounter &c = rows[i].counter;
+			out << std::left << std::setw (48) << rows[i].name << std::right
+				<< std::setw (10) << c.count
+				<< std::setw (14) << std::fixed << std::setprecision (3) << c.totalMs
+				<< std::setw (12) << (c.count ? c.totalMs / c.count : 0.0)
+				<< std::setw (12) << c.maxMs << "   ";
+			for (int b=0;b<AVC_STATS_BUCKETS;b++)
+				out << " " << c.histogram[b];
+			out << std::endl;
+		}
+	}
+
+	bool AvocadoMessageStats::Dump (const std::string &path)
+	{
+		std::ofstream out (path.c_str ());
+		if (!out.is_open ())
+			return false;
+		std::vector<AvocadoStatsRow> messages, modules;
+		AvocadoStatsPool &pool = GetStatsPool ();
+		EnterCriticalSection (&pool.m_lock);
+		for (size_t id=0;id<pool.m_messages.size ();id++)
+		{
+			if (pool.m_messages[id].count == 0)
+				continue;
+			AvocadoStatsRow row;
+			row.name = AvocadoMessageRegistry::GetMessageName (AvocadoMessageId (id));
+			row.counter = pool.m_messages[id];
+			messages.push_back (row);
+		}
+		for (size_t m=0;m<pool.m_modules.size ();m++)
+		{
+			for (size_t id=0;id<pool.m_modules[m].messages.size ();id++)
+			{
+				if (pool.m_modules[m].messages[id].count == 0)
+					continue;
+				AvocadoStatsRow row;
+				row.name = pool.m_modules[m].name + "::" + AvocadoMessageRegistry::GetMessageName (AvocadoMessageId (id));
+				row.counter = pool.m_modules[m].messages[id];
+				modules.push_back (row);
+			}
+		}
+		LeaveCriticalSection (&pool.m_lock);
+
+		out << "Avocado engine message statistics, times in ms, histogram buckets of 10us * 2^b" << std::endl << std::endl;
+		out << std::left << std::setw (48) << "message" << std::right << std::setw (10) << "calls" << std::setw (14) << "total"
+			<< std::setw (12) << "average" << std::setw (12) << "max" << "    histogram" << std::endl;
+		DumpRows (out, messages);
+		out << std::endl << std::left << std::setw (48) << "module::message" << std::right << std::setw (10) << "calls" << std::setw (14) << "total"
+			<< std::setw (12) << "average" << std::setw (12) << "max" << "    histogram" << std::endl;
+		DumpRows (out, modules);
+		return out.good ();
+	}
+}
@@ -0,0 +1,81 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include "AvocadoMessageHandler.h"
+#include <string>
+
+namespace avocado
+{
+	/* Bucket b counts the calls faster than 10us * 2^b, the last bucket takes everything slower. */
+	#define AVC_STATS_BUCKETS 16
+
+	struct AvocadoLatencyCounter
+	{
+		AvocadoLatencyCounter ();
+		void			Add (double ms);
+
+		unsigned int	count;
+		double			totalMs;
+		double			maxMs;
+		unsigned int	histogram[AVC_STATS_BUCKETS];
+	};
+
+	/* Message latency counters, per message name and per handling module.
+	   Off by default (engine option "engine_stats" or the EnableEngineStats message), when off a dispatch only tests a flag.
+	   The engine answers GetEngineStats through AvocadoDocInterface::DocParamChanged ("EngineStats",...) with the GetStats list,
+	   ResetEngineStats clears the counters and DumpEngineStats writes a table to the file given as parameter. */
+	class AvocadoMessageStats
+	{
+	public:
+		static bool					IsEnabled () { return s_enabled; }
+		static void					SetEnabled (bool enabled);
+		static void					Reset ();
+
+		/* msgId may be AVC_INVALID_MESSAGE_ID, then msg is registered. module NULL is the whole message as the engine sent it. */
+		static void					Add (const std::string &msg, AvocadoMessageId msgId, const AvocadoMessageHandler *module, double ms);
+		static AvocadoMessageId		GetMouseMessageId (AvcMouseActType msg);
+
+		/* "Enabled", "HistogramLimitsUs", then "MessageCount" rows of Message<i> Count<i> TotalMs<i> MaxMs<i> Histogram<i>
+		   and "ModuleRowCount" rows of the same with a ModuleName<i> / ModuleMessage<i> prefix. */
+		static ParamListSharedPtr	GetStats ();
+		static bool					Dump (const std::string &path);
+
+		static __int64				GetTicks ();
+		static double				TicksToMs (__int64 ticks);
+	private:
+		static bool					s_enabled;
+	};
+
+	/* Times one dispatch from construction to destruction. Costs a flag test when the stats are off. */
+	class AvocadoStatsScope
+	{
+	public:
+		AvocadoStatsScope (const std::string &msg, AvocadoMessageId msgId = AVC_INVALID_MESSAGE_ID, const AvocadoMessageHandler *module = NULL)
+			: m_msg (&msg), m_msgId (msgId), m_module (module), m_active (AvocadoMessageStats::IsEnabled ()), m_start (0)
+		{
+			if (m_active)
+				m_start = AvocadoMessageStats::GetTicks ();
+		}
+		AvocadoStatsScope (AvcMouseActType msg, const AvocadoMessageHandler *module = NULL)
+			: m_msg (NULL), m_msgId (AVC_INVALID_MESSAGE_ID), m_module (module), m_active (AvocadoMessageStats::IsEnabled ()), m_start (0)
+		{
+			if (m_active)
+			{
+				m_msgId = AvocadoMessageStats::GetMouseMessageId (msg);
+				m_start = AvocadoMessageStats::GetTicks ();
+			}
+		}
+		~AvocadoStatsScope ()
+		{
+			if (m_active)
+				AvocadoMessageStats::Add (m_msg ? *m_msg : std::string (), m_msgId, m_module, AvocadoMessageStats::TicksToMs (AvocadoMessageStats::GetTicks () - m_start));
+		}
+	private:
+		const std::string				*m_msg;
+		AvocadoMessageId				m_msgId;
+		const AvocadoMessageHandler		*m_module;
+		bool							m_active;
+		__int64							m_start;
+	};
+}
@@ -44,6 +44,7 @@ namespace avocado
 	bool AvocadoNetwork::OnRegister()
 	{
 		AvocadoSoapClient as;
+		SubscribeMessage ("DownloadFile");
 		return true;
 	}
 }
\ No newline at end of file
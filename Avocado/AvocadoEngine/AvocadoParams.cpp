@@ -5,16 +5,398 @@
 #include "AvocadoParams.h"
 #include <iostream> 
 #include <fstream>
+#include <sstream>
+#include <new>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <windows.h>
 
 #include <nvutil/DbgNew.h>
 namespace avocado {
 
+	//----------------------------------------------
+	// Value scanners used by createFromString.
+	// They work on [begin,end) ranges of the list arena so no temporary strings are created.
+
+	static const size_t PARAM_ARENA_ALIGN = 8;
+	static const size_t PARAM_ARENA_MIN_BLOCK = 1024;
+	// lists shorter than this are scanned, hashing a handful of names is not worth a table.
+	static const size_t PARAM_INDEX_MIN_SIZE = 8;
+
+	static int ScanInt (const char *begin, const char *end)
+	{
+		const char *c = begin;
+		while (c < end && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n'))
+			c++;
+		bool neg = false;
+		if (c < end && (*c == '-' || *c == '+'))
+		{
+			neg = (*c == '-');
+			c++;
+		}
+		if (c == end || *c < '0' || *c > '9')
+			return 0;
+		long long acc = 0;
+		while (c < end && *c >= '0' && *c <= '9')
+		{
+			if (acc <= (long long)INT_MAX + 1)
+				acc = acc * 10 + (*c - '0');
+			c++;
+		}
+		if (neg)
+			acc = -acc;
+		if (acc > INT_MAX)
+			return INT_MAX;
+		if (acc < INT_MIN)
+			return INT_MIN;
+		return (int)acc;
+	}
+
+	static float ScanFloat (const char *begin, const char *end)
+	{
+		// copy only the decimal part we care about, so strtod never reads past the value.
+		char buf[64];
+		size_t n = 0;
+		const char *c = begin;
+		while (c < end && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n'))
+			c++;
+		while (c < end && n < sizeof(buf) - 1)
+		{
+			char ch = *c;
+			if ((ch >= '0' && ch <= '9') || ch == '.' || ch == '-' || ch == '+' || ch == 'e' || ch == 'E')
+				buf[n++] = ch;
+			else
+				break;
+			c++;
+		}
+		buf[n] = 0;
+		if (n == 0)
+			return 0.0f;
+		return (float)strtod (buf, 0);
+	}
+
+	static size_t CountCells (const char *begin, const char *end, char sep)
+	{
+		if (begin == end)
+			return 0;
+		size_t n = 1;
+		for (const char *c = begin; c < end; c++)
+		{
+			if (*c == sep)
+				n++;
+		}
+		// a trailing separator does not open a new cell, "1F2F" holds two.
+		if (end[-1] == sep)
+			n--;
+		return n;
+	}
+
+	/* Walks a length prefixed string[] value starting at begin. It may run over ',' and ';' inside items,
+	   valueEnd gets the separator that closes the whole value (or end). Fills out when given, returns the item count. */
+	static size_t ScanStringItems (const char *begin, const char *end, ParamStringRef *out, const char **valueEnd)
+	{
+		size_t count = 0;
+		const char *c = begin;
+		while (c < end && *c != ',' && *c != ';')
+		{
+			size_t len = 0;
+			const char *digits = c;
+			while (c < end && *c >= '0' && *c <= '9')
+			{
+				len = len * 10 + size_t (*c - '0');
+				c++;
+			}
+			if (c == digits || c == end || *c != ':')
+			{
+				// not a length prefix, skip to the next separator and stop.
+				while (c < end && *c != ',' && *c != ';')
+					c++;
+				break;
+			}
+			c++;
+			if (len > size_t (end - c))
+				len = size_t (end - c);
+			if (out)
+			{
+				out[count].m_data = c;
+				out[count].m_length = len;
+			}
+			count++;
+			c += len;
+		}
+		*valueEnd = c;
+		return count;
+	}
+
+	static void AppendFloat (string &res, float f)
+	{
+		std::stringstream vs;
+		vs << f;
+		res.append (vs.str());
+	}
+
+	static void AppendSize (string &res, size_t n)
+	{
+		char buf[32];
+		size_t k = 0;
+		do
+		{
+			buf[k++] = char ('0' + n % 10);
+			n /= 10;
+		} while (n);
+		while (k)
+			res += buf[--k];
+	}
+
+	//----------------------------------------------
+	// Binary form helpers.
+	// Layout : magic, varint param count, then per param a type tag (ParamTypeId), varint name length and the name bytes,
+	// followed by the value. ints are zigzag varints, floats are 4 little endian bytes, float16 is 16 of those,
+	// bools one byte, pointers 8 little endian bytes, strings a varint length and the bytes.
+	// Arrays start with a varint item count (matrices for float16[]) and then the items in the same encoding.
+
+	static const char PARAM_BINARY_MAGIC[4] = { '\x01', 'A', 'P', 'B' };
+	static const size_t PARAM_BINARY_MAGIC_SIZE = 4;
+
+	static void PutVarint (string &res, unsigned long long v)
+	{
+		while (v >= 0x80)
+		{
+			res += char ((v & 0x7f) | 0x80);
+			v >>= 7;
+		}
+		res += char (v);
+	}
+
+	static void PutInt (string &res, int v)
+	{
+		// zigzag, so small negative numbers stay short too.
+		PutVarint (res, ((unsigned int)v << 1) ^ (unsigned int)(v >> 31));
+	}
+
+	static void PutFloat (string &res, float f)
+	{
+		unsigned int bits;
+		memcpy (&bits, &f, sizeof(bits));
+		char b[4] = { char (bits), char (bits >> 8), char (bits >> 16), char (bits >> 24) };
+		res.append (b, 4);
+	}
+
+	static void PutBytes (string &res, const char *data, size_t len)
+	{
+		PutVarint (res, len);
+		res.append (data, len);
+	}
+
+	/* Bounds checked reader over the arena copy of a binary list. Every Get returns false once the input runs out. */
+	struct ParamBinaryReader
+	{
+		ParamBinaryReader (const char *begin, const char *end) : m_cur (begin), m_end (end) {}
+
+		bool GetVarint (unsigned long long &v)
+		{
+			v = 0;
+			for (int shift = 0; shift < 64 && m_cur < m_end; shift += 7)
+			{
+				unsigned char b = (unsigned char)*m_cur++;
+				v |= (unsigned long long)(b & 0x7f) << shift;
+				if (!(b & 0x80))
+					return true;
+			}
+			return false;
+		}
+		bool GetSize (size_t &n)
+		{
+			unsigned long long v;
+			// every counted thing takes at least a byte, so a larger count can only come from a broken input.
+			if (!GetVarint (v) || v > (unsigned long long)(m_end - m_cur))
+				return false;
+			n = size_t (v);
+			return true;
+		}
+		bool GetInt (int &i)
+		{
+			unsigned long long v;
+			if (!GetVarint (v))
+				return false;
+			unsigned int u = (unsigned int)v;
+			i = int (u >> 1) ^ -int (u & 1);
+			return true;
+		}
+		bool GetFloat (float &f)
+		{
+			if (m_end - m_cur < 4)
+				return false;
+			const unsigned char *b = (const unsigned char*)m_cur;
+			unsigned int bits = b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+			memcpy (&f, &bits, sizeof(f));
+			m_cur += 4;
+			return true;
+		}
+		bool GetBytes (const char *&data, size_t &len)
+		{
+			if (!GetSize (len) || len > size_t (m_end - m_cur))
+				return false;
+			data = m_cur;
+			m_cur += len;
+			return true;
+		}
+
+		const char *m_cur;
+		const char *m_end;
+	};
+
+	//----------------------------------------------
+	// ParamArena
+
+	ParamArena::ParamArena () : m_cur (0), m_end (0)
+	{
+	}
+
+	ParamArena::~ParamArena ()
+	{
+		for (size_t i=0;i<m_blocks.size();i++)
+			free (m_blocks[i]);
+		m_blocks.clear();
+		m_blockSizes.clear();
+	}
+
+	void ParamArena::AddBlock (size_t bytes)
+	{
+		if (bytes < PARAM_ARENA_MIN_BLOCK)
+			bytes = PARAM_ARENA_MIN_BLOCK;
+		char *block = (char*)malloc (bytes);
+		if (!block)
+			throw std::bad_alloc ();
+		m_blocks.push_back (block);
+		m_blockSizes.push_back (bytes);
+		m_cur = block;
+		m_end = block + bytes;
+	}
+
+	void ParamArena::Reserve (size_t bytes)
+	{
+		if ((size_t)(m_end - m_cur) < bytes)
+			AddBlock (bytes);
+	}
+
+	void* ParamArena::Allocate (size_t bytes)
+	{
+		bytes = (bytes + PARAM_ARENA_ALIGN - 1) & ~(PARAM_ARENA_ALIGN - 1);
+		if ((size_t)(m_end - m_cur) < bytes)
+		{
+			// grow geometrically so a long list needs only a few blocks.
+			size_t next = m_blocks.empty() ? PARAM_ARENA_MIN_BLOCK : (size_t)(m_end - m_blocks.back()) * 2;
+			AddBlock (next > bytes ? next : bytes);
+		}
+		void *res = m_cur;
+		m_cur += bytes;
+		return res;
+	}
+
+	const char* ParamArena::StoreString (const char *str, size_t len)
+	{
+		char *dst = (char*)Allocate (len + 1);
+		if (len)
+			memcpy (dst, str, len);
+		dst[len] = 0;
+		return dst;
+	}
+
+	void ParamArena::Reset ()
+	{
+		// keep the largest block around, the list is likely to be refilled with a similar size.
+		if (m_blocks.empty())
+			return;
+		size_t largest = 0;
+		for (size_t i=1;i<m_blocks.size();i++)
+		{
+			if (m_blockSizes[i] > m_blockSizes[largest])
+				largest = i;
+		}
+		char *keep = m_blocks[largest];
+		const size_t keepSize = m_blockSizes[largest];
+		for (size_t i=0;i<m_blocks.size();i++)
+		{
+			if (i != largest)
+				free (m_blocks[i]);
+		}
+		m_cur = keep;
+		m_end = keep + keepSize;
+		m_blocks.clear();
+		m_blockSizes.clear();
+		m_blocks.push_back (keep);
+		m_blockSizes.push_back (keepSize);
+	}
+
+	//----------------------------------------------
+	// ParamAtom
+
+	/* The intern pool lives for the whole process, atoms never die.
+	   It is created on first use so static atoms in other files are safe. */
+	struct ParamAtomPool
+	{
+		ParamAtomPool () { InitializeCriticalSection (&m_lock); }
+		~ParamAtomPool () { DeleteCriticalSection (&m_lock); }
+		CRITICAL_SECTION m_lock;
+		std::set <string> m_names;
+	};
+
+	static ParamAtomPool& GetParamAtomPool ()
+	{
+		static ParamAtomPool pool;
+		return pool;
+	}
+
+	unsigned int ParamAtom::HashName (const char *name, size_t len)
+	{
+		// FNV-1a
+		unsigned int h = 2166136261u;
+		for (size_t i=0;i<len;i++)
+		{
+			h ^= (unsigned char)name[i];
+			h *= 16777619u;
+		}
+		return h ? h : 1;	// 0 marks a Param name not hashed yet.
+	}
+
+	ParamAtom::ParamAtom () : m_name (""), m_length (0), m_hash (HashName ("", 0))
+	{
+	}
+
+	ParamAtom::ParamAtom (const char *name)
+	{
+		Intern (name, strlen (name));
+	}
+
+	ParamAtom::ParamAtom (const string &name)
+	{
+		Intern (name.data(), name.size());
+	}
+
+	void ParamAtom::Intern (const char *name, size_t len)
+	{
+		ParamAtomPool &pool = GetParamAtomPool ();
+		EnterCriticalSection (&pool.m_lock);
+		const string &interned = *(pool.m_names.insert (string (name, len)).first);
+		m_name = interned.c_str();
+		LeaveCriticalSection (&pool.m_lock);
+		m_length = len;
+		m_hash = HashName (name, len);
+	}
+
 	//----------------------------------------------
 	// Param
 
-	Param::Param (string name)
+	Param::Param (ParamTypeId type, const char *name, size_t nameLength)
 	{
+		m_typeId = type;
 		m_name = name;
+		m_nameLength = nameLength;
+		m_nameHash = 0;
 	}
 
 	Param::~Param()
@@ -43,21 +425,20 @@ namespace avocado {
 
 	bool Param::GetName  (string &name) 
 	{ 
-		name = m_name; 
+		name.assign (m_name, m_nameLength);
 		return true;
 	}
-	//----------------------------------------------
-	// IntParam
 
-	IntParam::IntParam(string name, int x) : Param(name)
+	bool Param::IsNamed (const char *name, size_t len) const
 	{
-		value = x; 
+		return len == m_nameLength && memcmp (name, m_name, len) == 0;
 	}
+	//----------------------------------------------
+	// IntParam
 
-	IntParam::IntParam(string name, string x) : Param(name)
+	IntParam::IntParam(const char *name, size_t nameLength, int x) : Param(PARAM_TYPE_INT, name, nameLength)
 	{
-		std::istringstream xs(x);
-		xs >> value;
+		value = x; 
 	}
 
 	string IntParam::GetType () 
@@ -88,17 +469,11 @@ namespace avocado {
 	//----------------------------------------------
 	// FloatParam
 
-	FloatParam::FloatParam(string name, float x) : Param(name)
+	FloatParam::FloatParam(const char *name, size_t nameLength, float x) : Param(PARAM_TYPE_FLOAT, name, nameLength)
 	{
 		value = x; 
 	}
 
-	FloatParam::FloatParam(string name, string x) : Param(name)
-	{
-		std::istringstream xs(x);
-		xs >> value;
-	}
-
 	string FloatParam::GetType () 
 	{
 		return "Float";
@@ -126,32 +501,17 @@ namespace avocado {
 	//----------------------------------------------
 	// Float16Param
 
-	Float16Param::Float16Param(string name, const float *x) : Param(name)
+	Float16Param::Float16Param(const char *name, size_t nameLength, const float *x) : Param(PARAM_TYPE_FLOAT16, name, nameLength)
 	{
 		if (x)
 		{
 			for (int i=0;i<16;i++)
 				value[i] = x[i]; 
 		}
-	}
-
-	Float16Param::Float16Param(string name, string x) : Param(name)
-	{
-		//std::istringstream xs(x);
-		size_t k=0;
-		size_t cell = 0;
-		while (k<x.size())
+		else
 		{
-			std::string temp  = "";
-			while (x[k] != 'F')
-			{
-				temp+= x[k];
-				k++;
-			}
-			std::istringstream xs(temp);
-			xs >> value[cell] ;
-			cell++;
-			k++;
+			for (int i=0;i<16;i++)
+				value[i] = 0.0f;
 		}
 	}
 
@@ -183,7 +543,7 @@ namespace avocado {
 	//----------------------------------------------
 	// BoolParam
 
-	BoolParam::BoolParam(string name, bool x) : Param(name)
+	BoolParam::BoolParam(const char *name, size_t nameLength, bool x) : Param(PARAM_TYPE_BOOL, name, nameLength)
 	{
 		value = x; 
 	}
@@ -192,13 +552,6 @@ namespace avocado {
 		value = val; 
 		return;
 	}
-	BoolParam::BoolParam(string name, string x) : Param(name)
-	{
-		if (x == "1") 
-			value = true; 
-		else 
-			value = false;
-	}
 
 	string BoolParam::GetType () 
 	{
@@ -223,9 +576,10 @@ namespace avocado {
 	//----------------------------------------------
 	// StringParam
 
-	StringParam::StringParam(string name, string x) : Param (name)
+	StringParam::StringParam(const char *name, size_t nameLength, const char *x, size_t xLength) : Param (PARAM_TYPE_STRING, name, nameLength)
 	{
-		value = x;
+		m_value = x;
+		m_valueLength = xLength;
 	}
 
 	string StringParam::GetType () 
@@ -235,35 +589,26 @@ namespace avocado {
 
 	bool StringParam::GetValue (string &val)
 	{
-		val = value; 
+		val.assign (m_value, m_valueLength);
 		return true;
 	}
 
 	bool StringParam::SetValue (string val)
 	{
-		value = val; 
+		// the arena is append only, so a changed value lives in the param itself.
+		m_ownedValue.swap (val);
+		m_value = m_ownedValue.c_str();
+		m_valueLength = m_ownedValue.size();
 		return true;
 	}
 	//----------------------------------------------
 	// PointerParam
 
-	PointerParam::PointerParam(string name , void * x) : Param (name)
+	PointerParam::PointerParam(const char *name, size_t nameLength, void * x) : Param (PARAM_TYPE_POINTER, name, nameLength)
 	{
 		value = x;
 	}
 
-	PointerParam::PointerParam(string name , string x) : Param (name) 
-	{
-		std::istringstream xs(x);
-#ifdef _AVENG64
-		int xi;
-#else
-		long xi;
-#endif
-		xs >> xi;
-		value = (void*)xi;
-	}
-
 	string PointerParam::GetType () 
 	{
 		return "Pointer";
@@ -275,57 +620,149 @@ namespace avocado {
 		return true; 
 	}
 
+	//----------------------------------------------
+	// IntArrayParam
+
+	IntArrayParam::IntArrayParam (const char *name, size_t nameLength, const int *values, size_t count) : Param (PARAM_TYPE_INT_ARRAY, name, nameLength)
+	{
+		m_values = values;
+		m_count = count;
+	}
+
+	string IntArrayParam::GetType ()
+	{
+		return "IntegerArray";
+	}
+
+	bool IntArrayParam::GetValue (vector <int> &val)
+	{
+		val.assign (m_values, m_values + m_count);
+		return true;
+	}
+
+	bool IntArrayParam::GetValue (string &val)
+	{
+		std::stringstream vs;
+		for (size_t i=0;i<m_count;i++)
+		{
+			if (i)
+				vs << ":";
+			vs << m_values[i];
+		}
+		val = vs.str();
+		return true;
+	}
+
+	//----------------------------------------------
+	// FloatArrayParam
+
+	FloatArrayParam::FloatArrayParam (const char *name, size_t nameLength, const float *values, size_t count) : Param (PARAM_TYPE_FLOAT_ARRAY, name, nameLength)
+	{
+		m_values = values;
+		m_count = count;
+	}
+
+	string FloatArrayParam::GetType ()
+	{
+		return "FloatArray";
+	}
+
+	bool FloatArrayParam::GetValue (vector <float> &val)
+	{
+		val.assign (m_values, m_values + m_count);
+		return true;
+	}
+
+	bool FloatArrayParam::GetValue (string &val)
+	{
+		val.clear();
+		for (size_t i=0;i<m_count;i++)
+		{
+			if (i)
+				val += ':';
+			AppendFloat (val, m_values[i]);
+		}
+		return true;
+	}
+
+	//----------------------------------------------
+	// Float16ArrayParam
+
+	Float16ArrayParam::Float16ArrayParam (const char *name, size_t nameLength, const float *values, size_t count) : Param (PARAM_TYPE_FLOAT16_ARRAY, name, nameLength)
+	{
+		m_values = values;
+		m_count = count;
+	}
+
+	string Float16ArrayParam::GetType ()
+	{
+		return "Float16Array";
+	}
+
+	bool Float16ArrayParam::GetValue (vector <float> &val)
+	{
+		val.assign (m_values, m_values + m_count * 16);
+		return true;
+	}
+
+	bool Float16ArrayParam::GetValue (string &val)
+	{
+		val.clear();
+		for (size_t i=0;i<m_count * 16;i++)
+		{
+			AppendFloat (val, m_values[i]);
+			val += 'F';
+		}
+		return true;
+	}
+
+	//----------------------------------------------
+	// StringArrayParam
+
+	StringArrayParam::StringArrayParam (const char *name, size_t nameLength, const ParamStringRef *values, size_t count) : Param (PARAM_TYPE_STRING_ARRAY, name, nameLength)
+	{
+		m_values = values;
+		m_count = count;
+	}
+
+	string StringArrayParam::GetType ()
+	{
+		return "StringArray";
+	}
+
+	bool StringArrayParam::GetValue (vector <string> &val)
+	{
+		val.resize (m_count);
+		for (size_t i=0;i<m_count;i++)
+			val[i].assign (m_values[i].m_data, m_values[i].m_length);
+		return true;
+	}
+
+	bool StringArrayParam::GetValue (string &val)
+	{
+		val.clear();
+		for (size_t i=0;i<m_count;i++)
+		{
+			AppendSize (val, m_values[i].m_length);
+			val += ':';
+			val.append (m_values[i].m_data, m_values[i].m_length);
+		}
+		return true;
+	}
+
 	//----------------------------------------------
 	// ParamList
 
-	ParamList::ParamList()
+	ParamList::ParamList() : m_indexedCount (0)
 	{
 		//m_list.clear();
 	}
 
 	ParamList::~ParamList()
 	{
+		// params live in m_arena, only their destructors are called here.
 		for (size_t i=0;i<m_list.size();i++)
-		{
-			Param* p = m_list[i];
-			if (p->GetType() == "Integer")
-			{
-				IntParam* pp = (IntParam*)p;
-				delete pp;
-			} 
-			else if (p->GetType() == "Boolean")
-			{
-				BoolParam* pp = (BoolParam*)p;
-				delete pp;
-			}
-			else if (p->GetType() == "String")
-			{
-				StringParam* pp = (StringParam*)p;
-				delete pp;
-			}
-			else if (p->GetType() == "Pointer")
-			{
-				PointerParam* pp = (PointerParam*)p;
-				delete pp;
-			} 
-			else if (p->GetType() == "Float")
-			{
-				FloatParam* pp = (FloatParam*)p;
-				delete pp;
-			} 
-			else if (p->GetType() == "Float16")
-			{
-				Float16Param* pp = (Float16Param*)p;
-				delete pp;
-			} 
-			else
-			{
-				int x=1;
-				x++;
-				//Assert !!
-			}
-
-		}
+			m_list[i]->~Param();
 		m_list.clear();
 	}
 
@@ -339,97 +776,190 @@ namespace avocado {
 	/* createFromString is one of the most important functions in Avocado */
 	/* it is called trilions times in each run, any performance improvement is welcome */
 	/* any error here might be critical */
+	/* The input is copied once into the list arena and scanned in a single pass.
+	   Names and string values are views into that copy, so a message costs a couple of allocations in total.
+	   A token with an unknown type (a string value holding ',' or ';') is glued to the last string param
+	   together with its separator, exactly like before. Such a token without a previous string is dropped,
+	   and text after the last separator is ignored. */
 	ParamListSharedPtr ParamList::createFromString (const string &params)
 	{
+		if (IsBinary (params))
+			return createFromBinary (params);
+
 		ParamList *plh = new ParamList;
 		ParamListSharedPtr res = ParamListSharedPtr(plh);
 
+		const size_t len = params.size();
+		if (len == 0)
+			return res;
+
+		size_t separators = 0;
+		for (size_t k=0;k<len;k++)
+		{
+			if (params[k] == ',' || params[k] == ';')
+				separators++;
+		}
+		if (separators == 0)
+			return res;
+
+		plh->m_list.reserve (separators);
+		plh->m_arena.Reserve (len + 1 + separators * (sizeof(Float16Param) + PARAM_ARENA_ALIGN));
+		const char *text = plh->m_arena.StoreString (params.data(), len);
+		const char *textEnd = text + len;
 
-		unsigned int pos = 0;
-		int last = -1;
-		int prevStringIdx = -1;
-		while (pos < params.size())
+		StringParam *prevString = 0;
+		const char *tokenBegin = text;
+		for (const char *c = text; c < textEnd; c++)
 		{
-			if (params[pos] == ',' || params[pos] == ';')
+			if (*c != ',' && *c != ';')
+				continue;
+
+			const char *tokenEnd = c;
+			const char *sq = 0;
+			const char *eq = 0;
+			for (const char *t = tokenBegin; t < tokenEnd && !(sq && eq); t++)
 			{
-				string param =  params.substr (last+1,pos-last-1);
-				size_t eq = param.find ("=");
-				size_t sq = param.find (" ");
+				if (!sq && *t == ' ')
+					sq = t;
+				if (!eq && *t == '=')
+					eq = t;
+			}
 
-				//if (sq > last + 1)
-				string type,name,value ;
-				{
-				if (sq == string::npos || eq == string::npos)
+			bool known = false;
+			if (sq && eq && eq > sq)
+			{
+				const char *name = sq + 1;
+				size_t nameLength = eq - name;
+				const char *val = eq + 1;
+				size_t typeLength = sq - tokenBegin;
+				known = true;
+				Param *p = 0;
+
+				if (typeLength == 3 && memcmp (tokenBegin, "int", 3) == 0)
 				{
-					type = "none";
+					p = new (plh->m_arena.Allocate (sizeof(IntParam))) IntParam (name, nameLength, ScanInt (val, tokenEnd));
+					prevString = 0;
 				}
-				else
+				else if (typeLength == 5 && memcmp (tokenBegin, "float", 5) == 0)
 				{
-					type =  param.substr (0,sq);
-					name = param.substr(sq+1,eq-sq-1);
-					value = param.substr (eq+1,param.size()-eq-1);
+					p = new (plh->m_arena.Allocate (sizeof(FloatParam))) FloatParam (name, nameLength, ScanFloat (val, tokenEnd));
+					prevString = 0;
 				}
-				if (type == "int")
+				else if (typeLength == 7 && memcmp (tokenBegin, "float16", 7) == 0)
 				{
-					prevStringIdx = -1;
-					(res)->m_list.push_back (new IntParam (name,value));
-				} else
-				if (type == "float")
+					float cells[16];
+					size_t cell = 0;
+					const char *cellBegin = val;
+					for (const char *f = val; f <= tokenEnd && cell < 16; f++)
+					{
+						if (f == tokenEnd || *f == 'F')
+						{
+							if (f == tokenEnd && f == cellBegin)
+								break;
+							cells[cell++] = ScanFloat (cellBegin, f);
+							cellBegin = f + 1;
+						}
+					}
+					while (cell < 16)
+						cells[cell++] = 0.0f;
+					p = new (plh->m_arena.Allocate (sizeof(Float16Param))) Float16Param (name, nameLength, cells);
+					prevString = 0;
+				}
+				else if (typeLength == 4 && memcmp (tokenBegin, "bool", 4) == 0)
 				{
-					prevStringIdx = -1;
-					(res)->m_list.push_back (new FloatParam (name,value));
+					bool b = (tokenEnd - val == 1 && *val == '1');
+					p = new (plh->m_arena.Allocate (sizeof(BoolParam))) BoolParam (name, nameLength, b);
+					prevString = 0;
 				}
-				else if (type == "float16")
+				else if (typeLength == 6 && memcmp (tokenBegin, "string", 6) == 0)
 				{
-					prevStringIdx = -1;
-					(res)->m_list.push_back (new Float16Param (name,value));
+					prevString = new (plh->m_arena.Allocate (sizeof(StringParam))) StringParam (name, nameLength, val, tokenEnd - val);
+					p = prevString;
 				}
-				else if (type == "bool")
+				else if (typeLength == 3 && memcmp (tokenBegin, "ptr", 3) == 0)
 				{
-					prevStringIdx = -1;
-					ParamListWriteLock(res)->m_list.push_back  (new BoolParam (name,value));
+#ifdef _AVENG64
+					int xi = ScanInt (val, tokenEnd);
+#else
+					long xi = ScanInt (val, tokenEnd);
+#endif
+					p = new (plh->m_arena.Allocate (sizeof(PointerParam))) PointerParam (name, nameLength, (void*)(intptr_t)xi);
+					prevString = 0;
 				}
-				else if (type == "string")
+				else if (typeLength == 5 && memcmp (tokenBegin, "int[]", 5) == 0)
 				{
-					prevStringIdx = (int)ParamListWriteLock(res)->m_list.size();
-					ParamListWriteLock(res)->m_list.push_back (new StringParam (name,value));
+					size_t count = CountCells (val, tokenEnd, ':');
+					int *values = (int*)plh->m_arena.Allocate (sizeof(int) * (count ? count : 1));
+					const char *cellBegin = val;
+					for (size_t k=0;k<count;k++)
+					{
+						const char *cellEnd = cellBegin;
+						while (cellEnd < tokenEnd && *cellEnd != ':')
+							cellEnd++;
+						values[k] = ScanInt (cellBegin, cellEnd);
+						cellBegin = cellEnd + 1;
+					}
+					p = new (plh->m_arena.Allocate (sizeof(IntArrayParam))) IntArrayParam (name, nameLength, values, count);
+					prevString = 0;
 				}
-				else if (type == "ptr")
+				else if ((typeLength == 7 && memcmp (tokenBegin, "float[]", 7) == 0) || (typeLength == 9 && memcmp (tokenBegin, "float16[]", 9) == 0))
 				{
-					prevStringIdx = -1;
-					ParamListWriteLock(res)->m_list.push_back (new PointerParam (name,value));
+					const bool isMatrix = (typeLength == 9);
+					const char cellSep = isMatrix ? 'F' : ':';
+					size_t cells = CountCells (val, tokenEnd, cellSep);
+					size_t count = isMatrix ? (cells + 15) / 16 : cells;
+					size_t floats = isMatrix ? count * 16 : count;
+					float *values = (float*)plh->m_arena.Allocate (sizeof(float) * (floats ? floats : 1));
+					const char *cellBegin = val;
+					for (size_t k=0;k<floats;k++)
+					{
+						if (k < cells)
+						{
+							const char *cellEnd = cellBegin;
+							while (cellEnd < tokenEnd && *cellEnd != cellSep)
+								cellEnd++;
+							values[k] = ScanFloat (cellBegin, cellEnd);
+							cellBegin = cellEnd + 1;
+						}
+						else
+							values[k] = 0.0f;
+					}
+					if (isMatrix)
+						p = new (plh->m_arena.Allocate (sizeof(Float16ArrayParam))) Float16ArrayParam (name, nameLength, values, count);
+					else
+						p = new (plh->m_arena.Allocate (sizeof(FloatArrayParam))) FloatArrayParam (name, nameLength, values, count);
+					prevString = 0;
 				}
-				else
+				else if (typeLength == 8 && memcmp (tokenBegin, "string[]", 8) == 0)
 				{
-				//	if (prevStringIdx != -1)
+					// items may hold separators, so the value decides where the token ends, not the first ',' we saw.
+					const char *valueEnd = 0;
+					size_t count = ScanStringItems (val, textEnd, 0, &valueEnd);
+					if (valueEnd < textEnd)
 					{
-						StringParam *p = (StringParam*)(ParamListWriteLock(res)->m_list[prevStringIdx]);
-						string val;
-						p->GetValue (val);
-					
-						val += params[last];
-						val += param;
-						// not sure about this one here..but I am almost sure that its needed.
-						//if (pos < params.size() - 1)
-					
-								
-						p->SetValue (val);
+						ParamStringRef *values = (ParamStringRef*)plh->m_arena.Allocate (sizeof(ParamStringRef) * (count ? count : 1));
+						ScanStringItems (val, textEnd, values, &valueEnd);
+						p = new (plh->m_arena.Allocate (sizeof(StringArrayParam))) StringArrayParam (name, nameLength, values, count);
 					}
-				//	else
-				//	{
-						// this is a big problem !!! we dont want to get here, never.
-				//	}
+					prevString = 0;
+					c = (valueEnd < textEnd) ? valueEnd : textEnd - 1;
 				}
-
+				else
+				{
+					known = false;
 				}
-						last = pos;
+
+				if (p)
+					plh->m_list.push_back (p);
 			}
-			pos++;
-		}
-		string param =  params.substr (last+1,pos-last-1);
-		if (param.size() > 1)
-		{
-			param.clear ();
+
+			if (!known && prevString)
+			{
+				// the previous string value ends right before our separator, so widening the view keeps it contiguous.
+				prevString->m_valueLength = tokenEnd - prevString->m_value;
+			}
+
+			tokenBegin = c + 1;
 		}
 		return res;
 	}	
@@ -437,6 +967,238 @@ namespace avocado {
 	{
 		return SerializeListLow(false);
 	}
+
+	const string ParamList::SerializeParam (size_t i)
+	{
+		string res ("");
+		if (i < m_list.size())
+			AppendParamText (res,m_list[i]);
+		return res;
+	}
+
+	bool ParamList::IsBinary (const string &params)
+	{
+		return params.size() >= PARAM_BINARY_MAGIC_SIZE && memcmp (params.data(), PARAM_BINARY_MAGIC, PARAM_BINARY_MAGIC_SIZE) == 0;
+	}
+
+	/* Like createFromString the input is copied once into the arena and names and strings are views into it.
+	   A truncated or corrupt list keeps the params decoded so far, an input without the magic gives an empty list. */
+	ParamListSharedPtr ParamList::createFromBinary (const string &params)
+	{
+		ParamList *plh = new ParamList;
+		ParamListSharedPtr res = ParamListSharedPtr(plh);
+		if (!IsBinary (params))
+			return res;
+
+		const size_t len = params.size();
+		const char *data = plh->m_arena.StoreString (params.data(), len);
+		ParamBinaryReader in (data + PARAM_BINARY_MAGIC_SIZE, data + len);
+		size_t count = 0;
+		if (!in.GetSize (count))
+			return res;
+		plh->m_list.reserve (count);
+
+		for (size_t k=0;k<count && in.m_cur < in.m_end;k++)
+		{
+			const ParamTypeId type = ParamTypeId ((unsigned char)*in.m_cur++);
+			const char *name = 0;
+			size_t nameLength = 0;
+			if (!in.GetBytes (name, nameLength))
+				break;
+			Param *p = 0;
+			switch (type)
+			{
+			case PARAM_TYPE_INT:
+				{
+					int v;
+					if (in.GetInt (v))
+						p = new (plh->m_arena.Allocate (sizeof(IntParam))) IntParam (name, nameLength, v);
+				}
+				break;
+			case PARAM_TYPE_FLOAT:
+				{
+					float v;
+					if (in.GetFloat (v))
+						p = new (plh->m_arena.Allocate (sizeof(FloatParam))) FloatParam (name, nameLength, v);
+				}
+				break;
+			case PARAM_TYPE_FLOAT16:
+				{
+					float v[16];
+					size_t cell = 0;
+					while (cell < 16 && in.GetFloat (v[cell]))
+						cell++;
+					if (cell == 16)
+						p = new (plh->m_arena.Allocate (sizeof(Float16Param))) Float16Param (name, nameLength, v);
+				}
+				break;
+			case PARAM_TYPE_BOOL:
+				if (in.m_cur < in.m_end)
+					p = new (plh->m_arena.Allocate (sizeof(BoolParam))) BoolParam (name, nameLength, *in.m_cur++ != 0);
+				break;
+			case PARAM_TYPE_STRING:
+				{
+					const char *v;
+					size_t vLength;
+					if (in.GetBytes (v, vLength))
+						p = new (plh->m_arena.Allocate (sizeof(StringParam))) StringParam (name, nameLength, v, vLength);
+				}
+				break;
+			case PARAM_TYPE_POINTER:
+				if (in.m_end - in.m_cur >= 8)
+				{
+					unsigned long long v = 0;
+					for (int b=7;b>=0;b--)
+						v = (v << 8) | (unsigned char)in.m_cur[b];
+					in.m_cur += 8;
+					p = new (plh->m_arena.Allocate (sizeof(PointerParam))) PointerParam (name, nameLength, (void*)(intptr_t)v);
+				}
+				break;
+			case PARAM_TYPE_INT_ARRAY:
+				{
+					size_t n;
+					if (!in.GetSize (n))
+						break;
+					int *values = (int*)plh->m_arena.Allocate (sizeof(int) * (n ? n : 1));
+					size_t i = 0;
+					while (i < n && in.GetInt (values[i]))
+						i++;
+					if (i == n)
+						p = new (plh->m_arena.Allocate (sizeof(IntArrayParam))) IntArrayParam (name, nameLength, values, n);
+				}
+				break;
+			case PARAM_TYPE_FLOAT_ARRAY:
+			case PARAM_TYPE_FLOAT16_ARRAY:
+				{
+					size_t n;
+					if (!in.GetSize (n))
+						break;
+					const size_t cells = (type == PARAM_TYPE_FLOAT16_ARRAY) ? 16 : 1;
+					if (n > size_t (in.m_end - in.m_cur) / (4 * cells))
+						break;
+					float *values = (float*)plh->m_arena.Allocate (sizeof(float) * (n ? n * cells : 1));
+					for (size_t i=0;i<n * cells;i++)
+						in.GetFloat (values[i]);
+					if (type == PARAM_TYPE_FLOAT16_ARRAY)
+						p = new (plh->m_arena.Allocate (sizeof(Float16ArrayParam))) Float16ArrayParam (name, nameLength, values, n);
+					else
+						p = new (plh->m_arena.Allocate (sizeof(FloatArrayParam))) FloatArrayParam (name, nameLength, values, n);
+				}
+				break;
+			case PARAM_TYPE_STRING_ARRAY:
+				{
+					size_t n;
+					if (!in.GetSize (n))
+						break;
+					ParamStringRef *values = (ParamStringRef*)plh->m_arena.Allocate (sizeof(ParamStringRef) * (n ? n : 1));
+					size_t i = 0;
+					while (i < n && in.GetBytes (values[i].m_data, values[i].m_length))
+						i++;
+					if (i == n)
+						p = new (plh->m_arena.Allocate (sizeof(StringArrayParam))) StringArrayParam (name, nameLength, values, n);
+				}
+				break;
+			}
+			if (!p)
+				break;
+			plh->m_list.push_back (p);
+		}
+		return res;
+	}
+
+	/* Binary counterpart of SerializeList, about the size of the text form for small messages and much smaller
+	   for numbers and arrays. Floats and matrices keep every bit, the text form rounds them to 6 digits. */
+	const string ParamList::SerializeBinary ()
+	{
+		string res (PARAM_BINARY_MAGIC, PARAM_BINARY_MAGIC_SIZE);
+		PutVarint (res, m_list.size());
+		for (size_t i=0;i<m_list.size();i++)
+		{
+			Param* p  = m_list[i];
+			res += char (p->GetTypeId());
+			PutBytes (res, p->GetNameData(), p->GetNameLength());
+			switch (p->GetTypeId())
+			{
+			case PARAM_TYPE_INT:
+				{
+					int val = 0;
+					((IntParam*)p)->GetValue (val);
+					PutInt (res, val);
+				}
+				break;
+			case PARAM_TYPE_FLOAT:
+				{
+					float val = 0.0f;
+					((FloatParam*)p)->GetValue (val);
+					PutFloat (res, val);
+				}
+				break;
+			case PARAM_TYPE_FLOAT16:
+				{
+					float val[16];
+					((Float16Param*)p)->GetValue (val);
+					for (int k=0;k<16;k++)
+						PutFloat (res, val[k]);
+				}
+				break;
+			case PARAM_TYPE_BOOL:
+				{
+					bool val = false;
+					((BoolParam*)p)->GetValue (val);
+					res += char (val ? 1 : 0);
+				}
+				break;
+			case PARAM_TYPE_STRING:
+				{
+					StringParam *sp = (StringParam*)p;
+					PutBytes (res, sp->m_value, sp->m_valueLength);
+				}
+				break;
+			case PARAM_TYPE_POINTER:
+				{
+					void* val = 0;
+					((PointerParam*)p)->GetValue (&val);
+					unsigned long long v = (unsigned long long)(intptr_t)val;
+					for (int b=0;b<8;b++)
+						res += char (v >> (8 * b));
+				}
+				break;
+			case PARAM_TYPE_INT_ARRAY:
+				{
+					IntArrayParam *ap = (IntArrayParam*)p;
+					PutVarint (res, ap->GetCount());
+					for (size_t k=0;k<ap->GetCount();k++)
+						PutInt (res, ap->GetData()[k]);
+				}
+				break;
+			case PARAM_TYPE_FLOAT_ARRAY:
+				{
+					FloatArrayParam *ap = (FloatArrayParam*)p;
+					PutVarint (res, ap->GetCount());
+					for (size_t k=0;k<ap->GetCount();k++)
+						PutFloat (res, ap->GetData()[k]);
+				}
+				break;
+			case PARAM_TYPE_FLOAT16_ARRAY:
+				{
+					Float16ArrayParam *ap = (Float16ArrayParam*)p;
+					PutVarint (res, ap->GetCount());
+					for (size_t k=0;k<ap->GetCount() * 16;k++)
+						PutFloat (res, ap->GetData()[k]);
+				}
+				break;
+			case PARAM_TYPE_STRING_ARRAY:
+				{
+					StringArrayParam *ap = (StringArrayParam*)p;
+					PutVarint (res, ap->GetCount());
+					for (size_t k=0;k<ap->GetCount();k++)
+						PutBytes (res, ap->GetData()[k].m_data, ap->GetData()[k].m_length);
+				}
+				break;
+			}
+		}
+		return res;
+	}
 	ParamListSharedPtr ParamList::createFromFile (string filename)
 	{
 		ifstream infile (filename);
@@ -467,86 +1229,105 @@ namespace avocado {
 		return true;
 	}
 	
-	const string ParamList::SerializeListLow (bool endOfLine)
+	/* The text of one param, a list is these one after the other. */
+	void ParamList::AppendParamText (string &res, Param *p)
 	{
-		string res ("");
-		for (size_t i=0;i<m_list.size();i++)
+		switch (p->GetTypeId())
 		{
-			Param* p  = m_list[i];
-			string name;
-			p->GetName (name);
-			if (p->GetType()=="Integer")
+		case PARAM_TYPE_INT:
 			{
 				int val ;
 				((IntParam*)p)->GetValue(val);
 				std::stringstream vs;
 				vs << val;
 				res.append ("int ");
-				res.append (name);
+				res.append (p->GetNameData(), p->GetNameLength());
 				res.append ("=");
 				res.append (vs.str());
 				res.append (",");
 			}
-			if (p->GetType()=="Float")
+			break;
+		case PARAM_TYPE_FLOAT:
 			{
 				float val ;
 				((FloatParam*)p)->GetValue(val);
 				std::stringstream vs;
 				vs << val;
 				res.append ("float ");
-				res.append (name);
+				res.append (p->GetNameData(), p->GetNameLength());
 				res.append ("=");
 				res.append (vs.str());
 				res.append (",");
 			}
-			if (p->GetType()=="Float16")
+			break;
+		case PARAM_TYPE_FLOAT16:
 			{
-				//1float val[16] ;
 				std::string val;
 				((Float16Param*)p)->GetValue(val);
-				std::stringstream vs;
-				vs << val;
 				res.append ("float16 ");
-				res.append (name);
+				res.append (p->GetNameData(), p->GetNameLength());
 				res.append ("=");
-				res.append (vs.str());
+				res.append (val);
 				res.append (",");
 			}
-			else if (p->GetType()=="Boolean")
+			break;
+		case PARAM_TYPE_BOOL:
 			{
 				bool val ;
 				((BoolParam*)p)->GetValue(val);
-				std::stringstream vs;
-				vs << val;
 				res.append ("bool ");
-				res.append (name);
-				res.append ("=");
-				res.append (vs.str());
-				res.append (",");
+				res.append (p->GetNameData(), p->GetNameLength());
+				res.append (val ? "=1," : "=0,");
 			}
-			else if (p->GetType()=="String")
+			break;
+		case PARAM_TYPE_STRING:
 			{
-				string val;
-				((StringParam*)p)->GetValue(val);		
+				StringParam *sp = (StringParam*)p;
 				res.append ("string ");
-				res.append (name);
+				res.append (p->GetNameData(), p->GetNameLength());
 				res.append ("=");
-				res.append (val);
+				res.append (sp->m_value, sp->m_valueLength);
 				res.append (",");
 			}
-			else if (p->GetType()== "Pointer")
+			break;
+		case PARAM_TYPE_POINTER:
 			{
 				void* val ;
 				((PointerParam*)p)->GetValue(&val);
-				int vp = (int)val;
+				int vp = (int)(intptr_t)val;
 				std::stringstream vs;
 				vs << vp;
 				res.append ("ptr ");
-				res.append (name);
+				res.append (p->GetNameData(), p->GetNameLength());
 				res.append ("=");
 				res.append (vs.str());
 				res.append (",");
 			}
+			break;
+		case PARAM_TYPE_INT_ARRAY:
+		case PARAM_TYPE_FLOAT_ARRAY:
+		case PARAM_TYPE_FLOAT16_ARRAY:
+		case PARAM_TYPE_STRING_ARRAY:
+			{
+				static const char *arrayTypes[] = { "int[] ", "float[] ", "float16[] ", "string[] " };
+				string val;
+				p->GetValue (val);
+				res.append (arrayTypes[p->GetTypeId() - PARAM_TYPE_INT_ARRAY]);
+				res.append (p->GetNameData(), p->GetNameLength());
+				res.append ("=");
+				res.append (val);
+				res.append (",");
+			}
+			break;
+		}
+	}
+
+	const string ParamList::SerializeListLow (bool endOfLine)
+	{
+		string res ("");
+		for (size_t i=0;i<m_list.size();i++)
+		{
+			AppendParamText (res,m_list[i]);
 			if (endOfLine)
 				res.append ("\n");
 		}
@@ -556,80 +1337,123 @@ namespace avocado {
 
 	void ParamList::Clear()
 	{ 
+		for (size_t i=0;i<m_list.size();i++)
+			m_list[i]->~Param();
 		m_list.clear();
+		m_arena.Reset();
+		InvalidateNameIndex ();
 	}
 
 	/* Push Commands */
 	void ParamList::PushInt (string name, int i)
 	{
-		m_list.push_back(new IntParam (name,i));
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		m_list.push_back(new (m_arena.Allocate (sizeof(IntParam))) IntParam (n,name.size(),i));
 	}
 	void ParamList::PushFloat (string name, float f)
 	{
-		m_list.push_back(new FloatParam (name,f));
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		m_list.push_back(new (m_arena.Allocate (sizeof(FloatParam))) FloatParam (n,name.size(),f));
 	}
 	void ParamList::PushFloat16 (string name, const float *f)
 	{
-		m_list.push_back(new Float16Param (name,f));
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		m_list.push_back(new (m_arena.Allocate (sizeof(Float16Param))) Float16Param (n,name.size(),f));
 	}
 	void ParamList::PushBool (string name,bool b)
 	{
-		m_list.push_back(new BoolParam (name,b)); 
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		m_list.push_back(new (m_arena.Allocate (sizeof(BoolParam))) BoolParam (n,name.size(),b));
 	}
 	void ParamList::PushString (string name,string str)
 	{
-		m_list.push_back(new StringParam (name,str)); 
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		const char *v = m_arena.StoreString (str.data(), str.size());
+		m_list.push_back(new (m_arena.Allocate (sizeof(StringParam))) StringParam (n,name.size(),v,str.size()));
 	}
 
 	void ParamList::PushPtr (string name,void * p)
 	{
-		m_list.push_back (new PointerParam (name,p));
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		m_list.push_back (new (m_arena.Allocate (sizeof(PointerParam))) PointerParam (n,name.size(),p));
+	}
+
+	/* Push Array Commands */
+	void ParamList::PushIntArray (string name, const int *values, size_t count)
+	{
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		int *v = (int*)m_arena.Allocate (sizeof(int) * (count ? count : 1));
+		if (count)
+			memcpy (v, values, sizeof(int) * count);
+		m_list.push_back (new (m_arena.Allocate (sizeof(IntArrayParam))) IntArrayParam (n,name.size(),v,count));
+	}
+	void ParamList::PushFloatArray (string name, const float *values, size_t count)
+	{
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		float *v = (float*)m_arena.Allocate (sizeof(float) * (count ? count : 1));
+		if (count)
+			memcpy (v, values, sizeof(float) * count);
+		m_list.push_back (new (m_arena.Allocate (sizeof(FloatArrayParam))) FloatArrayParam (n,name.size(),v,count));
+	}
+	void ParamList::PushFloat16Array (string name, const float *values, size_t matrixCount)
+	{
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		float *v = (float*)m_arena.Allocate (sizeof(float) * 16 * (matrixCount ? matrixCount : 1));
+		if (matrixCount)
+			memcpy (v, values, sizeof(float) * 16 * matrixCount);
+		m_list.push_back (new (m_arena.Allocate (sizeof(Float16ArrayParam))) Float16ArrayParam (n,name.size(),v,matrixCount));
+	}
+	void ParamList::PushStringArray (string name, const vector <string> &values)
+	{
+		const char *n = m_arena.StoreString (name.data(), name.size());
+		ParamStringRef *v = (ParamStringRef*)m_arena.Allocate (sizeof(ParamStringRef) * (values.size() ? values.size() : 1));
+		for (size_t i=0;i<values.size();i++)
+		{
+			v[i].m_data = m_arena.StoreString (values[i].data(), values[i].size());
+			v[i].m_length = values[i].size();
+		}
+		m_list.push_back (new (m_arena.Allocate (sizeof(StringArrayParam))) StringArrayParam (n,name.size(),v,values.size()));
 	}	
 
 	/* Pop Commands */
+	void ParamList::PopLast ()
+	{
+		// the arena space is reclaimed on Clear or when the list dies.
+		m_list.back()->~Param();
+		m_list.pop_back();
+		InvalidateNameIndex ();
+	}
 	void ParamList::PopInt (int &i) 
 	{
 		((IntParam*)(m_list.back()))->GetValue (i); 
-		IntParam* ip = (IntParam*)m_list[m_list.size()-1];
-		delete ip;
-		m_list.pop_back(); 
+		PopLast ();
 	}
 	void ParamList::PopFloat (float &f) 
 	{
 		((FloatParam*)(m_list.back()))->GetValue (f); 
-		FloatParam* ip = (FloatParam*)m_list[m_list.size()-1];
-		delete ip;
-		m_list.pop_back(); 
+		PopLast ();
 	}
 	void ParamList::PopFloat16 (float *f) 
 	{
 		((Float16Param*)(m_list.back()))->GetValue (f); 
-		Float16Param* ip = (Float16Param*)m_list[m_list.size()-1];
-		delete ip;
-		m_list.pop_back(); 
+		PopLast ();
 	}
 	void ParamList::PopBool (bool &b)
 	{ 
 		((BoolParam*)(m_list.back()))->GetValue (b);
-		BoolParam* bp = (BoolParam*)m_list[m_list.size()-1];
-		delete bp;
-		m_list.pop_back(); 
+		PopLast ();
 	}
 
 	void ParamList::PopString (string &str)
 	{
 		((StringParam*)(m_list.back()))->GetValue (str); 
-		StringParam* sp = (StringParam*)m_list[m_list.size()-1];
-		delete sp;
-		m_list.pop_back(); 
+		PopLast ();
 	}
 
 	void ParamList::PopPtr (void ** p) 
 	{
 		((PointerParam*)(m_list.back()))->GetValue (p); 
-		PointerParam* pp = (PointerParam*)m_list[m_list.size()-1];
-		delete pp;
-		m_list.pop_back(); 
+		PopLast ();
 	} 
 
 	bool ParamList::IsEmpty () 
@@ -646,19 +1470,77 @@ namespace avocado {
 	{
 		return m_list[i];
 	}
-	Param* ParamList::GetParam (const string &name) 
+	void ParamList::InvalidateNameIndex ()
+	{
+		m_nameIndex.clear();
+		m_indexedCount = 0;
+	}
+
+	/* Brings the name index up to date with m_list. Pushes only add their new params,
+	   a full rebuild happens when the table gets half full. The first param of a name wins, like the old linear search. */
+	void ParamList::UpdateNameIndex ()
+	{
+		if (m_nameIndex.size() < m_list.size() * 2)
+		{
+			size_t tableSize = 16;
+			while (tableSize < m_list.size() * 4)
+				tableSize <<= 1;
+			m_nameIndex.assign (tableSize, -1);
+			m_indexedCount = 0;
+		}
+		const size_t mask = m_nameIndex.size() - 1;
+		for (size_t i = m_indexedCount;i<m_list.size();i++)
+		{
+			Param *p = m_list[i];
+			size_t slot = p->GetNameHash() & mask;
+			while (m_nameIndex[slot] != -1)
+			{
+				Param *other = m_list[m_nameIndex[slot]];
+				if (other->GetNameHash() == p->GetNameHash() && other->IsNamed (p->GetNameData(), p->GetNameLength()))
+					break;
+				slot = (slot + 1) & mask;
+			}
+			if (m_nameIndex[slot] == -1)
+				m_nameIndex[slot] = int (i);
+		}
+		m_indexedCount = m_list.size();
+	}
+
+	Param* ParamList::FindParam (const char *name, size_t len, unsigned int hash)
 	{
-		size_t i=0;
-		while (i<m_list.size())
+		if (m_list.size() < PARAM_INDEX_MIN_SIZE)
+		{
+			for (size_t i=0;i<m_list.size();i++)
+			{
+				if (m_list[i]->IsNamed (name, len))
+					return m_list[i];
+			}
+			return 0;
+		}
+		if (m_indexedCount != m_list.size())
+			UpdateNameIndex ();
+		if (hash == 0)
+			hash = ParamAtom::HashName (name, len);
+		const size_t mask = m_nameIndex.size() - 1;
+		size_t slot = hash & mask;
+		while (m_nameIndex[slot] != -1)
 		{
-			string cn;
-			m_list[i]->GetName (cn);
-			if (cn == name)
-				return m_list[i];
-			i++;
+			Param *p = m_list[m_nameIndex[slot]];
+			if (p->GetNameHash() == hash && p->IsNamed (name, len))
+				return p;
+			slot = (slot + 1) & mask;
 		}
 		return 0;
 	}
+
+	Param* ParamList::GetParam (const string &name) 
+	{
+		return FindParam (name.data(), name.size(), 0);
+	}
+	Param* ParamList::GetParam (const ParamAtom &name)
+	{
+		return FindParam (name.GetName(), name.GetLength(), name.GetHash());
+	}
 	bool  ParamList::GetFloatValueByName (const string &paramname,float &target)
     {
 		    Param* trp = GetParam (paramname);
@@ -715,4 +1597,97 @@ namespace avocado {
 			return false;
 	}
   
-}
\ No newline at end of file
+	bool  ParamList::GetFloatValueByName (const ParamAtom &paramname,float &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp)
+			return ((FloatParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetFloat16ValueByName (const ParamAtom &paramname,float *target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp)
+			return ((Float16Param*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetBoolValueByName (const ParamAtom &paramname,bool &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp)
+			return ((BoolParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetStringValueByName (const ParamAtom &paramname, std::string &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp)
+			return ((StringParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetIntValueByName (const ParamAtom &paramname,int &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp)
+			return ((IntParam*)trp)->GetValue (target);
+		return false;
+	}
+
+	bool  ParamList::GetIntArrayByName (const string &paramname, vector <int> &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp && trp->GetTypeId() == PARAM_TYPE_INT_ARRAY)
+			return ((IntArrayParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetIntArrayByName (const ParamAtom &paramname, vector <int> &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp && trp->GetTypeId() == PARAM_TYPE_INT_ARRAY)
+			return ((IntArrayParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetFloatArrayByName (const string &paramname, vector <float> &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp && trp->GetTypeId() == PARAM_TYPE_FLOAT_ARRAY)
+			return ((FloatArrayParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetFloatArrayByName (const ParamAtom &paramname, vector <float> &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp && trp->GetTypeId() == PARAM_TYPE_FLOAT_ARRAY)
+			return ((FloatArrayParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetFloat16ArrayByName (const string &paramname, vector <float> &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp && trp->GetTypeId() == PARAM_TYPE_FLOAT16_ARRAY)
+			return ((Float16ArrayParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetFloat16ArrayByName (const ParamAtom &paramname, vector <float> &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp && trp->GetTypeId() == PARAM_TYPE_FLOAT16_ARRAY)
+			return ((Float16ArrayParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetStringArrayByName (const string &paramname, vector <string> &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp && trp->GetTypeId() == PARAM_TYPE_STRING_ARRAY)
+			return ((StringArrayParam*)trp)->GetValue (target);
+		return false;
+	}
+	bool  ParamList::GetStringArrayByName (const ParamAtom &paramname, vector <string> &target)
+	{
+		Param* trp = GetParam (paramname);
+		if (trp && trp->GetTypeId() == PARAM_TYPE_STRING_ARRAY)
+			return ((StringArrayParam*)trp)->GetValue (target);
+		return false;
+	}
+
+}
@@ -17,25 +17,90 @@ namespace avocado {
 	typedef nvutil::SmartPtr< ParamList > ParamListSharedPtr;
 	typedef ParamListSharedPtr ParamListWriteLock;
 	
+/* Type tag of a parameter, so we dont have to compare GetType () strings on hot paths. */
+enum ParamTypeId {
+	PARAM_TYPE_INT = 0,
+	PARAM_TYPE_FLOAT,
+	PARAM_TYPE_FLOAT16,
+	PARAM_TYPE_BOOL,
+	PARAM_TYPE_STRING,
+	PARAM_TYPE_POINTER,
+	PARAM_TYPE_INT_ARRAY,
+	PARAM_TYPE_FLOAT_ARRAY,
+	PARAM_TYPE_FLOAT16_ARRAY,
+	PARAM_TYPE_STRING_ARRAY
+};
+
+/* Pre-resolved parameter name. Atoms are interned once for the whole process and carry their hash,
+   so keep them around (usually as statics) and hand them to GetParam / Get*ValueByName in hot loops. */
+class ParamAtom {
+public:
+	ParamAtom ();
+	explicit ParamAtom (const char *name);
+	explicit ParamAtom (const string &name);
+	const char* GetName () const { return m_name; }
+	size_t GetLength () const { return m_length; }
+	unsigned int GetHash () const { return m_hash; }
+	bool operator== (const ParamAtom &other) const { return m_name == other.m_name; }
+	static unsigned int HashName (const char *name, size_t len);
+private:
+	void Intern (const char *name, size_t len);
+
+	const char *m_name;
+	size_t m_length;
+	unsigned int m_hash;
+};
+
+/* Bump allocator owned by each ParamList. Holds the Param objects and the characters of their names and values,
+   so building a list costs a handful of allocations instead of a few per parameter. Memory is given back only when
+   the arena is reset or destroyed. */
+class ParamArena {
+public:
+	ParamArena ();
+	~ParamArena ();
+	void* Allocate (size_t bytes);
+	const char* StoreString (const char *str, size_t len);
+	void Reserve (size_t bytes);
+	void Reset ();
+private:
+	ParamArena (const ParamArena &);
+	ParamArena & operator= (const ParamArena &);
+	void AddBlock (size_t bytes);
+
+	vector <char*> m_blocks;
+	vector <size_t> m_blockSizes;
+	char *m_cur;
+	char *m_end;
+};
+
 class Param {
 public:
-	Param (string name);
-	~Param (); 
+	Param (ParamTypeId type, const char *name, size_t nameLength);
+	virtual ~Param ();
 	virtual bool GetValue (int &val);
 	virtual bool GetValue (bool &val);
 	virtual bool GetValue (string &val);
 	virtual bool GetValue (void** val);
 	bool GetName  (string &name);
+	const char* GetNameData () const { return m_name; }
+	size_t GetNameLength () const { return m_nameLength; }
+	// hashed on the first use, only lists long enough to get a name index ever ask for it.
+	unsigned int GetNameHash () { if (m_nameHash == 0) m_nameHash = ParamAtom::HashName (m_name, m_nameLength); return m_nameHash; }
+	bool IsNamed (const char *name, size_t len) const;
+	ParamTypeId GetTypeId () const { return m_typeId; }
 	virtual string GetType () = 0;
-	string m_name; 
+protected:
+	const char *m_name;		// points into the owning list arena, not null terminated.
+	size_t m_nameLength;
+	unsigned int m_nameHash;	// 0 until GetNameHash.
+	ParamTypeId m_typeId;
 };
 
 class IntParam : public Param 
 {
 public:
 	~IntParam () {};
-	IntParam (string name, int x);
-	IntParam (string name, string x);
+	IntParam (const char *name, size_t nameLength, int x);
 	virtual string GetType ();
 	virtual bool GetValue (int &val);
 	virtual bool GetValue (string &val);
@@ -47,8 +112,7 @@ class FloatParam : public Param
 {
 public:
 	~FloatParam () {};
-	FloatParam (string name, float x);
-	FloatParam (string name, string x);
+	FloatParam (const char *name, size_t nameLength, float x);
 	virtual string GetType ();
 	virtual bool GetValue (float &val);
 	virtual bool GetValue (string &val);
@@ -60,8 +124,7 @@ class Float16Param : public Param
 {
 public:
 	~Float16Param () {};
-	Float16Param (string name, const float *x);
-	Float16Param (string name, string x);
+	Float16Param (const char *name, size_t nameLength, const float *x);
 	virtual string GetType ();
 	virtual bool GetValue (float *val);
 	virtual bool GetValue (string &val);
@@ -73,8 +136,7 @@ class BoolParam : public Param
 {
 public:
 	~BoolParam () {};
-	BoolParam (string name , bool x);
-	BoolParam (string name , string x);
+	BoolParam (const char *name, size_t nameLength, bool x);
 	virtual string GetType ();
 	virtual bool GetValue (bool &val); 
 	virtual bool GetValue (string &val); 
@@ -85,28 +147,100 @@ private:
 
 class StringParam : public Param 
 {
+	friend class ParamList;
 public:
 	~StringParam() {}
-	StringParam (string name, string x);
+	StringParam (const char *name, size_t nameLength, const char *x, size_t xLength);
 	virtual string GetType ();
 	bool SetValue (string val);
 	virtual bool GetValue (string &val);
 private:
-	string value;
+	const char *m_value;		// arena storage, or m_ownedValue once SetValue was called.
+	size_t m_valueLength;
+	string m_ownedValue;
 };
 
 class PointerParam : public Param 
 {
 public:
 	~PointerParam() {}
-	PointerParam (string name , void * x);
-	PointerParam (string name , string x);
+	PointerParam (const char *name, size_t nameLength, void * x);
 	virtual string GetType ();
 	virtual bool GetValue (void **val);
 private:
 	void* value;
 };
 
+/* Array params keep their items in one contiguous block of the list arena.
+   Text form : "int[] ids=1:2:3," "float[] f=0.5:1," "float16[] m=1F0F..F1F0F..F," (16 cells per matrix)
+   and "string[] s=3:abc5:a,b;c," where every item is prefixed by its length, so items may hold any character. */
+class IntArrayParam : public Param
+{
+public:
+	~IntArrayParam () {};
+	IntArrayParam (const char *name, size_t nameLength, const int *values, size_t count);
+	virtual string GetType ();
+	virtual bool GetValue (string &val);
+	bool GetValue (vector <int> &val);
+	size_t GetCount () const { return m_count; }
+	const int* GetData () const { return m_values; }
+private:
+	const int *m_values;
+	size_t m_count;
+};
+
+class FloatArrayParam : public Param
+{
+public:
+	~FloatArrayParam () {};
+	FloatArrayParam (const char *name, size_t nameLength, const float *values, size_t count);
+	virtual string GetType ();
+	virtual bool GetValue (string &val);
+	bool GetValue (vector <float> &val);
+	size_t GetCount () const { return m_count; }
+	const float* GetData () const { return m_values; }
+private:
+	const float *m_values;
+	size_t m_count;
+};
+
+class Float16ArrayParam : public Param
+{
+public:
+	~Float16ArrayParam () {};
+	/* values holds 16 * count floats */
+	Float16ArrayParam (const char *name, size_t nameLength, const float *values, size_t count);
+	virtual string GetType ();
+	virtual bool GetValue (string &val);
+	bool GetValue (vector <float> &val);
+	size_t GetCount () const { return m_count; }
+	const float* GetData () const { return m_values; }
+private:
+	const float *m_values;
+	size_t m_count;
+};
+
+struct ParamStringRef
+{
+	const char *m_data;
+	size_t m_length;
+};
+
+class StringArrayParam : public Param
+{
+public:
+	~StringArrayParam () {};
+	StringArrayParam (const char *name, size_t nameLength, const ParamStringRef *values, size_t count);
+	virtual string GetType ();
+	virtual bool GetValue (string &val);
+	bool GetValue (vector <string> &val);
+	size_t GetCount () const { return m_count; }
+	const ParamStringRef* GetData () const { return m_values; }
+private:
+	const ParamStringRef *m_values;
+	size_t m_count;
+};
+
 /* Is this cool or what ? we have a general parameter list , can represent anything and get created from a string */
 class ParamList : public nvutil::RCObject
 {
@@ -116,13 +250,22 @@ class ParamList : public nvutil::RCObject
 
 		so now , in thoery , the user can use a shell command line to send messages into Avocado.
 		Not only that , in the near future , we will send messages from outside applications (== different procces , network connection).
+
+		Lists that only travel inside the engine (or between engines) can use the binary form instead, see SerializeBinary.
+		It is not text and may hold zero bytes, so never push it through c_str () , files or the shell.
 	*/
 public:
 	static ParamListSharedPtr createNew ();
+	/* accepts the text syntax and the binary form, the binary magic can never start a text list */
 	static ParamListSharedPtr createFromString (const string &params);
+	static ParamListSharedPtr createFromBinary (const string &params);
 	static ParamListSharedPtr createFromFile (string filename);
+	static bool IsBinary (const string &params);
 	
 	const string SerializeList ();
+	/* The text of param i alone, SerializeList is these joined in order */
+	const string SerializeParam (size_t i);
+	const string SerializeBinary ();
 	const bool SaveToFile (string filename);
 	void Clear(); 
 
@@ -134,6 +277,12 @@ public:
 	void PushFloat (string name, float f);
 	void PushFloat16 (string name, const float *f);
 
+	/* Push Array Commands , the values are copied */
+	void PushIntArray (string name, const int *values, size_t count);
+	void PushFloatArray (string name, const float *values, size_t count);
+	void PushFloat16Array (string name, const float *values, size_t matrixCount);
+	void PushStringArray (string name, const vector <string> &values);
+
 	/* Pop Commands */
 	void PopInt (int &i);
 	void PopBool (bool &b);
@@ -146,6 +295,7 @@ public:
 	size_t GetParamCount ();
 	Param* GetParam (size_t i);
 	Param* GetParam (const string &name);
+	Param* GetParam (const ParamAtom &name);
 	vector <Param*> m_list;
 	~ParamList();
 		ParamList ();
@@ -155,9 +305,36 @@ public:
 	bool GetIntValueByName (const string &paramname,int &target);
 	bool GetFloat16ValueByName (const string &paramname,float *target);
 	
+	/* Same as above with a pre-resolved name, no hashing and no allocation */
+	bool GetFloatValueByName (const ParamAtom &paramname,float &target);
+	bool GetBoolValueByName (const ParamAtom &paramname,bool &target);
+	bool GetStringValueByName (const ParamAtom &paramname, std::string &target);
+	bool GetIntValueByName (const ParamAtom &paramname,int &target);
+	bool GetFloat16ValueByName (const ParamAtom &paramname,float *target);
+
+	/* Array getters, false when the name is missing or not an array of that type */
+	bool GetIntArrayByName (const string &paramname, vector <int> &target);
+	bool GetFloatArrayByName (const string &paramname, vector <float> &target);
+	bool GetFloat16ArrayByName (const string &paramname, vector <float> &target);
+	bool GetStringArrayByName (const string &paramname, vector <string> &target);
+	bool GetIntArrayByName (const ParamAtom &paramname, vector <int> &target);
+	bool GetFloatArrayByName (const ParamAtom &paramname, vector <float> &target);
+	bool GetFloat16ArrayByName (const ParamAtom &paramname, vector <float> &target);
+	bool GetStringArrayByName (const ParamAtom &paramname, vector <string> &target);
+
 private:
+	ParamList (const ParamList &);
 	const string SerializeListLow (bool endOfLine);
+	static void AppendParamText (string &res, Param *p);
+	void PopLast ();
+	Param* FindParam (const char *name, size_t len, unsigned int hash);	// hash 0 : hashed here if the list is indexed.
+	void UpdateNameIndex ();
+	void InvalidateNameIndex ();
 
+	ParamArena m_arena;
+	// open addressing table of m_list indices, built on the first lookup by name of a long list.
+	vector <int> m_nameIndex;
+	size_t m_indexedCount;
 };
 
-}
\ No newline at end of file
+}
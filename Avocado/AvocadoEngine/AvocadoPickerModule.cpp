@@ -45,6 +45,14 @@ namespace avocado
 
 	bool AvocadoPicker::OnRegister ()
 	{
+		// only these messages are dispatched to this module, keep the list in sync with the handlers below.
+		static const char *s_messages[] = { "ManipulationStart", "ManipulationEnd", "SetViewParam" };
+		for (size_t i=0;i<sizeof (s_messages) / sizeof (s_messages[0]);i++)
+			SubscribeMessage (s_messages[i]);
+		SubscribeMouseMessage (AVC_TIMER_TICK);
+		SubscribeMouseMessage (AVC_MOUSE_LDOWN);
+		SubscribeMouseMessage (AVC_MOUSE_RUP);
+		SubscribeMouseMessage (AVC_MOUSE_MOVE);
 		return true;
 	}
 	bool AvocadoPicker::HandleAvocadoViewGeneralStringMessage (const std::string &msg, int docId,const std::string &paramStr, bool &needRepaint)
@@ -16,9 +16,9 @@
 #include <nvsg/GeoNode.h>
 
 #include "SceneFunctions.h"
+#include "AvocadoSceneQuery.h"
 #include <nvsg/PerspectiveCamera.h>
 #include <nvsg/FaceAttribute.h>
-#include <nvtraverser\SearchTraverser.h>
 #include <nvsg/CoreTypes.h>
 #include <nvmath/Vecnt.h>
 
@@ -1125,20 +1125,10 @@ void SceneRendererPipeline::doShader( const ViewStateSharedPtr &viewState)
 		NodeSharedPtr root = /*scene*/SceneReadLock(m_scene)->getRootNode();
 
 		// select everything from here on down
-		SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-		NVSG_ASSERT(st);
-		st->setClassName("class nvsg::GeoNode");
-		st->apply( root );
-
-		const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-		std::vector<ObjectWeakPtr>::const_iterator it;
-		for(it=searchResults.begin(); it!=searchResults.end(); it++)
+		const std::vector<GeoNodeSharedPtr> geoNodes = avocado::AvocadoSceneQuery ().Find<GeoNode> (root);
+		for (size_t i=0;i<geoNodes.size ();i++)
 		{
-			//GeoNodeWeakPtr node = static_cast<GeoNodeWeakPtr>(*it);
-			GeoNodeWriteLock node(dynamic_cast<GeoNodeWeakPtr>(*it));
-			GeoNodeSharedPtr geonode2(dynamic_cast<GeoNodeWeakPtr>(*it));
-			//GeoNodeSharedPtr geonode = nvutil::sharedPtr_cast<GeoNode*>(*it);
-			replaceStateSet( geonode2/*new CommandReplaceStateSet( node, 0, newSsh )*/ );
+			replaceStateSet( geoNodes[i]/*new CommandReplaceStateSet( node, 0, newSsh )*/ );
 		}
 	}
 }
@@ -1156,23 +1146,12 @@ void SceneRendererPipeline::doShader2( const ViewStateSharedPtr &viewState, bool
 		NodeSharedPtr root = /*scene*/SceneReadLock(m_scene)->getRootNode();
 
 		// select everything from here on down
-		SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-		NVSG_ASSERT(st);
-		st->setClassName("class nvsg::GeoNode");
-		st->setBaseClassSearch(true);
-		st->apply( root );
+		const std::vector<GeoNodeSharedPtr> geoNodes = avocado::AvocadoSceneQuery ().Find<GeoNode> (root);
 		if (!shaded)
 			m_cachedRoomTemp = 0;
-		const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-		std::vector<ObjectWeakPtr>::const_iterator it;
-		for(it=searchResults.begin(); it!=searchResults.end(); it++)
+		for (size_t i=0;i<geoNodes.size ();i++)
 		{
-			//GeoNodeWeakPtr node = static_cast<GeoNodeWeakPtr>(*it);
-		//	GeoNodeWriteLock node(dynamic_cast<GeoNodeWeakPtr>(*it));
-			GeoNodeSharedPtr geonode2(dynamic_cast<GeoNodeWeakPtr>(*it));
-
-			//GeoNodeSharedPtr geonode = nvutil::sharedPtr_cast<GeoNode*>(*it);
-			replaceStateSet2( geonode2,shaded/*new CommandReplaceStateSet( node, 0, newSsh )*/ );
+			replaceStateSet2( geoNodes[i],shaded/*new CommandReplaceStateSet( node, 0, newSsh )*/ );
 		}
 		if (m_cachedRoomTemp)
 		{
@@ -1230,23 +1209,12 @@ void SceneRendererPipeline::SetShaderTechnique( const ViewStateSharedPtr &viewSt
 		NodeSharedPtr root = /*scene*/SceneReadLock(m_scene)->getRootNode();
 
 		// select everything from here on down
-		SmartPtr<nvtraverser::SearchTraverser> st( new nvtraverser::SearchTraverser );
-		NVSG_ASSERT(st);
-		st->setClassName("class nvsg::GeoNode");
-		st->setBaseClassSearch(true);
-		st->apply( root );
+		const std::vector<GeoNodeSharedPtr> geoNodes = avocado::AvocadoSceneQuery ().Find<GeoNode> (root);
 		if (!shaded)
 			m_cachedRoomTemp = 0;
-		const std::vector<ObjectWeakPtr> & searchResults = st->getResults();
-		std::vector<ObjectWeakPtr>::const_iterator it;
-		for(it=searchResults.begin(); it!=searchResults.end(); it++)
+		for (size_t i=0;i<geoNodes.size ();i++)
 		{
-			//GeoNodeWeakPtr node = static_cast<GeoNodeWeakPtr>(*it);
-		//	GeoNodeWriteLock node(dynamic_cast<GeoNodeWeakPtr>(*it));
-			GeoNodeSharedPtr geonode2(dynamic_cast<GeoNodeWeakPtr>(*it));
-
-			//GeoNodeSharedPtr geonode = nvutil::sharedPtr_cast<GeoNode*>(*it);
-			SetGeoNodeTechnique( geonode2,shaded/*new CommandReplaceStateSet( node, 0, newSsh )*/ );
+			SetGeoNodeTechnique( geoNodes[i],shaded/*new CommandReplaceStateSet( node, 0, newSsh )*/ );
 		}
 		if (m_cachedRoomTemp)
 		{
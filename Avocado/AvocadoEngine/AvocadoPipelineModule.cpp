@@ -91,6 +91,10 @@ namespace avocado
 		m_pipeline->init (m_renderContextGL,m_renderTarget);
 		m_mainHighlightMask =  int(pow(2.0,2*m_viewId+3));
 		m_subHighlightMask =  int(pow(2.0,2*m_viewId+4));
+		// only these messages are dispatched to this module, keep the list in sync with the handlers below.
+		static const char *s_messages[] = { "Render", "PreHightlightElement", "UnPreHightlightElement", "HightlightElement", "UnHightlightElement", "OnTogHighlights", "SetViewParam", "ManipulationStart", "ManipulationEnd", "SetDocParam", "SaveViewToFileFull", "SaveViewToBitmapFile", "SaveViewToFile" };
+		for (size_t i=0;i<sizeof (s_messages) / sizeof (s_messages[0]);i++)
+			SubscribeMessage (s_messages[i]);
 		return true;
 	}
 	void AvocadoPipeline::HighlighStateSetCurrentDrawable (bool h)
@@ -0,0 +1,284 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoSceneCache.h"
+#include "AvocadoArchive.h"
+#include "AvocadoAutoSave.h"
+#include <list>
+#include <vector>
+#include <algorithm>
+#include <hash_map>
+#include <cstdio>
+#include <windows.h>
+
+namespace avocado
+{
+	struct AvocadoSceneCacheEntry
+	{
+		std::string						key;
+		unsigned __int64				size;
+		unsigned __int64				lastUse;		// FILETIME of the entry file, for the order of a scan
+	};
+
+	/* Least recently used first. */
+	typedef std::list<AvocadoSceneCacheEntry> AvocadoSceneCacheList;
+
+	static bool SceneCacheEntryOlder (const AvocadoSceneCacheEntry &a, const AvocadoSceneCacheEntry &b)
+	{
+		return a.lastUse < b.lastUse;
+	}
+
+	static bool IsSceneCacheKey (const std::string &s)
+	{
+		if (s.size () != 16)
+			return false;
+		for (size_t i=0;i<s.size ();i++)
+			if (!((s[i] >= '0' && s[i] <= '9') || (s[i] >= 'a' && s[i] <= 'f')))
+				return false;
+		return true;
+	}
+
+	struct AvocadoSceneCache::Impl
+	{
+		Impl () : m_enabled (true), m_maxBytes (1024 * 1024 * 1024), m_totalBytes (0)
+		{
+			InitializeCriticalSection (&m_lock);
+		}
+
+		std::string EntryPath (const std::string &key) const
+		{
+			return m_folder + "\\" + key + ".nbf";
+		}
+
+		void Unlink (AvocadoSceneCacheList::iterator it)
+		{
+			m_totalBytes -= it->size;
+			m_byKey.erase (it->key);
+			m_entries.erase (it);
+		}
+
+		/* Under m_lock. The entry just added is kept whatever its size. */
+		void Evict ()
+		{
+			while (m_totalBytes > m_maxBytes && m_entries.size () > 1)
+			{
+				DeleteFileA (EntryPath (m_entries.front ().key).c_str ());
+				Unlink (m_entries.begin ());
+			}
+		}
+
+		/* Under m_lock. Entries in the order they were last used in, partial writes of a session that did not
+		   finish are removed. */
+		void Scan ()
+		{
+			m_entries.clear ();
+			m_byKey.clear ();
+			m_totalBytes = 0;
+			if (m_folder.empty ())
+				return;
+			CreateDirectoryA (m_folder.c_str (),NULL);
+			std::vector<AvocadoSceneCacheEntry> found;
+			WIN32_FIND_DATAA data;
+			HANDLE h = FindFirstFileA ((m_folder + "\\*.nbf").c_str (),&data);
+			if (h != INVALID_HANDLE_VALUE)
+			{
+				do
+				{
+					const std::string name (data.cFileName);
+					const std::string stem = name.substr (0,name.size () - 4);
+					if (!IsSceneCacheKey (stem))
+					{
+						if (name.find (".writing.") != std::string::npos)
+							DeleteFileA ((m_folder + "\\" + name).c_str ());
+						continue;
+					}
+					AvocadoSceneCacheEntry entry;
+					entry.key = stem;
+					entry.size = ((unsigned __int64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+					entry.lastUse = ((unsigned __int64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+					found.push_back (entry);
+				}
+				while (FindNextFileA (h,&data));
+				FindClose (h);
+			}
+			std::sort (found.begin (),found.end (),SceneCacheEntryOlder);
+			for (size_t i=0;i<found.size ();i++)
+			{
+				m_entries.push_back (found[i]);
+				m_byKey[found[i].key] = --m_entries.end ();
+				m_totalBytes += found[i].size;
+			}
+			Evict ();
+		}
+
+		CRITICAL_SECTION				m_lock;
+		bool							m_enabled;
+		std::string						m_folder;
+		unsigned __int64				m_maxBytes;
+		unsigned __int64				m_totalBytes;
+		AvocadoSceneCacheList			m_entries;
+		std::hash_map<std::string,AvocadoSceneCacheList::iterator>	m_byKey;
+	};
+
+	AvocadoSceneCache::AvocadoSceneCache () : m_impl (new Impl ())
+	{
+	}
+
+	AvocadoSceneCache& AvocadoSceneCache::Get ()
+	{
+		// never destroyed, the import threads may still use it while the engine terminates.
+		static AvocadoSceneCache *s_cache = new AvocadoSceneCache ();
+		return *s_cache;
+	}
+
+	void AvocadoSceneCache::SetFolder (const std::string &folder)
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		if (folder != m_impl->m_folder)
+		{
+			m_impl->m_folder = folder;
+			m_impl->Scan ();
+		}
+		LeaveCriticalSection (&m_impl->m_lock);
+	}
+
+	void AvocadoSceneCache::SetEnabled (bool enabled)
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		m_impl->m_enabled = enabled;
+		LeaveCriticalSection (&m_impl->m_lock);
+	}
+
+	bool AvocadoSceneCache::IsEnabled ()
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		const bool enabled = m_impl->m_enabled && !m_impl->m_folder.empty ();
+		LeaveCriticalSection (&m_impl->m_lock);
+		return enabled;
+	}
+
+	void AvocadoSceneCache::SetMaxBytes (unsigned __int64 maxBytes)
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		m_impl->m_maxBytes = maxBytes;
+		m_impl->Evict ();
+		LeaveCriticalSection (&m_impl->m_lock);
+	}
+
+	static std::string SceneCacheHex (unsigned __int64 v)
+	{
+		std::string hex (16,'0');
+		for (int i=15;i>=0;i--,v >>= 4)
+			hex[i] = "0123456789abcdef"[v & 15];
+		return hex;
+	}
+
+	std::string AvocadoSceneCache::MakeKey (const std::string &sourcePath, const std::string &options)
+	{
+		std::string bytes;
+		if (!IsEnabled () || !AvocadoArchiveBlobs::ReadFile (sourcePath,bytes))
+			return "";
+		const std::string keyed = SceneCacheHex (AvocadoArchiveBlobs::ContentHash (bytes.data (),bytes.size ())) + ":"
+			+ SceneCacheHex (bytes.size ()) + ":" + options;
+		return SceneCacheHex (AvocadoArchiveBlobs::ContentHash (keyed.data (),keyed.size ()));
+	}
+
+	bool AvocadoSceneCache::Find (const std::string &key, std::string &path)
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		bool found = false;
+		std::hash_map<std::string,AvocadoSceneCacheList::iterator>::iterator it = m_impl->m_byKey.find (key);
+		if (m_impl->m_enabled && it != m_impl->m_byKey.end ())
+		{
+			path = m_impl->EntryPath (key);
+			// the file time carries the order to the next session.
+			FILETIME now;
+			GetSystemTimeAsFileTime (&now);
+			HANDLE h = CreateFileA (path.c_str (),FILE_WRITE_ATTRIBUTES,FILE_SHARE_READ | FILE_SHARE_WRITE,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+			found = (h != INVALID_HANDLE_VALUE);
+			if (found)
+			{
+				SetFileTime (h,NULL,NULL,&now);
+				CloseHandle (h);
+				it->second->lastUse = ((unsigned __int64)now.dwHighDateTime << 32) | now.dwLowDateTime;
+				m_impl->m_entries.splice (m_impl->m_entries.end (),m_impl->m_entries,it->second);
+			}
+			else
+				m_impl->Unlink (it->second);
+		}
+		LeaveCriticalSection (&m_impl->m_lock);
+		return found;
+	}
+
+	std::string AvocadoSceneCache::GetWritePath (const std::string &key)
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		char thread[16];
+		sprintf (thread,"%lu",(unsigned long)GetCurrentThreadId ());
+		const std::string path = m_impl->m_folder + "\\" + key + "." + thread + ".writing.nbf";
+		LeaveCriticalSection (&m_impl->m_lock);
+		return path;
+	}
+
+	bool AvocadoSceneCache::Add (const std::string &key, const std::string &written)
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		const std::string path = m_impl->EntryPath (key);
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		bool res = IsSceneCacheKey (key) && GetFileAttributesExA (written.c_str (),GetFileExInfoStandard,&data) != FALSE
+			&& AvocadoAutoSave::MoveToPath (written,path);
+		if (res)
+		{
+			std::hash_map<std::string,AvocadoSceneCacheList::iterator>::iterator it = m_impl->m_byKey.find (key);
+			if (it != m_impl->m_byKey.end ())
+				m_impl->Unlink (it->second);
+			AvocadoSceneCacheEntry entry;
+			entry.key = key;
+			entry.size = ((unsigned __int64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+			FILETIME now;
+			GetSystemTimeAsFileTime (&now);
+			entry.lastUse = ((unsigned __int64)now.dwHighDateTime << 32) | now.dwLowDateTime;
+			m_impl->m_entries.push_back (entry);
+			m_impl->m_byKey[key] = --m_impl->m_entries.end ();
+			m_impl->m_totalBytes += entry.size;
+			m_impl->Evict ();
+		}
+		else
+			DeleteFileA (written.c_str ());
+		LeaveCriticalSection (&m_impl->m_lock);
+		return res;
+	}
+
+	void AvocadoSceneCache::Discard (const std::string &written)
+	{
+		DeleteFileA (written.c_str ());
+	}
+
+	void AvocadoSceneCache::Remove (const std::string &key)
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		std::hash_map<std::string,AvocadoSceneCacheList::iterator>::iterator it = m_impl->m_byKey.find (key);
+		if (it != m_impl->m_byKey.end ())
+		{
+			DeleteFileA (m_impl->EntryPath (key).c_str ());
+			m_impl->Unlink (it->second);
+		}
+		LeaveCriticalSection (&m_impl->m_lock);
+	}
+
+	size_t AvocadoSceneCache::GetEntryCount ()
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		const size_t count = m_impl->m_entries.size ();
+		LeaveCriticalSection (&m_impl->m_lock);
+		return count;
+	}
+
+	unsigned __int64 AvocadoSceneCache::GetTotalBytes ()
+	{
+		EnterCriticalSection (&m_impl->m_lock);
+		const unsigned __int64 total = m_impl->m_totalBytes;
+		LeaveCriticalSection (&m_impl->m_lock);
+		return total;
+	}
+}
@@ -0,0 +1,46 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include <string>
+
+namespace avocado
+{
+	/* Imported scenes as they come out of optimizeForRaytracing and convertFFPToCGFX, kept on disk in NBF between
+	   sessions. An entry is keyed by the content of its source file and the options the import ran with, so an
+	   edited model or another flip_yz_on_import misses. Past the size limit the least recently used entries go.
+	   The import module reads and writes the entries (see loadCachedFileScene), this only keeps the files.
+	   Thread safe, the import scheduler threads use it. */
+	class AvocadoSceneCache
+	{
+	public:
+		static AvocadoSceneCache&		Get ();
+
+		/* Entries are <key>.nbf files in the folder, what earlier sessions left there is picked up. */
+		void							SetFolder (const std::string &folder);
+		void							SetEnabled (bool enabled);
+		bool							IsEnabled ();
+		void							SetMaxBytes (unsigned __int64 maxBytes);
+
+		/* Empty when the cache is off or the source can not be read. */
+		std::string						MakeKey (const std::string &sourcePath, const std::string &options);
+		/* The entry file of key, marked as used. */
+		bool							Find (const std::string &key, std::string &path);
+		/* Where a new entry is written before it is added, next to the entries. */
+		std::string						GetWritePath (const std::string &key);
+		/* The file written at GetWritePath becomes the entry of key, false (and the file is gone) when it could
+		   not be moved in. Entries are evicted past the size limit, the new one last. */
+		bool							Add (const std::string &key, const std::string &written);
+		/* A write that failed, or an entry that would not load. */
+		void							Discard (const std::string &written);
+		void							Remove (const std::string &key);
+
+		size_t							GetEntryCount ();
+		unsigned __int64				GetTotalBytes ();
+	private:
+		AvocadoSceneCache ();
+
+		struct Impl;
+		Impl							*m_impl;
+	};
+}
@@ -0,0 +1,187 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoSceneQuery.h"
+#include "AvocadoWorkerPool.h"
+#include <nvsg/Group.h>
+#include <nvsg/GeoNode.h>
+#include <algorithm>
+
+using namespace nvsg;
+
+namespace avocado
+{
+	/* One subtree of the root on a pool thread. */
+	class AvocadoSceneQueryTask : public AvocadoParallelTask
+	{
+	public:
+		AvocadoSceneQueryTask (const AvocadoSceneQuery &query, const std::vector<NodeWeakPtr> &subtrees, AvocadoSceneQueryKind kind,
+			AvocadoSceneQuery::MatchFunction matches, size_t limit)
+			: m_query (query), m_subtrees (subtrees), m_kind (kind), m_matches (matches), m_limit (limit), m_found (subtrees.size ()) {}
+
+		virtual void Run (size_t index)
+		{
+			m_query.Walk (m_subtrees[index],m_kind,m_matches,m_limit,m_found[index]);
+		}
+
+		const std::vector<ObjectWeakPtr>& GetFound (size_t index) const { return m_found[index]; }
+	private:
+		const AvocadoSceneQuery				&m_query;
+		const std::vector<NodeWeakPtr>		&m_subtrees;
+		AvocadoSceneQueryKind				m_kind;
+		AvocadoSceneQuery::MatchFunction	m_matches;
+		size_t								m_limit;
+		std::vector<std::vector<ObjectWeakPtr> >	m_found;
+	};
+
+	AvocadoSceneQuery::AvocadoSceneQuery () : m_hasName (false), m_traversalMask (~0), m_userData (NULL), m_hasUserData (false),
+		m_limit ((size_t)-1), m_parallel (false)
+	{
+	}
+
+	AvocadoSceneQuery& AvocadoSceneQuery::Name (const std::string &name)
+	{
+		m_name = name;
+		m_hasName = true;
+		return *this;
+	}
+
+	AvocadoSceneQuery& AvocadoSceneQuery::NamePrefix (const std::string &prefix)
+	{
+		m_namePrefix = prefix;
+		return *this;
+	}
+
+	AvocadoSceneQuery& AvocadoSceneQuery::TraversalMask (unsigned int mask)
+	{
+		m_traversalMask = mask;
+		return *this;
+	}
+
+	AvocadoSceneQuery& AvocadoSceneQuery::UserData (const void *userData)
+	{
+		m_userData = userData;
+		m_hasUserData = true;
+		return *this;
+	}
+
+	AvocadoSceneQuery& AvocadoSceneQuery::Limit (size_t count)
+	{
+		m_limit = count;
+		return *this;
+	}
+
+	AvocadoSceneQuery& AvocadoSceneQuery::Parallel (bool parallel)
+	{
+		m_parallel = parallel;
+		return *this;
+	}
+
+	unsigned int AvocadoSceneQuery::GetKnownObjectCode (const Object *obj)
+	{
+		unsigned int oc = obj->getObjectCode ();
+		while (oc != OC_INVALID && oc >= OC_CUSTOMOBJECT)
+			oc = obj->getHigherLevelObjectCode (oc);
+		return oc;
+	}
+
+	bool AvocadoSceneQuery::Accepts (const Object *obj) const
+	{
+		if (m_hasUserData && obj->getUserData () != m_userData)
+			return false;
+		if (m_hasName && obj->getName () != m_name)
+			return false;
+		if (!m_namePrefix.empty () && obj->getName ().compare (0,m_namePrefix.size (),m_namePrefix) != 0)
+			return false;
+		return true;
+	}
+
+	/* Depth first, children in order, with a stack of its own : an imported model can nest deeper than the
+	   thread stack would like. Only read locks and weak pointers, no reference counts change on the way. */
+	void AvocadoSceneQuery::Walk (NodeWeakPtr root, AvocadoSceneQueryKind kind, MatchFunction matches, size_t limit, std::vector<ObjectWeakPtr> &found) const
+	{
+		if (found.size () >= limit)
+			return;
+		std::vector<NodeWeakPtr> stack;
+		stack.push_back (root);
+		while (!stack.empty ())
+		{
+			NodeWeakPtr weak = stack.back ();
+			stack.pop_back ();
+			NodeReadLock node (weak);
+			if ((node->getTraversalMask () & m_traversalMask) == 0)
+				continue;
+			const unsigned int oc = GetKnownObjectCode (node);
+			if (kind == SCENE_QUERY_NODES && matches (oc) && Accepts (node))
+			{
+				found.push_back (weak);
+				if (found.size () >= limit)
+					return;
+			}
+			if (AvocadoSceneQueryType<Group>::Matches (oc))
+			{
+				const Group *group = static_cast<const Group*>((const Node*)node);
+				const size_t first = stack.size ();
+				for (Group::ChildrenConstIterator it = group->beginChildren ();it != group->endChildren ();++it)
+					stack.push_back ((*it).get ());
+				std::reverse (stack.begin () + first,stack.end ());
+			}
+			else if (oc == OC_GEONODE && kind == SCENE_QUERY_DRAWABLES)
+			{
+				const GeoNode *geo = static_cast<const GeoNode*>((const Node*)node);
+				for (GeoNode::StateSetConstIterator ss = geo->beginStateSets ();ss != geo->endStateSets ();++ss)
+				{
+					for (GeoNode::DrawableConstIterator dr = geo->beginDrawables (ss);dr != geo->endDrawables (ss);++dr)
+					{
+						DrawableReadLock drawable ((*dr).get ());
+						if ((drawable->getTraversalMask () & m_traversalMask) == 0)
+							continue;
+						if (matches (GetKnownObjectCode (drawable)) && Accepts (drawable))
+						{
+							found.push_back ((*dr).get ());
+							if (found.size () >= limit)
+								return;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void AvocadoSceneQuery::Run (const NodeSharedPtr &root, AvocadoSceneQueryKind kind, MatchFunction matches, size_t limit, std::vector<ObjectWeakPtr> &found) const
+	{
+		found.clear ();
+		if (!root || limit == 0)
+			return;
+		std::vector<NodeWeakPtr> subtrees;
+		if (m_parallel)
+		{
+			NodeReadLock node (root);
+			const unsigned int oc = GetKnownObjectCode (node);
+			if ((node->getTraversalMask () & m_traversalMask) == 0)
+				return;
+			if (AvocadoSceneQueryType<Group>::Matches (oc))
+			{
+				if (kind == SCENE_QUERY_NODES && matches (oc) && Accepts (node))
+					found.push_back (root.get ());
+				const Group *group = static_cast<const Group*>((const Node*)node);
+				for (Group::ChildrenConstIterator it = group->beginChildren ();it != group->endChildren ();++it)
+					subtrees.push_back ((*it).get ());
+			}
+		}
+		if (subtrees.size () < 2)
+		{
+			found.clear ();
+			Walk (root.get (),kind,matches,limit,found);
+			return;
+		}
+		// every subtree up to the limit, then the first ones in order : the same results as one walk.
+		AvocadoSceneQueryTask task (*this,subtrees,kind,matches,limit);
+		AvocadoWorkerPool::Get ().ParallelFor (subtrees.size (),task);
+		for (size_t i=0;i<subtrees.size () && found.size () < limit;i++)
+		{
+			const std::vector<ObjectWeakPtr> &part = task.GetFound (i);
+			found.insert (found.end (),part.begin (),part.begin () + std::min (part.size (),limit - found.size ()));
+		}
+	}
+}
@@ -0,0 +1,129 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include <nvsg/Object.h>
+#include <string>
+#include <vector>
+
+namespace avocado
+{
+	enum AvocadoSceneQueryKind
+	{
+		SCENE_QUERY_NODES,			// the nodes under the root, groups and GeoNodes
+		SCENE_QUERY_DRAWABLES		// the drawables of the GeoNodes under the root
+	};
+
+	/* The object codes a SceniX type answers to, what a base class search by its class name finds. A query of
+	   T matches on these instead of comparing class names, custom objects are taken up to the code they extend. */
+	template <typename T> struct AvocadoSceneQueryType {};
+
+	template <> struct AvocadoSceneQueryType<nvsg::Node>
+	{
+		enum { Kind = SCENE_QUERY_NODES };
+		static bool Matches (unsigned int oc) { return true; }
+	};
+
+	template <> struct AvocadoSceneQueryType<nvsg::Group>
+	{
+		enum { Kind = SCENE_QUERY_NODES };
+		static bool Matches (unsigned int oc)
+		{
+			return oc == nvsg::OC_GROUP || oc == nvsg::OC_FLIPBOOKANIMATION || oc == nvsg::OC_LOD || oc == nvsg::OC_SWITCH
+				|| oc == nvsg::OC_TRANSFORM || oc == nvsg::OC_ANIMATEDTRANSFORM || oc == nvsg::OC_BILLBOARD;
+		}
+	};
+
+	template <> struct AvocadoSceneQueryType<nvsg::Transform>
+	{
+		enum { Kind = SCENE_QUERY_NODES };
+		static bool Matches (unsigned int oc) { return oc == nvsg::OC_TRANSFORM || oc == nvsg::OC_ANIMATEDTRANSFORM; }
+	};
+
+	template <> struct AvocadoSceneQueryType<nvsg::GeoNode>
+	{
+		enum { Kind = SCENE_QUERY_NODES };
+		static bool Matches (unsigned int oc) { return oc == nvsg::OC_GEONODE; }
+	};
+
+	template <> struct AvocadoSceneQueryType<nvsg::Drawable>
+	{
+		enum { Kind = SCENE_QUERY_DRAWABLES };
+		static bool Matches (unsigned int oc) { return true; }
+	};
+
+	template <> struct AvocadoSceneQueryType<nvsg::Primitive>
+	{
+		enum { Kind = SCENE_QUERY_DRAWABLES };
+		static bool Matches (unsigned int oc)
+		{
+			return oc == nvsg::OC_PRIMITIVE || oc == nvsg::OC_RECT_PATCHES || oc == nvsg::OC_QUAD_PATCHES || oc == nvsg::OC_QUAD_PATCHES_4X4
+				|| oc == nvsg::OC_TRI_PATCHES || oc == nvsg::OC_TRI_PATCHES_4;
+		}
+	};
+
+	/* Finds the nodes or drawables of a type under a root in one pass, what a SearchTraverser with a class name
+	   and a dynamic_cast of every result did. The criteria add up :
+
+		std::vector<nvsg::GeoNodeSharedPtr> geoNodes = AvocadoSceneQuery ().NamePrefix ("AvoGeoNode").Find<nvsg::GeoNode> (root);
+
+	   Results come in the order a traverser visits them, every child of a Switch or an LOD included. A subtree
+	   whose traversal mask has no bit of the query mask is skipped as a traverser skips it. Limit stops the walk
+	   once that many are found. Parallel walks the subtrees of the root children on the worker pool, holding
+	   read locks only : the scene must not change while the query runs. */
+	class AvocadoSceneQuery
+	{
+	public:
+		typedef bool (*MatchFunction) (unsigned int objectCode);
+
+		AvocadoSceneQuery ();
+
+		AvocadoSceneQuery&				Name (const std::string &name);
+		AvocadoSceneQuery&				NamePrefix (const std::string &prefix);
+		AvocadoSceneQuery&				TraversalMask (unsigned int mask);
+		AvocadoSceneQuery&				UserData (const void *userData);
+		AvocadoSceneQuery&				Limit (size_t count);
+		AvocadoSceneQuery&				Parallel (bool parallel);
+
+		template <typename T>
+		std::vector<typename nvutil::ObjectTraits<T>::SharedPtr> Find (const nvsg::NodeSharedPtr &root) const
+		{
+			std::vector<nvsg::ObjectWeakPtr> found;
+			Run (root,AvocadoSceneQueryKind (AvocadoSceneQueryType<T>::Kind),&AvocadoSceneQueryType<T>::Matches,m_limit,found);
+			std::vector<typename nvutil::ObjectTraits<T>::SharedPtr> res;
+			res.reserve (found.size ());
+			for (size_t i=0;i<found.size ();i++)
+				res.push_back (typename nvutil::ObjectTraits<T>::SharedPtr (static_cast<typename nvutil::ObjectTraits<T>::WeakPtr>(found[i])));
+			return res;
+		}
+
+		/* The first match, NULL when there is none. The walk stops there. */
+		template <typename T>
+		typename nvutil::ObjectTraits<T>::SharedPtr FindFirst (const nvsg::NodeSharedPtr &root) const
+		{
+			std::vector<nvsg::ObjectWeakPtr> found;
+			Run (root,AvocadoSceneQueryKind (AvocadoSceneQueryType<T>::Kind),&AvocadoSceneQueryType<T>::Matches,1,found);
+			if (found.empty ())
+				return typename nvutil::ObjectTraits<T>::SharedPtr ();
+			return typename nvutil::ObjectTraits<T>::SharedPtr (static_cast<typename nvutil::ObjectTraits<T>::WeakPtr>(found[0]));
+		}
+
+		/* The object code a traverser would handle obj by, custom object codes taken up to a known one. */
+		static unsigned int				GetKnownObjectCode (const nvsg::Object *obj);
+	private:
+		void							Run (const nvsg::NodeSharedPtr &root, AvocadoSceneQueryKind kind, MatchFunction matches, size_t limit, std::vector<nvsg::ObjectWeakPtr> &found) const;
+		void							Walk (nvsg::NodeWeakPtr root, AvocadoSceneQueryKind kind, MatchFunction matches, size_t limit, std::vector<nvsg::ObjectWeakPtr> &found) const;
+		bool							Accepts (const nvsg::Object *obj) const;
+
+		std::string						m_name;
+		bool							m_hasName;
+		std::string						m_namePrefix;
+		unsigned int					m_traversalMask;
+		const void						*m_userData;
+		bool							m_hasUserData;
+		size_t							m_limit;
+		bool							m_parallel;
+
+		friend class AvocadoSceneQueryTask;
+	};
+}
@@ -19,6 +19,7 @@
 #include <nvutil/Trace.h>
 #include "AvocadoMaterials.h"
 #include "AvocadoParams.h"
+#include "AvocadoArchive.h"
 #include "../../3rdParty/jpeg-8d/Jpegfile.h"
 #include <nvsg/BufferHost.h>
 using namespace nvmath;
@@ -619,7 +620,10 @@ namespace avocado
 				
 				TextureHostSharedPtr tex ;//= TextureHost::createFromFile (m_cachedBgImage,sp);//"C:\\Education\\AvocadoNet\\Avocado\\Release\\media\\textures\\crosscube4.hdr",sp);
 				sp.push_back(nvutil::GetProccessDirectory(false) );
-				if (nvutil::loadTextureHost (m_cachedBgImage,tex,sp))
+				string bgFile;
+				if (!AvocadoVirtualFiles::Get ().FindFile (m_cachedBgImage,sp,bgFile))
+					bgFile = m_cachedBgImage;
+				if (MaterialBase2::LoadTexture (bgFile,tex,sp))
 				{
 				TextureHostWriteLock( tex )->convertToTextureTarget(	NVSG_TEXTURE_2D );
 				TextureHostWriteLock( tex )->createMipmaps ();
@@ -34,6 +34,10 @@ namespace avocado
 
 	bool AvocadoSelection::OnRegister()
 	{
+		// only these messages are dispatched to this module, keep the list in sync with the handlers below.
+		static const char *s_messages[] = { "OnPick", "OnPickNothing" };
+		for (size_t i=0;i<sizeof (s_messages) / sizeof (s_messages[0]);i++)
+			SubscribeMessage (s_messages[i]);
 		return true;
 	}
 
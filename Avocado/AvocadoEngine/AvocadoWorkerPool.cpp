@@ -0,0 +1,164 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoWorkerPool.h"
+#include <vector>
+#include <windows.h>
+#include <process.h>
+
+namespace avocado
+{
+	// set on pool threads and on a caller while it takes part in a ParallelFor.
+	static __declspec(thread) int s_inParallelFor = 0;
+
+	struct AvocadoWorkerPool::Impl
+	{
+		Impl () : m_requested (0), m_task (NULL), m_count (0), m_next (0), m_pending (0), m_stop (0)
+		{
+			InitializeCriticalSection (&m_jobLock);
+			m_wake = CreateSemaphore (NULL,0,0x7fffffff,NULL);
+			m_done = CreateEvent (NULL,FALSE,FALSE,NULL);
+		}
+
+		void RunIndices ()
+		{
+			for (;;)
+			{
+				const LONG index = InterlockedIncrement (&m_next) - 1;
+				if (size_t (index) >= m_count)
+					break;
+				m_task->Run (size_t (index));
+			}
+		}
+
+		static unsigned __stdcall WorkerMain (void *arg)
+		{
+			Impl *impl = (Impl*)arg;
+			s_inParallelFor = 1;
+			for (;;)
+			{
+				WaitForSingleObject (impl->m_wake,INFINITE);
+				if (impl->m_stop)
+					break;
+				impl->RunIndices ();
+				if (InterlockedDecrement (&impl->m_pending) == 0)
+					SetEvent (impl->m_done);
+			}
+			return 0;
+		}
+
+		int ThreadCount () const
+		{
+			if (m_requested > 0)
+				return m_requested;
+			SYSTEM_INFO info;
+			GetSystemInfo (&info);
+			return info.dwNumberOfProcessors > 0 ? int (info.dwNumberOfProcessors) : 1;
+		}
+
+		void StartWorkers ()
+		{
+			const int workers = ThreadCount () - 1;
+			m_stop = 0;
+			while (int (m_threads.size ()) < workers)
+			{
+				HANDLE h = (HANDLE)_beginthreadex (NULL,0,WorkerMain,this,0,NULL);
+				if (!h)
+					break;
+				m_threads.push_back (h);
+			}
+		}
+
+		void StopWorkers ()
+		{
+			if (m_threads.empty ())
+				return;
+			InterlockedExchange (&m_stop,1);
+			ReleaseSemaphore (m_wake,LONG (m_threads.size ()),NULL);
+			for (size_t i=0;i<m_threads.size ();i++)
+			{
+				WaitForSingleObject (m_threads[i],INFINITE);
+				CloseHandle (m_threads[i]);
+			}
+			m_threads.clear ();
+		}
+
+		CRITICAL_SECTION				m_jobLock;
+		HANDLE							m_wake;
+		HANDLE							m_done;
+		std::vector<HANDLE>				m_threads;
+		int								m_requested;
+		AvocadoParallelTask				*m_task;
+		size_t							m_count;
+		volatile LONG					m_next;
+		volatile LONG					m_pending;
+		volatile LONG					m_stop;
+	};
+
+	AvocadoWorkerPool::AvocadoWorkerPool () : m_impl (new Impl ())
+	{
+	}
+
+	AvocadoWorkerPool& AvocadoWorkerPool::Get ()
+	{
+		// never destroyed, see Shutdown.
+		static AvocadoWorkerPool *s_pool = new AvocadoWorkerPool ();
+		return *s_pool;
+	}
+
+	void AvocadoWorkerPool::SetThreadCount (int count)
+	{
+		EnterCriticalSection (&m_impl->m_jobLock);
+		if (count < 0)
+			count = 0;
+		if (count != m_impl->m_requested)
+		{
+			m_impl->StopWorkers ();
+			m_impl->m_requested = count;
+		}
+		LeaveCriticalSection (&m_impl->m_jobLock);
+	}
+
+	int AvocadoWorkerPool::GetThreadCount ()
+	{
+		EnterCriticalSection (&m_impl->m_jobLock);
+		const int count = m_impl->ThreadCount ();
+		LeaveCriticalSection (&m_impl->m_jobLock);
+		return count;
+	}
+
+	void AvocadoWorkerPool::Shutdown ()
+	{
+		EnterCriticalSection (&m_impl->m_jobLock);
+		m_impl->StopWorkers ();
+		LeaveCriticalSection (&m_impl->m_jobLock);
+	}
+
+	void AvocadoWorkerPool::ParallelFor (size_t count, AvocadoParallelTask &task)
+	{
+		if (count == 0)
+			return;
+		if (count == 1 || s_inParallelFor)
+		{
+			for (size_t i=0;i<count;i++)
+				task.Run (i);
+			return;
+		}
+		EnterCriticalSection (&m_impl->m_jobLock);
+		m_impl->StartWorkers ();
+		const size_t wake = m_impl->m_threads.size () < count - 1 ? m_impl->m_threads.size () : count - 1;
+		m_impl->m_task = &task;
+		m_impl->m_count = count;
+		m_impl->m_next = 0;
+		m_impl->m_pending = LONG (wake);
+		if (wake)
+			ReleaseSemaphore (m_impl->m_wake,LONG (wake),NULL);
+		s_inParallelFor = 1;
+		m_impl->RunIndices ();
+		s_inParallelFor = 0;
+		if (wake)
+			WaitForSingleObject (m_impl->m_done,INFINITE);
+		m_impl->m_task = NULL;
+		LeaveCriticalSection (&m_impl->m_jobLock);
+	}
+}
@@ -0,0 +1,41 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#pragma once
+#include <cstddef>
+
+namespace avocado
+{
+	/* One index of a ParallelFor. Run is called from any pool thread, once per index, in no particular order. */
+	class AvocadoParallelTask
+	{
+	public:
+		virtual ~AvocadoParallelTask () {}
+		virtual void	Run (size_t index) = 0;
+	};
+
+	/* A fixed set of worker threads for the engine side data crunching (document text, parsing).
+	   ParallelFor returns once every index ran, the calling thread takes indices too.
+	   The tasks must not touch the scene graph, that stays on the thread that owns it. A parallel AvocadoSceneQuery
+	   is the one exception : it only reads, while the owning thread waits in ParallelFor.
+	   One ParallelFor runs at a time, a ParallelFor from inside a task runs on the calling thread. */
+	class AvocadoWorkerPool
+	{
+	public:
+		static AvocadoWorkerPool&	Get ();
+
+		/* 0 is one thread per core, 1 runs everything on the caller. */
+		void						SetThreadCount (int count);
+		int							GetThreadCount ();
+
+		void						ParallelFor (size_t count, AvocadoParallelTask &task);
+		/* Joins the threads, the next ParallelFor starts them again. Called from AvocadoTerminate,
+		   the pool itself lives for the whole process so nothing is joined while the dll unloads. */
+		void						Shutdown ();
+	private:
+		AvocadoWorkerPool ();
+
+		struct Impl;
+		Impl						*m_impl;
+	};
+}
@@ -21,6 +21,7 @@
 #include <sstream>
 #include <locale>
 #include <nvsg/Triangles.h>
+#include "AvocadoImportScheduler.h"
 
 #include <nvutil/DbgNew.h>
 
@@ -29,6 +30,32 @@ using namespace nvsg;
 using namespace nvutil;
 using namespace nvmath;
 
+namespace
+{
+  // builds an effect the first time its shader source shows up, under the cache lock as Cg is not re-entrant.
+  // The textures the source names are loaded with it, every state set gets a clone of its own.
+  struct FFPEffectMaker
+  {
+    CgFxSharedPtr Make( const std::string & shader )
+    {
+      bool failOnTextureLoad = false;
+      std::string error;
+      return CgFx::createFromLump( shader, std::vector<std::string>(), error, failOnTextureLoad );
+    }
+    CgFxSharedPtr Copy( const CgFxSharedPtr & cached )
+    {
+      return cached ? CgFxSharedPtr( cached->clone() ) : CgFxSharedPtr();
+    }
+  };
+
+  avocado::AvocadoImportCache<CgFxSharedPtr> s_effectCache;
+}
+
+void FFPToCgFxTraverser::ClearEffectCache()
+{
+  s_effectCache.Clear();
+}
+
 FFPToCgFxTraverser::FFPToCgFxTraverser()
   : m_numStateSets(0)
 {
@@ -205,9 +232,8 @@ void FFPToCgFxTraverser::handleStateSet(StateSet * stateSet)
     // now, apply effect to this stateset
     std::string shader = buildShader();
 
-    bool failOnTextureLoad = false;
-    std::string error;
-    CgFxSharedPtr cgfxh = CgFx::createFromLump( shader, std::vector<std::string>(), error, failOnTextureLoad );
+    FFPEffectMaker maker;
+    CgFxSharedPtr cgfxh = s_effectCache.Find( shader, maker );
 
     if( cgfxh )
     {
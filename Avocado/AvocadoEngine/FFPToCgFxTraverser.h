@@ -46,6 +46,8 @@ class FFPToCgFxTraverser : public nvtraverser::ExclusiveTraverser
     virtual ~FFPToCgFxTraverser();
 	void SetFlipYZ (bool flipYZ);
 	bool GetFlipYZ ();
+	// effects are built once per shader source and cloned for each state set, the import jobs share them.
+	static void ClearEffectCache ();
   protected:
     virtual std::string buildShader();
     virtual void handleStateSet(nvsg::StateSet * sSet);
@@ -1017,6 +1017,10 @@ namespace nvutil
 	  // delete ffpt;
 	}
   }
+  void clearFFPToCGFXCache ()
+  {
+    FFPToCgFxTraverser::ClearEffectCache ();
+  }
 
   void optimizeUnifyVertices( const nvsg::SceneSharedPtr & scene )
   {
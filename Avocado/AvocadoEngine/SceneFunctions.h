@@ -21,6 +21,8 @@ namespace nvutil
 	std::string GetProccessDirectory (bool media = true);
 	void convertFFPToCGFX(  nvsg::SceneSharedPtr & scene,bool flipYZ = false );
 	void convertFFPToCGFXNode(  nvsg::NodeSharedPtr & node, bool flipYZ = false );
+	// the effects convertFFPToCGFX shares between files and import jobs.
+	void clearFFPToCGFXCache ();
 	bool DrinkMaterialsFromStateSet (nvsg::StateSetSharedPtr ss, float ambient[3],float diffuse[3],float specular[3],float &shin,float &opac,std::string &orgTex);
 	void SetLightsPreset (nvsg::SceneSharedPtr,int pre,std::vector <nvsg::LightSourceSharedPtr> &return_lights);
 	void SetLightDirection (nvsg::SceneSharedPtr,float val, int LightIndex, int axis);
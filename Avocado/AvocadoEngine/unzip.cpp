@@ -4303,6 +4303,33 @@ ZRESULT UnzipItemHandle(HZIP hz, int index, HANDLE h) {return UnzipItemInternal(
 ZRESULT UnzipItem(HZIP hz, int index, const TCHAR *fn) {return UnzipItemInternal(hz,index,(void*)fn,0,ZIP_FILENAME);}
 ZRESULT UnzipItem(HZIP hz, int index, void *z,unsigned int len) {return UnzipItemInternal(hz,index,z,len,ZIP_MEMORY);}
 
+ZRESULT UnzipInflate(const void *src, unsigned int srclen, void *dst, unsigned int dstlen, unsigned long crc)
+{ if (dstlen==0) return (crc==0 ? ZR_OK : ZR_CORRUPT);
+  if (src==0 || dst==0) return ZR_ARGS;
+  z_stream stream;
+  stream.zalloc = (alloc_func)0;
+  stream.zfree = (free_func)0;
+  stream.opaque = (voidpf)0;
+  if (inflateInit2(&stream)!=Z_OK) return ZR_NOALLOC;
+  stream.next_in = (Byte*)src; stream.avail_in = srclen;
+  stream.next_out = (Byte*)dst; stream.avail_out = dstlen;
+  int err=Z_OK;
+  while (err==Z_OK && stream.avail_out>0)
+  { uInt inBefore=stream.avail_in, outBefore=stream.avail_out;
+    err = inflate(&stream,Z_SYNC_FLUSH);
+    if (stream.avail_in==inBefore && stream.avail_out==outBefore) break; // no progress, the stream is short
+  }
+  inflateEnd(&stream);
+  if (stream.avail_out!=0) return ZR_CORRUPT;
+  if (ucrc32(0,(const Byte*)dst,dstlen)!=crc) return ZR_CORRUPT;
+  return ZR_OK;
+}
+
+unsigned long UnzipCrc32(unsigned long crc, const void *buf, unsigned int len)
+{ if (buf==0 || len==0) return crc;
+  return ucrc32(crc,(const Byte*)buf,len);
+}
+
 ZRESULT SetUnzipBaseDir(HZIP hz, const TCHAR *dir)
 { if (hz==0) {lasterrorU=ZR_ARGS;return ZR_ARGS;}
   TUnzipHandleData *han = (TUnzipHandleData*)hz;
@@ -97,6 +97,15 @@ ZRESULT UnzipItemHandle(HZIP hz, int index, HANDLE h);
 // If you unzip a directory with ZIP_FILENAME, then the directory gets created.
 // If you unzip it to a handle or a memory block, then nothing gets created
 // and it emits 0 bytes.
+ZRESULT UnzipInflate(const void *src, unsigned int srclen, void *dst, unsigned int dstlen, unsigned long crc);
+// UnzipInflate - inflates the deflated data of an item that is already in memory,
+// src/srclen being the comp_size bytes that follow its local header. dstlen must be
+// the item's unc_size and crc its crc, the result is ZR_CORRUPT when either does not
+// match. It needs no HZIP and keeps no state, so it can be called from any thread;
+// it does not set the code that FormatZipMessage(ZR_RECENT) reports.
+unsigned long UnzipCrc32(unsigned long crc, const void *buf, unsigned int len);
+// UnzipCrc32 - the zip crc of buf, carried on from crc: 0 to start one, the crc of
+// the bytes before buf to extend it. Like UnzipInflate it needs no HZIP.
 ZRESULT SetUnzipBaseDir(HZIP hz, const TCHAR *dir);
 // if unzipping to a filename, and it's a relative filename, then it will be relative to here.
 // (defaults to current-directory).
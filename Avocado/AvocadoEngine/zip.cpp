@@ -36,6 +36,7 @@ typedef unsigned short WORD;
 #else
 	#include "../AvocadoHandlers/stdafx.h"
 #endif
+#include <process.h>
 #include "zip.h"
 #endif
 
@@ -625,6 +626,7 @@ typedef unsigned (*WRITEFUNC)(void *param, const char *buf, unsigned size);
 struct TState
 { void *param;
   int level; bool seekable;
+  bool lastblock; // false when the input is one block of a larger item, see flush_end
   READFUNC readfunc; FLUSHFUNC flush_outbuf;
   TTreeState ts; TBitState bs; TDeflateState ds;
   const char *err;
@@ -1688,7 +1690,7 @@ void lm_init (TState &state, int pack_level, ush *flags)
 {
     register unsigned j;
 
-    Assert(state,pack_level>=1 && pack_level<=8,"bad pack level");
+    Assert(state,pack_level>=1 && pack_level<=9,"bad pack level");
 
     /* Do not slide the window if the whole input is already in memory
      * (window_size > 0)
@@ -1938,6 +1940,24 @@ void fill_window(TState &state)
    flush_block(state,state.ds.block_start >= 0L ? (char*)&state.ds.window[(unsigned)state.ds.block_start] : \
                 (char*)NULL, (long)state.ds.strstart - state.ds.block_start, (eof))
 
+/* ===========================================================================
+ * Flush the last block of the input. When the input is one block of a larger
+ * item (the parallel mode) it is not the end of the deflate stream: the data
+ * is followed by an empty stored block instead, which is not marked as the
+ * last one and brings the output to a byte boundary, so that the output of
+ * the item's next block can simply be appended to it.
+ */
+ulg flush_end(TState &state)
+{
+    if (state.lastblock) return FLUSH_BLOCK(state,1); /* eof */
+    FLUSH_BLOCK(state,0);
+    send_bits(state,(STORED_BLOCK<<1)+0, 3);
+    state.ts.cmpr_bytelen += ((state.ts.cmpr_len_bits + 3 + 7) >> 3) + 4;
+    state.ts.cmpr_len_bits = 0L;
+    copy_block(state,(char*)NULL, 0, 1); /* with header, flushes the output */
+    return state.ts.cmpr_bytelen;
+}
+
 /* ===========================================================================
  * Processes a new input file and return its compressed length. This
  * function does not perform lazy evaluation of matches and inserts
@@ -2017,7 +2037,7 @@ ulg deflate_fast(TState &state)
          */
         if (state.ds.lookahead < MIN_LOOKAHEAD) fill_window(state);
     }
-    return FLUSH_BLOCK(state,1); /* eof */
+    return flush_end(state);
 }
 
 /* ===========================================================================
@@ -2126,7 +2146,7 @@ ulg deflate(TState &state)
     }
     if (match_available) ct_tally (state,0, state.ds.window[state.ds.strstart-1]);
 
-    return FLUSH_BLOCK(state,1); /* eof */
+    return flush_end(state);
 }
 
 
@@ -2285,6 +2305,37 @@ ulg crc32(ulg crc, const uch *buf, extent len)
   return crc ^ 0xffffffffL;  // (instead of ~c for 64-bit machines)
 }
 
+// crc32_combine - the crc of two pieces of data one after the other, from the
+// crc of each and the length of the second. This is zlib's: appending len2
+// zero bytes to the first piece is a linear operation on its crc, done here by
+// squaring the matrix of the one-zero-bit operator log2(len2) times.
+ulg gf2_matrix_times(const ulg *mat, ulg vec)
+{ ulg sum=0;
+  while (vec) {if (vec&1) sum^=*mat; vec>>=1; mat++;}
+  return sum;
+}
+void gf2_matrix_square(ulg *square, const ulg *mat)
+{ for (int n=0; n<32; n++) square[n]=gf2_matrix_times(mat,mat[n]);
+}
+ulg crc32_combine(ulg crc1, ulg crc2, ulg len2)
+{ if (len2==0) return crc1;
+  ulg even[32], odd[32];
+  odd[0]=0xedb88320L; // the crc polynomial
+  ulg row=1; for (int n=1; n<32; n++) {odd[n]=row; row<<=1;}
+  gf2_matrix_square(even,odd); // two zero bits
+  gf2_matrix_square(odd,even); // four zero bits
+  do
+  { gf2_matrix_square(even,odd); // the first square gives one zero byte
+    if (len2&1) crc1=gf2_matrix_times(even,crc1);
+    len2>>=1;
+    if (len2==0) break;
+    gf2_matrix_square(odd,even);
+    if (len2&1) crc1=gf2_matrix_times(odd,crc1);
+    len2>>=1;
+  } while (len2!=0);
+  return crc1^crc2;
+}
+
 
 void update_keys(unsigned long *keys, char c)
 { keys[0] = CRC32(keys[0],c);
@@ -2334,6 +2385,35 @@ bool HasZipSuffix(const TCHAR *fn)
   return false;
 }
 
+bool HasCompressedSuffix(const TCHAR *fn)
+{ // formats that are compressed already, stored when ZipSetCompression asks for it
+  if (HasZipSuffix(fn)) return true;
+  const TCHAR *ext = fn+_tcslen(fn);
+  while (ext>fn && *ext!='.') ext--;
+  if (ext==fn && *ext!='.') return false;
+  if (lustricmp(ext,_T(".jpg"))==0) return true;
+  if (lustricmp(ext,_T(".jpeg"))==0) return true;
+  if (lustricmp(ext,_T(".png"))==0) return true;
+  if (lustricmp(ext,_T(".gif"))==0) return true;
+  if (lustricmp(ext,_T(".7z"))==0) return true;
+  if (lustricmp(ext,_T(".rar"))==0) return true;
+  if (lustricmp(ext,_T(".cab"))==0) return true;
+  if (lustricmp(ext,_T(".mp3"))==0) return true;
+  if (lustricmp(ext,_T(".mp4"))==0) return true;
+  if (lustricmp(ext,_T(".wmv"))==0) return true;
+  return false;
+}
+
+bool HasCompressedSignature(const unsigned char *b, unsigned int len)
+{ // the same formats by their first bytes, whatever the item is named
+  if (len>=3 && b[0]==0xFF && b[1]==0xD8 && b[2]==0xFF) return true;             // jpeg
+  if (len>=4 && b[0]==0x89 && b[1]=='P' && b[2]=='N' && b[3]=='G') return true;   // png
+  if (len>=4 && b[0]=='G' && b[1]=='I' && b[2]=='F' && b[3]=='8') return true;    // gif
+  if (len>=4 && b[0]=='P' && b[1]=='K' && b[2]==3 && b[3]==4) return true;        // zip, and the .avc in it
+  if (len>=2 && b[0]==0x1F && b[1]==0x8B) return true;                             // gzip
+  if (len>=6 && b[0]=='7' && b[1]=='z' && b[2]==0xBC && b[3]==0xAF) return true;  // 7z
+  return false;
+}
 
 
 
@@ -2341,10 +2421,14 @@ bool HasZipSuffix(const TCHAR *fn)
 
 
 
+
+struct TZipBlock;
+class TZipParallel;
+
 class TZip
 { public:
-  TZip(const char *pwd) : hfout(0),mustclosehfout(false),hmapout(0),zfis(0),obuf(0),hfin(0),writ(0),oerr(false),hasputcen(false),ooffset(0),encwriting(false),encbuf(0),password(0), state(0) {if (pwd!=0 && *pwd!=0) {password=new char[strlen(pwd)+1]; strcpy(password,pwd);}}
-  ~TZip() {if (state!=0) delete state; state=0; if (encbuf!=0) delete[] encbuf; encbuf=0; if (password!=0) delete[] password; password=0;}
+  TZip(const char *pwd) : hfout(0),mustclosehfout(false),hmapout(0),zfis(0),obuf(0),hfin(0),writ(0),oerr(false),hasputcen(false),ooffset(0),encwriting(false),encbuf(0),password(0), state(0), par(0), level(8), sniff(false), icrc(true) {if (pwd!=0 && *pwd!=0) {password=new char[strlen(pwd)+1]; strcpy(password,pwd);}}
+  ~TZip() {pstop(); if (state!=0) delete state; state=0; if (encbuf!=0) delete[] encbuf; encbuf=0; if (password!=0) delete[] password; password=0;}
 
   // These variables say about the file we're writing into
   // We can write to pipe, file-by-handle, file-by-name, memory-to-memmapfile
@@ -2367,6 +2451,9 @@ class TZip
   //
   TZipFileInfo *zfis;       // each file gets added onto this list, for writing the table at the end
   TState *state;            // we use just one state object per zip, because it's big (500k)
+  TZipParallel *par;        // the threads and blocks of the parallel mode, or 0 when the items are deflated here
+  int level;                // deflate level of the items, 0 to store them, see ZipSetCompression
+  bool sniff;               // store the items that do not compress
 
   ZRESULT Create(void *z,unsigned int len,DWORD flags);
   static unsigned sflush(void *param,const char *buf, unsigned *size);
@@ -2382,6 +2469,7 @@ class TZip
   ulg attr; iztimes times; ulg timestamp;  // all open_* methods set these
   bool iseekable; long isize,ired;         // size is not set until close() on pips
   ulg crc;                                 // crc is not set until close(). iwrit is cumulative
+  bool icrc;                               // whether read() keeps the crc, the parallel mode's threads do it instead
   HANDLE hfin; bool selfclosehf;           // for input files and pipes
   const char *bufin; unsigned int lenin,posin; // for memory
   // and a variable for what we've done with the input: (i.e. compressed it!)
@@ -2396,14 +2484,25 @@ class TZip
   ZRESULT open_dir();
   static unsigned sread(TState &s,char *buf,unsigned size);
   unsigned read(char *buf, unsigned size);
+  unsigned int peek(char *buf, unsigned int size);
+  bool icompressible(const TCHAR *dstzn);
   ZRESULT iclose();
 
   ZRESULT ideflate(TZipFileInfo *zfi);
   ZRESULT istore();
 
+  void initentry(TZipFileInfo &zfi, const TCHAR *dstzn, bool needs_trailing_slash, bool isdir, int method, int passex, char *xloc, char *xcen);
+  ZRESULT endentry(TZipFileInfo &zfi, int method, int passex, bool isdir, ulg ecrc, ulg ecsize, long eisize);
   ZRESULT Add(const TCHAR *odstzn, void *src,unsigned int len, DWORD flags);
   ZRESULT AddCentral();
 
+  ZRESULT SetParallel(unsigned int threads);
+  ZRESULT SetCompression(int level, bool sniff);
+  ZRESULT padd(const TCHAR *dstzn, bool needs_trailing_slash, int method, int mlevel);
+  ZRESULT pwrite(unsigned int keep);
+  void pputblock(TZipBlock &b);
+  void pstop();
+
 };
 
 
@@ -2524,6 +2623,7 @@ ZRESULT TZip::GetMemory(void **pbuf, unsigned long *plen)
 { // When the user calls GetMemory, they're presumably at the end
   // of all their adding. In any case, we have to add the central
   // directory now, otherwise the memory we tell them won't be complete.
+  pwrite(0); pstop();
   if (!hasputcen) AddCentral(); hasputcen=true;
   if (pbuf!=NULL) *pbuf=(void*)obuf;
   if (plen!=NULL) *plen=writ;
@@ -2533,8 +2633,9 @@ ZRESULT TZip::GetMemory(void **pbuf, unsigned long *plen)
 
 ZRESULT TZip::Close()
 { // if the directory hadn't already been added through a call to GetMemory,
-  // then we do it now
-  ZRESULT res=ZR_OK; if (!hasputcen) res=AddCentral(); hasputcen=true;
+  // then we do it now, after the blocks of the parallel mode still in flight
+  ZRESULT res=pwrite(0); pstop();
+  if (!hasputcen) {ZRESULT cres=AddCentral(); if (res==ZR_OK) res=cres;} hasputcen=true;
 #ifdef ZIP_STD
   if (hfout!=0 && mustclosehfout) fclose(hfout); hfout=0; mustclosehfout=false;
 #else
@@ -2638,7 +2739,7 @@ unsigned TZip::read(char *buf, unsigned size)
     memcpy(buf, bufin+posin, red);
     posin += red;
     ired += red;
-    crc = crc32(crc, (uch*)buf, red);
+    if (icrc) crc = crc32(crc, (uch*)buf, red);
     return red;
   }
   else if (hfin!=0)
@@ -2651,12 +2752,90 @@ unsigned TZip::read(char *buf, unsigned size)
     if (!ok) return 0;
 #endif
     ired += red;
-    crc = crc32(crc, (uch*)buf, red);
+    if (icrc) crc = crc32(crc, (uch*)buf, red);
     return red;
   }
   else {oerr=ZR_NOTINITED; return 0;}
 }
 
+unsigned int TZip::peek(char *pbuf, unsigned int size)
+{ // the first bytes of the input, which is left where it was: at its start
+  if (bufin!=0)
+  { unsigned int red = lenin-posin; if (red>size) red=size;
+    memcpy(pbuf,bufin+posin,red);
+    return red;
+  }
+  if (hfin==0 || !iseekable) return 0;
+  unsigned int red=0;
+  while (red<size)
+  {
+#ifdef ZIP_STD
+    DWORD n = (DWORD)fread(pbuf+red,1,size-red,hfin);
+#else
+    DWORD n=0; if (!ReadFile(hfin,pbuf+red,size-red,&n,NULL)) n=0;
+#endif
+    if (n==0) break;
+    red+=n;
+  }
+#ifdef ZIP_STD
+  fseek(hfin,0,SEEK_SET);
+#else
+  SetFilePointer(hfin,0,NULL,FILE_BEGIN);
+#endif
+  return red;
+}
+
+struct TZipSample  // what icompressible deflates, and how much comes out
+{ const char *in; unsigned int inlen, inpos;
+  unsigned int outlen;
+};
+
+static unsigned sampleread(TState &state,char *buf,unsigned size)
+{ TZipSample *s = (TZipSample*)state.param;
+  unsigned int red = s->inlen-s->inpos;
+  if (red>size) red=size;
+  memcpy(buf,s->in+s->inpos,red);
+  s->inpos += red;
+  return red;
+}
+
+static unsigned sampleflush(void *param,const char *, unsigned *size)
+{ TZipSample *s = (TZipSample*)param;
+  unsigned int writ=*size; s->outlen+=writ; *size=0;
+  return writ;
+}
+
+#define SAMPLE_SIZE (64*1024)
+#define SAMPLE_MIN (256*1024)
+
+bool TZip::icompressible(const TCHAR *dstzn)
+{ // By its name, then by its first bytes: its signature, and what the fastest
+  // level makes of them. Less than 1/16th saved and it is not worth deflating.
+  // Items under SAMPLE_MIN are not sampled, deflating them costs less than that.
+  if (HasCompressedSuffix(dstzn)) return false;
+  char *sample = new char[SAMPLE_SIZE];
+  unsigned int len = peek(sample,SAMPLE_SIZE);
+  bool res = true;
+  if (HasCompressedSignature((const unsigned char*)sample,len)) res=false;
+  else if (len>=4096 && isize>=SAMPLE_MIN)
+  { if (state==0) state=new TState();
+    TZipSample s; s.in=sample; s.inlen=len; s.inpos=0; s.outlen=0;
+    state->readfunc=sampleread; state->flush_outbuf=sampleflush;
+    state->param=&s; state->level=1; state->seekable=true; state->err=NULL;
+    state->lastblock=true;
+    state->ts.static_dtree[0].dl.len = 0;
+    state->ds.window_size=0;
+    ush att=(ush)BINARY, flg=0;
+    bi_init(*state,buf,sizeof(buf),1);
+    ct_init(*state,&att);
+    lm_init(*state,1,&flg);
+    deflate(*state);
+    if (state->err==NULL && s.outlen > len-len/16) res=false;
+  }
+  delete[] sample;
+  return res;
+}
+
 ZRESULT TZip::iclose()
 { 
 #ifdef ZIP_STD
@@ -2678,7 +2857,8 @@ ZRESULT TZip::ideflate(TZipFileInfo *zfi)
   // stack breaks if we try to put it all on the stack. It will be deleted lazily
   state->err=0;
   state->readfunc=sread; state->flush_outbuf=sflush;
-  state->param=this; state->level=8; state->seekable=iseekable; state->err=NULL;
+  state->param=this; state->level=(level<1 ? 1 : level); state->seekable=iseekable; state->err=NULL;
+  state->lastblock=true;
   // the following line will make ct_init realise it has to perform the init
   state->ts.static_dtree[0].dl.len = 0;
   // Thanks to Alvin77 for this crucial fix:
@@ -2709,36 +2889,279 @@ ZRESULT TZip::istore()
 
 
 
-bool has_seeded=false;
-ZRESULT TZip::Add(const TCHAR *odstzn, void *src,unsigned int len, DWORD flags)
+// ----------------------------------------------------------------------
+// The parallel mode, see ZipSetParallel in zip.h. Each item is read in blocks
+// of PAR_BLOCKSIZE that the threads deflate independently of each other; the
+// adding thread writes them in order as soon as the oldest one is done. At
+// most PAR_BLOCKSPERTHREAD blocks per thread are in flight, their buffers are
+// kept for the blocks that follow.
+#ifdef ZIP_STD
+// no threads here, the items are deflated as they are added
+ZRESULT TZip::SetParallel(unsigned int) {return ZR_OK;}
+ZRESULT TZip::padd(const TCHAR *,bool,int,int) {return ZR_ARGS;}
+ZRESULT TZip::pwrite(unsigned int) {return ZR_OK;}
+void TZip::pstop() {}
+#else
+
+#define PAR_BLOCKSIZE (1024*1024)
+#define PAR_BLOCKSPERTHREAD 4
+
+struct TZipEntry  // an item while its blocks are in flight
+{ TZipFileInfo zfi;
+  char xloc[EB_L_UT_SIZE], xcen[EB_C_UT_SIZE];
+  int method;
+  ulg crc, csize; long isize;  // of the blocks written so far
+};
+
+struct TZipBlock
+{ TZipEntry *entry;            // the item it is a part of
+  int method, level;
+  bool first, last;            // the first block writes the local header, the last one the sizes and crc
+  char *in; unsigned int inlen, inpos;
+  char *out; unsigned int outlen, outsize;
+  ulg crc; ush flg;            // of its input, and what lm_init makes of the level
+  ZRESULT res;
+  volatile LONG done;          // set by the thread that deflated it
+};
+
+class TZipParallel
+{ public:
+  TZipParallel() : blocks(0), nblocks(0), head(0), count(0), take(0), threads(0), nthreads(0), work(0), done(0), quit(0) {InitializeCriticalSection(&cs);}
+  ~TZipParallel();
+  bool Start(unsigned int n);
+  void Submit(TZipBlock &b) {b.done=0; ReleaseSemaphore(work,1,NULL);}
+
+  TZipBlock *blocks; unsigned int nblocks; // a ring of slots
+  unsigned int head, count;  // the oldest block not yet written, and how many are in flight (adding thread only)
+  unsigned int take;         // the next block for a thread to deflate, under cs
+  CRITICAL_SECTION cs;
+  HANDLE *threads; unsigned int nthreads;
+  HANDLE work;               // semaphore, the blocks submitted that no thread took yet
+  HANDLE done;               // auto-reset event, a thread finished a block
+  volatile LONG quit;
+
+  static unsigned __stdcall ThreadMain(void *param);
+  static void deflateblock(TState &state, char *obuf, unsigned int obufsize, TZipBlock &b);
+  static unsigned bread(TState &state,char *buf,unsigned size);
+  static unsigned bflush(void *param,const char *buf, unsigned *size);
+};
+
+bool TZipParallel::Start(unsigned int n)
+{ nblocks = n*PAR_BLOCKSPERTHREAD;
+  blocks = new TZipBlock[nblocks];
+  for (unsigned int i=0; i<nblocks; i++)
+  { TZipBlock &b=blocks[i]; b.entry=0; b.last=false; b.in=0; b.inlen=0; b.out=0; b.outlen=0; b.outsize=0; b.done=0;
+  }
+  work = CreateSemaphore(NULL,0,nblocks+n,NULL);
+  done = CreateEvent(NULL,FALSE,FALSE,NULL);
+  if (work==0 || done==0) return false;
+  threads = new HANDLE[n];
+  for (nthreads=0; nthreads<n; nthreads++)
+  { threads[nthreads] = (HANDLE)_beginthreadex(NULL,0,ThreadMain,this,0,NULL);
+    if (threads[nthreads]==0) break;
+  }
+  return nthreads!=0;
+}
+
+TZipParallel::~TZipParallel()
+{ // the blocks have been written, or never will be after an error
+  if (nthreads!=0)
+  { InterlockedExchange(&quit,1);
+    ReleaseSemaphore(work,nthreads,NULL);
+    for (unsigned int i=0; i<nthreads; i++) {WaitForSingleObject(threads[i],INFINITE); CloseHandle(threads[i]);}
+  }
+  if (threads!=0) delete[] threads;
+  if (work!=0) CloseHandle(work);
+  if (done!=0) CloseHandle(done);
+  for (unsigned int i=0; i<nblocks; i++)
+  { TZipBlock &b=blocks[i];
+    if (b.entry!=0 && b.last) delete b.entry;
+    if (b.in!=0) delete[] b.in;
+    if (b.out!=0) delete[] b.out;
+  }
+  if (blocks!=0) delete[] blocks;
+  DeleteCriticalSection(&cs);
+}
+
+unsigned __stdcall TZipParallel::ThreadMain(void *param)
+{ TZipParallel *par = (TZipParallel*)param;
+  TState *state = new TState(); // the 500k again, one per thread
+  char *obuf = new char[16384];
+  for (;;)
+  { WaitForSingleObject(par->work,INFINITE);
+    if (InterlockedCompareExchange(&par->quit,0,0)!=0) break;
+    EnterCriticalSection(&par->cs);
+    TZipBlock &b = par->blocks[par->take];
+    par->take = (par->take+1)%par->nblocks;
+    LeaveCriticalSection(&par->cs);
+    deflateblock(*state,obuf,16384,b);
+    InterlockedExchange(&b.done,1);
+    SetEvent(par->done);
+  }
+  delete[] obuf;
+  delete state;
+  return 0;
+}
+
+void TZipParallel::deflateblock(TState &state, char *obuf, unsigned int obufsize, TZipBlock &b)
+{ b.crc = crc32(CRCVAL_INITIAL,(uch*)b.in,b.inlen);
+  b.outlen=0; b.flg=0; b.res=ZR_OK;
+  if (b.method==STORE) return; // it is written as it was read
+  // as TZip::ideflate, but the input is the block and the output goes after it
+  state.readfunc=bread; state.flush_outbuf=bflush;
+  state.param=&b; state.level=b.level; state.seekable=true; state.err=NULL;
+  state.lastblock=b.last;
+  state.ts.static_dtree[0].dl.len = 0;
+  state.ds.window_size=0;
+  b.inpos=0;
+  ush att=(ush)BINARY;
+  bi_init(state,obuf,obufsize,1);
+  ct_init(state,&att);
+  lm_init(state,state.level,&b.flg);
+  deflate(state);
+  if (state.err!=NULL) b.res=ZR_FLATE;
+}
+
+unsigned TZipParallel::bread(TState &state,char *buf,unsigned size)
+{ // static
+  TZipBlock *b = (TZipBlock*)state.param;
+  unsigned int red = b->inlen-b->inpos;
+  if (red>size) red=size;
+  memcpy(buf,b->in+b->inpos,red);
+  b->inpos += red;
+  return red;
+}
+
+unsigned TZipParallel::bflush(void *param,const char *buf, unsigned *size)
+{ // static
+  if (*size==0) return 0;
+  TZipBlock *b = (TZipBlock*)param;
+  if (b->outlen+*size > b->outsize)
+  { unsigned int n = (b->outsize==0 ? PAR_BLOCKSIZE : b->outsize*2);
+    while (n < b->outlen+*size) n*=2;
+    char *out = new char[n];
+    if (b->outlen!=0) memcpy(out,b->out,b->outlen);
+    if (b->out!=0) delete[] b->out;
+    b->out=out; b->outsize=n;
+  }
+  memcpy(b->out+b->outlen,buf,*size);
+  b->outlen += *size;
+  unsigned int writ=*size; *size=0;
+  return writ;
+}
+
+ZRESULT TZip::SetParallel(unsigned int threads)
 { if (oerr) return ZR_FAILED;
   if (hasputcen) return ZR_ENDED;
+  if (threads==0) {SYSTEM_INFO si; GetSystemInfo(&si); threads=si.dwNumberOfProcessors;}
+  ZRESULT r = pwrite(0);
+  pstop();
+  if (r!=ZR_OK) return r;
+  if (threads<=1) return ZR_OK;
+  par = new TZipParallel();
+  if (!par->Start(threads)) {pstop(); return ZR_NOALLOC;}
+  return ZR_OK;
+}
 
-  // if we use password encryption, then every isize and csize is 12 bytes bigger
-  int passex=0; if (password!=0 && flags!=ZIP_FOLDER) passex=12;
+void TZip::pstop()
+{ if (par!=0) delete par;
+  par=0;
+}
 
-  // zip has its own notion of what its names should look like: i.e. dir/file.stuff
-  TCHAR dstzn[MAX_PATH]; _tcsncpy(dstzn,odstzn,MAX_PATH); dstzn[MAX_PATH-1]=0;
-  if (*dstzn==0) return ZR_ARGS;
-  TCHAR *d=dstzn; while (*d!=0) {if (*d=='\\') *d='/'; d++;}
-  bool isdir = (flags==ZIP_FOLDER);
-  bool needs_trailing_slash = (isdir && dstzn[_tcslen(dstzn)-1]!='/');
-  int method=DEFLATE; if (isdir || HasZipSuffix(dstzn)) method=STORE;
+ZRESULT TZip::padd(const TCHAR *dstzn, bool needs_trailing_slash, int method, int mlevel)
+{ TZipEntry *e = new TZipEntry;
+  initentry(e->zfi,dstzn,needs_trailing_slash,false,method,0,e->xloc,e->xcen);
+  e->method=method; e->crc=CRCVAL_INITIAL; e->csize=0; e->isize=0;
+  // A full block only goes to the threads once there is more input after it,
+  // since the last block of the item is the one that ends the deflate stream.
+  TZipBlock *pend=0;
+  ZRESULT r=ZR_OK;
+  icrc=false; // the threads do it
+  for (;;)
+  { if (par->count==par->nblocks) {r=pwrite(par->nblocks-1); if (r!=ZR_OK) break;}
+    TZipBlock &b = par->blocks[(par->head+par->count)%par->nblocks];
+    if (b.in==0) b.in=new char[PAR_BLOCKSIZE];
+    b.inlen=0;
+    bool eof=false;
+    while (!eof && b.inlen<PAR_BLOCKSIZE)
+    { unsigned int red=read(b.in+b.inlen,PAR_BLOCKSIZE-b.inlen);
+      if (red==0 || red==(unsigned int)EOF) eof=true;
+      else b.inlen+=red;
+    }
+    if (b.inlen==0 && pend!=0) break;
+    if (pend!=0) par->Submit(*pend);
+    b.entry=e; b.method=method; b.level=mlevel; b.first=(pend==0); b.last=false;
+    par->count++;
+    pend=&b;
+    if (eof) break;
+  }
+  icrc=true;
+  iclose();
+  if (r!=ZR_OK)
+  { // the blocks in flight are dropped with the threads, the zip has failed anyway
+    pstop();
+    delete e;
+    return r;
+  }
+  pend->last=true; // from now on the blocks own the entry
+  par->Submit(*pend);
+  return oerr;
+}
+
+ZRESULT TZip::pwrite(unsigned int keep)
+{ // Writes the oldest blocks in flight until no more than 'keep' are left,
+  // waiting for the threads to deflate them.
+  if (par==0) return ZR_OK;
+  while (par->count>keep)
+  { TZipBlock &b = par->blocks[par->head];
+    while (InterlockedCompareExchange(&b.done,0,0)==0) WaitForSingleObject(par->done,INFINITE);
+    pputblock(b);
+    b.entry=0;
+    par->head=(par->head+1)%par->nblocks;
+    par->count--;
+  }
+  return oerr;
+}
 
-  // now open whatever was our input source:
-  ZRESULT openres;
-  if (flags==ZIP_FILENAME) openres=open_file((const TCHAR*)src);
-  else if (flags==ZIP_HANDLE) openres=open_handle((HANDLE)src,len);
-  else if (flags==ZIP_MEMORY) openres=open_mem(src,len);
-  else if (flags==ZIP_FOLDER) openres=open_dir();
-  else return ZR_ARGS;
-  if (openres!=ZR_OK) return openres;
+void TZip::pputblock(TZipBlock &b)
+{ TZipEntry *e = b.entry;
+  if (oerr==ZR_OK && b.res!=ZR_OK) oerr=b.res;
+  if (oerr==ZR_OK && b.first)
+  { e->zfi.off = writ+ooffset;
+    if (putlocal(&e->zfi,swrite,this)!=ZE_OK && oerr==ZR_OK) oerr=ZR_WRITE;
+    writ += 4 + LOCHEAD + (unsigned int)e->zfi.nam + (unsigned int)e->zfi.ext;
+  }
+  if (oerr==ZR_OK)
+  { const char *data = (b.method==STORE ? b.in : b.out);
+    unsigned int len = (b.method==STORE ? b.inlen : b.outlen);
+    if (len!=0 && write(data,len)!=len && oerr==ZR_OK) oerr=ZR_WRITE;
+    writ += len;
+    e->csize += len;
+    e->isize += b.inlen;
+    e->crc = crc32_combine(e->crc,b.crc,b.inlen);
+    e->zfi.flg |= b.flg;
+  }
+  if (b.last)
+  { if (oerr==ZR_OK) oerr=endentry(e->zfi,e->method,0,false,e->crc,e->csize,e->isize);
+    delete e;
+  }
+}
+#endif
 
-  // A zip "entry" consists of a local header (which includes the file name),
-  // then the compressed data, and possibly an extended local header.
+ZRESULT TZip::SetCompression(int l, bool s)
+{ if (oerr) return ZR_FAILED;
+  if (hasputcen) return ZR_ENDED;
+  if (l<0 || l>9) return ZR_ARGS;
+  level=l; sniff=s;
+  return ZR_OK;
+}
 
-  // Initialize the local header
-  TZipFileInfo zfi; zfi.nxt=NULL;
+
+
+bool has_seeded=false;
+void TZip::initentry(TZipFileInfo &zfi, const TCHAR *dstzn, bool needs_trailing_slash, bool isdir, int method, int passex, char *xloc, char *xcen)
+{ // Initialize the local header for the input just opened
+  zfi.nxt=NULL;
   strcpy(zfi.name,"");
 #ifdef UNICODE
   WideCharToMultiByte(CP_UTF8,0,dstzn,-1,zfi.iname,MAX_PATH,0,0);
@@ -2771,8 +3194,8 @@ ZRESULT TZip::Add(const TCHAR *odstzn, void *src,unsigned int len, DWORD flags)
   // stuff the 'times' structure into zfi.extra
 
   // nb. apparently there's a problem with PocketPC CE(zip)->CE(unzip) fails. And removing the following block fixes it up.
-  char xloc[EB_L_UT_SIZE]; zfi.extra=xloc;  zfi.ext=EB_L_UT_SIZE;
-  char xcen[EB_C_UT_SIZE]; zfi.cextra=xcen; zfi.cext=EB_C_UT_SIZE;
+  zfi.extra=xloc;  zfi.ext=EB_L_UT_SIZE;
+  zfi.cextra=xcen; zfi.cext=EB_C_UT_SIZE;
   xloc[0]  = 'U';
   xloc[1]  = 'T';
   xloc[2]  = EB_UT_LEN(3);       // length of data part of e.f.
@@ -2792,7 +3215,82 @@ ZRESULT TZip::Add(const TCHAR *odstzn, void *src,unsigned int len, DWORD flags)
   xloc[16] = (char)(times.ctime >> 24);
   memcpy(zfi.cextra,zfi.extra,EB_C_UT_SIZE);
   zfi.cextra[EB_LEN] = EB_UT_LEN(1);
+}
+
+ZRESULT TZip::endentry(TZipFileInfo &zfi, int method, int passex, bool isdir, ulg ecrc, ulg ecsize, long eisize)
+{ // The item's data has been written, ecrc/ecsize/eisize are its crc, compressed and uncompressed size.
+  int r;
+  // (3) Either rewrite the local header with correct information...
+  bool first_header_has_size_right = (zfi.siz==ecsize+passex);
+  zfi.crc = ecrc;
+  zfi.siz = ecsize+passex;
+  zfi.len = eisize;
+  if (ocanseek && (password==0 || isdir))
+  { zfi.how = (ush)method;
+    if ((zfi.flg & 1) == 0) zfi.flg &= ~8; // clear the extended local header flag
+    zfi.lflg = zfi.flg;
+    // rewrite the local header:
+    if (!oseek(zfi.off-ooffset)) return ZR_SEEK;
+    if ((r = putlocal(&zfi, swrite,this)) != ZE_OK) return ZR_WRITE;
+    if (!oseek(writ)) return ZR_SEEK;
+  }
+  else
+  { // (4) ... or put an updated header at the end
+    if (zfi.how != (ush) method) return ZR_NOCHANGE;
+    if (method==STORE && !first_header_has_size_right) return ZR_NOCHANGE;
+    if ((r = putextended(&zfi, swrite,this)) != ZE_OK) return ZR_WRITE;
+    writ += 16L;
+    zfi.flg = zfi.lflg; // if flg modified by inflate, for the central index
+  }
+  if (oerr!=ZR_OK) return oerr;
+
+  // Keep a copy of the zipfileinfo, for our end-of-zip directory
+  char *cextra = new char[zfi.cext]; memcpy(cextra,zfi.cextra,zfi.cext); zfi.cextra=cextra;
+  TZipFileInfo *pzfi = new TZipFileInfo; memcpy(pzfi,&zfi,sizeof(zfi));
+  if (zfis==NULL) zfis=pzfi;
+  else {TZipFileInfo *z=zfis; while (z->nxt!=NULL) z=z->nxt; z->nxt=pzfi;}
+  return ZR_OK;
+}
 
+ZRESULT TZip::Add(const TCHAR *odstzn, void *src,unsigned int len, DWORD flags)
+{ if (oerr) return ZR_FAILED;
+  if (hasputcen) return ZR_ENDED;
+
+  // if we use password encryption, then every isize and csize is 12 bytes bigger
+  int passex=0; if (password!=0 && flags!=ZIP_FOLDER) passex=12;
+
+  // zip has its own notion of what its names should look like: i.e. dir/file.stuff
+  TCHAR dstzn[MAX_PATH]; _tcsncpy(dstzn,odstzn,MAX_PATH); dstzn[MAX_PATH-1]=0;
+  if (*dstzn==0) return ZR_ARGS;
+  TCHAR *d=dstzn; while (*d!=0) {if (*d=='\\') *d='/'; d++;}
+  bool isdir = (flags==ZIP_FOLDER);
+  bool needs_trailing_slash = (isdir && dstzn[_tcslen(dstzn)-1]!='/');
+  int method=DEFLATE; if (isdir || HasZipSuffix(dstzn)) method=STORE;
+
+  // now open whatever was our input source:
+  ZRESULT openres;
+  if (flags==ZIP_FILENAME) openres=open_file((const TCHAR*)src);
+  else if (flags==ZIP_HANDLE) openres=open_handle((HANDLE)src,len);
+  else if (flags==ZIP_MEMORY) openres=open_mem(src,len);
+  else if (flags==ZIP_FOLDER) openres=open_dir();
+  else return ZR_ARGS;
+  if (openres!=ZR_OK) return openres;
+  // stored, when asked for and its size is known up front, see ZipSetCompression
+  if (method==DEFLATE && iseekable && (level==0 || (sniff && !icompressible(dstzn)))) method=STORE;
+
+  // In the parallel mode the item goes to the threads, block by block. Anything
+  // else is written right here, after the blocks that are still in flight.
+  if (par!=0 && password==0 && !isdir) return padd(dstzn,needs_trailing_slash,method,(level<1 ? 1 : level));
+  ZRESULT parres = pwrite(0);
+  if (parres!=ZR_OK) {iclose(); return parres;}
+
+  // A zip "entry" consists of a local header (which includes the file name),
+  // then the compressed data, and possibly an extended local header.
+
+  // Initialize the local header
+  TZipFileInfo zfi;
+  char xloc[EB_L_UT_SIZE], xcen[EB_C_UT_SIZE];
+  initentry(zfi,dstzn,needs_trailing_slash,isdir,method,passex,xloc,xcen);
 
   // (1) Start by writing the local header:
   int r = putlocal(&zfi,swrite,this);
@@ -2828,36 +3326,8 @@ ZRESULT TZip::Add(const TCHAR *odstzn, void *src,unsigned int len, DWORD flags)
   if (oerr!=ZR_OK) return oerr;
   if (writeres!=ZR_OK) return ZR_WRITE;
 
-  // (3) Either rewrite the local header with correct information...
-  bool first_header_has_size_right = (zfi.siz==csize+passex);
-  zfi.crc = crc;
-  zfi.siz = csize+passex;
-  zfi.len = isize;
-  if (ocanseek && (password==0 || isdir))
-  { zfi.how = (ush)method;
-    if ((zfi.flg & 1) == 0) zfi.flg &= ~8; // clear the extended local header flag
-    zfi.lflg = zfi.flg;
-    // rewrite the local header:
-    if (!oseek(zfi.off-ooffset)) return ZR_SEEK;
-    if ((r = putlocal(&zfi, swrite,this)) != ZE_OK) return ZR_WRITE;
-    if (!oseek(writ)) return ZR_SEEK;
-  }
-  else
-  { // (4) ... or put an updated header at the end
-    if (zfi.how != (ush) method) return ZR_NOCHANGE;
-    if (method==STORE && !first_header_has_size_right) return ZR_NOCHANGE;
-    if ((r = putextended(&zfi, swrite,this)) != ZE_OK) return ZR_WRITE;
-    writ += 16L;
-    zfi.flg = zfi.lflg; // if flg modified by inflate, for the central index
-  }
-  if (oerr!=ZR_OK) return oerr;
-
-  // Keep a copy of the zipfileinfo, for our end-of-zip directory
-  char *cextra = new char[zfi.cext]; memcpy(cextra,zfi.cextra,zfi.cext); zfi.cextra=cextra;
-  TZipFileInfo *pzfi = new TZipFileInfo; memcpy(pzfi,&zfi,sizeof(zfi));
-  if (zfis==NULL) zfis=pzfi;
-  else {TZipFileInfo *z=zfis; while (z->nxt!=NULL) z=z->nxt; z->nxt=pzfi;}
-  return ZR_OK;
+  // (3) and (4), the sizes and crc
+  return endentry(zfi,method,passex,isdir,crc,csize,isize);
 }
 
 ZRESULT TZip::AddCentral()
@@ -2949,6 +3419,25 @@ HZIP CreateZipHandle(HANDLE h, const char *password) {return CreateZipInternal(h
 HZIP CreateZip(const TCHAR *fn, const char *password) {return CreateZipInternal((void*)fn,0,ZIP_FILENAME,password);}
 HZIP CreateZip(void *z,unsigned int len, const char *password) {return CreateZipInternal(z,len,ZIP_MEMORY,password);}
 
+ZRESULT ZipSetParallel(HZIP hz, unsigned int threads)
+{ if (hz==0) {lasterrorZ=ZR_ARGS;return ZR_ARGS;}
+  TZipHandleData *han = (TZipHandleData*)hz;
+  if (han->flag!=2) {lasterrorZ=ZR_ZMODE;return ZR_ZMODE;}
+  TZip *zip = han->zip;
+  lasterrorZ = zip->SetParallel(threads);
+  return lasterrorZ;
+}
+
+
+ZRESULT ZipSetCompression(HZIP hz, int level, bool storeIncompressible)
+{ if (hz==0) {lasterrorZ=ZR_ARGS;return ZR_ARGS;}
+  TZipHandleData *han = (TZipHandleData*)hz;
+  if (han->flag!=2) {lasterrorZ=ZR_ZMODE;return ZR_ZMODE;}
+  TZip *zip = han->zip;
+  lasterrorZ = zip->SetCompression(level,storeIncompressible);
+  return lasterrorZ;
+}
+
 
 ZRESULT ZipAddInternal(HZIP hz,const TCHAR *dstzn, void *src,unsigned int len, DWORD flags)
 { if (hz==0) {lasterrorZ=ZR_ARGS;return ZR_ARGS;}
@@ -64,6 +64,32 @@ HZIP CreateZipHandle(HANDLE h, const char *password);
 // can close yours anytime.
 
 
+ZRESULT ZipSetParallel(HZIP hz, unsigned int threads);
+// ZipSetParallel - call this after CreateZip to have the items deflated on
+// several threads: 'threads' of them, 0 for one per processor, 1 to go back
+// to deflating on the calling thread. Each item is read in blocks of 1Mb
+// that are deflated independently of each other and written in order as soon
+// as they are done, so a large item is spread across the threads as well as
+// a run of small ones. No more than 4 blocks per thread are held in memory.
+// The zipfile is a standard one; every block but an item's last ends with an
+// empty stored block, and starts without the previous block as dictionary,
+// which makes the compressed items about 0.3% larger.
+// Encrypted items and folders are still added on the calling thread.
+// Note: ZipAdd may return before the item is written. A write error then
+// comes back from a later ZipAdd, or from CloseZip.
+
+
+ZRESULT ZipSetCompression(HZIP hz, int level, bool storeIncompressible);
+// ZipSetCompression - call this after CreateZip to choose how the items that
+// follow are compressed. 'level' is the deflate level, from 1 (fastest) to 9
+// (smallest); 8 is what is used when this is never called. Level 0 stores the
+// items, except those added from a pipe, which are deflated at level 1.
+// With 'storeIncompressible' an item is stored when it is compressed already:
+// by its name (jpg, png, zip...), its first bytes, or because its first 64k
+// deflated at level 1 save less than 1/16th of them. Items with the zip
+// suffixes (.zip, .gz...) are always stored.
+
+
 ZRESULT ZipAdd(HZIP hz,const TCHAR *dstzn, const TCHAR *fn);
 ZRESULT ZipAdd(HZIP hz,const TCHAR *dstzn, void *src,unsigned int len);
 ZRESULT ZipAddHandle(HZIP hz,const TCHAR *dstzn, HANDLE h);
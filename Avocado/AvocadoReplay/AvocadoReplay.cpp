@@ -0,0 +1,221 @@
+/* --------------------------------*/
+/* Copyright 2010-2013 Assaf Yariv */
+/* --------------------------------*/
+#include "AvocadoAppInterface.h"
+#include "AvocadoAppOptionsInterface.h"
+#include "AvocadoMessageRecorder.h"
+#include <windows.h>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include <algorithm>
+
+using namespace avocado;
+
+/* Plays a session written by the engine option "record_messages_file" (or StartMessageRecording) back into the engine,
+   as fast as possible or with the recorded timing, and prints the time of each entry point.
+   Views are created on hidden windows, the engine needs one for its GL context. */
+
+class ReplayDocInterface : public AvocadoDocInterface
+{
+public:
+	ReplayDocInterface () : m_paramChanges (0), m_errors (0) {}
+	virtual void ViewStateChanged (vector <AvocadoViewStateInterface>, int current ) {}
+	virtual void MaterialStateChanged (vector<AvocadoMaterialStateInterface>) {}
+	virtual void ElementsChanged ( vector <AvocadoElementInterface> ,vector <AvocadoFileLinkInterface>) {}
+	virtual void DocParamChanged (const char *paramName, const char *value) { m_paramChanges++; }
+	virtual void ErrorCallback (const char* errDesc) { m_errors++; std::cout << "doc error : " << errDesc << std::endl; }
+	size_t m_paramChanges;
+	size_t m_errors;
+};
+
+class ReplayViewInterface : public AvocadoViewInterface
+{
+public:
+	ReplayViewInterface () : m_paintRequests (0), m_errors (0) {}
+	virtual void InvokePaintView() { m_paintRequests++; }
+	virtual void SelectionChanged ( std::vector<int> selectedElements ) {}
+	virtual void ViewParamChanged (const char *paramName, const char *value) {}
+	virtual void ErrorCallback (const char *errDesc) { m_errors++; std::cout << "view error : " << errDesc << std::endl; }
+	size_t m_paintRequests;
+	size_t m_errors;
+};
+
+struct ReplayTiming
+{
+	ReplayTiming () : count (0), totalMs (0.0), maxMs (0.0) {}
+	std::string	name;
+	size_t		count;
+	double		totalMs;
+	double		maxMs;
+	bool operator < (const ReplayTiming &other) const { return totalMs > other.totalMs; }
+};
+
+static double TicksToMs (LONGLONG ticks)
+{
+	static double s_msPerTick = 0.0;
+	if (s_msPerTick == 0.0)
+	{
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency (&freq);
+		s_msPerTick = 1000.0 / double (freq.QuadPart);
+	}
+	return double (ticks) * s_msPerTick;
+}
+
+static void PumpMessages ()
+{
+	MSG msg;
+	while (PeekMessage (&msg, NULL, 0, 0, PM_REMOVE))
+	{
+		TranslateMessage (&msg);
+		DispatchMessage (&msg);
+	}
+}
+
+static int MapId (const std::map<int,int> &ids, int id)
+{
+	std::map<int,int>::const_iterator it = ids.find (id);
+	return it != ids.end () ? it->second : id;
+}
+
+int main (int argc, char **argv)
+{
+	std::string recording, session, statsPath;
+	bool realtime = false;
+	for (int i=1;i<argc;i++)
+	{
+		if (strcmp (argv[i], "-realtime") == 0)
+			realtime = true;
+		else if (strcmp (argv[i], "-session") == 0 && i + 1 < argc)
+			session = argv[++i];
+		else if (strcmp (argv[i], "-stats") == 0 && i + 1 < argc)
+			statsPath = argv[++i];
+		else if (recording.empty ())
+			recording = argv[i];
+	}
+	if (recording.empty ())
+	{
+		std::cout << "usage : AvocadoReplay <recording> [-realtime] [-session <folder>] [-stats <file>]" << std::endl;
+		return 1;
+	}
+
+	std::vector<AvocadoRecordedCall> calls;
+	if (!AvocadoMessageRecorder::ReadRecording (recording, calls))
+	{
+		std::cout << "cannot read recording " << recording << std::endl;
+		return 1;
+	}
+	std::cout << calls.size () << " calls in " << recording << std::endl;
+
+	AvocadoInit (false, session);
+	SetEngineOptionBool ("engine_stats", true);
+
+	// recorded doc and view ids to the ones this engine gave.
+	std::map<int,int> docIds, viewIds;
+	std::vector<ReplayDocInterface*> docs;
+	std::vector<ReplayViewInterface*> views;
+	std::vector<HWND> windows;
+	std::map<std::string,ReplayTiming> timings;
+
+	LARGE_INTEGER start, before, after;
+	QueryPerformanceCounter (&start);
+	for (size_t i=0;i<calls.size ();i++)
+	{
+		const AvocadoRecordedCall &call = calls[i];
+		if (realtime)
+		{
+			QueryPerformanceCounter (&before);
+			const double waitMs = call.timeMs - TicksToMs (before.QuadPart - start.QuadPart);
+			if (waitMs >= 1.0)
+				Sleep (DWORD (waitMs));
+		}
+		PumpMessages ();
+
+		QueryPerformanceCounter (&before);
+		switch (call.kind)
+		{
+		case AvocadoRecordedCall::MOUSE_MESSAGE:
+			OnSendAvocadoMouseStringMessage (call.mouseMsg, MapId (viewIds, call.id), call.x, call.y, call.zDelta);
+			break;
+		case AvocadoRecordedCall::VIEW_MESSAGE:
+			OnSendAvocadoGeneralStringMessage (call.msg, MapId (viewIds, call.id), call.paramStr, call.toAllModules);
+			break;
+		case AvocadoRecordedCall::DOC_MESSAGE:
+			OnSendAvocadoDocGeneralStringMessage (call.msg, MapId (docIds, call.id), call.paramStr, call.targetModule);
+			break;
+		case AvocadoRecordedCall::CREATE_DOC:
+			docs.push_back (new ReplayDocInterface ());
+			docIds[call.id] = OnCreateDoc (docs.back ());
+			break;
+		case AvocadoRecordedCall::CREATE_VIEW:
+			{
+				// never shown, the engine only needs its DC.
+				HWND hWnd = CreateWindowExA (0, "STATIC", "AvocadoReplay", WS_OVERLAPPEDWINDOW, 0, 0, 1024, 768, NULL, NULL, GetModuleHandle (NULL), NULL);
+				windows.push_back (hWnd);
+				views.push_back (new ReplayViewInterface ());
+				viewIds[call.id] = OnCreateView ((void*)&hWnd, views.back ());
+			}
+			break;
+		case AvocadoRecordedCall::SIZE_VIEW:
+			OnSizeView (MapId (viewIds, call.id), call.x, call.y);
+			break;
+		case AvocadoRecordedCall::SERIALIZE_DOC:
+			{
+				std::string path = call.paramStr;
+				OnSerializeDoc (MapId (docIds, call.id), path, call.isImport, call.isStoring);
+			}
+			break;
+		case AvocadoRecordedCall::SET_ACTIVE_DOC:
+			SetActiveDoc (MapId (docIds, call.id));
+			break;
+		}
+		QueryPerformanceCounter (&after);
+
+		const double ms = TicksToMs (after.QuadPart - before.QuadPart);
+		ReplayTiming &timing = timings[call.GetName ()];
+		timing.name = call.GetName ();
+		timing.count++;
+		timing.totalMs += ms;
+		if (ms > timing.maxMs)
+			timing.maxMs = ms;
+	}
+	QueryPerformanceCounter (&after);
+	const double totalMs = TicksToMs (after.QuadPart - start.QuadPart);
+
+	std::vector<ReplayTiming> rows;
+	for (std::map<std::string,ReplayTiming>::const_iterator it = timings.begin ();it != timings.end ();++it)
+		rows.push_back (it->second);
+	std::sort (rows.begin (), rows.end ());
+	std::cout << std::left << std::setw (48) << "call" << std::right << std::setw (10) << "calls" << std::setw (14) << "total"
+		<< std::setw (12) << "average" << std::setw (12) << "max" << std::endl;
+	for (size_t i=0;i<rows.size ();i++)
+	{
+		std::cout << std::left << std::setw (48) << rows[i].name << std::right
+			<< std::setw (10) << rows[i].count
+			<< std::setw (14) << std::fixed << std::setprecision (3) << rows[i].totalMs
+			<< std::setw (12) << rows[i].totalMs / rows[i].count
+			<< std::setw (12) << rows[i].maxMs << std::endl;
+	}
+	std::cout << "replayed in " << totalMs << " ms (recorded " << (calls.empty () ? 0.0 : calls.back ().timeMs) << " ms)" << std::endl;
+
+	size_t errors = 0;
+	for (size_t i=0;i<docs.size ();i++)
+		errors += docs[i]->m_errors;
+	for (size_t i=0;i<views.size ();i++)
+		errors += views[i]->m_errors;
+
+	if (!statsPath.empty () && !docIds.empty ())
+		OnSendAvocadoDocGeneralStringMessage ("DumpEngineStats", docIds.begin ()->second, statsPath);
+
+	AvocadoTerminate ();
+	for (size_t i=0;i<windows.size ();i++)
+		DestroyWindow (windows[i]);
+	for (size_t i=0;i<docs.size ();i++)
+		delete docs[i];
+	for (size_t i=0;i<views.size ();i++)
+		delete views[i];
+	return errors > 0 ? 2 : 0;
+}
@@ -36,6 +36,7 @@
 #include "nvutil/Singleton.h"
 #include "nvutil/SWMRSync.h"
 #include "nvutil/Trace.h"
+#include "nvutil/SmallObjectPool.h"
 
 #if !defined(NDEBUG)
 #if _WIN32_IE != _WIN32_IE_WIN8
@@ -45,92 +46,17 @@
 
 namespace nvutil
 {
-  //! Chunk of memory for our low level memory managment of fixed size objects
-  class Chunk
-  {
-    public:
-      //! construct a chunk of blockSize bytes
-      Chunk(size_t blockSize); 
-      
-      //! provide comparison of chunks
-      bool operator==(const Chunk& rhs) const;
-      bool operator!=(const Chunk& rhs) const;
-      
-      //! memory management interface
-      void * alloc();
-      void dealloc(void * p);
-      //! explicitely free memory
-      void freeMemory(); 
-      
-      //! provide number of blocks available in this chunk
-      unsigned char blocksAvailable() const;
-      //! for cleanup purposes, provide check if chunk is entirely unused
-      bool isUnused() const; 
-      //! provide address checking
-      bool isInsideBounds(void * p) const;
-
-      //! helpers used with address checking
-      void * lowerBound() const;
-      void * upperBound() const;
-
-    private:
-      //! maximum number of blocks we can address
-      enum { numBlocks = 255 };
-
-      //! one time initialization
-      void init();
-      
-      unsigned char * m_rawMem; // raw memory
-
-      //! bounds
-      size_t m_blockSize;
-      size_t m_chunkSize;
-
-      unsigned char m_firstAvailableBlock;  // addresses first memory block available
-      unsigned char m_blocksAvailable;      // total amount of blocks available 
-  };
-
-  //! Manages allocation requests for objects of a certain size only
-  class FixedAllocator
-  {
-    public:
-      //! default constructs a FixedAllocator object
-      NVSG_API FixedAllocator(); 
-
-      //! destructor - last chunk memory cleanup
-      NVSG_API ~FixedAllocator();
-
-      //! Allocate one memory block of size blockSize
-      NVSG_API void * alloc();
-
-      //! Free the single memory block pointed to by \a p
-      NVSG_API void dealloc(void * p);
-
-      //! one time initialization
-      NVSG_API void init ( size_t blockSize );
-
-    private:
-      size_t m_blockSize;   // fixed block size
-
-      typedef std::map<void*,Chunk*> Chunks;
-      Chunks m_chunks; // array of chunks
-
-      Chunk  * m_lastAlloc;   // last chunk taken for allocation
-      Chunk  * m_lastDealloc; // last chunk taken for deallocation
-      std::set<Chunk*>  m_availableChunks;  // set of chunks with free blocks
-  };
-
 //<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
   //! Internal manager for memory allocations.
   /** This class is used as a \c Singleton by \c IAllocator, which is the base of all \c RCObject classes.
-    * It manages the efficient allocation of small objects by using an array of \c FixedAllocator objects, one for
-    * each small size up to \c maxBlockSize. Allocations larger than that size are redirected to the standard
-    * allocation \c ::new.  */
+    * It manages the efficient allocation of small objects by a \c SmallObjectPool, one \c FixedAllocator for each
+    * multiple of \c SmallObjectPool::blockGranularity up to \c SmallObjectPool::maxBlockSize behind a cache per
+    * thread, so threads creating and destroying objects do not wait on each other. Allocations larger than that
+    * size are redirected to the standard allocation \c ::new.  */
   class Allocator
   {
     public:
       //! Default constructor
-      /** Initializes the array of \c FixedAllocator objects. */
       NVSG_API Allocator();
 
       //! Destructor
@@ -168,6 +94,10 @@ namespace nvutil
                   , size_t size   //!<  size of the allocated memory
                   );
 
+      //! Give the blocks cached by the calling thread back to the shared pools
+      /** Done when the thread ends, a thread that goes idle for long can call it earlier. */
+      void flushThreadCache();
+
     private:
       //! Helper allocation routine used with debug and non-debug mode
       void * palloc(size_t size);
@@ -175,12 +105,12 @@ namespace nvutil
     private:
       // forward to default new/delete operators if block size
       // exceeds the threshold given by maxBlockSize
-      enum { maxBlockSize = 1024 };
+      enum { maxBlockSize = SmallObjectPool::maxBlockSize };
 
-      // provide one allocator for each single size <= maxBlockSize
-      FixedAllocator m_allocTbl[maxBlockSize];
+      // synchronizes its threads itself
+      SmallObjectPool m_smallObjects;
 
-      SWMRSync m_lock; // for synchronizing concurrent access
+      SWMRSync m_lock; // for synchronizing access to the debug and counter data
 
       // leak detection in debug mode
 #if !defined(NDEBUG)
@@ -253,7 +183,6 @@ namespace nvutil
 
   inline void * Allocator::alloc(size_t size)
   {
-    AutoLock lock(m_lock);
     void *p = palloc(size);
 
 #if !defined(NDEBUG)
@@ -265,6 +194,7 @@ namespace nvutil
       allocInfo.p = p;
       allocInfo.size = size;
       allocInfo.location = !trace.empty() ? trace[0] : "unknown location";
+      AutoLock lock(m_lock);
       m_dbgAllocInfos.push_back(allocInfo);
 #endif
     }
@@ -288,7 +218,6 @@ namespace nvutil
 #if !defined(NDEBUG)
   inline void * Allocator::alloc(size_t size, const char* src, unsigned int ln)
   {
-    AutoLock lock(m_lock);
     void * p = palloc(size);
 
     // optionally collect allocation info for memory leak detection
@@ -300,6 +229,7 @@ namespace nvutil
       allocInfo.p = p;
       allocInfo.size = size;
       allocInfo.location = location.str();
+      AutoLock lock(m_lock);
       m_dbgAllocInfos.push_back(allocInfo);
     }
     return p;
@@ -308,16 +238,16 @@ namespace nvutil
 
   inline void Allocator::dealloc(void *p, size_t size)
   {
-    AutoLock lock(m_lock);
 #if !defined(NDEBUG)
     if( nvsg::nvsgGetDebugFlags() & nvsg::NVSG_DBG_LEAK_DETECTION )
     {
+      AutoLock lock(m_lock);
       m_dbgAllocInfos.erase(std::remove(m_dbgAllocInfos.begin(), m_dbgAllocInfos.end(), p), m_dbgAllocInfos.end());
     }
 #endif
     if ( size <= maxBlockSize )
     {
-      m_allocTbl[size-1].dealloc(p); 
+      m_smallObjects.dealloc(p, size);
     } 
     else
     {
@@ -325,21 +255,29 @@ namespace nvutil
     }
   }
 
+  inline void Allocator::flushThreadCache()
+  {
+    m_smallObjects.flushThreadCache();
+  }
+
   inline void * Allocator::palloc(size_t size)
   {
 #if defined( ALLOCATION_COUNTER )
-    m_allocSizeMap[size]++;
+    {
+      AutoLock lock(m_lock);
+      m_allocSizeMap[size]++;
+    }
 #endif
     // use suitable allocation for given size
-    return (size<=maxBlockSize) ? m_allocTbl[size-1].alloc() : ::operator new(size);
+    return (size<=maxBlockSize) ? m_smallObjects.alloc(size) : ::operator new(size);
   }
 //>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
   //! An allocator interface
   /** The \c IAllocator interface provides overloads of the \c new and \c delete operators for heap allocation.
     * This overloads make use of a specialized memory manager, that is highly optimized for small object allocation.
-    * For large objects, i.e. objects greater than 128 bytes, the \c IAllocator interface utilizes the default
-    * memory manager.
+    * For large objects, i.e. objects greater than \c Allocator::maxBlockSize (1024) bytes, the \c IAllocator
+    * interface utilizes the default memory manager.
     * \note Typically a user defined class utilizes this interface through public inheritance.
     */
   Allocator Singleton<Allocator>::m_instance;
@@ -392,168 +330,6 @@ namespace nvutil
   // implementation following
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
-  /**
-  * Chunk::init() 
-  *
-  * provides one time initialization
-  */
-  inline void Chunk::init()
-  {
-    m_rawMem = ::new unsigned char[m_chunkSize];
-    
-    m_firstAvailableBlock = 0;
-    m_blocksAvailable = numBlocks;
-
-    unsigned char * p = m_rawMem;
-    for ( unsigned char i=0; i!=numBlocks; p+=m_blockSize ) 
-    {
-      // code indices of next available blocks in first byte of each block 
-      *p = ++i;
-    }
-  }
-
-  /**
-  * Chunk::freeMemory() 
-  *
-  * explicitely free chunk's raw memory
-  */
-  inline void Chunk::freeMemory()
-  {
-    // should not attempt to free memory of a chunk in use
-    NVSG_ASSERT(isUnused());
-    ::delete[] m_rawMem;
-  }
-
-  /**
-  * Chunk::alloc() 
-  *
-  * get one block from chunk; returns NULL if no blocks available
-  */
-  inline void * Chunk::alloc()
-  {
-    if ( !m_blocksAvailable ) 
-    {
-      // this needs to be handled in superior layers
-      return NULL;
-    }
-
-    unsigned char * p = &m_rawMem[m_firstAvailableBlock*m_blockSize];
-    // index of next block available is coded in first byte
-    m_firstAvailableBlock = *p; 
-    // one block less available in this chunk
-    --m_blocksAvailable; 
-
-    return (void *)p;
-  }
-
-  /**
-  * Chunk::dealloc()
-  *
-  * deallocate a block pointed to by p
-  */
-  inline void Chunk::dealloc(void * p)
-  {
-    unsigned char * ptr = (unsigned char*)p;
-    
-    // range check
-    NVSG_ASSERT(ptr>=m_rawMem);
-    NVSG_ASSERT(ptr<&m_rawMem[m_chunkSize]);
-    // alignment check
-    NVSG_ASSERT(!((ptr-m_rawMem)%m_blockSize));
-    
-    *ptr = m_firstAvailableBlock;
-    m_firstAvailableBlock = (unsigned char)((ptr - m_rawMem) / m_blockSize);
-
-    // truncation check
-    NVSG_ASSERT(m_firstAvailableBlock==((ptr-m_rawMem)/m_blockSize));
-    ++m_blocksAvailable;
-  }
-
-  /**
-  * Chunk::operator==()
-  *
-  * returns true if rhs equals this chunk
-  */
-  inline bool Chunk::operator==(const Chunk& rhs) const
-  {
-    // consider chunks to be equal if they point to same raw memory location
-    NVSG_ASSERT(    ( m_rawMem != rhs.m_rawMem )
-                ||  (     ( m_blockSize           == rhs.m_blockSize )
-                      &&  ( m_firstAvailableBlock == rhs.m_firstAvailableBlock )
-                      &&  ( m_blocksAvailable     == rhs.m_blocksAvailable ) ) );
-    return (  m_rawMem==rhs.m_rawMem );
-  }
-
-  /**
-  * Chunk::operator!=()
-  *
-  * returns true if rhs not equals this chunk
-  */
-  inline bool Chunk::operator!=(const Chunk& rhs) const
-  {
-    return !operator==(rhs);
-  }
-
-  /** 
-  * Chunk::blocksAvailable()
-  * 
-  * provides number of blocks available in this chunk 
-  */
-  inline unsigned char Chunk::blocksAvailable() const 
-  { 
-    return m_blocksAvailable; 
-  }
-
-  /**
-  * Chunk::isInsideBounds() 
-  *
-  * returns true if the address given belongs to this chunk; false otherwise  
-  */
-  inline bool Chunk::isInsideBounds(void * p) const
-  {
-    return p>=lowerBound() && p<upperBound();
-  }
-
-  /** 
-  * Chunk::isUnused()
-  * 
-  * for cleanup purposes, provide check if chunk is entirely unused 
-  */
-  inline bool Chunk::isUnused() const 
-  { 
-    return m_blocksAvailable==numBlocks; 
-  }
-
-  /** 
-  * Chunk::lowerBound()
-  * 
-  * query lower bound of memory chunk 
-  */
-  inline void * Chunk::lowerBound() const 
-  { 
-    return (void*)m_rawMem; 
-  }
-
-  /** 
-  * Chunk::upperBound()
-  * 
-  * query upper bound of memory chunk 
-  */
-  inline void * Chunk::upperBound() const 
-  { 
-    return (void*)&m_rawMem[m_chunkSize]; 
-  }
-
-  /**
-  * FixedAllocator::init()
-  *
-  * one time initialization
-  */
-  inline void FixedAllocator::init(size_t blockSize)
-  { 
-    m_blockSize = blockSize; 
-  }
-
   /**
   * IAllocator::operator new()
   *
@@ -0,0 +1,285 @@
+#pragma once
+/** \file */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#if defined( _WIN32 )
+#include <malloc.h>
+#endif
+
+namespace nvutil
+{
+  //! Manages allocation requests for objects of a certain size only
+  /** Blocks are carved from chunks of \c chunkSize bytes, aligned to their size, so the chunk of any block is
+    * found by masking its address. A chunk header at the start of the chunk keeps an intrusive list of the freed
+    * blocks and a pointer to the blocks never handed out yet. Chunks with free blocks are linked into a list, the
+    * first of them serves the next alloc. alloc and dealloc are O(1).
+    *
+    * A chunk that gets empty is kept as the spare one, a second empty chunk is returned to the system. Alternating
+    * alloc and dealloc around a chunk boundary does not allocate and free a chunk each time.
+    *
+    * Chunks still in use when the FixedAllocator is destroyed are left alone, objects of static storage might
+    * still live in them.
+    *
+    * Not thread safe, \c Allocator synchronizes the calls. Depends on the standard library only. */
+  class FixedAllocator
+  {
+    public:
+      enum { chunkSize = 64 * 1024 };   // bytes of a chunk, a power of two
+
+      //! default constructs a FixedAllocator object
+      FixedAllocator();
+
+      //! destructor - frees the chunks no block is used from
+      ~FixedAllocator();
+
+      //! Allocate one memory block of size blockSize
+      void * alloc();
+
+      //! Free the single memory block pointed to by \a p
+      /** \a p can be any block allocated by this FixedAllocator and not yet freed. */
+      void dealloc(void * p);
+
+      //! one time initialization
+      /** Must be called before the first alloc. The block size is rounded up to a multiple of a pointer size. */
+      void init( size_t blockSize );
+
+      //! block size after rounding
+      size_t getBlockSize() const;
+
+      //! number of chunks currently allocated from the system, the spare one included
+      size_t getChunkCount() const;
+
+    private:
+      struct ChunkHeader
+      {
+        FixedAllocator  * owner;      // for checks only
+        ChunkHeader     * prev;       // in the list of chunks with free blocks
+        ChunkHeader     * next;
+        void            * freeList;   // freed blocks, each holds the address of the next one
+        unsigned char   * unused;     // first block never handed out
+        size_t            used;       // blocks handed out
+      };
+
+      // the first block starts past the header, aligned for any type
+      enum { headerSize = (sizeof(ChunkHeader) + 15) & ~15 };
+
+      static ChunkHeader * chunkOf( void * p );
+      ChunkHeader * newChunk();
+      void freeChunk( ChunkHeader * chunk );
+      void link( ChunkHeader * chunk );
+      void unlink( ChunkHeader * chunk );
+
+      // not permitted
+      FixedAllocator( const FixedAllocator & );
+      FixedAllocator & operator=( const FixedAllocator & );
+
+    private:
+      size_t          m_blockSize;      // fixed block size
+      size_t          m_blocksPerChunk;
+      ChunkHeader   * m_available;      // chunks with free blocks, the spare one excluded
+      ChunkHeader   * m_spare;          // the empty chunk kept back
+      size_t          m_chunkCount;
+  };
+
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+  // implementation following
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+  inline FixedAllocator::FixedAllocator()
+    : m_blockSize(0)
+    , m_blocksPerChunk(0)
+    , m_available(NULL)
+    , m_spare(NULL)
+    , m_chunkCount(0)
+  {
+  }
+
+  inline FixedAllocator::~FixedAllocator()
+  {
+    if ( m_spare )
+    {
+      freeChunk( m_spare );
+    }
+    for ( ChunkHeader * chunk = m_available; chunk; )
+    {
+      ChunkHeader * next = chunk->next;
+      if ( chunk->used == 0 )
+      {
+        freeChunk( chunk );
+      }
+      chunk = next;
+    }
+  }
+
+  /**
+  * FixedAllocator::init()
+  *
+  * one time initialization
+  */
+  inline void FixedAllocator::init( size_t blockSize )
+  {
+    assert( !m_chunkCount && blockSize && blockSize <= chunkSize / 2 );
+    m_blockSize = ( blockSize + sizeof(void *) - 1 ) & ~( sizeof(void *) - 1 );
+    m_blocksPerChunk = ( chunkSize - headerSize ) / m_blockSize;
+  }
+
+  inline size_t FixedAllocator::getBlockSize() const
+  {
+    return m_blockSize;
+  }
+
+  inline size_t FixedAllocator::getChunkCount() const
+  {
+    return m_chunkCount;
+  }
+
+  inline FixedAllocator::ChunkHeader * FixedAllocator::chunkOf( void * p )
+  {
+    return reinterpret_cast<ChunkHeader *>( reinterpret_cast<size_t>(p) & ~size_t(chunkSize - 1) );
+  }
+
+  inline FixedAllocator::ChunkHeader * FixedAllocator::newChunk()
+  {
+#if defined( _WIN32 )
+    void * mem = _aligned_malloc( chunkSize, chunkSize );
+#else
+    void * mem = NULL;
+    if ( posix_memalign( &mem, chunkSize, chunkSize ) != 0 )
+    {
+      mem = NULL;
+    }
+#endif
+    if ( !mem )
+    {
+      return NULL;
+    }
+    ChunkHeader * chunk = static_cast<ChunkHeader *>(mem);
+    chunk->owner = this;
+    chunk->prev = NULL;
+    chunk->next = NULL;
+    chunk->freeList = NULL;
+    chunk->unused = static_cast<unsigned char *>(mem) + headerSize;
+    chunk->used = 0;
+    ++m_chunkCount;
+    return chunk;
+  }
+
+  inline void FixedAllocator::freeChunk( ChunkHeader * chunk )
+  {
+    assert( chunk->used == 0 );
+    --m_chunkCount;
+#if defined( _WIN32 )
+    _aligned_free( chunk );
+#else
+    free( chunk );
+#endif
+  }
+
+  inline void FixedAllocator::link( ChunkHeader * chunk )
+  {
+    chunk->prev = NULL;
+    chunk->next = m_available;
+    if ( m_available )
+    {
+      m_available->prev = chunk;
+    }
+    m_available = chunk;
+  }
+
+  inline void FixedAllocator::unlink( ChunkHeader * chunk )
+  {
+    if ( chunk->prev )
+    {
+      chunk->prev->next = chunk->next;
+    }
+    else
+    {
+      m_available = chunk->next;
+    }
+    if ( chunk->next )
+    {
+      chunk->next->prev = chunk->prev;
+    }
+    chunk->prev = chunk->next = NULL;
+  }
+
+  /**
+  * FixedAllocator::alloc()
+  *
+  * get one block; returns NULL if the system has no memory left
+  */
+  inline void * FixedAllocator::alloc()
+  {
+    assert( m_blockSize );
+    ChunkHeader * chunk = m_available;
+    if ( !chunk )
+    {
+      chunk = m_spare ? m_spare : newChunk();
+      if ( !chunk )
+      {
+        return NULL;
+      }
+      m_spare = NULL;
+      link( chunk );
+    }
+
+    void * p;
+    if ( chunk->freeList )
+    {
+      p = chunk->freeList;
+      chunk->freeList = *static_cast<void **>(p);
+    }
+    else
+    {
+      p = chunk->unused;
+      chunk->unused += m_blockSize;
+    }
+    if ( ++chunk->used == m_blocksPerChunk )
+    {
+      // full, the next alloc takes another chunk
+      unlink( chunk );
+    }
+    return p;
+  }
+
+  /**
+  * FixedAllocator::dealloc()
+  *
+  * deallocate a block pointed to by p
+  */
+  inline void FixedAllocator::dealloc( void * p )
+  {
+    if ( !p )
+    {
+      return;
+    }
+    ChunkHeader * chunk = chunkOf( p );
+    // range, alignment and ownership check
+    assert( chunk->owner == this );
+    assert( static_cast<unsigned char *>(p) >= reinterpret_cast<unsigned char *>(chunk) + headerSize );
+    assert( ( static_cast<unsigned char *>(p) - reinterpret_cast<unsigned char *>(chunk) - headerSize ) % m_blockSize == 0 );
+    assert( static_cast<unsigned char *>(p) < chunk->unused );
+
+    if ( chunk->used == m_blocksPerChunk )
+    {
+      link( chunk );
+    }
+    *static_cast<void **>(p) = chunk->freeList;
+    chunk->freeList = p;
+    if ( --chunk->used == 0 )
+    {
+      unlink( chunk );
+      if ( m_spare )
+      {
+        freeChunk( chunk );
+      }
+      else
+      {
+        m_spare = chunk;
+      }
+    }
+  }
+
+} // namespace nvutil
@@ -0,0 +1,368 @@
+#pragma once
+/** \file */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include "nvsg/nvsgapi.h"
+#include "nvutil/FixedAllocator.h"
+
+namespace nvutil
+{
+  //! Small object allocation from many threads
+  /** One \c FixedAllocator for each multiple of \c blockGranularity up to \c maxBlockSize, shared by all threads
+    * under one lock, and in front of them a cache per thread : for each size a magazine, a list of free blocks only
+    * its thread takes from and gives back to. alloc and dealloc from the magazine take no lock.
+    *
+    * An empty magazine is refilled with half its capacity under the lock, a full one gives half of it back, so a
+    * thread takes the lock about once every capacity / 2 calls. Blocks freed by another thread than the one that
+    * allocated them go back to the shared pool with the magazine of the freeing thread.
+    *
+    * The cache of a thread is given back when the thread ends, or on \c flushThreadCache. The lock and the thread
+    * local storage are in Allocator.cpp, this header pulls in no system header. */
+  class SmallObjectPool
+  {
+    public:
+      enum { maxBlockSize = 1024, blockGranularity = 8, classCount = maxBlockSize / blockGranularity };
+
+      //! default constructs a SmallObjectPool object
+      SmallObjectPool();
+
+      //! destructor - gives back the caches of the threads still running
+      /** No other thread may allocate from or free to the pool any more, nor be ending : the caches of the threads
+        * that did not end yet are released here, from under them. */
+      ~SmallObjectPool();
+
+      //! Allocate one memory block of \a size bytes, 0 < \a size <= \c maxBlockSize
+      /** Returns NULL if the system has no memory left. */
+      void * alloc( size_t size );
+
+      //! Free the block pointed to by \a p, allocated with the same \a size
+      void dealloc( void * p, size_t size );
+
+      //! Give the blocks cached by the calling thread back to the shared pools
+      void flushThreadCache();
+
+      //! number of chunks held by the shared pools
+      size_t getChunkCount() const;
+
+    private:
+      struct Magazine
+      {
+        void          * head;       // free blocks, each holds the address of the next one
+        unsigned int    count;
+      };
+
+      struct ThreadCache
+      {
+        SmallObjectPool * owner;
+        ThreadCache     * prev;     // in the list of all caches
+        ThreadCache     * next;
+        Magazine          magazines[classCount];
+      };
+
+      static unsigned int capacityOf( size_t cls );
+      ThreadCache * threadCache();
+      ThreadCache * newThreadCache();
+      void releaseThreadCache( ThreadCache * cache );
+      void * refill( Magazine & magazine, size_t cls );
+      void flush( Magazine & magazine, size_t cls, unsigned int keep );
+
+      // the system part, in Allocator.cpp
+      NVSG_API void createSystemObjects();    // the lock and the thread local slot, sets m_cached
+      NVSG_API void freeCacheSlot();
+      NVSG_API void destroySystemObjects();
+      NVSG_API void lock() const;
+      NVSG_API void unlock() const;
+      NVSG_API ThreadCache * getThreadCache() const;
+      NVSG_API bool setThreadCache( ThreadCache * cache );
+
+      // called by the system when a thread with a cache ends
+#if defined( _WIN32 )
+      static void __stdcall threadEnded( void * cache );
+#else
+      static void threadEnded( void * cache );
+#endif
+
+      // not permitted
+      SmallObjectPool( const SmallObjectPool & );
+      SmallObjectPool & operator=( const SmallObjectPool & );
+
+    private:
+      FixedAllocator    m_pools[classCount];  // by ( size - 1 ) / blockGranularity
+      ThreadCache     * m_caches;             // of all threads, under the lock
+      bool              m_cached;             // false if the system had no thread local storage left
+      void            * m_lock;               // the system lock
+      unsigned long     m_cacheSlot;          // the system thread local slot, it calls back when the thread ends
+  };
+
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+  // implementation following
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+  inline SmallObjectPool::SmallObjectPool()
+    : m_caches(NULL)
+    , m_cached(false)
+    , m_lock(NULL)
+    , m_cacheSlot(0)
+  {
+    for ( size_t i=0 ; i<classCount ; i++ )
+    {
+      m_pools[i].init( ( i + 1 ) * blockGranularity );
+    }
+    createSystemObjects();
+  }
+
+  /**
+  * SmallObjectPool::~SmallObjectPool()
+  *
+  * freeCacheSlot frees the thread local slot. FlsFree calls threadEnded on the calling thread for every thread
+  * whose slot still holds a cache, those of threads still running included, and releases them. pthread_key_delete
+  * calls nothing, the loop releases them instead. Either way a live thread's cache is released by another thread
+  * while its slot is gone, and the thread is not called back when it ends : that is safe only when no other
+  * thread uses the pool any more, nor is ending at the same time, which is what the destructor requires.
+  */
+  inline SmallObjectPool::~SmallObjectPool()
+  {
+    freeCacheSlot();
+    while ( m_caches )
+    {
+      releaseThreadCache( m_caches );
+    }
+    destroySystemObjects();
+  }
+
+  /**
+  * SmallObjectPool::capacityOf()
+  *
+  * blocks a magazine holds : about 4 KB of them, no less than 4 and no more than 64
+  */
+  inline unsigned int SmallObjectPool::capacityOf( size_t cls )
+  {
+    const size_t capacity = 4096 / ( ( cls + 1 ) * blockGranularity );
+    return capacity < 4 ? 4 : capacity > 64 ? 64 : static_cast<unsigned int>(capacity);
+  }
+
+  inline SmallObjectPool::ThreadCache * SmallObjectPool::threadCache()
+  {
+    if ( !m_cached )
+    {
+      return NULL;
+    }
+    ThreadCache * cache = getThreadCache();
+    return cache ? cache : newThreadCache();
+  }
+
+  inline SmallObjectPool::ThreadCache * SmallObjectPool::newThreadCache()
+  {
+    // not from the pool, the cache is freed when the thread ends
+    ThreadCache * cache = static_cast<ThreadCache *>( calloc( 1, sizeof(ThreadCache) ) );
+    if ( !cache )
+    {
+      return NULL;
+    }
+    if ( !setThreadCache( cache ) )
+    {
+      free( cache );
+      return NULL;
+    }
+    cache->owner = this;
+    lock();
+    cache->next = m_caches;
+    if ( m_caches )
+    {
+      m_caches->prev = cache;
+    }
+    m_caches = cache;
+    unlock();
+    return cache;
+  }
+
+  inline void SmallObjectPool::releaseThreadCache( ThreadCache * cache )
+  {
+    for ( size_t i=0 ; i<classCount ; i++ )
+    {
+      flush( cache->magazines[i], i, 0 );
+    }
+    lock();
+    if ( cache->prev )
+    {
+      cache->prev->next = cache->next;
+    }
+    else
+    {
+      m_caches = cache->next;
+    }
+    if ( cache->next )
+    {
+      cache->next->prev = cache->prev;
+    }
+    unlock();
+    free( cache );
+  }
+
+#if defined( _WIN32 )
+  inline void __stdcall SmallObjectPool::threadEnded( void * cache )
+#else
+  inline void SmallObjectPool::threadEnded( void * cache )
+#endif
+  {
+    if ( cache )
+    {
+      ThreadCache * threadCache = static_cast<ThreadCache *>(cache);
+      threadCache->owner->releaseThreadCache( threadCache );
+    }
+  }
+
+  /**
+  * SmallObjectPool::refill()
+  *
+  * takes half a magazine from the shared pool, returns one more block for the caller
+  */
+  inline void * SmallObjectPool::refill( Magazine & magazine, size_t cls )
+  {
+    assert( !magazine.head );
+    const unsigned int batch = capacityOf( cls ) / 2;
+    lock();
+    void * p = m_pools[cls].alloc();
+    for ( unsigned int i=0 ; p && i<batch ; i++ )
+    {
+      void * block = m_pools[cls].alloc();
+      if ( !block )
+      {
+        break;
+      }
+      *static_cast<void **>(block) = magazine.head;
+      magazine.head = block;
+      ++magazine.count;
+    }
+    unlock();
+    return p;
+  }
+
+  /**
+  * SmallObjectPool::flush()
+  *
+  * gives the blocks past the first keep ones back to the shared pool, the ones freed last stay
+  */
+  inline void SmallObjectPool::flush( Magazine & magazine, size_t cls, unsigned int keep )
+  {
+    if ( magazine.count <= keep )
+    {
+      return;
+    }
+    void * tail = magazine.head;
+    if ( keep )
+    {
+      void * last = magazine.head;
+      for ( unsigned int i=1 ; i<keep ; i++ )
+      {
+        last = *static_cast<void **>(last);
+      }
+      tail = *static_cast<void **>(last);
+      *static_cast<void **>(last) = NULL;
+    }
+    else
+    {
+      magazine.head = NULL;
+    }
+    magazine.count = keep;
+    lock();
+    while ( tail )
+    {
+      void * next = *static_cast<void **>(tail);
+      m_pools[cls].dealloc( tail );
+      tail = next;
+    }
+    unlock();
+  }
+
+  /**
+  * SmallObjectPool::alloc()
+  *
+  * from the magazine of the calling thread, without a lock unless it is empty
+  */
+  inline void * SmallObjectPool::alloc( size_t size )
+  {
+    assert( 0 < size && size <= maxBlockSize );
+    const size_t cls = ( size - 1 ) / blockGranularity;
+    ThreadCache * cache = threadCache();
+    if ( !cache )
+    {
+      lock();
+      void * p = m_pools[cls].alloc();
+      unlock();
+      return p;
+    }
+    Magazine & magazine = cache->magazines[cls];
+    if ( !magazine.head )
+    {
+      return refill( magazine, cls );
+    }
+    void * p = magazine.head;
+    magazine.head = *static_cast<void **>(p);
+    --magazine.count;
+    return p;
+  }
+
+  /**
+  * SmallObjectPool::dealloc()
+  *
+  * into the magazine of the calling thread, a full one gives half of its blocks back first
+  */
+  inline void SmallObjectPool::dealloc( void * p, size_t size )
+  {
+    if ( !p )
+    {
+      return;
+    }
+    assert( 0 < size && size <= maxBlockSize );
+    const size_t cls = ( size - 1 ) / blockGranularity;
+    ThreadCache * cache = threadCache();
+    if ( !cache )
+    {
+      lock();
+      m_pools[cls].dealloc( p );
+      unlock();
+      return;
+    }
+    Magazine & magazine = cache->magazines[cls];
+    const unsigned int capacity = capacityOf( cls );
+    if ( magazine.count == capacity )
+    {
+      flush( magazine, cls, capacity / 2 );
+    }
+    *static_cast<void **>(p) = magazine.head;
+    magazine.head = p;
+    ++magazine.count;
+  }
+
+  inline void SmallObjectPool::flushThreadCache()
+  {
+    if ( !m_cached )
+    {
+      return;
+    }
+    ThreadCache * cache = getThreadCache();
+    if ( cache )
+    {
+      for ( size_t i=0 ; i<classCount ; i++ )
+      {
+        flush( cache->magazines[i], i, 0 );
+      }
+    }
+  }
+
+  inline size_t SmallObjectPool::getChunkCount() const
+  {
+    size_t count = 0;
+    lock();
+    for ( size_t i=0 ; i<classCount ; i++ )
+    {
+      count += m_pools[i].getChunkCount();
+    }
+    unlock();
+    return count;
+  }
+
+} // namespace nvutil
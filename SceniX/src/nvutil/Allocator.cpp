@@ -7,4 +7,92 @@ namespace nvutil {
 	}
 	Allocator::~Allocator () {}
 
-}
\ No newline at end of file
+	/* The system part of SmallObjectPool, so that Allocator.h pulls in no system header. The thread local slot
+	   calls threadEnded when a thread with a cache ends : fiber local storage on Windows, a pthread key elsewhere. */
+	void SmallObjectPool::createSystemObjects ()
+	{
+#if defined(_WIN32)
+		CRITICAL_SECTION *cs = new CRITICAL_SECTION;
+		InitializeCriticalSection (cs);
+		m_lock = cs;
+		const DWORD slot = FlsAlloc (threadEnded);
+		m_cached = slot != FLS_OUT_OF_INDEXES;
+		m_cacheSlot = slot;
+#else
+		pthread_mutexattr_t attr;
+		pthread_mutexattr_init (&attr);
+		pthread_mutexattr_settype (&attr,PTHREAD_MUTEX_RECURSIVE);
+		pthread_mutex_t *mutex = new pthread_mutex_t;
+		pthread_mutex_init (mutex,&attr);
+		pthread_mutexattr_destroy (&attr);
+		m_lock = mutex;
+		pthread_key_t key;
+		m_cached = pthread_key_create (&key,threadEnded) == 0;
+		m_cacheSlot = m_cached ? (unsigned long)key : 0;
+#endif
+	}
+
+	void SmallObjectPool::freeCacheSlot ()
+	{
+		// FlsFree calls threadEnded, on this thread, for the cache of every thread that still has one in the slot.
+		// pthread_key_delete calls nothing, the caller releases the caches left.
+#if defined(_WIN32)
+		if (m_cached)
+			FlsFree ((DWORD)m_cacheSlot);
+#else
+		if (m_cached)
+			pthread_key_delete ((pthread_key_t)m_cacheSlot);
+#endif
+		m_cached = false;
+	}
+
+	void SmallObjectPool::destroySystemObjects ()
+	{
+#if defined(_WIN32)
+		DeleteCriticalSection ((CRITICAL_SECTION*)m_lock);
+		delete (CRITICAL_SECTION*)m_lock;
+#else
+		pthread_mutex_destroy ((pthread_mutex_t*)m_lock);
+		delete (pthread_mutex_t*)m_lock;
+#endif
+		m_lock = NULL;
+	}
+
+	void SmallObjectPool::lock () const
+	{
+#if defined(_WIN32)
+		EnterCriticalSection ((CRITICAL_SECTION*)m_lock);
+#else
+		pthread_mutex_lock ((pthread_mutex_t*)m_lock);
+#endif
+	}
+
+	void SmallObjectPool::unlock () const
+	{
+#if defined(_WIN32)
+		LeaveCriticalSection ((CRITICAL_SECTION*)m_lock);
+#else
+		pthread_mutex_unlock ((pthread_mutex_t*)m_lock);
+#endif
+	}
+
+	SmallObjectPool::ThreadCache* SmallObjectPool::getThreadCache () const
+	{
+		if (!m_cached)
+			return NULL;
+#if defined(_WIN32)
+		return (ThreadCache*)FlsGetValue ((DWORD)m_cacheSlot);
+#else
+		return (ThreadCache*)pthread_getspecific ((pthread_key_t)m_cacheSlot);
+#endif
+	}
+
+	bool SmallObjectPool::setThreadCache (ThreadCache *cache)
+	{
+#if defined(_WIN32)
+		return !!FlsSetValue ((DWORD)m_cacheSlot,cache);
+#else
+		return pthread_setspecific ((pthread_key_t)m_cacheSlot,cache) == 0;
+#endif
+	}
+}